@@ -72,6 +72,17 @@
 #define VDAC       (3.3)
 #define MAX_GAIN   (20.0 * log10(VPA / VDAC))
 
+#define VOLUME_LEVEL_NUM (101)
+
+/*
+ * Register values of all user volume levels are calculated once when initialized,
+ * so that volume setting only looks up the table
+ */
+typedef struct {
+    codec_dac_volume_config_t config;  /* Keep as first member so that handle can be used as configuration */
+    uint8_t                   reg_table[VOLUME_LEVEL_NUM];
+} codec_dac_volume_t;
+
 /*
  * User can customize the volume setting by modifying the mapping table and adjust the volume step according to
  * the speaker playback system, and the other volume levels shift the value accordingly.
@@ -114,14 +125,41 @@ static inline uint8_t audio_codec_calculate_reg(volume_handle_t vol_handle, floa
     return reg;
 }
 
+static uint8_t audio_codec_calc_volume_reg(volume_handle_t vol_handle, int user_volume)
+{
+    float dac_volume = 0;
+    codec_dac_volume_config_t *handle = (codec_dac_volume_config_t *) vol_handle;
+    if (user_volume == 0) {
+        dac_volume = handle->min_dac_volume; // Make sure the speaker voice is near silent
+    } else {
+        /*
+         * For better audio performance, at the max volume, we need to ensure:
+         * Audio Process Gain + Codec DAC Volume + PA Gain <= MAX_GAIN.
+         * The PA Gain and Audio Process Gain are known when the board design is fixed, so
+         * max Codec DAC Volume = MAX_GAIN - PA Gain - Audio Process Gain，then
+         * the volume mapping table shift accordingly.
+         */
+        dac_volume = handle->offset_conv_volume(user_volume) + MAX_GAIN - handle->board_pa_gain;
+        dac_volume = dac_volume < handle->max_dac_volume ? dac_volume : handle->max_dac_volume;
+    }
+    return audio_codec_calculate_reg(handle, dac_volume);
+}
+
 volume_handle_t audio_codec_volume_init(codec_dac_volume_config_t *config)
 {
-    codec_dac_volume_config_t *handle = (codec_dac_volume_config_t *) audio_calloc(1, sizeof(codec_dac_volume_config_t));
+    codec_dac_volume_t *vol = (codec_dac_volume_t *) audio_calloc(1, sizeof(codec_dac_volume_t));
+    if (vol == NULL) {
+        return NULL;
+    }
+    codec_dac_volume_config_t *handle = &vol->config;
     memcpy(handle, config, sizeof(codec_dac_volume_config_t));
     if (!handle->offset_conv_volume) {
         handle->offset_conv_volume = codec_get_dac_volume_offset;
     }
-    return (volume_handle_t) handle;
+    for (int i = 0; i < VOLUME_LEVEL_NUM; i++) {
+        vol->reg_table[i] = audio_codec_calc_volume_reg(handle, i);
+    }
+    return (volume_handle_t) vol;
 }
 
 /**
@@ -136,9 +174,9 @@ float audio_codec_cal_dac_volume(volume_handle_t vol_handle)
 
 uint8_t audio_codec_get_dac_reg_value(volume_handle_t vol_handle, int volume)
 {
-    float dac_volume = 0;
     int user_volume = volume;
-    codec_dac_volume_config_t *handle = (codec_dac_volume_config_t *) vol_handle;
+    codec_dac_volume_t *vol = (codec_dac_volume_t *) vol_handle;
+    codec_dac_volume_config_t *handle = &vol->config;
 
     if (user_volume < 0) {
         user_volume = 0;
@@ -146,20 +184,7 @@ uint8_t audio_codec_get_dac_reg_value(volume_handle_t vol_handle, int volume)
         user_volume = 100;
     }
 
-    if (user_volume == 0) {
-        dac_volume = handle->min_dac_volume; // Make sure the speaker voice is near silent
-    } else {
-        /*
-         * For better audio performance, at the max volume, we need to ensure:
-         * Audio Process Gain + Codec DAC Volume + PA Gain <= MAX_GAIN.
-         * The PA Gain and Audio Process Gain are known when the board design is fixed, so
-         * max Codec DAC Volume = MAX_GAIN - PA Gain - Audio Process Gain，then
-         * the volume mapping table shift accordingly.
-         */
-        dac_volume = handle->offset_conv_volume(user_volume) + MAX_GAIN - handle->board_pa_gain;
-        dac_volume = dac_volume < handle->max_dac_volume ? dac_volume : handle->max_dac_volume;
-    }
-    handle->reg_value = audio_codec_calculate_reg(handle, dac_volume);
+    handle->reg_value = vol->reg_table[user_volume];
     handle->user_volume = user_volume;
     return handle->reg_value;
 }
@@ -56,14 +56,19 @@ typedef struct {
 /**
  * @brief Init the audio dac volume by config
  *
+ * @note Register values of volume 0-100 are calculated here by `offset_conv_volume`,
+ *       so the configuration is not used to calculate register again after init
+ *
  * @param config Codec dac volume config
  *
- * @return volume_handle_t
+ * @return
+ *     - NULL: No memory
+ *     - Others: Volume handle
  */
 volume_handle_t audio_codec_volume_init(codec_dac_volume_config_t *config);
 
 /**
- * @brief Calculate codec register value by a linear formula
+ * @brief Get codec register value of user volume from the table built in init
  *
  * @param vol_handle The dac volume handle
  * @param volume User set volume (0-100)
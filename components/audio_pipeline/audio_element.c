@@ -834,6 +834,14 @@ esp_err_t audio_element_set_input_timeout(audio_element_handle_t el, TickType_t
     return ESP_FAIL;
 }
 
+TickType_t audio_element_get_input_timeout(audio_element_handle_t el)
+{
+    if (el) {
+        return el->input_wait_time;
+    }
+    return 0;
+}
+
 esp_err_t audio_element_set_output_timeout(audio_element_handle_t el, TickType_t timeout)
 {
     if (el) {
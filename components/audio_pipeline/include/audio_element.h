@@ -594,6 +594,15 @@ esp_err_t audio_element_report_pos(audio_element_handle_t el);
  */
 esp_err_t audio_element_set_input_timeout(audio_element_handle_t el, TickType_t timeout);
 
+/**
+ * @brief      Get input read timeout.
+ *
+ * @param[in]  el       The audio element handle
+ *
+ * @return     The input read timeout, 0 if `el` is NULL
+ */
+TickType_t audio_element_get_input_timeout(audio_element_handle_t el);
+
 /**
  * @brief      Set output read timeout (default is `portMAX_DELAY`).
  *
@@ -36,6 +36,7 @@
 
 #include "audio_error.h"
 #include "audio_mem.h"
+#include "audio_mutex.h"
 #include "audio_recorder.h"
 #include "audio_sys.h"
 #include "audio_thread.h"
@@ -75,16 +76,31 @@ typedef struct __recorder_message {
         RECORDER_CMD_WWE_CTRL,
         RECORDER_CMD_MN_CTRL,
         RECORDER_CMD_MN_DECT,
+        RECORDER_CMD_ENCODER_CTRL,
         RECORDER_CMD_DESTROY,
     } id;
     void *data;
     int  data_len;
 } recorder_msg_t;
 
+typedef struct __audio_recorder audio_recorder_t;
+
+/**
+ * @brief Encoder fed by the recorder, with its read position in the shared fan-out buffer
+ */
+typedef struct {
+    void                      *handle;
+    recorder_encoder_iface_t  *iface;
+    bool                      enabled;
+    bool                      running;
+    uint64_t                  pos;
+    audio_recorder_t          *recorder;
+} recorder_encoder_slot_t;
+
 /**
  * @brief Container of recorder
  */
-typedef struct __audio_recorder {
+struct __audio_recorder {
     rec_event_cb_t            event_cb;
     void                      *user_data;
     recorder_data_read_t      read;
@@ -94,8 +110,16 @@ typedef struct __audio_recorder {
     int                       vad_start;
     int                       vad_off;
     int                       wakeup_end;
-    void                      *encoder_handle;
-    recorder_encoder_iface_t  *encoder_iface;
+    int                       preroll_ms;
+    int                       sr_bytes_per_ms;
+    uint64_t                  wakeup_pos;
+    recorder_encoder_slot_t   encoders[AUDIO_REC_ENCODER_MAX];
+    int                       encoder_num;
+    char                      *fanout_buf;
+    uint64_t                  fanout_wr;
+    uint64_t                  fanout_tail;
+    void                      *fanout_lock;
+    void                      *fanout_pull_lock;
     audio_thread_t            task_handle;
     EventGroupHandle_t        sync_evt;
     QueueHandle_t             cmd_queue;
@@ -103,7 +127,7 @@ typedef struct __audio_recorder {
     bool                      vad_check;
     esp_timer_handle_t        vad_timer;
     audio_recorder_state_t    state;
-} audio_recorder_t;
+};
 
 static void audio_recorder_reset(audio_recorder_t *recorder);
 
@@ -188,6 +212,23 @@ static void audio_recorder_vad_timer_expired(void *arg)
     audio_recorder_notify_events(recorder, RECORDER_EVENT_VAD_TIMER_EXPIRED);
 }
 
+static void audio_recorder_mark_wakeup(audio_recorder_t *recorder)
+{
+    int buffered = 0;
+    if (recorder->preroll_ms > 0 && recorder->sr_handle && recorder->sr_iface->get_position) {
+        recorder->sr_iface->get_position(recorder->sr_handle, &recorder->wakeup_pos, &buffered);
+    }
+}
+
+static void audio_recorder_preroll(audio_recorder_t *recorder)
+{
+    if (recorder->preroll_ms > 0 && recorder->sr_handle && recorder->sr_iface->seek) {
+        uint64_t preroll = (uint64_t)recorder->preroll_ms * recorder->sr_bytes_per_ms;
+        uint64_t start = recorder->wakeup_pos > preroll ? recorder->wakeup_pos - preroll : 0;
+        recorder->sr_iface->seek(recorder->sr_handle, start);
+    }
+}
+
 static esp_err_t audio_recorder_afe_monitor(recorder_sr_result_t result, void *user_ctx)
 {
     AUDIO_NULL_CHECK(TAG, user_ctx, return ESP_FAIL);
@@ -199,6 +240,8 @@ static esp_err_t audio_recorder_afe_monitor(recorder_sr_result_t result, void *u
             audio_recorder_notify_events(recorder, RECORDER_EVENT_NOISE_DECT);
             break;
         case SR_RESULT_WAKEUP:
+            /* Called from the fetch task before the output of the detecting frame, so the position is exact */
+            audio_recorder_mark_wakeup(recorder);
             audio_recorder_notify_events(recorder, RECORDER_EVENT_WWE_DECT);
             break;
         case SR_RESULT_SPEECH:
@@ -222,12 +265,43 @@ static esp_err_t audio_recorder_mn_monitor(recorder_sr_result_t result, void *us
     }
 }
 
-static esp_err_t audio_recorder_encoder_enable(audio_recorder_t *recorder, bool enable)
+static uint64_t audio_recorder_fanout_pos(audio_recorder_t *recorder)
 {
-    if (recorder->encoder_handle) {
-        return recorder->encoder_iface->base.enable(recorder->encoder_handle, enable);
+    uint64_t pos = 0;
+    if (recorder->fanout_buf) {
+        mutex_lock(recorder->fanout_lock);
+        pos = recorder->fanout_wr;
+        mutex_unlock(recorder->fanout_lock);
     }
-    return ESP_OK;
+    return pos;
+}
+
+static esp_err_t audio_recorder_encoder_slot_run(audio_recorder_t *recorder, recorder_encoder_slot_t *slot, bool run, uint64_t pos)
+{
+    if (slot->running == run) {
+        return ESP_OK;
+    }
+    if (run) {
+        slot->pos = pos;
+    }
+    slot->running = run;
+    return slot->iface->base.enable(slot->handle, run);
+}
+
+static esp_err_t audio_recorder_encoders_run(audio_recorder_t *recorder, bool enable)
+{
+    esp_err_t ret = ESP_OK;
+    uint64_t pos = 0;
+    if (enable) {
+        audio_recorder_preroll(recorder);
+        /* Taken once before any encoder runs, the first one starts pulling and moves `fanout_wr` right away */
+        pos = audio_recorder_fanout_pos(recorder);
+    }
+    for (int i = 0; i < recorder->encoder_num; i++) {
+        recorder_encoder_slot_t *slot = &recorder->encoders[i];
+        ret |= audio_recorder_encoder_slot_run(recorder, slot, enable && slot->enabled, pos);
+    }
+    return ret == ESP_OK ? ESP_OK : ESP_FAIL;
 }
 
 static void audio_recorder_update_state(audio_recorder_t *recorder, int event)
@@ -258,8 +332,8 @@ static void audio_recorder_update_state(audio_recorder_t *recorder, int event)
                 } else {
                     recorder->state = RECORDER_ST_SPEECHING;
                     audio_recorder_update_state_2_user(recorder, AUDIO_REC_WAKEUP_START);
+                    audio_recorder_encoders_run(recorder, true);
                     audio_recorder_update_state_2_user(recorder, AUDIO_REC_VAD_START);
-                    audio_recorder_encoder_enable(recorder, true);
                 }
             }
             break;
@@ -271,8 +345,8 @@ static void audio_recorder_update_state(audio_recorder_t *recorder, int event)
                     audio_recorder_vad_timer_start(recorder, recorder->state);
                 } else {
                     recorder->state = RECORDER_ST_SPEECHING;
+                    audio_recorder_encoders_run(recorder, true);
                     audio_recorder_update_state_2_user(recorder, AUDIO_REC_VAD_START);
-                    audio_recorder_encoder_enable(recorder, true);
                 }
             } else if (event == RECORDER_EVENT_WAKEUP_TIMER_EXPIRED) {
                 recorder->state = RECORDER_ST_IDLE;
@@ -287,8 +361,8 @@ static void audio_recorder_update_state(audio_recorder_t *recorder, int event)
             } else if (event == RECORDER_EVENT_VAD_TIMER_EXPIRED) {
                 recorder->state = RECORDER_ST_SPEECHING;
                 esp_timer_stop(recorder->wakeup_timer);
+                audio_recorder_encoders_run(recorder, true);
                 audio_recorder_update_state_2_user(recorder, AUDIO_REC_VAD_START);
-                audio_recorder_encoder_enable(recorder, true);
             } else if (event == RECORDER_EVENT_WAKEUP_TIMER_EXPIRED) {
                 recorder->state = RECORDER_ST_IDLE;
                 esp_timer_stop(recorder->vad_timer);
@@ -305,7 +379,7 @@ static void audio_recorder_update_state(audio_recorder_t *recorder, int event)
                     recorder->state = RECORDER_ST_WAIT_FOR_SLEEP;
                     audio_recorder_wakeup_timer_start(recorder, recorder->state);
                     audio_recorder_update_state_2_user(recorder, AUDIO_REC_VAD_END);
-                    audio_recorder_encoder_enable(recorder, false);
+                    audio_recorder_encoders_run(recorder, false);
                 }
             }
             break;
@@ -318,7 +392,7 @@ static void audio_recorder_update_state(audio_recorder_t *recorder, int event)
                 recorder->state = RECORDER_ST_WAIT_FOR_SLEEP;
                 audio_recorder_wakeup_timer_start(recorder, recorder->state);
                 audio_recorder_update_state_2_user(recorder, AUDIO_REC_VAD_END);
-                audio_recorder_encoder_enable(recorder, false);
+                audio_recorder_encoders_run(recorder, false);
             }
             break;
         }
@@ -342,7 +416,7 @@ static void audio_recorder_reset(audio_recorder_t *recorder)
 {
     esp_timer_stop(recorder->wakeup_timer);
     esp_timer_stop(recorder->vad_timer);
-    audio_recorder_encoder_enable(recorder, false);
+    audio_recorder_encoders_run(recorder, false);
     recorder->state = RECORDER_ST_IDLE;
 }
 
@@ -366,6 +440,7 @@ static void audio_recorder_task(void *parameters)
                     if (sr_st.afe_state == SUSPENDED) {
                         recorder->sr_iface->afe_suspend(recorder->sr_handle, false);
                     }
+                    audio_recorder_mark_wakeup(recorder);
                 }
                 audio_recorder_update_state(recorder, RECORDER_EVENT_WWE_DECT);
                 break;
@@ -374,7 +449,7 @@ static void audio_recorder_task(void *parameters)
                 ESP_LOGI(TAG, "RECORDER_CMD_TRIGGER_STOP [state %d]", recorder->state);
                 if ((recorder->state >= RECORDER_ST_SPEECHING) && (recorder->state <= RECORDER_ST_WAIT_FOR_SILENCE)) {
                     recorder->event_cb(AUDIO_REC_VAD_END, recorder->user_data);
-                    audio_recorder_encoder_enable(recorder, false);
+                    audio_recorder_encoders_run(recorder, false);
                 }
                 if (recorder->state != RECORDER_ST_IDLE) {
                     recorder->event_cb(AUDIO_REC_WAKEUP_END, recorder->user_data);
@@ -414,6 +489,14 @@ static void audio_recorder_task(void *parameters)
             case RECORDER_CMD_MN_DECT:
                 audio_recorder_update_state_2_user(recorder, (int)msg.data);
                 break;
+            case RECORDER_CMD_ENCODER_CTRL: {
+                recorder_encoder_slot_t *slot = &recorder->encoders[(int)msg.data];
+                slot->enabled = msg.data_len;
+                bool speeching = recorder->state == RECORDER_ST_SPEECHING || recorder->state == RECORDER_ST_WAIT_FOR_SILENCE;
+                /* Joins the others from the newest data, the older one belongs to them */
+                audio_recorder_encoder_slot_run(recorder, slot, slot->enabled && speeching, audio_recorder_fanout_pos(recorder));
+                break;
+            }
             default:
                 break;
         }
@@ -437,6 +520,64 @@ static int audio_recorder_read_from_sr(void *buffer, int buf_sz, void *user_ctx,
     return ret;
 }
 
+static int audio_recorder_read_source(audio_recorder_t *recorder, void *buffer, int buf_sz, TickType_t ticks)
+{
+    if (recorder->sr_handle) {
+        return audio_recorder_read_from_sr(buffer, buf_sz, recorder, ticks);
+    }
+    return recorder->read(buffer, buf_sz, NULL, ticks);
+}
+
+/*
+ * Read callback of the encoders when there are more than one: the data is read once from SR (or the user read callback)
+ * into `fanout_buf`, and every encoder copies it straight into its own input buffer from its own position.
+ * The encoder which runs out of data pulls the next chunk, a lagging encoder loses its oldest data when it is overwritten.
+ */
+static int audio_recorder_fanout_read(void *buffer, int buf_sz, void *user_ctx, TickType_t ticks)
+{
+    recorder_encoder_slot_t *slot = (recorder_encoder_slot_t *)user_ctx;
+    audio_recorder_t *recorder = slot->recorder;
+    int ret = 0;
+
+    mutex_lock(recorder->fanout_lock);
+    if (recorder->fanout_wr == slot->pos) {
+        mutex_unlock(recorder->fanout_lock);
+        mutex_lock(recorder->fanout_pull_lock);
+        mutex_lock(recorder->fanout_lock);
+        if (recorder->fanout_wr == slot->pos) {
+            int off = recorder->fanout_wr % AUDIO_REC_FANOUT_BUF_SZ;
+            int len = AUDIO_REC_FANOUT_BUF_SZ - off < buf_sz ? AUDIO_REC_FANOUT_BUF_SZ - off : buf_sz;
+            /* Invalidate the area about to be written before releasing the lock */
+            if (recorder->fanout_wr + len > recorder->fanout_tail + AUDIO_REC_FANOUT_BUF_SZ) {
+                recorder->fanout_tail = recorder->fanout_wr + len - AUDIO_REC_FANOUT_BUF_SZ;
+            }
+            mutex_unlock(recorder->fanout_lock);
+            ret = audio_recorder_read_source(recorder, recorder->fanout_buf + off, len, ticks);
+            mutex_lock(recorder->fanout_lock);
+            if (ret > 0) {
+                recorder->fanout_wr += ret;
+            }
+        }
+        mutex_unlock(recorder->fanout_pull_lock);
+    }
+    if (slot->pos < recorder->fanout_tail) {
+        ESP_LOGW(TAG, "Encoder %d is too slow, %d bytes lost", (int)(slot - recorder->encoders), (int)(recorder->fanout_tail - slot->pos));
+        slot->pos = recorder->fanout_tail;
+    }
+    int len = recorder->fanout_wr - slot->pos;
+    if (len > 0) {
+        len = len < buf_sz ? len : buf_sz;
+        int off = slot->pos % AUDIO_REC_FANOUT_BUF_SZ;
+        int first = AUDIO_REC_FANOUT_BUF_SZ - off < len ? AUDIO_REC_FANOUT_BUF_SZ - off : len;
+        memcpy(buffer, recorder->fanout_buf + off, first);
+        memcpy((char *)buffer + first, recorder->fanout_buf, len - first);
+        slot->pos += len;
+        ret = len;
+    }
+    mutex_unlock(recorder->fanout_lock);
+    return ret;
+}
+
 static void audio_recorder_free(audio_recorder_t *recorder)
 {
     AUDIO_NULL_CHECK(TAG, recorder, return;);
@@ -453,6 +594,13 @@ static void audio_recorder_free(audio_recorder_t *recorder)
     if (recorder->sync_evt) {
         vEventGroupDelete(recorder->sync_evt);
     }
+    if (recorder->fanout_lock) {
+        mutex_destroy(recorder->fanout_lock);
+    }
+    if (recorder->fanout_pull_lock) {
+        mutex_destroy(recorder->fanout_pull_lock);
+    }
+    audio_free(recorder->fanout_buf);
     free(recorder);
 }
 
@@ -475,8 +623,22 @@ audio_rec_handle_t audio_recorder_create(audio_rec_cfg_t *config)
     recorder->vad_start      = config->vad_start;
     recorder->vad_off        = config->vad_off;
     recorder->wakeup_end     = config->wakeup_end;
-    recorder->encoder_handle = config->encoder_handle;
-    recorder->encoder_iface  = config->encoder_iface;
+    recorder->preroll_ms     = config->preroll_ms;
+    if (config->encoder_handle) {
+        recorder->encoders[recorder->encoder_num].handle = config->encoder_handle;
+        recorder->encoders[recorder->encoder_num].iface = config->encoder_iface;
+        recorder->encoders[recorder->encoder_num].enabled = true;
+        recorder->encoder_num++;
+    }
+    for (int i = 0; i < config->encoder_num; i++) {
+        AUDIO_CHECK(TAG, recorder->encoder_num < AUDIO_REC_ENCODER_MAX, goto _failed, "Too many encoders");
+        AUDIO_NULL_CHECK(TAG, config->encoders[i].handle, goto _failed);
+        AUDIO_NULL_CHECK(TAG, config->encoders[i].iface, goto _failed);
+        recorder->encoders[recorder->encoder_num].handle = config->encoders[i].handle;
+        recorder->encoders[recorder->encoder_num].iface = config->encoders[i].iface;
+        recorder->encoders[recorder->encoder_num].enabled = !config->encoders[i].disabled;
+        recorder->encoder_num++;
+    }
 
     recorder->vad_check = true;
     recorder->sync_evt = xEventGroupCreate();
@@ -503,6 +665,17 @@ audio_rec_handle_t audio_recorder_create(audio_rec_cfg_t *config)
     if (recorder->sr_handle) {
         recorder_sr_iface_t *sr_iface = recorder->sr_iface;
         AUDIO_NULL_CHECK(TAG, sr_iface, goto _failed);
+        if (recorder->preroll_ms > 0) {
+            int rate = 0, bits = 0, channels = 0;
+            if (sr_iface->get_position && sr_iface->seek && sr_iface->get_output_info
+                && sr_iface->get_output_info(recorder->sr_handle, &rate, &bits, &channels) == ESP_OK) {
+                recorder->sr_bytes_per_ms = rate * (bits >> 3) * channels / 1000;
+            }
+            if (recorder->sr_bytes_per_ms <= 0) {
+                ESP_LOGW(TAG, "The SR interface can't seek its output, pre-roll is disabled");
+                recorder->preroll_ms = 0;
+            }
+        }
 
         sr_iface->set_afe_monitor(recorder->sr_handle, audio_recorder_afe_monitor, recorder);
         sr_iface->set_mn_monitor(recorder->sr_handle, audio_recorder_mn_monitor, recorder);
@@ -510,13 +683,24 @@ audio_rec_handle_t audio_recorder_create(audio_rec_cfg_t *config)
         sr_iface->base.enable(recorder->sr_handle, true);
     }
 
-    if (recorder->encoder_handle) {
-        recorder_encoder_iface_t *encoder_iface = recorder->encoder_iface;
+    if (recorder->encoder_num > 1) {
+        recorder->fanout_buf = audio_calloc(1, AUDIO_REC_FANOUT_BUF_SZ);
+        AUDIO_NULL_CHECK(TAG, recorder->fanout_buf, goto _failed);
+        recorder->fanout_lock = mutex_create();
+        AUDIO_NULL_CHECK(TAG, recorder->fanout_lock, goto _failed);
+        recorder->fanout_pull_lock = mutex_create();
+        AUDIO_NULL_CHECK(TAG, recorder->fanout_pull_lock, goto _failed);
+        for (int i = 0; i < recorder->encoder_num; i++) {
+            recorder->encoders[i].recorder = recorder;
+            recorder->encoders[i].iface->base.set_read_cb(recorder->encoders[i].handle, audio_recorder_fanout_read, &recorder->encoders[i]);
+        }
+    } else if (recorder->encoder_num == 1) {
+        recorder_encoder_iface_t *encoder_iface = recorder->encoders[0].iface;
 
         if (recorder->sr_handle) {
-            encoder_iface->base.set_read_cb(recorder->encoder_handle, audio_recorder_read_from_sr, recorder);
+            encoder_iface->base.set_read_cb(recorder->encoders[0].handle, audio_recorder_read_from_sr, recorder);
         } else {
-            encoder_iface->base.set_read_cb(recorder->encoder_handle, recorder->read, NULL);
+            encoder_iface->base.set_read_cb(recorder->encoders[0].handle, recorder->read, NULL);
         }
     }
 
@@ -657,9 +841,9 @@ int audio_recorder_data_read(audio_rec_handle_t handle, void *buffer, int length
         ESP_LOGW(TAG, "Not in speeching, return 0");
         return 0;
     }
-    if (recorder->encoder_handle) {
-        subproc = &recorder->encoder_iface->base;
-        ret = subproc->fetch(recorder->encoder_handle, buffer, length, ticks);
+    if (recorder->encoder_num) {
+        subproc = &recorder->encoders[0].iface->base;
+        ret = subproc->fetch(recorder->encoders[0].handle, buffer, length, ticks);
     } else if (recorder->sr_handle) {
         subproc = &recorder->sr_iface->base;
         ret = subproc->fetch(recorder->sr_handle, buffer, length, ticks);
@@ -670,6 +854,38 @@ int audio_recorder_data_read(audio_rec_handle_t handle, void *buffer, int length
     return ret;
 }
 
+int audio_recorder_encoder_data_read(audio_rec_handle_t handle, int index, void *buffer, int length, TickType_t ticks)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_ERR_INVALID_ARG);
+    audio_recorder_t *recorder = (audio_recorder_t *)handle;
+    AUDIO_CHECK(TAG, index >= 0 && index < recorder->encoder_num, return ESP_ERR_INVALID_ARG, "Invalid encoder index");
+    if (recorder->state != RECORDER_ST_SPEECHING && recorder->state != RECORDER_ST_WAIT_FOR_SILENCE) {
+        ESP_LOGW(TAG, "Not in speeching, return 0");
+        return 0;
+    }
+    recorder_encoder_slot_t *slot = &recorder->encoders[index];
+    return slot->iface->base.fetch(slot->handle, buffer, length, ticks);
+}
+
+esp_err_t audio_recorder_encoder_enable(audio_rec_handle_t handle, int index, bool enable)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    audio_recorder_t *recorder = (audio_recorder_t *)handle;
+    AUDIO_CHECK(TAG, index >= 0 && index < recorder->encoder_num, return ESP_FAIL, "Invalid encoder index");
+
+    recorder_msg_t msg = {
+        .id = RECORDER_CMD_ENCODER_CTRL,
+        .data = (void *)index,
+        .data_len = enable,
+    };
+    if (xQueueSend(recorder->cmd_queue, &msg, portMAX_DELAY) != pdTRUE) {
+        ESP_LOGE(TAG, "The recorder encoder ctrl failed");
+        return ESP_FAIL;
+    } else {
+        return ESP_OK;
+    }
+}
+
 bool audio_recorder_get_wakeup_state(audio_rec_handle_t handle)
 {
     AUDIO_NULL_CHECK(TAG, handle, return false);
@@ -40,6 +40,10 @@ extern "C" {
 #define AUDIO_REC_DEF_WAKEEND_TM      (900)   /*!< Duration after vad off (ms) */
 #define AUDIO_REC_VAD_START_SPEECH_MS (160)   /*!< Consecutive speech frame will be judged to vad start (ms) */
 #define AUDIO_REC_DEF_VAD_OFF_TM      (300)   /*!< Default vad off time (ms) */
+#define AUDIO_REC_DEF_PREROLL_TM      (0)     /*!< Default pre-roll before the wake up point (ms), 0 to disable */
+
+#define AUDIO_REC_ENCODER_MAX         (4)         /*!< Maximum number of encoders, including `encoder_handle` */
+#define AUDIO_REC_FANOUT_BUF_SZ       (8 * 1024)  /*!< Size of the buffer shared by the encoders */
 
 /**
  * @brief Recorder event
@@ -58,6 +62,15 @@ typedef enum {
  */
 typedef esp_err_t (*rec_event_cb_t)(audio_rec_evt_t event, void *user_data);
 
+/**
+ * @brief Additional encoder of audio recorder
+ */
+typedef struct {
+    void                      *handle;         /*!< Encoder handle */
+    recorder_encoder_iface_t  *iface;          /*!< Encoder interface */
+    bool                      disabled;        /*!< Don't start the encoder when speech starts, see `audio_recorder_encoder_enable` */
+} audio_rec_encoder_t;
+
 /**
  * @brief Audio recorder configuration
  */
@@ -74,8 +87,13 @@ typedef struct {
     int                       vad_start;       /*!< Unit:ms. Consecutive speech frame will be judged to vad start*/
     int                       vad_off;         /*!< Unit:ms. When the silence time exceeds this value, it is determined as AUDIO_REC_VAD_END state */
     int                       wakeup_end;      /*!< Unit:ms. When the silence time after AUDIO_REC_VAD_END state exceeds this value, it is determined as AUDIO_REC_WAKEUP_END */
+    int                       preroll_ms;      /*!< Unit:ms. The recorded data starts this long before the wake up point instead of the oldest data buffered by SR.
+                                                    The SR `rb_size` must hold the pre-roll plus the audio up to VAD start. 0 to disable.
+                                                    It needs `get_position`, `seek` and `get_output_info` of `sr_iface`, disabled without them */
     void                      *encoder_handle; /*!< Encoder handle */
     recorder_encoder_iface_t  *encoder_iface;  /*!< Encoder interface */
+    audio_rec_encoder_t       *encoders;       /*!< Additional encoders fed with the same data as `encoder_handle`, each one can have its own resample and format (optional) */
+    int                       encoder_num;     /*!< Number of `encoders`, up to AUDIO_REC_ENCODER_MAX - 1 */
 } audio_rec_cfg_t;
 
 /**
@@ -97,8 +115,11 @@ typedef struct __audio_recorder *audio_rec_handle_t;
         .vad_start      = AUDIO_REC_VAD_START_SPEECH_MS, \
         .vad_off        = AUDIO_REC_DEF_VAD_OFF_TM,      \
         .wakeup_end     = AUDIO_REC_DEF_WAKEEND_TM,      \
+        .preroll_ms     = AUDIO_REC_DEF_PREROLL_TM,      \
         .encoder_handle = NULL,                          \
         .encoder_iface  = NULL,                          \
+        .encoders       = NULL,                          \
+        .encoder_num    = 0,                             \
     }
 
 /**
@@ -188,6 +209,38 @@ esp_err_t audio_recorder_vad_check_enable(audio_rec_handle_t handle, bool enable
  */
 int audio_recorder_data_read(audio_rec_handle_t handle, void *buffer, int length, TickType_t ticks);
 
+/**
+ * @brief Read the output of one of the encoders
+ *
+ * @note Index 0 is the `encoder_handle` (or the first of `encoders` if it is not set), reading index 0 is the same as `audio_recorder_data_read`
+ *
+ * @param handle  Audio recorder handle
+ * @param index   Index of the encoder
+ * @param buffer  Buffer to save data
+ * @param length  Size of buffer
+ * @param ticks   Timeout for reading
+ *
+ * @return Length of data actually read
+ *         ESP_ERR_INVALID_ARG
+ */
+int audio_recorder_encoder_data_read(audio_rec_handle_t handle, int index, void *buffer, int length, TickType_t ticks);
+
+/**
+ * @brief Enable or disable one of the encoders, the others are not affected
+ *
+ * @note A disabled encoder is stopped and not started again when speech starts.
+ *       Enabling an encoder during speech starts it immediately from the current data.
+ *
+ * @param handle  Audio recorder handle
+ * @param index   Index of the encoder
+ * @param enable  true: enable the encoder
+ *                false: disable the encoder
+ *
+ * @return ESP_OK
+ *         ESP_FAIL
+ */
+esp_err_t audio_recorder_encoder_enable(audio_rec_handle_t handle, int index, bool enable);
+
 /**
  * @brief Destroy audio recorder and recycle all resource
  *
@@ -126,6 +126,58 @@ __attribute__((always_inline)) inline esp_err_t ch_sort_16bit_4ch(int16_t *i_buf
     return ESP_OK;
 }
 
+/**
+ * @brief Sort the given 2 channels i2s data in place with `src_order`, same result as `ch_sort_16bit_2ch` without the second buffer.
+ *
+ * @param buf           data buffer, 4 bytes aligned
+ * @param len           length of `buf`
+ * @param src_order     order of the channels
+ * @return ESP_OK
+ */
+__attribute__((always_inline)) inline esp_err_t ch_sort_16bit_2ch_inplace(int16_t *buf, size_t len, int8_t *src_order)
+{
+    if (src_order[0] == DAT_CH_0 && src_order[1] == DAT_CH_1) {
+        return ESP_OK;
+    }
+    uint32_t *frame = (uint32_t *)buf;
+    for (int i = 0; i < (len >> 2); i++) {
+        frame[i] = (frame[i] >> 16) | (frame[i] << 16);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Sort the given 4 channels i2s data in place with `src_order`, same result as `ch_sort_16bit_4ch` without the second buffer.
+ *        The output is packed to 3 channels at the beginning of `buf`, its length is `len * 3 / 4`.
+ *
+ * @param buf           data buffer
+ * @param len           length of `buf`
+ * @param src_order     order of the channels
+ * @return ESP_OK
+ *         ESP_ERR_INVALID_ARG
+ */
+__attribute__((always_inline)) inline esp_err_t ch_sort_16bit_4ch_inplace(int16_t *buf, size_t len, int8_t *src_order)
+{
+    int8_t ch0_idx = ch_get_idx(src_order, 4, DAT_CH_0);
+    int8_t ch1_idx = ch_get_idx(src_order, 4, DAT_CH_1);
+    int8_t ref_idx = ch_get_idx(src_order, 4, DAT_CH_2);
+
+    if (ch0_idx == -1 || ch1_idx == -1 || ref_idx == -1) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    /* Frame `i` is written to [3i, 3i + 2], which never passes the frames not read yet */
+    for (int i = 0; i < (len >> 3); i++) {
+        int16_t *in = &buf[i << 2];
+        int16_t ch0 = in[ch0_idx];
+        int16_t ch1 = in[ch1_idx];
+        int16_t ref = in[ref_idx];
+        buf[3 * i + 0] = ch0;
+        buf[3 * i + 1] = ch1;
+        buf[3 * i + 2] = ref;
+    }
+    return ESP_OK;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -42,6 +42,14 @@ extern "C" {
 #define FEED_TASK_PINNED_CORE    (1)
 #define FETCH_TASK_PINNED_CORE   (1)
 #define SR_OUTPUT_RB_SIZE        (6 * 1024)
+#define SR_GATE_OPEN_DB          (-50)
+#define SR_GATE_HANGOVER_MS      (3000)
+#define SR_GATE_LOOKBACK_MS      (200)
+#if CONFIG_FREERTOS_UNICORE
+#define SR_MERGE_TASKS           (true)
+#else
+#define SR_MERGE_TASKS           (false)
+#endif
 
 /**
  * @brief SR processor handle
@@ -55,18 +63,33 @@ typedef struct {
     afe_config_t afe_cfg;                               /*!< Configuration of AFE */
     int8_t       input_order[DAT_CH_MAX];               /*!< Channel order of the input data */
     bool         multinet_init;                         /*!< Enable of speech command recognition */
-    int          feed_task_core;                        /*!< Core id of feed task */
+    int          feed_task_core;                        /*!< Core id of feed task, -1 for no affinity */
     int          feed_task_prio;                        /*!< Priority of feed task*/
     int          feed_task_stack;                       /*!< Stack size of feed task */
-    int          fetch_task_core;                       /*!< Core id of fetch task */
+    int          fetch_task_core;                       /*!< Core id of fetch task, -1 for no affinity */
     int          fetch_task_prio;                       /*!< Priority of fetch task */
     int          fetch_task_stack;                      /*!< Stack size of fetch task */
+    bool         merge_tasks;                           /*!< Feed and fetch in one task with the feed task core and priority, saves a task on single core targets */
     int          rb_size;                               /*!< Ringbuffer size of recorder sr */
     char         *partition_label;                      /*!< Partition label which stored the model data */
     char         *mn_language;                          /*!< Command language for multinet to load */
     char         *wn_wakeword;                          /*!< Wake Word for WakeNet to load. This is useful when multiple Wake Words are selected in sdkconfig. Setting this to NULL will use the first found model. */
+    bool         gate_enable;                           /*!< Stop feeding the AFE while the capture is silent, the AFE sleeps until sound is back */
+    int          gate_open_db;                          /*!< Level of the first mic in dBFS above which the AFE is woken up, it is parked again 6 dB below */
+    int          gate_hangover_ms;                      /*!< Silence duration before the AFE is parked */
+    int          gate_lookback_ms;                      /*!< Capture fed to the AFE before the sound which woke it up, up to 16 feed chunks */
 } recorder_sr_cfg_t;
 
+/**
+ * @brief Statistics of the pre-VAD gate, `gated_frames / frames` is the share of the AFE work saved
+ */
+typedef struct {
+    uint32_t     frames;                                /*!< Feed chunks captured */
+    uint32_t     gated_frames;                          /*!< Feed chunks not fed to the AFE */
+    uint32_t     openings;                              /*!< Times the AFE was woken up */
+    bool         parked;                                /*!< The AFE is parked now */
+} recorder_sr_gate_stats_t;
+
 #if CONFIG_AFE_MIC_NUM == (1)
 #define INPUT_ORDER_DEFAULT() { \
         DAT_CH_1,               \
@@ -97,10 +120,15 @@ typedef struct {
     .fetch_task_core  = FETCH_TASK_PINNED_CORE, \
     .fetch_task_prio  = FETCH_TASK_PRIO,        \
     .fetch_task_stack = FETCH_TASK_STACK_SZ,    \
+    .merge_tasks      = SR_MERGE_TASKS,         \
     .rb_size          = SR_OUTPUT_RB_SIZE,      \
     .partition_label  = "model",                \
     .mn_language      = ESP_MN_CHINESE,         \
     .wn_wakeword      = NULL,                   \
+    .gate_enable      = false,                  \
+    .gate_open_db     = SR_GATE_OPEN_DB,        \
+    .gate_hangover_ms = SR_GATE_HANGOVER_MS,    \
+    .gate_lookback_ms = SR_GATE_LOOKBACK_MS,    \
 };
 
 /**
@@ -136,6 +164,17 @@ esp_err_t recorder_sr_destroy(recorder_sr_handle_t handle);
  */
 esp_err_t recorder_sr_reset_speech_cmd(recorder_sr_handle_t handle, char *command_str, char *err_phrase_id);
 
+/**
+ * @brief Get the statistics of the pre-VAD gate
+ *
+ * @param handle        SR processor handle
+ * @param stats         Statistics output
+ *
+ * @return ESP_OK
+ *         ESP_FAIL
+ */
+esp_err_t recorder_sr_get_gate_stats(recorder_sr_handle_t handle, recorder_sr_gate_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -128,6 +128,42 @@ typedef struct {
      *          ESP_ERR_INVALID_ARG
      */
     esp_err_t (*mn_enable)(void *handle, bool enable);
+
+    /**
+     * @brief Get the position of the output data, in bytes since the sr was created
+     *
+     * @param handle    The handle of sr handle
+     * @param written   Position of the newest output data
+     * @param buffered  Length of the output data not fetched yet, the oldest one is at `written - buffered`
+     *
+     * @returns ESP_OK
+     *          ESP_ERR_INVALID_ARG
+     */
+    esp_err_t (*get_position)(void *handle, uint64_t *written, int *buffered);
+
+    /**
+     * @brief Drop the buffered output data older than the given position, so the next fetch starts from it
+     *
+     * @param handle    The handle of sr handle
+     * @param pos       Position got from `get_position`
+     *
+     * @returns ESP_OK
+     *          ESP_ERR_INVALID_ARG
+     */
+    esp_err_t (*seek)(void *handle, uint64_t pos);
+
+    /**
+     * @brief Get the format of the output data
+     *
+     * @param handle       The handle of sr handle
+     * @param sample_rate  Sample rate of the output data
+     * @param bits         Bits per sample of the output data
+     * @param channels     Channels of the output data
+     *
+     * @returns ESP_OK
+     *          ESP_ERR_INVALID_ARG
+     */
+    esp_err_t (*get_output_info)(void *handle, int *sample_rate, int *bits, int *channels);
 } recorder_sr_iface_t;
 
 #ifdef __cplusplus
@@ -22,6 +22,7 @@
  *
  */
 #include <string.h>
+#include <math.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
@@ -33,6 +34,7 @@
 
 #include "audio_error.h"
 #include "audio_mem.h"
+#include "audio_mutex.h"
 #include "audio_thread.h"
 
 #include "ringbuf.h"
@@ -56,16 +58,29 @@
 #define FETCH_TASK_DESTROY (BIT(1))
 #define FEED_TASK_RUNNING  (BIT(2))
 #define FETCH_TASK_RUNNING (BIT(3))
+#define OUT_DATA_READY     (BIT(4))
+
+#define RECORDER_SR_TASK_CORE(core) ((core) < 0 ? tskNO_AFFINITY : (core))
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
 
 static const char *TAG = "RECORDER_SR";
 
 static const esp_afe_sr_iface_t *esp_afe = &ESP_AFE_SR_HANDLE;
 #if CONFIG_AFE_MIC_NUM == (1)
 #define RECORDER_CHANNEL_NUM (2)
+#define AFE_CHANNEL_NUM      (2)
 #else
 #define RECORDER_CHANNEL_NUM (4)
+#define AFE_CHANNEL_NUM      (3)
 #endif
 
+#define SR_GATE_LOOKBACK_MAX   (16)
+#define SR_GATE_HYSTERESIS_DB  (6)
+#define SR_GATE_MIN_ZCR_HZ     (100) /* Below this zero crossing rate the sound is taken as hum */
+#define SR_SAMPLE_RATE         (16000)
+
 #ifdef CONFIG_USE_MULTINET
 static const esp_mn_iface_t *multinet = NULL;
 #endif
@@ -79,6 +94,8 @@ typedef struct __recorder_sr {
     int                   fetch_task_stack;
     ringbuf_handle_t      out_rb;
     int                   rb_size;
+    void                  *out_lock;
+    uint64_t              out_written;
     EventGroupHandle_t    events;
     bool                  feed_running;
     bool                  fetch_running;
@@ -101,6 +118,22 @@ typedef struct __recorder_sr {
 #endif /* CONFIG_USE_MULTINET */
     int8_t                input_order[DAT_CH_MAX];
     char                  *wn_wakeword;
+    bool                  merge_tasks;
+    int16_t               *feed_buf;
+    int                   feed_buf_size;
+    int                   feed_fill;
+    int16_t               *feed_pool[SR_GATE_LOOKBACK_MAX + 1];
+    int                   feed_pool_num;
+    int                   feed_pool_idx;
+    bool                  gate_enable;
+    bool                  gate_parked;
+    int                   gate_history;
+    int                   gate_silent_chunks;
+    int                   gate_hangover_chunks;
+    int64_t               gate_open_level;
+    int64_t               gate_close_level;
+    int                   gate_min_zc;
+    recorder_sr_gate_stats_t gate_stats;
 } recorder_sr_t;
 
 static esp_err_t recorder_sr_output(recorder_sr_t *recorder_sr, void *buffer, int len);
@@ -207,40 +240,121 @@ static esp_err_t recorder_mn_detect(recorder_sr_t *recorder_sr, int16_t *buffer,
 }
 #endif /*CONFIG_USE_MULTINET*/
 
+/*
+ * Pre-VAD gate on the first mic channel of the sorted capture: the mean square level opens the gate,
+ * it closes after `gate_hangover_chunks` below the lower level. Frames with too few zero crossings are hum.
+ * Returns true if the chunk is to be fed to the AFE.
+ */
+static bool recorder_sr_gate(recorder_sr_t *recorder_sr, int16_t *chunk)
+{
+    int samples = recorder_sr->feed_buf_size / (sizeof(int16_t) * RECORDER_CHANNEL_NUM);
+    int64_t energy = 0;
+    int zc = 0;
+    int16_t last = chunk[0];
+    for (int i = 0; i < samples; i++) {
+        int16_t cur = chunk[i * AFE_CHANNEL_NUM];
+        energy += (int32_t)cur * cur;
+        zc += (cur ^ last) < 0;
+        last = cur;
+    }
+    energy /= samples;
+    bool sound = zc >= recorder_sr->gate_min_zc;
+
+    recorder_sr->gate_stats.frames++;
+    if (recorder_sr->gate_parked) {
+        if (sound && energy > recorder_sr->gate_open_level) {
+            recorder_sr->gate_parked = false;
+            recorder_sr->gate_silent_chunks = 0;
+            recorder_sr->gate_stats.openings++;
+            ESP_LOGD(TAG, "Gate open, feed %d chunks of look back", recorder_sr->gate_history);
+            return true;
+        }
+        recorder_sr->gate_stats.gated_frames++;
+        return false;
+    }
+    if (sound && energy > recorder_sr->gate_close_level) {
+        recorder_sr->gate_silent_chunks = 0;
+    } else if (++recorder_sr->gate_silent_chunks >= recorder_sr->gate_hangover_chunks) {
+        ESP_LOGD(TAG, "Gate closed, park the AFE");
+        recorder_sr->gate_parked = true;
+        recorder_sr->gate_history = 0;
+        /* No more AFE results until the gate opens again, report the silence now */
+        if (recorder_sr->vad_enable && recorder_sr->afe_monitor) {
+            recorder_sr->afe_monitor(SR_RESULT_NOISE, recorder_sr->afe_monitor_ctx);
+        }
+    }
+    return true;
+}
+
+/*
+ * Read one chunk into the current pool buffer, sort it in place and feed it to the AFE.
+ * With the gate enabled the pool holds the look-back chunks: a parked chunk only moves the pool index,
+ * and they are all fed when the gate opens, so nothing is copied.
+ * Returns the number of chunks fed.
+ */
+static int recorder_sr_feed(recorder_sr_t *recorder_sr)
+{
+    /* Keep the partial data across calls, a short read only delays the feed */
+    int ret = recorder_sr->read((char *)recorder_sr->feed_buf + recorder_sr->feed_fill, recorder_sr->feed_buf_size - recorder_sr->feed_fill,
+                                recorder_sr->read_ctx, portMAX_DELAY);
+    if (ret <= 0) {
+        return 0;
+    }
+    recorder_sr->feed_fill += ret;
+    if (recorder_sr->feed_fill < recorder_sr->feed_buf_size) {
+        return 0;
+    }
+    recorder_sr->feed_fill = 0;
+#if RECORDER_CHANNEL_NUM == 2
+    ch_sort_16bit_2ch_inplace(recorder_sr->feed_buf, recorder_sr->feed_buf_size, recorder_sr->input_order);
+#else /* RECORDER_CHANNEL_NUM == 2 */
+    ch_sort_16bit_4ch_inplace(recorder_sr->feed_buf, recorder_sr->feed_buf_size, recorder_sr->input_order);
+#endif /* RECORDER_CHANNEL_NUM == 2 */
+    if (!recorder_sr->gate_enable) {
+        esp_afe->feed(recorder_sr->afe_handle, recorder_sr->feed_buf);
+        return 1;
+    }
+
+    int fed = 0;
+    if (recorder_sr_gate(recorder_sr, recorder_sr->feed_buf)) {
+        for (int i = recorder_sr->gate_history; i > 0; i--) {
+            int idx = (recorder_sr->feed_pool_idx + recorder_sr->feed_pool_num - i) % recorder_sr->feed_pool_num;
+            esp_afe->feed(recorder_sr->afe_handle, recorder_sr->feed_pool[idx]);
+            fed++;
+        }
+        recorder_sr->gate_history = 0;
+        esp_afe->feed(recorder_sr->afe_handle, recorder_sr->feed_buf);
+        fed++;
+    } else if (recorder_sr->gate_history < recorder_sr->feed_pool_num - 1) {
+        recorder_sr->gate_history++;
+    }
+    recorder_sr->feed_pool_idx = (recorder_sr->feed_pool_idx + 1) % recorder_sr->feed_pool_num;
+    recorder_sr->feed_buf = recorder_sr->feed_pool[recorder_sr->feed_pool_idx];
+    return fed;
+}
+
+static void recorder_sr_fetch_once(recorder_sr_t *recorder_sr)
+{
+    afe_fetch_result_t *res = esp_afe->fetch(recorder_sr->afe_handle);
+#ifdef CONFIG_USE_MULTINET
+    recorder_mn_detect(recorder_sr, res->data, res->wakeup_state);
+#endif
+    if (recorder_sr->afe_monitor) {
+        recorder_sr->afe_monitor(recorder_sr_afe_result_convert(recorder_sr, res), recorder_sr->afe_monitor_ctx);
+    }
+    recorder_sr_output(recorder_sr, res->data, res->data_size);
+}
+
 static void feed_task(void *parameters)
 {
     recorder_sr_t *recorder_sr = (recorder_sr_t *)parameters;
-    int chunksize = esp_afe->get_feed_chunksize(recorder_sr->afe_handle);
-    int buf_size = chunksize * sizeof(int16_t) * RECORDER_CHANNEL_NUM;
-    int16_t *i_buf = audio_calloc(1, buf_size);
-    assert(i_buf);
-    int16_t *o_buf = audio_calloc(1, buf_size);;
-    assert(o_buf);
-
-    int fill_cnt = 0;
 
     recorder_sr->feed_running = true;
 
     while (recorder_sr->feed_running) {
         xEventGroupWaitBits(recorder_sr->events, FEED_TASK_RUNNING, false, true, portMAX_DELAY);
-
-        int ret = recorder_sr->read((char *)i_buf + fill_cnt, buf_size - fill_cnt, recorder_sr->read_ctx, portMAX_DELAY);
-        fill_cnt += ret;
-        if (fill_cnt == buf_size) {
-#if RECORDER_CHANNEL_NUM == 2
-            ch_sort_16bit_2ch(i_buf, o_buf, fill_cnt, recorder_sr->input_order);
-#else /* RECORDER_CHANNEL_NUM == 2 */
-            ch_sort_16bit_4ch(i_buf, o_buf, fill_cnt, recorder_sr->input_order);
-#endif /* RECORDER_CHANNEL_NUM == 2 */
-            esp_afe->feed(recorder_sr->afe_handle, o_buf);
-            fill_cnt -= buf_size;
-        } else if (fill_cnt > buf_size) {
-            ESP_LOGE(TAG, "fill cnt > buffer_size, there may be memory out of range");
-            recorder_sr->feed_running = false;
-        }
+        recorder_sr_feed(recorder_sr);
     }
-    audio_free(i_buf);
-    audio_free(o_buf);
     xEventGroupClearBits(recorder_sr->events, FEED_TASK_RUNNING);
     xEventGroupSetBits(recorder_sr->events, FEED_TASK_DESTROY);
     vTaskDelete(NULL);
@@ -253,35 +367,127 @@ static void fetch_task(void *parameters)
 
     while (recorder_sr->fetch_running) {
         xEventGroupWaitBits(recorder_sr->events, FETCH_TASK_RUNNING, false, true, portMAX_DELAY);
+        recorder_sr_fetch_once(recorder_sr);
+    }
+    xEventGroupClearBits(recorder_sr->events, FETCH_TASK_RUNNING);
+    xEventGroupSetBits(recorder_sr->events, FETCH_TASK_DESTROY);
+    vTaskDelete(NULL);
+}
 
-        afe_fetch_result_t *res = esp_afe->fetch(recorder_sr->afe_handle);
-#ifdef CONFIG_USE_MULTINET
-        recorder_mn_detect(recorder_sr, res->data, res->wakeup_state);
-#endif
-        if (recorder_sr->afe_monitor) {
-            recorder_sr->afe_monitor(recorder_sr_afe_result_convert(recorder_sr, res), recorder_sr->afe_monitor_ctx);
+/*
+ * Feed and fetch in one task, fetching only when enough samples have been fed to complete a fetch chunk
+ * so the task never blocks inside the AFE.
+ */
+static void feed_fetch_task(void *parameters)
+{
+    recorder_sr_t *recorder_sr = (recorder_sr_t *)parameters;
+    int feed_chunk = esp_afe->get_feed_chunksize(recorder_sr->afe_handle);
+    int fetch_chunk = esp_afe->get_fetch_chunksize(recorder_sr->afe_handle);
+    int fed = 0;
+
+    recorder_sr->feed_running = true;
+    recorder_sr->fetch_running = true;
+
+    while (recorder_sr->fetch_running) {
+        xEventGroupWaitBits(recorder_sr->events, FEED_TASK_RUNNING | FETCH_TASK_RUNNING, false, true, portMAX_DELAY);
+        fed += recorder_sr_feed(recorder_sr) * feed_chunk;
+        while (fed >= fetch_chunk && recorder_sr->fetch_running) {
+            recorder_sr_fetch_once(recorder_sr);
+            fed -= fetch_chunk;
         }
-        recorder_sr_output(recorder_sr, res->data, res->data_size);
     }
-    xEventGroupClearBits(recorder_sr->events, FETCH_TASK_RUNNING);
+    recorder_sr->feed_running = false;
+    xEventGroupClearBits(recorder_sr->events, FEED_TASK_RUNNING | FETCH_TASK_RUNNING);
     xEventGroupSetBits(recorder_sr->events, FETCH_TASK_DESTROY);
     vTaskDelete(NULL);
 }
 
 static esp_err_t recorder_sr_output(recorder_sr_t *recorder_sr, void *buffer, int len)
 {
+    mutex_lock(recorder_sr->out_lock);
     if (rb_bytes_available(recorder_sr->out_rb) < len) {
         rb_read(recorder_sr->out_rb, NULL, len, 0);
     }
     int ret = rb_write(recorder_sr->out_rb, buffer, len, 0);
+    if (ret > 0) {
+        recorder_sr->out_written += ret;
+    }
+    mutex_unlock(recorder_sr->out_lock);
+    xEventGroupSetBits(recorder_sr->events, OUT_DATA_READY);
     return ret == len ? ESP_OK : ESP_FAIL;
 }
 
+/*
+ * The reads never block inside out_lock, so the drop-oldest in recorder_sr_output and the position math in
+ * recorder_sr_get_position/recorder_sr_seek always see `out_written` and the buffered bytes change together.
+ */
 static int recorder_sr_fetch(void *handle, void *buf, int len, TickType_t ticks)
 {
     AUDIO_CHECK(TAG, handle, return ESP_ERR_INVALID_ARG, "Handle is NULL");
     recorder_sr_t *recorder_sr = (recorder_sr_t *)handle;
-    return rb_read(recorder_sr->out_rb, buf, len, ticks);
+    TickType_t start = xTaskGetTickCount();
+    int total = 0;
+    int ret = 0;
+    while (total < len) {
+        mutex_lock(recorder_sr->out_lock);
+        ret = rb_read(recorder_sr->out_rb, (char *)buf + total, len - total, 0);
+        mutex_unlock(recorder_sr->out_lock);
+        if (ret > 0) {
+            total += ret;
+            continue;
+        }
+        if (ret != RB_TIMEOUT) {
+            break;
+        }
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (ticks != portMAX_DELAY && elapsed >= ticks) {
+            break;
+        }
+        xEventGroupWaitBits(recorder_sr->events, OUT_DATA_READY, pdTRUE, pdFALSE,
+                            ticks == portMAX_DELAY ? portMAX_DELAY : ticks - elapsed);
+    }
+    return total > 0 ? total : ret;
+}
+
+static esp_err_t recorder_sr_get_position(void *handle, uint64_t *written, int *buffered)
+{
+    AUDIO_CHECK(TAG, handle, return ESP_ERR_INVALID_ARG, "Handle is NULL");
+    recorder_sr_t *recorder_sr = (recorder_sr_t *)handle;
+
+    mutex_lock(recorder_sr->out_lock);
+    *written = recorder_sr->out_written;
+    *buffered = rb_bytes_filled(recorder_sr->out_rb);
+    mutex_unlock(recorder_sr->out_lock);
+    return ESP_OK;
+}
+
+static esp_err_t recorder_sr_seek(void *handle, uint64_t pos)
+{
+    AUDIO_CHECK(TAG, handle, return ESP_ERR_INVALID_ARG, "Handle is NULL");
+    recorder_sr_t *recorder_sr = (recorder_sr_t *)handle;
+
+    mutex_lock(recorder_sr->out_lock);
+    int buffered = rb_bytes_filled(recorder_sr->out_rb);
+    uint64_t oldest = recorder_sr->out_written - buffered;
+    if (pos > oldest) {
+        int drop = pos - oldest > buffered ? buffered : (int)(pos - oldest);
+        rb_read(recorder_sr->out_rb, NULL, drop & ~1, 0);
+    } else if (pos < oldest) {
+        ESP_LOGW(TAG, "%d bytes before the seek position are gone, enlarge rb_size", (int)(oldest - pos));
+    }
+    mutex_unlock(recorder_sr->out_lock);
+    return ESP_OK;
+}
+
+static esp_err_t recorder_sr_get_output_info(void *handle, int *sample_rate, int *bits, int *channels)
+{
+    AUDIO_CHECK(TAG, handle, return ESP_ERR_INVALID_ARG, "Handle is NULL");
+
+    /* The AFE outputs one processed channel of 16 bit samples */
+    *sample_rate = SR_SAMPLE_RATE;
+    *bits = 16;
+    *channels = 1;
+    return ESP_OK;
 }
 
 static esp_err_t recorder_sr_suspend(void *handle, bool suspend)
@@ -294,6 +500,7 @@ static esp_err_t recorder_sr_suspend(void *handle, bool suspend)
         xEventGroupClearBits(recorder_sr->events, FETCH_TASK_RUNNING);
         if (recorder_sr->out_rb) {
             rb_done_write(recorder_sr->out_rb);
+            xEventGroupSetBits(recorder_sr->events, OUT_DATA_READY);
         }
     } else {
         xEventGroupSetBits(recorder_sr->events, FEED_TASK_RUNNING);
@@ -308,25 +515,43 @@ static esp_err_t recorder_sr_enable(void *handle, bool enable)
     recorder_sr_t *recorder_sr = (recorder_sr_t *)handle;
     esp_err_t ret = ESP_OK;
     if (enable) {
-        if (!recorder_sr->feed_running) {
-            audio_thread_t feed_thread = NULL;
-            ret |= audio_thread_create(&feed_thread, "feed_task",
-                feed_task,
-                (void *)recorder_sr,
-                recorder_sr->feed_task_stack,
-                recorder_sr->feed_task_prio,
-                true,
-                recorder_sr->feed_task_core);
-        }
-        if (!recorder_sr->fetch_running) {
-            audio_thread_t fetch_thread = NULL;
-            ret |= audio_thread_create(&fetch_thread, "fetch_task",
-                fetch_task,
-                (void *)recorder_sr,
-                recorder_sr->fetch_task_stack,
-                recorder_sr->fetch_task_prio,
-                true,
-                recorder_sr->fetch_task_core);
+        /* The AFE starts parked, the first sound wakes it up with its look back */
+        recorder_sr->gate_parked = recorder_sr->gate_enable;
+        recorder_sr->gate_history = 0;
+        if (recorder_sr->merge_tasks) {
+            if (!recorder_sr->fetch_running) {
+                recorder_sr->feed_fill = 0;
+                audio_thread_t sr_thread = NULL;
+                ret |= audio_thread_create(&sr_thread, "feed_fetch_task",
+                    feed_fetch_task,
+                    (void *)recorder_sr,
+                    MAX(recorder_sr->feed_task_stack, recorder_sr->fetch_task_stack),
+                    recorder_sr->feed_task_prio,
+                    true,
+                    RECORDER_SR_TASK_CORE(recorder_sr->feed_task_core));
+            }
+        } else {
+            if (!recorder_sr->feed_running) {
+                recorder_sr->feed_fill = 0;
+                audio_thread_t feed_thread = NULL;
+                ret |= audio_thread_create(&feed_thread, "feed_task",
+                    feed_task,
+                    (void *)recorder_sr,
+                    recorder_sr->feed_task_stack,
+                    recorder_sr->feed_task_prio,
+                    true,
+                    RECORDER_SR_TASK_CORE(recorder_sr->feed_task_core));
+            }
+            if (!recorder_sr->fetch_running) {
+                audio_thread_t fetch_thread = NULL;
+                ret |= audio_thread_create(&fetch_thread, "fetch_task",
+                    fetch_task,
+                    (void *)recorder_sr,
+                    recorder_sr->fetch_task_stack,
+                    recorder_sr->fetch_task_prio,
+                    true,
+                    RECORDER_SR_TASK_CORE(recorder_sr->fetch_task_core));
+            }
         }
         recorder_sr_suspend(handle, !recorder_sr->wwe_enable);
 
@@ -335,6 +560,8 @@ static esp_err_t recorder_sr_enable(void *handle, bool enable)
         }
     } else {
         recorder_sr_suspend(handle, false);
+        /* The fetch task waits for data inside the AFE, keep feeding until it quits */
+        recorder_sr->gate_parked = false;
 
         if (recorder_sr->fetch_running) {
             recorder_sr->fetch_running = false;
@@ -352,6 +579,7 @@ static esp_err_t recorder_sr_enable(void *handle, bool enable)
         }
         if (recorder_sr->out_rb) {
             rb_done_write(recorder_sr->out_rb);
+            xEventGroupSetBits(recorder_sr->events, OUT_DATA_READY);
         }
     }
     return ret == ESP_OK ? ESP_OK : ESP_FAIL;
@@ -476,6 +704,9 @@ static recorder_sr_iface_t recorder_sr_iface = {
     .set_mn_monitor = recorder_sr_set_mn_monitor,
     .wwe_enable = recorder_sr_wwe_enable,
     .mn_enable = recorder_sr_mn_enable,
+    .get_position = recorder_sr_get_position,
+    .seek = recorder_sr_seek,
+    .get_output_info = recorder_sr_get_output_info,
 };
 
 static void recorder_sr_clear(void *handle)
@@ -505,6 +736,15 @@ static void recorder_sr_clear(void *handle)
         vEventGroupDelete(recorder_sr->events);
         recorder_sr->events = NULL;
     }
+    if (recorder_sr->out_lock) {
+        mutex_destroy(recorder_sr->out_lock);
+        recorder_sr->out_lock = NULL;
+    }
+    for (int i = 0; i < recorder_sr->feed_pool_num; i++) {
+        audio_free(recorder_sr->feed_pool[i]);
+        recorder_sr->feed_pool[i] = NULL;
+    }
+    recorder_sr->feed_buf = NULL;
     if (recorder_sr) {
         audio_free(recorder_sr);
     }
@@ -526,6 +766,7 @@ recorder_sr_handle_t recorder_sr_create(recorder_sr_cfg_t *cfg, recorder_sr_ifac
     recorder_sr->partition_label  = cfg->partition_label;
     recorder_sr->aec_enable       = cfg->afe_cfg.aec_init;
     recorder_sr->wn_wakeword      = cfg->wn_wakeword;
+    recorder_sr->merge_tasks      = cfg->merge_tasks;
 #ifdef CONFIG_USE_MULTINET
     recorder_sr->mn_language      = cfg->mn_language;
 #endif
@@ -559,6 +800,27 @@ recorder_sr_handle_t recorder_sr_create(recorder_sr_cfg_t *cfg, recorder_sr_ifac
     AUDIO_NULL_CHECK(TAG, recorder_sr->events, goto _failed);
     recorder_sr->out_rb = rb_create(recorder_sr->rb_size, 1);
     AUDIO_NULL_CHECK(TAG, recorder_sr->out_rb, goto _failed);
+    recorder_sr->out_lock = mutex_create();
+    AUDIO_NULL_CHECK(TAG, recorder_sr->out_lock, goto _failed);
+    /* The channels are sorted in place, so the capture buffers are kept for the lifetime of the sr */
+    int feed_chunk = esp_afe->get_feed_chunksize(recorder_sr->afe_handle);
+    recorder_sr->feed_buf_size = feed_chunk * sizeof(int16_t) * RECORDER_CHANNEL_NUM;
+    recorder_sr->feed_pool_num = 1;
+    if (cfg->gate_enable) {
+        int chunk_ms = feed_chunk * 1000 / SR_SAMPLE_RATE;
+        int lookback = (cfg->gate_lookback_ms + chunk_ms - 1) / chunk_ms;
+        recorder_sr->feed_pool_num += lookback > SR_GATE_LOOKBACK_MAX ? SR_GATE_LOOKBACK_MAX : lookback;
+        recorder_sr->gate_enable = true;
+        recorder_sr->gate_hangover_chunks = cfg->gate_hangover_ms / chunk_ms + 1;
+        recorder_sr->gate_open_level = (int64_t)(32768.0 * 32768.0 * pow(10, cfg->gate_open_db / 10.0));
+        recorder_sr->gate_close_level = (int64_t)(32768.0 * 32768.0 * pow(10, (cfg->gate_open_db - SR_GATE_HYSTERESIS_DB) / 10.0));
+        recorder_sr->gate_min_zc = SR_GATE_MIN_ZCR_HZ * 2 * feed_chunk / SR_SAMPLE_RATE;
+    }
+    for (int i = 0; i < recorder_sr->feed_pool_num; i++) {
+        recorder_sr->feed_pool[i] = audio_calloc(1, recorder_sr->feed_buf_size);
+        AUDIO_NULL_CHECK(TAG, recorder_sr->feed_pool[i], goto _failed);
+    }
+    recorder_sr->feed_buf = recorder_sr->feed_pool[0];
 
     *iface = &recorder_sr_iface;
 
@@ -625,3 +887,14 @@ esp_err_t recorder_sr_reset_speech_cmd(recorder_sr_handle_t handle, char *comman
     return ESP_FAIL;
 #endif
 }
+
+esp_err_t recorder_sr_get_gate_stats(recorder_sr_handle_t handle, recorder_sr_gate_stats_t *stats)
+{
+    AUDIO_CHECK(TAG, handle, return ESP_FAIL, "Handle is NULL");
+    AUDIO_CHECK(TAG, stats, return ESP_FAIL, "stats is NULL");
+    recorder_sr_t *recorder_sr = (recorder_sr_t *)handle;
+
+    memcpy(stats, &recorder_sr->gate_stats, sizeof(recorder_sr_gate_stats_t));
+    stats->parked = recorder_sr->gate_parked;
+    return ESP_OK;
+}
@@ -78,6 +78,21 @@ extern const uint8_t _1ch16bit16k_pcm_end[] asm("_binary_1ch16bit16k_pcm_end");
 static EventGroupHandle_t events;
 static QueueHandle_t rec_q = NULL;
 static int read_cnt = 0;
+static int read_bytes = 0;
+
+/* Output positions of the SR, only tracked when the test sets `pos_sr_handle` */
+static void *pos_sr_handle;
+static recorder_sr_iface_t *pos_sr_iface;
+static uint64_t pos_wakeup;
+static uint64_t pos_start;
+
+static uint64_t sr_output_pos(bool oldest)
+{
+    uint64_t written = 0;
+    int buffered = 0;
+    pos_sr_iface->get_position(pos_sr_handle, &written, &buffered);
+    return oldest ? written - buffered : written;
+}
 
 static void voice_read_task(void *args)
 {
@@ -128,6 +143,7 @@ static void voice_read_task(void *args)
                 voice_reading = false;
                 ESP_LOGE(TAG, "Read Finished");
             } else {
+                read_bytes += ret;
                 xEventGroupSetBits(events, RECORDER_GOT_DAT);
             }
         }
@@ -210,11 +226,19 @@ static esp_err_t recorder_event_cb(audio_rec_evt_t type, void *user_data)
     switch (type) {
         case AUDIO_REC_WAKEUP_START: {
             ESP_LOGI(TAG, "recorder_event_cb - REC_EVENT_WAKEUP_START");
+            if (pos_sr_handle) {
+                /* Later than the exact wake up point by the event latency */
+                pos_wakeup = sr_output_pos(false);
+            }
             xEventGroupSetBits(events, SR_WAKEUP);
             break;
         }
         case AUDIO_REC_VAD_START: {
             ESP_LOGI(TAG, "recorder_event_cb - REC_EVENT_VAD_START");
+            if (pos_sr_handle) {
+                /* Nothing is fetched before the reader starts, so the oldest data is the first one delivered */
+                pos_start = sr_output_pos(true);
+            }
             int msg = REC_START;
             if (xQueueSend(rec_q, &msg, portMAX_DELAY) != pdPASS) {
                 ESP_LOGE(TAG, "rec start send failed");
@@ -251,6 +275,7 @@ static esp_err_t recorder_event_cb(audio_rec_evt_t type, void *user_data)
 static void test_init(void *recorder)
 {
     read_cnt = 0;
+    read_bytes = 0;
     TEST_ASSERT_NOT_NULL(events = xEventGroupCreate());
     TEST_ASSERT_NOT_NULL(rec_q = xQueueCreate(3, sizeof(int)));
     TEST_ASSERT(pdTRUE == xTaskCreate(voice_read_task, "rec_task", 4 * 1024, recorder, 6, NULL));
@@ -767,3 +792,185 @@ TEST_CASE("Use [sr - all enable, resample, encoder]", "[audio][timeout=100][test
 
     test_deinit();
 }
+
+TEST_CASE("Use [sr - wwe enable, vad disabled, mn disabled, preroll]", "[audio][timeout=100][test_env=UT_T1_AUDIO]")
+{
+    recorder_sr_cfg_t recorder_sr_cfg = DEFAULT_RECORDER_SR_CFG();
+    recorder_sr_cfg.afe_cfg.memory_alloc_mode = AFE_MEMORY_ALLOC_MORE_PSRAM;
+    recorder_sr_cfg.afe_cfg.agc_mode = AFE_MN_PEAK_NO_AGC;
+    recorder_sr_cfg.rb_size = 32 * 1024;
+
+    audio_rec_cfg_t cfg = AUDIO_RECORDER_DEFAULT_CFG();
+#if CONFIG_AFE_MIC_NUM == (1)
+    cfg.read = (recorder_data_read_t)&input_2ch_for_afe;
+#else
+    cfg.read = (recorder_data_read_t)&input_4ch_for_afe;
+#endif
+    cfg.event_cb = recorder_event_cb;
+    cfg.sr_handle = recorder_sr_create(&recorder_sr_cfg, &cfg.sr_iface);
+    cfg.vad_off = 1000;
+    cfg.preroll_ms = 300;
+
+    int rate = 0, bits_per_sample = 0, channels = 0;
+    TEST_ASSERT(ESP_OK == cfg.sr_iface->get_output_info(cfg.sr_handle, &rate, &bits_per_sample, &channels));
+    const uint64_t bytes_per_ms = rate * (bits_per_sample >> 3) * channels / 1000;
+    pos_sr_handle = cfg.sr_handle;
+    pos_sr_iface = cfg.sr_iface;
+
+    audio_rec_handle_t recorder = audio_recorder_create(&cfg);
+    TEST_ASSERT_NOT_NULL(recorder);
+    TEST_ASSERT(ESP_OK == audio_recorder_multinet_enable(recorder, false));
+    TEST_ASSERT(ESP_OK == audio_recorder_vad_check_enable(recorder, false));
+
+    test_init(recorder);
+
+    EventBits_t bits = 0;
+    EventBits_t expect = 0;
+
+    expect = SR_WAKEUP | SR_VAD_START | RECORDER_GOT_DAT;
+    bits = xEventGroupWaitBits(events, expect, true, true, pdMS_TO_TICKS(10000));
+    TEST_ASSERT((bits & expect) == expect);
+
+    expect = SR_VAD_END | SR_SLEEP | RECORDER_READ_FIN;
+    bits = xEventGroupWaitBits(events, expect, true, true, pdMS_TO_TICKS(10000));
+    TEST_ASSERT((bits & expect) == expect);
+
+    /* Delivered data starts the pre-roll before the wake up point, not at the oldest buffered data */
+    uint64_t preroll = pos_wakeup - pos_start;
+    ESP_LOGI(TAG, "Pre-roll %d ms, %d bytes read", (int)(preroll / bytes_per_ms), read_bytes);
+    TEST_ASSERT(preroll >= cfg.preroll_ms * bytes_per_ms);
+    TEST_ASSERT(preroll <= (cfg.preroll_ms + 200) * bytes_per_ms);
+    TEST_ASSERT(read_bytes >= preroll);
+    pos_sr_handle = NULL;
+
+    TEST_ASSERT(ESP_OK == audio_recorder_destroy(recorder));
+    TEST_ASSERT(ESP_OK == recorder_sr_destroy(cfg.sr_handle));
+
+    test_deinit();
+}
+
+TEST_CASE("Use [sr - wwe enable, vad disabled, mn disabled, gate]", "[audio][timeout=100][test_env=UT_T1_AUDIO]")
+{
+    recorder_sr_cfg_t recorder_sr_cfg = DEFAULT_RECORDER_SR_CFG();
+    recorder_sr_cfg.afe_cfg.memory_alloc_mode = AFE_MEMORY_ALLOC_MORE_PSRAM;
+    recorder_sr_cfg.afe_cfg.agc_mode = AFE_MN_PEAK_NO_AGC;
+    recorder_sr_cfg.gate_enable = true;
+    recorder_sr_cfg.gate_hangover_ms = 500;
+
+    audio_rec_cfg_t cfg = AUDIO_RECORDER_DEFAULT_CFG();
+#if CONFIG_AFE_MIC_NUM == (1)
+    cfg.read = (recorder_data_read_t)&input_2ch_for_afe;
+#else
+    cfg.read = (recorder_data_read_t)&input_4ch_for_afe;
+#endif
+    cfg.event_cb = recorder_event_cb;
+    cfg.sr_handle = recorder_sr_create(&recorder_sr_cfg, &cfg.sr_iface);
+    cfg.vad_off = 1000;
+
+    audio_rec_handle_t recorder = audio_recorder_create(&cfg);
+    TEST_ASSERT_NOT_NULL(recorder);
+    TEST_ASSERT(ESP_OK == audio_recorder_multinet_enable(recorder, false));
+    TEST_ASSERT(ESP_OK == audio_recorder_vad_check_enable(recorder, false));
+
+    test_init(recorder);
+
+    EventBits_t bits = 0;
+    EventBits_t expect = 0;
+
+    /* The wake word must survive the gate, the look back covers its onset */
+    expect = SR_WAKEUP | SR_VAD_START | RECORDER_GOT_DAT;
+    bits = xEventGroupWaitBits(events, expect, true, true, pdMS_TO_TICKS(10000));
+    TEST_ASSERT((bits & expect) == expect);
+
+    expect = SR_VAD_END | SR_SLEEP | RECORDER_READ_FIN;
+    bits = xEventGroupWaitBits(events, expect, true, true, pdMS_TO_TICKS(10000));
+    TEST_ASSERT((bits & expect) == expect);
+
+    recorder_sr_gate_stats_t stats = { 0 };
+    TEST_ASSERT(ESP_OK == recorder_sr_get_gate_stats(cfg.sr_handle, &stats));
+    ESP_LOGI(TAG, "Gate: %u frames, %u gated, %u openings", stats.frames, stats.gated_frames, stats.openings);
+    TEST_ASSERT(stats.openings > 0);
+    TEST_ASSERT(stats.gated_frames < stats.frames);
+
+    TEST_ASSERT(ESP_OK == audio_recorder_destroy(recorder));
+    TEST_ASSERT(ESP_OK == recorder_sr_destroy(cfg.sr_handle));
+
+    test_deinit();
+}
+
+TEST_CASE("Use [amrwb] and [resample, amrnb] fed by one source", "[audio][timeout=100][test_env=UT_T1_AUDIO]")
+{
+    audio_rec_cfg_t cfg = AUDIO_RECORDER_DEFAULT_CFG();
+    cfg.read = (recorder_data_read_t)&input_1ch_for_encoder;
+    cfg.event_cb = recorder_event_cb;
+
+    recorder_encoder_cfg_t wb_encoder_cfg = { 0 };
+    amrwb_encoder_cfg_t amrwb_enc_cfg = DEFAULT_AMRWB_ENCODER_CONFIG();
+    amrwb_enc_cfg.contain_amrwb_header = true;
+    amrwb_enc_cfg.task_core = 1;
+    wb_encoder_cfg.encoder = amrwb_encoder_init(&amrwb_enc_cfg);
+    TEST_ASSERT_NOT_NULL(wb_encoder_cfg.encoder);
+    cfg.encoder_handle = recorder_encoder_create(&wb_encoder_cfg, &cfg.encoder_iface);
+    TEST_ASSERT_NOT_NULL(cfg.encoder_handle);
+
+    recorder_encoder_cfg_t nb_encoder_cfg = { 0 };
+    rsp_filter_cfg_t filter_cfg = DEFAULT_RESAMPLE_FILTER_CONFIG();
+    filter_cfg.src_ch = 1;
+    filter_cfg.src_rate = 16000;
+    filter_cfg.dest_ch = 1;
+    filter_cfg.dest_rate = 8000;
+    filter_cfg.stack_in_ext = true;
+    filter_cfg.max_indata_bytes = 1024;
+    nb_encoder_cfg.resample = rsp_filter_init(&filter_cfg);
+    TEST_ASSERT_NOT_NULL(nb_encoder_cfg.resample);
+    amrnb_encoder_cfg_t amrnb_enc_cfg = DEFAULT_AMRNB_ENCODER_CONFIG();
+    amrnb_enc_cfg.contain_amrnb_header = true;
+    amrnb_enc_cfg.stack_in_ext = true;
+    nb_encoder_cfg.encoder = amrnb_encoder_init(&amrnb_enc_cfg);
+    TEST_ASSERT_NOT_NULL(nb_encoder_cfg.encoder);
+
+    audio_rec_encoder_t encoders[1] = { 0 };
+    encoders[0].handle = recorder_encoder_create(&nb_encoder_cfg, &encoders[0].iface);
+    TEST_ASSERT_NOT_NULL(encoders[0].handle);
+    cfg.encoders = encoders;
+    cfg.encoder_num = 1;
+
+    audio_rec_handle_t recorder = audio_recorder_create(&cfg);
+    TEST_ASSERT_NOT_NULL(recorder);
+
+    test_init(recorder);
+
+    EventBits_t bits = 0;
+    EventBits_t expect = 0;
+
+    TEST_ASSERT(audio_recorder_trigger_start(recorder) == ESP_OK);
+    expect = SR_WAKEUP | SR_VAD_START | RECORDER_GOT_DAT;
+    bits = xEventGroupWaitBits(events, expect, true, true, pdMS_TO_TICKS(2000));
+    TEST_ASSERT((bits & expect) == expect);
+
+    char *nb_data = audio_calloc(1, 512);
+    TEST_ASSERT_NOT_NULL(nb_data);
+    int nb_len = 0;
+    for (int i = 0; i < 50; i++) {
+        int ret = audio_recorder_encoder_data_read(recorder, 1, nb_data, 512, pdMS_TO_TICKS(100));
+        nb_len += ret > 0 ? ret : 0;
+    }
+    ESP_LOGI(TAG, "Got %d bytes of amrnb", nb_len);
+    TEST_ASSERT_GREATER_THAN(0, nb_len);
+    TEST_ASSERT(ESP_ERR_INVALID_ARG == audio_recorder_encoder_data_read(recorder, 2, nb_data, 512, 0));
+
+    TEST_ASSERT(ESP_OK == audio_recorder_encoder_enable(recorder, 1, false));
+    vTaskDelay(pdMS_TO_TICKS(1000));
+
+    TEST_ASSERT(audio_recorder_trigger_stop(recorder) == ESP_OK);
+    expect = SR_VAD_END | SR_SLEEP | RECORDER_READ_FIN;
+    bits = xEventGroupWaitBits(events, expect, true, true, pdMS_TO_TICKS(2000));
+    TEST_ASSERT((bits & expect) == expect);
+
+    audio_free(nb_data);
+    TEST_ASSERT(ESP_OK == audio_recorder_destroy(recorder));
+    TEST_ASSERT(ESP_OK == recorder_encoder_destroy(cfg.encoder_handle));
+    TEST_ASSERT(ESP_OK == recorder_encoder_destroy(encoders[0].handle));
+
+    test_deinit();
+}
@@ -33,6 +33,7 @@
 #include "freertos/task.h"
 
 #include "fatfs_stream.h"
+#include "seek_index.h"
 #include "audio_common.h"
 #include "audio_mem.h"
 #include "audio_element.h"
@@ -63,6 +64,7 @@ typedef struct fatfs_stream {
     int file;
     wr_stream_type_t w_type;
     bool write_header;
+    seek_index_builder_handle_t seek_builder;
 } fatfs_stream_t;
 
 
@@ -144,6 +146,9 @@ static esp_err_t _fatfs_open(audio_element_handle_t self)
                 return ESP_FAIL;
             }
         }
+        if (fatfs->seek_builder) {
+            seek_index_builder_begin(fatfs->seek_builder, info.byte_pos);
+        }
     } else if (fatfs->type == AUDIO_STREAM_WRITER) {
         fatfs->file = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU);
         if (fatfs->file == -1) {
@@ -180,8 +185,23 @@ static int _fatfs_read(audio_element_handle_t self, char *buffer, int len, TickT
     ESP_LOGD(TAG, "read len=%d, pos=%d/%d", len, (int)info.byte_pos, (int)info.total_bytes);
     /* use file descriptors to access files */
     int rlen = read(fatfs->file, buffer, len);
+    while (rlen > 0 && fatfs->seek_builder) {
+        audio_element_update_byte_pos(self, rlen);
+        // Frames before seek target are dropped, so decoder starts at the right frame
+        int drop = seek_index_builder_feed(fatfs->seek_builder, buffer, rlen);
+        if (drop < rlen) {
+            if (drop) {
+                memmove(buffer, buffer + drop, rlen - drop);
+            }
+            return rlen - drop;
+        }
+        rlen = read(fatfs->file, buffer, len);
+    }
     if (rlen == 0) {
         ESP_LOGW(TAG, "No more data, ret:%d", rlen);
+        if (fatfs->seek_builder) {
+            seek_index_builder_finish(fatfs->seek_builder);
+        }
     } else if (rlen == -1) {
         ESP_LOGE(TAG, "The error is happened in reading data. Error message: %s", strerror(errno));
     } else {
@@ -256,6 +276,9 @@ static esp_err_t _fatfs_close(audio_element_handle_t self)
 static esp_err_t _fatfs_destroy(audio_element_handle_t self)
 {
     fatfs_stream_t *fatfs = (fatfs_stream_t *)audio_element_getdata(self);
+    if (fatfs->seek_builder) {
+        seek_index_builder_destroy(fatfs->seek_builder);
+    }
     audio_free(fatfs);
     return ESP_OK;
 }
@@ -300,4 +323,39 @@ _fatfs_init_exit:
     audio_free(fatfs);
     return NULL;
 }
-// Example of using an audio element - END
\ No newline at end of file
+// Example of using an audio element - END
+
+esp_err_t fatfs_stream_set_seek_index(audio_element_handle_t el, seek_index_t *index)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_FAIL);
+    fatfs_stream_t *fatfs = (fatfs_stream_t *)audio_element_getdata(el);
+    if (fatfs->type != AUDIO_STREAM_READER) {
+        ESP_LOGE(TAG, "Seek index is only for reader");
+        return ESP_FAIL;
+    }
+    if (fatfs->seek_builder) {
+        seek_index_builder_destroy(fatfs->seek_builder);
+        fatfs->seek_builder = NULL;
+    }
+    if (index) {
+        fatfs->seek_builder = seek_index_builder_create(index);
+        AUDIO_MEM_CHECK(TAG, fatfs->seek_builder, return ESP_ERR_NO_MEM);
+    }
+    return ESP_OK;
+}
+
+esp_err_t fatfs_stream_seek(audio_element_handle_t el, uint32_t time_ms)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_FAIL);
+    fatfs_stream_t *fatfs = (fatfs_stream_t *)audio_element_getdata(el);
+    if (fatfs->seek_builder == NULL) {
+        ESP_LOGE(TAG, "No seek index, call fatfs_stream_set_seek_index first");
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t pos = 0;
+    esp_err_t ret = seek_index_builder_seek(fatfs->seek_builder, time_ms, &pos);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return audio_element_set_byte_pos(el, pos);
+}
@@ -0,0 +1,548 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "gapless_stream.h"
+#include "playlist.h"
+#include "media_probe.h"
+#include "audio_error.h"
+#include "audio_mem.h"
+#include "audio_thread.h"
+#include "esp_log.h"
+
+static const char *TAG = "GAPLESS_STREAM";
+
+#define GAPLESS_READ_TICKS      (pdMS_TO_TICKS(50))
+#define GAPLESS_SEQ_TRACK_END   (1)
+#define GAPLESS_SEQ_EXIT        (2)
+#define GAPLESS_SEQ_FENCE       (3)
+
+typedef struct {
+    gapless_stream_track_t  track;
+    bool                    queued;
+    bool                    started;
+    uint64_t                skip_bytes;     /* Bytes to drop before first played sample */
+    uint64_t                remain_bytes;   /* Bytes to play, UINT64_MAX if played until source done */
+} gapless_slot_t;
+
+typedef struct gapless_seq {
+    gapless_stream_seq_cfg_t    cfg;
+    ringbuf_handle_t            rb[GAPLESS_STREAM_SLOT_NUM];
+    char                        *url[GAPLESS_STREAM_SLOT_NUM];
+    uint32_t                    gen[GAPLESS_STREAM_SLOT_NUM];   /* Load generation, bumped on every reset of slot */
+    uint32_t                    fence[GAPLESS_STREAM_SLOT_NUM]; /* Generation of last fence read, source events before it are stale */
+    audio_event_iface_handle_t  ctrl;   /* Sends track end and exit commands to sequencer task */
+    audio_event_iface_handle_t  evt;    /* Listens to commands and to events of source pipelines */
+    SemaphoreHandle_t           exit;
+} gapless_seq_t;
+
+typedef struct gapless_stream {
+    gapless_slot_t              slot[GAPLESS_STREAM_SLOT_NUM];
+    int                         order[GAPLESS_STREAM_SLOT_NUM]; /* Queued slots in play order */
+    int                         order_num;
+    int                         frame_bytes;
+    uint64_t                    pos;
+    bool                        finish;
+    bool                        skip;
+    SemaphoreHandle_t           lock;
+    SemaphoreHandle_t           queued;
+    gapless_stream_event_cb_t   event_cb;
+    void                        *event_ctx;
+    gapless_seq_t               *seq;
+} gapless_stream_t;
+
+static void _gapless_event(audio_element_handle_t self, gapless_stream_t *gapless, gapless_stream_event_id_t id, int slot)
+{
+    gapless_stream_event_msg_t msg = {
+        .id = id,
+        .slot = slot,
+        .user_data = gapless->slot[slot].track.user_data,
+        .pos = gapless->pos,
+    };
+    if (gapless->event_cb) {
+        gapless->event_cb(self, &msg, gapless->event_ctx);
+    }
+    // Sequencer reuses the slot and frees its URL, so it is told only after the callback returned
+    if (gapless->seq && id == GAPLESS_STREAM_EVENT_TRACK_END) {
+        audio_event_iface_msg_t cmd = {
+            .cmd = GAPLESS_SEQ_TRACK_END,
+            .data = (void *)slot,
+            .source = gapless->seq,
+        };
+        audio_event_iface_sendout(gapless->seq->ctrl, &cmd);
+    }
+}
+
+static int _gapless_current(gapless_stream_t *gapless)
+{
+    xSemaphoreTake(gapless->lock, portMAX_DELAY);
+    int slot = gapless->order_num ? gapless->order[0] : -1;
+    xSemaphoreGive(gapless->lock);
+    return slot;
+}
+
+static void _gapless_start(audio_element_handle_t self, gapless_stream_t *gapless, int slot)
+{
+    gapless_slot_t *s = &gapless->slot[slot];
+    audio_element_info_t info = { 0 };
+    audio_element_getinfo(self, &info);
+    if (s->track.src) {
+        audio_element_info_t src_info = { 0 };
+        audio_element_getinfo(s->track.src, &src_info);
+        if (src_info.sample_rates != info.sample_rates || src_info.channels != info.channels || src_info.bits != info.bits) {
+            ESP_LOGI(TAG, "Track in slot %d changes format to %d Hz, %d bits, %d channels", slot,
+                     src_info.sample_rates, src_info.bits, src_info.channels);
+            audio_element_set_music_info(self, src_info.sample_rates, src_info.channels, src_info.bits);
+            audio_element_report_info(self);
+            info = src_info;
+        }
+    }
+    gapless->frame_bytes = info.channels * info.bits / 8;
+    if (gapless->frame_bytes <= 0) {
+        gapless->frame_bytes = 1;
+    }
+    s->skip_bytes = (uint64_t)s->track.skip_samples * gapless->frame_bytes;
+    s->remain_bytes = s->track.total_samples ? (uint64_t)s->track.total_samples * gapless->frame_bytes : UINT64_MAX;
+    s->started = true;
+    _gapless_event(self, gapless, GAPLESS_STREAM_EVENT_TRACK_START, slot);
+}
+
+static void _gapless_end(audio_element_handle_t self, gapless_stream_t *gapless, int slot)
+{
+    xSemaphoreTake(gapless->lock, portMAX_DELAY);
+    for (int i = 1; i < gapless->order_num; i++) {
+        gapless->order[i - 1] = gapless->order[i];
+    }
+    gapless->order_num--;
+    gapless->slot[slot].queued = false;
+    gapless->slot[slot].started = false;
+    gapless->skip = false;
+    xSemaphoreGive(gapless->lock);
+    _gapless_event(self, gapless, GAPLESS_STREAM_EVENT_TRACK_END, slot);
+}
+
+static esp_err_t _gapless_open(audio_element_handle_t self)
+{
+    return ESP_OK;
+}
+
+static esp_err_t _gapless_close(audio_element_handle_t self)
+{
+    return ESP_OK;
+}
+
+static int _gapless_process(audio_element_handle_t self, char *in_buffer, int in_len)
+{
+    gapless_stream_t *gapless = (gapless_stream_t *)audio_element_getdata(self);
+    int filled = 0;
+    while (filled < in_len) {
+        int slot = _gapless_current(gapless);
+        if (slot < 0) {
+            if (filled) {
+                break;
+            }
+            if (gapless->finish) {
+                return AEL_IO_DONE;
+            }
+            if (xSemaphoreTake(gapless->queued, GAPLESS_READ_TICKS) != pdTRUE) {
+                return AEL_IO_TIMEOUT;
+            }
+            continue;
+        }
+        gapless_slot_t *s = &gapless->slot[slot];
+        // Format of next track is checked after samples before it are output
+        if (s->started == false && filled) {
+            break;
+        }
+        int ret = RB_DONE;
+        if (gapless->skip == false) {
+            ret = audio_element_multi_input(self, in_buffer + filled, in_len - filled, slot, GAPLESS_READ_TICKS);
+        }
+        if (ret == RB_TIMEOUT || ret == 0) {
+            if (filled) {
+                break;
+            }
+            return AEL_IO_TIMEOUT;
+        }
+        if (ret > 0) {
+            if (s->started == false) {
+                _gapless_start(self, gapless, slot);
+            }
+            // Drop encoder delay at start and padding after the last played sample
+            int drop = s->skip_bytes < ret ? s->skip_bytes : ret;
+            s->skip_bytes -= drop;
+            int keep = ret - drop;
+            if (keep > s->remain_bytes) {
+                keep = s->remain_bytes;
+            }
+            if (drop && keep) {
+                memmove(in_buffer + filled, in_buffer + filled + drop, keep);
+            }
+            filled += keep;
+            if (s->remain_bytes != UINT64_MAX) {
+                s->remain_bytes -= keep;
+            }
+            if (s->remain_bytes) {
+                continue;
+            }
+        }
+        // Source done, aborted, skipped or all samples played, join next track in the same buffer
+        if (s->started == false) {
+            _gapless_start(self, gapless, slot);
+        }
+        _gapless_end(self, gapless, slot);
+    }
+    int w_size = audio_element_output(self, in_buffer, filled);
+    if (w_size > 0) {
+        gapless->pos += w_size / gapless->frame_bytes;
+    }
+    return w_size;
+}
+
+static esp_err_t _gapless_destroy(audio_element_handle_t self)
+{
+    gapless_stream_t *gapless = (gapless_stream_t *)audio_element_getdata(self);
+    if (gapless->seq) {
+        gapless_stream_seq_stop(self);
+    }
+    vSemaphoreDelete(gapless->lock);
+    vSemaphoreDelete(gapless->queued);
+    audio_free(gapless);
+    return ESP_OK;
+}
+
+audio_element_handle_t gapless_stream_init(gapless_stream_cfg_t *config)
+{
+    AUDIO_NULL_CHECK(TAG, config, return NULL);
+    gapless_stream_t *gapless = audio_calloc(1, sizeof(gapless_stream_t));
+    AUDIO_MEM_CHECK(TAG, gapless, return NULL);
+    gapless->lock = xSemaphoreCreateMutex();
+    gapless->queued = xSemaphoreCreateBinary();
+    AUDIO_MEM_CHECK(TAG, gapless->lock && gapless->queued, goto _gapless_init_exit);
+    gapless->event_cb = config->event_cb;
+    gapless->event_ctx = config->event_ctx;
+    gapless->frame_bytes = 1;
+
+    audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
+    cfg.open = _gapless_open;
+    cfg.close = _gapless_close;
+    cfg.process = _gapless_process;
+    cfg.destroy = _gapless_destroy;
+    cfg.task_stack = config->task_stack;
+    cfg.task_prio = config->task_prio;
+    cfg.task_core = config->task_core;
+    cfg.stack_in_ext = config->stack_in_ext;
+    cfg.out_rb_size = config->out_rb_size;
+    cfg.buffer_len = config->buffer_len;
+    cfg.multi_in_rb_num = GAPLESS_STREAM_SLOT_NUM;
+    cfg.tag = "gapless";
+    audio_element_handle_t el = audio_element_init(&cfg);
+    AUDIO_MEM_CHECK(TAG, el, goto _gapless_init_exit);
+    audio_element_setdata(el, gapless);
+    return el;
+
+_gapless_init_exit:
+    if (gapless->lock) {
+        vSemaphoreDelete(gapless->lock);
+    }
+    if (gapless->queued) {
+        vSemaphoreDelete(gapless->queued);
+    }
+    audio_free(gapless);
+    return NULL;
+}
+
+esp_err_t gapless_stream_queue(audio_element_handle_t el, int slot, gapless_stream_track_t *track)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, track, return ESP_FAIL);
+    gapless_stream_t *gapless = (gapless_stream_t *)audio_element_getdata(el);
+    if (slot < 0 || slot >= GAPLESS_STREAM_SLOT_NUM) {
+        ESP_LOGE(TAG, "Invalid slot %d", slot);
+        return ESP_FAIL;
+    }
+    xSemaphoreTake(gapless->lock, portMAX_DELAY);
+    if (gapless->slot[slot].queued) {
+        xSemaphoreGive(gapless->lock);
+        ESP_LOGE(TAG, "Slot %d is used by another track", slot);
+        return ESP_FAIL;
+    }
+    memset(&gapless->slot[slot], 0, sizeof(gapless_slot_t));
+    gapless->slot[slot].track = *track;
+    gapless->slot[slot].queued = true;
+    gapless->order[gapless->order_num++] = slot;
+    gapless->finish = false;
+    xSemaphoreGive(gapless->lock);
+    xSemaphoreGive(gapless->queued);
+    return ESP_OK;
+}
+
+esp_err_t gapless_stream_finish(audio_element_handle_t el)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_FAIL);
+    gapless_stream_t *gapless = (gapless_stream_t *)audio_element_getdata(el);
+    gapless->finish = true;
+    xSemaphoreGive(gapless->queued);
+    return ESP_OK;
+}
+
+esp_err_t gapless_stream_skip(audio_element_handle_t el)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_FAIL);
+    gapless_stream_t *gapless = (gapless_stream_t *)audio_element_getdata(el);
+    gapless->skip = true;
+    return ESP_OK;
+}
+
+static esp_err_t _gapless_seq_load(audio_element_handle_t el, gapless_seq_t *seq, int slot, const char *url)
+{
+    gapless_stream_seq_cfg_t *cfg = &seq->cfg;
+    audio_free(seq->url[slot]);
+    seq->url[slot] = audio_strdup(url);
+    AUDIO_MEM_CHECK(TAG, seq->url[slot], return ESP_FAIL);
+
+    gapless_stream_track_t track = {
+        .src = cfg->decoder[slot],
+        .user_data = seq->url[slot],
+    };
+    // Only local files are probed, other URLs are played without trim
+    media_probe_info_t info;
+    if (media_probe_file(url, &info) == ESP_OK && (info.flags & MEDIA_PROBE_FLAG_GAPLESS)) {
+        track.skip_samples = info.enc_delay;
+        if (info.format == MEDIA_PROBE_FORMAT_MP3) {
+            track.skip_samples += cfg->mp3_decoder_delay;
+        }
+        track.total_samples = info.total_samples;
+    }
+    audio_element_set_uri(cfg->reader[slot], url);
+    if (gapless_stream_queue(el, slot, &track) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Prefetch slot %d: %s, skip %u, play %u samples", slot, url,
+             (unsigned int)track.skip_samples, (unsigned int)track.total_samples);
+    return audio_pipeline_run(cfg->pipeline[slot]);
+}
+
+static void _gapless_seq_reset(gapless_seq_t *seq, int slot)
+{
+    audio_pipeline_handle_t pipeline = seq->cfg.pipeline[slot];
+    audio_pipeline_stop(pipeline);
+    audio_pipeline_wait_for_stop(pipeline);
+    audio_pipeline_reset_ringbuffer(pipeline);
+    audio_pipeline_reset_elements(pipeline);
+    audio_pipeline_reset_items_state(pipeline);
+    rb_reset(seq->rb[slot]);
+    // Queue set hands out messages in arrival order, so events of stopped run all come before this fence
+    seq->gen[slot]++;
+    audio_event_iface_msg_t fence = {
+        .cmd = GAPLESS_SEQ_FENCE,
+        .data = (void *)slot,
+        .data_len = (int)seq->gen[slot],
+        .source = seq,
+    };
+    if (audio_event_iface_sendout(seq->ctrl, &fence) != ESP_OK) {
+        seq->fence[slot] = seq->gen[slot];
+    }
+}
+
+static int _gapless_seq_slot_of(gapless_seq_t *seq, void *source)
+{
+    for (int i = 0; i < GAPLESS_STREAM_SLOT_NUM; i++) {
+        if (source == seq->cfg.reader[i] || source == seq->cfg.decoder[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void _gapless_seq_task(void *pv)
+{
+    audio_element_handle_t el = (audio_element_handle_t)pv;
+    gapless_stream_t *gapless = (gapless_stream_t *)audio_element_getdata(el);
+    gapless_seq_t *seq = gapless->seq;
+    audio_event_iface_msg_t msg;
+    while (1) {
+        if (audio_event_iface_listen(seq->evt, &msg, portMAX_DELAY) != ESP_OK) {
+            continue;
+        }
+        if (msg.source == seq) {
+            if (msg.cmd == GAPLESS_SEQ_EXIT) {
+                break;
+            }
+            if (msg.cmd == GAPLESS_SEQ_FENCE) {
+                seq->fence[(int)msg.data] = (uint32_t)msg.data_len;
+                continue;
+            }
+            // Ended track releases its pipeline, which opens the track after next one
+            int slot = (int)msg.data;
+            _gapless_seq_reset(seq, slot);
+            char *url = NULL;
+            if (playlist_next(seq->cfg.playlist, 1, &url) != ESP_OK || _gapless_seq_load(el, seq, slot, url) != ESP_OK) {
+                ESP_LOGI(TAG, "No more track to prefetch");
+                gapless_stream_finish(el);
+            }
+            continue;
+        }
+        if (msg.source_type != AUDIO_ELEMENT_TYPE_ELEMENT || msg.cmd != AEL_MSG_CMD_REPORT_STATUS) {
+            continue;
+        }
+        int status = (int)msg.data;
+        int slot = _gapless_seq_slot_of(seq, msg.source);
+        if (slot >= 0 && seq->fence[slot] != seq->gen[slot]) {
+            // Sent by the run stopped in reset, must not end the track loaded since
+            continue;
+        }
+        if (slot >= 0 && status >= AEL_STATUS_ERROR_OPEN && status <= AEL_STATUS_ERROR_UNKNOWN) {
+            // A failed source never finishes its slot, end it after the PCM decoded so far so playback goes on
+            ESP_LOGW(TAG, "Source of slot %d fails with status %d, end the track", slot, status);
+            rb_done_write(seq->rb[slot]);
+        }
+    }
+    xSemaphoreGive(seq->exit);
+    vTaskDelete(NULL);
+}
+
+esp_err_t gapless_stream_seq_start(audio_element_handle_t el, gapless_stream_seq_cfg_t *config)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, config, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, config->playlist, return ESP_FAIL);
+    gapless_stream_t *gapless = (gapless_stream_t *)audio_element_getdata(el);
+    if (gapless->seq) {
+        ESP_LOGE(TAG, "Sequencer already started");
+        return ESP_FAIL;
+    }
+    for (int i = 0; i < GAPLESS_STREAM_SLOT_NUM; i++) {
+        if (config->pipeline[i] == NULL || config->reader[i] == NULL || config->decoder[i] == NULL) {
+            ESP_LOGE(TAG, "Source pipeline of slot %d is not set", i);
+            return ESP_FAIL;
+        }
+    }
+    gapless_seq_t *seq = audio_calloc(1, sizeof(gapless_seq_t));
+    AUDIO_MEM_CHECK(TAG, seq, return ESP_FAIL);
+    seq->cfg = *config;
+    audio_event_iface_cfg_t evt_cfg = AUDIO_EVENT_IFACE_DEFAULT_CFG();
+    seq->evt = audio_event_iface_init(&evt_cfg);
+    // Track end and fence of each slot, plus exit
+    evt_cfg.external_queue_size = GAPLESS_STREAM_SLOT_NUM * 2 + 1;
+    seq->ctrl = audio_event_iface_init(&evt_cfg);
+    seq->exit = xSemaphoreCreateBinary();
+    AUDIO_MEM_CHECK(TAG, seq->evt && seq->ctrl && seq->exit, goto _seq_start_exit);
+    if (audio_event_iface_set_listener(seq->ctrl, seq->evt) != ESP_OK) {
+        goto _seq_start_exit;
+    }
+    for (int i = 0; i < GAPLESS_STREAM_SLOT_NUM; i++) {
+        if (audio_pipeline_set_listener(config->pipeline[i], seq->evt) != ESP_OK) {
+            ESP_LOGE(TAG, "Fail to listen to source pipeline of slot %d", i);
+            goto _seq_start_exit;
+        }
+    }
+    for (int i = 0; i < GAPLESS_STREAM_SLOT_NUM; i++) {
+        seq->rb[i] = rb_create(config->prefetch_size, 1);
+        AUDIO_MEM_CHECK(TAG, seq->rb[i], goto _seq_start_exit);
+        audio_element_set_output_ringbuf(config->decoder[i], seq->rb[i]);
+        audio_element_set_multi_input_ringbuf(el, seq->rb[i], i);
+    }
+    gapless->seq = seq;
+    if (audio_thread_create(NULL, "gapless_seq", _gapless_seq_task, el, config->task_stack,
+                            config->task_prio, false, config->task_core) != ESP_OK) {
+        ESP_LOGE(TAG, "Create gapless sequencer task failed");
+        gapless->seq = NULL;
+        goto _seq_start_exit;
+    }
+
+    // Current track and next one are opened together
+    char *url = NULL;
+    if (playlist_get_current_list_url(config->playlist, &url) != ESP_OK || _gapless_seq_load(el, seq, 0, url) != ESP_OK) {
+        ESP_LOGE(TAG, "Fail to open current URL of playlist");
+        gapless_stream_seq_stop(el);
+        return ESP_FAIL;
+    }
+    if (playlist_next(config->playlist, 1, &url) != ESP_OK || _gapless_seq_load(el, seq, 1, url) != ESP_OK) {
+        gapless_stream_finish(el);
+    }
+    return ESP_OK;
+
+_seq_start_exit:
+    for (int i = 0; i < GAPLESS_STREAM_SLOT_NUM; i++) {
+        if (seq->rb[i]) {
+            audio_element_set_output_ringbuf(config->decoder[i], NULL);
+            audio_element_set_multi_input_ringbuf(el, NULL, i);
+            rb_destroy(seq->rb[i]);
+        }
+        if (seq->evt) {
+            audio_pipeline_remove_listener(config->pipeline[i]);
+        }
+    }
+    if (seq->evt) {
+        audio_event_iface_destroy(seq->evt);
+    }
+    if (seq->ctrl) {
+        audio_event_iface_destroy(seq->ctrl);
+    }
+    if (seq->exit) {
+        vSemaphoreDelete(seq->exit);
+    }
+    audio_free(seq);
+    return ESP_FAIL;
+}
+
+esp_err_t gapless_stream_seq_stop(audio_element_handle_t el)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_FAIL);
+    gapless_stream_t *gapless = (gapless_stream_t *)audio_element_getdata(el);
+    gapless_seq_t *seq = gapless->seq;
+    AUDIO_NULL_CHECK(TAG, seq, return ESP_FAIL);
+
+    audio_event_iface_msg_t exit = {
+        .cmd = GAPLESS_SEQ_EXIT,
+        .source = seq,
+    };
+    xQueueSend(audio_event_iface_get_queue_handle(seq->ctrl), &exit, portMAX_DELAY);
+    xSemaphoreTake(seq->exit, portMAX_DELAY);
+    gapless->seq = NULL;
+    xSemaphoreTake(gapless->lock, portMAX_DELAY);
+    memset(gapless->slot, 0, sizeof(gapless->slot));
+    gapless->order_num = 0;
+    xSemaphoreGive(gapless->lock);
+    for (int i = 0; i < GAPLESS_STREAM_SLOT_NUM; i++) {
+        _gapless_seq_reset(seq, i);
+        audio_element_set_output_ringbuf(seq->cfg.decoder[i], NULL);
+        audio_element_set_multi_input_ringbuf(el, NULL, i);
+        rb_destroy(seq->rb[i]);
+        audio_free(seq->url[i]);
+        audio_pipeline_remove_listener(seq->cfg.pipeline[i]);
+    }
+    audio_event_iface_remove_listener(seq->evt, seq->ctrl);
+    audio_event_iface_destroy(seq->ctrl);
+    audio_event_iface_destroy(seq->evt);
+    vSemaphoreDelete(seq->exit);
+    audio_free(seq);
+    return ESP_OK;
+}
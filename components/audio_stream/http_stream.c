@@ -35,6 +35,7 @@
 
 #include "esp_log.h"
 #include "http_stream.h"
+#include "seek_index.h"
 #include "http_playlist.h"
 #include "audio_mem.h"
 #include "audio_element.h"
@@ -100,6 +101,7 @@ typedef struct http_stream {
     int                             request_range_size;
     int64_t                         request_range_end;
     bool                            is_last_range;
+    seek_index_builder_handle_t     seek_builder;      /* Record and use seek index of direct URI */
 } http_stream_t;
 
 static esp_err_t http_stream_auto_connect_next_track(audio_element_handle_t el);
@@ -627,6 +629,15 @@ _stream_open_begin:
             }
         }
     }
+    if (http->seek_builder && http->is_playlist_resolved == false) {
+        // Server ignoring range request sends data from start
+        audio_element_getinfo(self, &info);
+        if (info.byte_pos > 0 && esp_http_client_get_status_code(http->client) == 200) {
+            ESP_LOGW(TAG, "Range not supported by server, seek index not used");
+            info.byte_pos = 0;
+        }
+        seek_index_builder_begin(http->seek_builder, info.byte_pos);
+    }
     http->is_open = true;
     audio_element_report_codec_fmt(self);
     return ESP_OK;
@@ -702,7 +713,7 @@ static bool _check_range_done(audio_element_handle_t self)
     return last_range;
 }
 
-static int _http_read(audio_element_handle_t self, char *buffer, int len, TickType_t ticks_to_wait, void *context)
+static int _http_read_chunk(audio_element_handle_t self, char *buffer, int len, TickType_t ticks_to_wait, void *context)
 {
     http_stream_t *http = (http_stream_t *)audio_element_getdata(self);
     audio_element_info_t info;
@@ -778,6 +789,35 @@ static int _http_read(audio_element_handle_t self, char *buffer, int len, TickTy
     return rlen;
 }
 
+static int _http_read(audio_element_handle_t self, char *buffer, int len, TickType_t ticks_to_wait, void *context)
+{
+    http_stream_t *http = (http_stream_t *)audio_element_getdata(self);
+    int rlen = _http_read_chunk(self, buffer, len, ticks_to_wait, context);
+    if (http->seek_builder == NULL || http->is_playlist_resolved) {
+        return rlen;
+    }
+    // Frames before seek target are dropped, so decoder starts at the right frame
+    while (rlen > 0 && http->_errno == 0) {
+        int drop = seek_index_builder_feed(http->seek_builder, buffer, rlen);
+        if (drop < rlen) {
+            if (drop) {
+                memmove(buffer, buffer + drop, rlen - drop);
+            }
+            return rlen - drop;
+        }
+        rlen = _http_read_chunk(self, buffer, len, ticks_to_wait, context);
+    }
+    if (rlen == 0 && http->_errno == 0) {
+        // Index is complete only when all content received
+        audio_element_info_t info;
+        audio_element_getinfo(self, &info);
+        if (info.total_bytes > 0 && info.byte_pos >= info.total_bytes) {
+            seek_index_builder_finish(http->seek_builder);
+        }
+    }
+    return rlen;
+}
+
 static int _http_write(audio_element_handle_t self, char *buffer, int len, TickType_t ticks_to_wait, void *context)
 {
     http_stream_t *http = (http_stream_t *)audio_element_getdata(self);
@@ -839,6 +879,9 @@ static esp_err_t _http_destroy(audio_element_handle_t self)
         audio_free(http->playlist->data);
         audio_free(http->playlist);
     }
+    if (http->seek_builder) {
+        seek_index_builder_destroy(http->seek_builder);
+    }
     audio_free(http);
     return ESP_OK;
 }
@@ -995,3 +1038,39 @@ esp_err_t http_stream_set_server_cert(audio_element_handle_t el, const char *cer
     http->cert_pem = cert;
     return ESP_OK;
 }
+
+esp_err_t http_stream_set_seek_index(audio_element_handle_t el, seek_index_t *index)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_FAIL);
+    http_stream_t *http = (http_stream_t *)audio_element_getdata(el);
+    if (http->type != AUDIO_STREAM_READER) {
+        ESP_LOGE(TAG, "Seek index is only for reader");
+        return ESP_FAIL;
+    }
+    if (http->seek_builder) {
+        seek_index_builder_destroy(http->seek_builder);
+        http->seek_builder = NULL;
+    }
+    if (index) {
+        http->seek_builder = seek_index_builder_create(index);
+        AUDIO_MEM_CHECK(TAG, http->seek_builder, return ESP_ERR_NO_MEM);
+    }
+    return ESP_OK;
+}
+
+esp_err_t http_stream_seek(audio_element_handle_t el, uint32_t time_ms)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_FAIL);
+    http_stream_t *http = (http_stream_t *)audio_element_getdata(el);
+    if (http->seek_builder == NULL) {
+        ESP_LOGE(TAG, "No seek index, call http_stream_set_seek_index first");
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t pos = 0;
+    esp_err_t ret = seek_index_builder_seek(http->seek_builder, time_ms, &pos);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    // Range request of `_prepare_range` starts from the frame
+    return audio_element_set_byte_pos(el, pos);
+}
@@ -64,6 +64,12 @@ typedef struct i2s_stream {
     int                 volume;
     bool                uninstall_drv;
     int                 data_bit_width;
+    i2s_stream_clock_cb sync_clock;
+    void               *sync_ctx;
+    int64_t             sync_start_us;
+    int64_t             sync_consumed;  /* content frames consumed since the scheduled start */
+    int                 sync_err_q4;    /* filtered timing error in 1/16 frames */
+    i2s_stream_sync_info_t sync_info;
 } i2s_stream_t;
 #ifdef SOC_I2S_SUPPORTS_ADC_DAC
 static esp_err_t i2s_mono_fix(int bits, uint8_t *sbuff, uint32_t len)
@@ -277,11 +283,100 @@ static int _i2s_write(audio_element_handle_t self, char *buffer, int len, TickTy
     return bytes_written;
 }
 
+static void _i2s_fill_silence(i2s_stream_t *i2s, char *buf, int len)
+{
+#if SOC_I2S_SUPPORTS_ADC_DAC
+    if ((i2s->config.i2s_config.mode & I2S_MODE_DAC_BUILT_IN) != 0) {
+        memset(buf, 0x80, len);
+        return;
+    }
+#endif
+    memset(buf, 0x00, len);
+}
+
+/*
+ * Scheduled playback against an external (shared) clock. The content frame that should enter the DMA
+ * queue now is the one due at `now + queue latency`. Large errors are fixed by writing silence or
+ * discarding input, small ones by inserting or dropping a single frame per buffer.
+ */
+static int _i2s_sync_process(audio_element_handle_t self, i2s_stream_t *i2s, char *in_buffer, int in_len)
+{
+    audio_element_info_t info = {0};
+    audio_element_getinfo(self, &info);
+    int frame = info.channels * info.bits / 8;
+    if (frame <= 0 || info.sample_rates <= 0) {
+        return AEL_PROCESS_FAIL;
+    }
+    int max_frames = in_len / frame - 1;
+    int64_t queued = (int64_t)i2s->config.i2s_config.dma_buf_count * i2s->config.i2s_config.dma_buf_len;
+    int64_t due = (i2s->sync_clock(i2s->sync_ctx) - i2s->sync_start_us) * info.sample_rates / 1000000 + queued;
+    int64_t err = i2s->sync_consumed - due;
+    i2s->sync_info.err_us = (int)(err * 1000000 / info.sample_rates);
+    int silence = 0;
+    int discard = 0;
+    if (i2s->sync_consumed == 0 && due < 0) {
+        silence = -due < max_frames ? -due : max_frames;
+    } else if (err > info.sample_rates / 20) {
+        silence = err < max_frames ? err : max_frames;
+    } else if (err < -(info.sample_rates / 20)) {
+        discard = -err < max_frames ? -err : max_frames;
+    }
+    if (silence > 0) {
+        _i2s_fill_silence(i2s, in_buffer, silence * frame);
+        audio_element_multi_output(self, in_buffer, silence * frame, 0);
+        return audio_element_output(self, in_buffer, silence * frame);
+    }
+
+    int threshold_q4 = (info.sample_rates / 5000 + 1) * 16;
+    i2s->sync_err_q4 += ((int)err * 16 - i2s->sync_err_q4) / 8;
+    bool insert = (discard == 0) && (i2s->sync_err_q4 > threshold_q4);
+    bool drop = (discard == 0) && (i2s->sync_err_q4 < -threshold_q4);
+    int want = discard > 0 ? discard * frame : (insert ? max_frames * frame : in_len - in_len % frame);
+    int r_size = audio_element_input(self, in_buffer, want);
+    if (r_size == AEL_IO_TIMEOUT) {
+        /* Underrun, keep the DMA fed, the lost time is caught up by dropping frames later */
+        _i2s_fill_silence(i2s, in_buffer, in_len);
+        audio_element_multi_output(self, in_buffer, in_len, 0);
+        return audio_element_output(self, in_buffer, in_len);
+    } else if (r_size <= 0) {
+        esp_err_t ret = i2s_stream_clear_dma_buffer(self);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        return r_size;
+    }
+    i2s->sync_consumed += r_size / frame;
+    audio_element_update_byte_pos(self, r_size);
+    r_size -= r_size % frame;
+    if (discard > 0) {
+        i2s->sync_info.dropped += r_size / frame;
+        return r_size;
+    }
+    if (drop && r_size > frame) {
+        r_size -= frame;
+        i2s->sync_info.dropped++;
+        i2s->sync_err_q4 += 16;
+    } else if (insert && r_size >= frame) {
+        memcpy(in_buffer + r_size, in_buffer + r_size - frame, frame);
+        r_size += frame;
+        i2s->sync_info.inserted++;
+        i2s->sync_err_q4 -= 16;
+    }
+    if (i2s->use_alc) {
+        alc_volume_setup_process(in_buffer, r_size, info.channels, i2s->volume_handle, i2s->volume);
+    }
+    audio_element_multi_output(self, in_buffer, r_size, 0);
+    return audio_element_output(self, in_buffer, r_size);
+}
+
 static int _i2s_process(audio_element_handle_t self, char *in_buffer, int in_len)
 {
+    i2s_stream_t *i2s = (i2s_stream_t *)audio_element_getdata(self);
+    if (i2s->sync_clock && i2s->type == AUDIO_STREAM_WRITER) {
+        return _i2s_sync_process(self, i2s, in_buffer, in_len);
+    }
     int r_size = audio_element_input(self, in_buffer, in_len);
     int w_size = 0;
-    i2s_stream_t *i2s = (i2s_stream_t *)audio_element_getdata(self);
     audio_element_info_t i2s_info = {0};
     if (r_size == AEL_IO_TIMEOUT) {
 #if SOC_I2S_SUPPORTS_ADC_DAC
@@ -519,3 +614,30 @@ esp_err_t i2s_stream_sync_delay(audio_element_handle_t i2s_stream, int delay_ms)
 
     return ESP_OK;
 }
+
+esp_err_t i2s_stream_play_at(audio_element_handle_t i2s_stream, i2s_stream_clock_cb clock, void *ctx, int64_t start_us)
+{
+    AUDIO_NULL_CHECK(TAG, i2s_stream, return ESP_FAIL);
+    i2s_stream_t *i2s = (i2s_stream_t *)audio_element_getdata(i2s_stream);
+    if (i2s->type != AUDIO_STREAM_WRITER) {
+        ESP_LOGE(TAG, "Scheduled playback is only supported by AUDIO_STREAM_WRITER");
+        return ESP_FAIL;
+    }
+    i2s->sync_clock = NULL;
+    i2s->sync_ctx = ctx;
+    i2s->sync_start_us = start_us;
+    i2s->sync_consumed = 0;
+    i2s->sync_err_q4 = 0;
+    memset(&i2s->sync_info, 0, sizeof(i2s->sync_info));
+    i2s->sync_clock = clock;
+    return ESP_OK;
+}
+
+esp_err_t i2s_stream_get_sync_info(audio_element_handle_t i2s_stream, i2s_stream_sync_info_t *info)
+{
+    AUDIO_NULL_CHECK(TAG, i2s_stream, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, info, return ESP_FAIL);
+    i2s_stream_t *i2s = (i2s_stream_t *)audio_element_getdata(i2s_stream);
+    *info = i2s->sync_info;
+    return ESP_OK;
+}
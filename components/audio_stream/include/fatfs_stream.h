@@ -33,6 +33,8 @@
 extern "C" {
 #endif
 
+struct seek_index;  /* `seek_index_t` in seek_index.h of playlist component */
+
 /**
  * @brief   FATFS Stream configurations, if any entry is zero then the configuration will be set to default values
  */
@@ -76,6 +78,42 @@ typedef struct {
  */
 audio_element_handle_t fatfs_stream_init(fatfs_stream_cfg_t *config);
 
+/**
+ * @brief      Set seek index of the file to play, used by `fatfs_stream_seek`
+ *
+ * @note       Index got from `playlist_get_seek_index` or `seek_index_build_file` is used as is.
+ *             An empty or partial index (cleared to zero if none saved) is filled while file is read,
+ *             and is flagged SEEK_INDEX_FLAG_COMPLETE when end of file reached, then it can be saved with
+ *             `playlist_save_seek_index`. Set it again when uri changed.
+ *
+ * @param      el     The fatfs_stream reader element handle
+ * @param      index  Seek index of current file, must be valid until unset, NULL to unset
+ *
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_NO_MEM on no memory
+ *     - ESP_FAIL on errors
+ */
+esp_err_t fatfs_stream_set_seek_index(audio_element_handle_t el, struct seek_index *index);
+
+/**
+ * @brief      Seek to a time with seek index
+ *
+ * @note       File is opened at the nearest indexed frame before `time_ms`, then frames are dropped
+ *             until the first frame at or after `time_ms`, so position is exact even for VBR MP3.
+ *             Call it when element is stopped, then run pipeline.
+ *
+ * @param      el       The fatfs_stream reader element handle
+ * @param      time_ms  Time to play from
+ *
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_NOT_FOUND if index is empty
+ *     - ESP_ERR_INVALID_STATE if seek index not set
+ *     - ESP_FAIL on errors
+ */
+esp_err_t fatfs_stream_seek(audio_element_handle_t el, uint32_t time_ms);
+
 #ifdef __cplusplus
 }
 #endif
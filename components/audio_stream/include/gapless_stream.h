@@ -0,0 +1,225 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _GAPLESS_STREAM_H_
+#define _GAPLESS_STREAM_H_
+
+#include "audio_element.h"
+#include "audio_pipeline.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Gapless stream joins PCM of several tracks into one continuous output.
+ *        Each track is decoded by its own source pipeline into one input slot (multiple input ringbuffer),
+ *        while a track plays the next one is decoded ahead into the other slot.
+ *        At the boundary the last sample of a track is followed directly by the first sample of the next one,
+ *        encoder delay and padding are dropped when given by `gapless_stream_track_t`.
+ *
+ *        e.g. [file0]->[dec0]--slot 0--\
+ *                                        [gapless]->[i2s]
+ *             [file1]->[dec1]--slot 1--/
+ *
+ * @note  Tracks with different PCM format are joined as well, the element reports new music info
+ *        before first sample of such track, the writer should follow it (e.g. `i2s_stream_set_clk`).
+ */
+
+#define GAPLESS_STREAM_SLOT_NUM             (2)
+
+#define GAPLESS_STREAM_TASK_STACK           (3 * 1024)
+#define GAPLESS_STREAM_TASK_CORE            (0)
+#define GAPLESS_STREAM_TASK_PRIO            (5)
+#define GAPLESS_STREAM_RINGBUFFER_SIZE      (8 * 1024)
+#define GAPLESS_STREAM_BUF_SIZE             (2 * 1024)
+#define GAPLESS_STREAM_PREFETCH_SIZE        (32 * 1024)
+#define GAPLESS_STREAM_MP3_DECODER_DELAY    (529)
+
+/**
+ * @brief Gapless stream event
+ */
+typedef enum {
+    GAPLESS_STREAM_EVENT_TRACK_START = 1,   /*!< First sample of track is read */
+    GAPLESS_STREAM_EVENT_TRACK_END,         /*!< Last sample of track is read, its slot can be used for another track */
+} gapless_stream_event_id_t;
+
+/**
+ * @brief Gapless stream event message
+ */
+typedef struct {
+    gapless_stream_event_id_t   id;         /*!< Event id */
+    int                         slot;       /*!< Input slot of track */
+    void                        *user_data; /*!< User data of track */
+    uint64_t                    pos;        /*!< Samples output by element before the event */
+} gapless_stream_event_msg_t;
+
+typedef void (*gapless_stream_event_cb_t)(audio_element_handle_t el, gapless_stream_event_msg_t *msg, void *ctx);
+
+/**
+ * @brief Gapless stream configurations
+ */
+typedef struct {
+    int                         out_rb_size;    /*!< Size of output ringbuffer */
+    int                         buffer_len;     /*!< Size of buffer to join tracks */
+    int                         task_stack;     /*!< Task stack size */
+    int                         task_core;      /*!< Task running in core (0 or 1) */
+    int                         task_prio;      /*!< Task priority (based on freeRTOS priority) */
+    bool                        stack_in_ext;   /*!< Try to allocate stack in external memory */
+    gapless_stream_event_cb_t   event_cb;       /*!< Called in element task when track starts or ends, should not block */
+    void                        *event_ctx;     /*!< Context of event callback */
+} gapless_stream_cfg_t;
+
+#define GAPLESS_STREAM_CFG_DEFAULT() {              \
+    .out_rb_size    = GAPLESS_STREAM_RINGBUFFER_SIZE, \
+    .buffer_len     = GAPLESS_STREAM_BUF_SIZE,      \
+    .task_stack     = GAPLESS_STREAM_TASK_STACK,    \
+    .task_core      = GAPLESS_STREAM_TASK_CORE,     \
+    .task_prio      = GAPLESS_STREAM_TASK_PRIO,     \
+    .stack_in_ext   = true,                         \
+}
+
+/**
+ * @brief Track queued to a slot
+ */
+typedef struct {
+    audio_element_handle_t  src;            /*!< Element writes PCM of track to the slot, its music info gives PCM format.
+                                                 NULL to use music info of gapless stream */
+    uint32_t                skip_samples;   /*!< Samples dropped at start, encoder delay plus decoder delay */
+    uint32_t                total_samples;  /*!< Samples played after skipped ones, rest is padding. 0 to play until source done */
+    void                    *user_data;     /*!< User data passed by event */
+} gapless_stream_track_t;
+
+/**
+ * @brief Gapless sequencer configurations, it plays URLs of a playlist with gapless stream
+ */
+typedef struct {
+    struct playlist_handle  *playlist;                          /*!< Playlist (`playlist_handle_t`), play starts from its current URL */
+    audio_pipeline_handle_t pipeline[GAPLESS_STREAM_SLOT_NUM];  /*!< Source pipelines, one per slot */
+    audio_element_handle_t  reader[GAPLESS_STREAM_SLOT_NUM];    /*!< First element of source pipeline, URI is set to it */
+    audio_element_handle_t  decoder[GAPLESS_STREAM_SLOT_NUM];   /*!< Last element of source pipeline, output to slot */
+    int                     prefetch_size;                      /*!< Size of ringbuffer between decoder and slot,
+                                                                     PCM of next track is decoded ahead up to this size */
+    int                     mp3_decoder_delay;                  /*!< Samples MP3 decoder outputs before first encoded sample */
+    int                     task_stack;                         /*!< Task stack size of sequencer */
+    int                     task_core;                          /*!< Task running in core (0 or 1) */
+    int                     task_prio;                          /*!< Task priority (based on freeRTOS priority) */
+} gapless_stream_seq_cfg_t;
+
+#define GAPLESS_STREAM_SEQ_CFG_DEFAULT() {                      \
+    .prefetch_size      = GAPLESS_STREAM_PREFETCH_SIZE,         \
+    .mp3_decoder_delay  = GAPLESS_STREAM_MP3_DECODER_DELAY,     \
+    .task_stack         = GAPLESS_STREAM_TASK_STACK,            \
+    .task_core          = GAPLESS_STREAM_TASK_CORE,             \
+    .task_prio          = GAPLESS_STREAM_TASK_PRIO,             \
+}
+
+/**
+ * @brief      Initialize gapless stream
+ *
+ * @param      config  The gapless stream configuration
+ *
+ * @return     The audio element handle
+ */
+audio_element_handle_t gapless_stream_init(gapless_stream_cfg_t *config);
+
+/**
+ * @brief      Queue a track to slot, tracks are played in queued order
+ *
+ * @note       Ringbuffer of slot is set by `audio_element_set_multi_input_ringbuf`,
+ *             the slot can be queued again after GAPLESS_STREAM_EVENT_TRACK_END of it
+ *
+ * @param      el      The gapless stream handle
+ * @param      slot    Input slot, less than GAPLESS_STREAM_SLOT_NUM
+ * @param      track   Track information
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL   slot is used by another track
+ */
+esp_err_t gapless_stream_queue(audio_element_handle_t el, int slot, gapless_stream_track_t *track);
+
+/**
+ * @brief      No more track will be queued, the element finishes after queued tracks
+ *
+ * @param      el      The gapless stream handle
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t gapless_stream_finish(audio_element_handle_t el);
+
+/**
+ * @brief      End the playing track now and join the next one
+ *
+ * @param      el      The gapless stream handle
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t gapless_stream_skip(audio_element_handle_t el);
+
+/**
+ * @brief      Start to play URLs of playlist from its current URL
+ *
+ * @note       Current URL and next URL are opened at once, next URL is taken by `playlist_next`
+ *             so current URL of playlist is one track ahead of playing one.
+ *             When a track ends its source pipeline is reset and opens the URL after next.
+ *             Encoder delay and padding are read by `media_probe_file` for local files.
+ *             Playback finishes when `playlist_next` fails, e.g. PLAYLIST_REPEAT_NONE at end of playlist.
+ *             When reader or decoder of a slot reports an error (e.g. missing file) the track ends after
+ *             the PCM decoded so far and playback goes on with the next URL.
+ *             The sequencer is the listener of source pipelines, do not set another one on them.
+ *             User data of track in events is the URL, it is valid until the GAPLESS_STREAM_EVENT_TRACK_END
+ *             callback of the track returns.
+ *
+ * @param      el      The gapless stream handle
+ * @param      config  The sequencer configuration
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t gapless_stream_seq_start(audio_element_handle_t el, gapless_stream_seq_cfg_t *config);
+
+/**
+ * @brief      Stop sequencer and source pipelines, release ringbuffers of slots
+ *
+ * @note       Stop the pipeline of gapless stream before, it reads from ringbuffers of slots
+ *
+ * @param      el      The gapless stream handle
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t gapless_stream_seq_stop(audio_element_handle_t el);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -33,6 +33,8 @@
 extern "C" {
 #endif
 
+struct seek_index;  /* `seek_index_t` in seek_index.h of playlist component */
+
 /**
  * @brief      HTTP Stream hook type
  */
@@ -168,6 +170,39 @@ esp_err_t http_stream_fetch_again(audio_element_handle_t el);
  */
 esp_err_t http_stream_set_server_cert(audio_element_handle_t el, const char *cert);
 
+/**
+ * @brief       Set seek index of the URI to play, used by `http_stream_seek`
+ * @note        Not used for playlist and HLS. An empty or partial index (cleared to zero if none saved) is filled
+ *              while content is received, and is flagged SEEK_INDEX_FLAG_COMPLETE when all content received.
+ *              Set it again when URI changed.
+ *
+ * @param       el     The http_stream reader element handle
+ * @param       index  Seek index of current URI, must be valid until unset, NULL to unset
+ *
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_NO_MEM on no memory
+ *     - ESP_FAIL on errors
+ */
+esp_err_t http_stream_set_seek_index(audio_element_handle_t el, struct seek_index *index);
+
+/**
+ * @brief       Seek to a time with seek index
+ * @note        Content is requested with range from the nearest indexed frame before `time_ms`,
+ *              frames are dropped until the first frame at or after `time_ms`.
+ *              Call it when element is stopped, then run pipeline.
+ *
+ * @param       el       The http_stream reader element handle
+ * @param       time_ms  Time to play from
+ *
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_NOT_FOUND if index is empty
+ *     - ESP_ERR_INVALID_STATE if seek index not set
+ *     - ESP_FAIL on errors
+ */
+esp_err_t http_stream_seek(audio_element_handle_t el, uint32_t time_ms);
+
 #ifdef __cplusplus
 }
 #endif
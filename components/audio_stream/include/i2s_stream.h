@@ -56,6 +56,20 @@ typedef struct {
     int                     buffer_len;         /*!< Buffer length use for an Element. Note: when 'bits_per_sample' is 24 bit, the buffer length must be a multiple of 3. The recommended value is 3600 */
 } i2s_stream_cfg_t;
 
+/**
+ * @brief      Clock source for scheduled playback, returns the current time of the timeline in microseconds
+ */
+typedef int64_t (*i2s_stream_clock_cb)(void *ctx);
+
+/**
+ * @brief      Scheduled playback status
+ */
+typedef struct {
+    int         err_us;         /*!< Last measured timing error, positive when the output is ahead of the timeline */
+    uint32_t    inserted;       /*!< Frames inserted to slow down */
+    uint32_t    dropped;        /*!< Frames dropped to catch up */
+} i2s_stream_sync_info_t;
+
 #define I2S_STREAM_TASK_STACK           (3072+512)
 #define I2S_STREAM_BUF_SIZE             (3600)
 #define I2S_STREAM_TASK_PRIO            (23)
@@ -300,6 +314,37 @@ esp_err_t i2s_alc_volume_get(audio_element_handle_t i2s_stream, int *volume);
  */
 esp_err_t i2s_stream_sync_delay(audio_element_handle_t i2s_stream, int delay_ms);
 
+/**
+ * @brief      Schedule the first incoming sample to be played at `start_us` on the timeline given by `clock`,
+ *             e.g. `clock_sync_get_time_us` of the clock sync service for multi-room playback.
+ *             Silence is played until the start time, afterwards single frames are inserted or dropped
+ *             to keep the output aligned with the timeline.
+ *
+ * @note       Only for AUDIO_STREAM_WRITER. The DMA queue is assumed to be full while streaming.
+ *
+ * @param[in]  i2s_stream   The i2s element handle
+ * @param[in]  clock        Timeline clock, NULL to disable scheduled playback
+ * @param[in]  ctx          Context passed to `clock`
+ * @param[in]  start_us     Timeline time of the first sample
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t i2s_stream_play_at(audio_element_handle_t i2s_stream, i2s_stream_clock_cb clock, void *ctx, int64_t start_us);
+
+/**
+ * @brief      Get the status of scheduled playback
+ *
+ * @param[in]  i2s_stream   The i2s element handle
+ * @param[out] info         The status
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t i2s_stream_get_sync_info(audio_element_handle_t i2s_stream, i2s_stream_sync_info_t *info);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,226 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _MIXER_STREAM_H_
+#define _MIXER_STREAM_H_
+
+#include "audio_element.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Mixer stream mixes PCM of several inputs (multiple input ringbuffers) into one output.
+ *        Each input is converted to output format: sample bits, channels and sample rate (linear interpolation).
+ *        Inputs can be attached and detached while the element is running, each of them has own gain and fade,
+ *        and a sidechain input (e.g. voice prompt) ducks the others while its level is above threshold.
+ *
+ *        e.g. [file0]->[dec0]--input 0 (music)--\
+ *                                                 [mixer]->[i2s]
+ *             [tone]->[dec1]---input 1 (voice)--/
+ *
+ * @note  Samples are mixed with 16 bits precision in 32 bits accumulator and saturated to output.
+ *        Linear interpolation suits prompts and voice,
+ *        put a resample filter in source pipeline if music needs high quality sample rate conversion.
+ */
+
+#define MIXER_STREAM_MAX_INPUT          (8)
+#define MIXER_STREAM_GAIN_MUTE          (-96.0f)
+#define MIXER_STREAM_GAIN_MAX           (12.0f)
+
+#define MIXER_STREAM_TASK_STACK         (3 * 1024)
+#define MIXER_STREAM_TASK_CORE          (0)
+#define MIXER_STREAM_TASK_PRIO          (5)
+#define MIXER_STREAM_RINGBUFFER_SIZE    (8 * 1024)
+#define MIXER_STREAM_INPUT_NUM          (4)
+#define MIXER_STREAM_FRAME_MS           (10)
+#define MIXER_STREAM_INPUT_TIMEOUT_MS   (5)
+
+/**
+ * @brief Mixer stream event
+ */
+typedef enum {
+    MIXER_STREAM_EVENT_INPUT_DONE = 1,  /*!< Input ringbuffer is done or aborted, all its samples are mixed */
+    MIXER_STREAM_EVENT_FADE_DONE,       /*!< Gain of input reaches target of fade or crossfade */
+    MIXER_STREAM_EVENT_INPUT_DETACHED,  /*!< Input faded out by crossfade is detached, its ringbuffer is not read anymore */
+} mixer_stream_event_id_t;
+
+/**
+ * @brief Mixer stream event message
+ */
+typedef struct {
+    mixer_stream_event_id_t id;         /*!< Event id */
+    int                     index;      /*!< Index of input */
+    void                    *user_data; /*!< User data of input */
+} mixer_stream_event_msg_t;
+
+typedef void (*mixer_stream_event_cb_t)(audio_element_handle_t el, mixer_stream_event_msg_t *msg, void *ctx);
+
+/**
+ * @brief Mixer stream configurations
+ */
+typedef struct {
+    int                     sample_rate;        /*!< Output sample rate */
+    int                     channels;           /*!< Output channels, 1 or 2 */
+    int                     bits;               /*!< Output sample bits, 16 or 32 */
+    int                     input_num;          /*!< Maximum number of inputs, up to MIXER_STREAM_MAX_INPUT */
+    int                     frame_ms;           /*!< Duration mixed by one process, also the step of gain ramps */
+    float                   duck_db;            /*!< Gain applied to other inputs while sidechain input is active */
+    float                   duck_threshold_db;  /*!< Level of sidechain input (dBFS) to start ducking */
+    int                     duck_attack_ms;     /*!< Time for ducked inputs to fall from 0 dB to `duck_db` */
+    int                     duck_release_ms;    /*!< Time for ducked inputs to rise from `duck_db` to 0 dB */
+    int                     duck_hold_ms;       /*!< Ducking holds for this time after sidechain level drops below threshold,
+                                                     avoids pumping between words */
+    int                     out_rb_size;        /*!< Size of output ringbuffer */
+    int                     task_stack;         /*!< Task stack size */
+    int                     task_core;          /*!< Task running in core (0 or 1) */
+    int                     task_prio;          /*!< Task priority (based on freeRTOS priority) */
+    bool                    stack_in_ext;       /*!< Try to allocate stack in external memory */
+    mixer_stream_event_cb_t event_cb;           /*!< Called in element task, mixer stream APIs can be called in it */
+    void                    *event_ctx;         /*!< Context of event callback */
+} mixer_stream_cfg_t;
+
+#define MIXER_STREAM_CFG_DEFAULT() {                    \
+    .sample_rate        = 48000,                        \
+    .channels           = 2,                            \
+    .bits               = 16,                           \
+    .input_num          = MIXER_STREAM_INPUT_NUM,       \
+    .frame_ms           = MIXER_STREAM_FRAME_MS,        \
+    .duck_db            = -12.0f,                       \
+    .duck_threshold_db  = -40.0f,                       \
+    .duck_attack_ms     = 50,                           \
+    .duck_release_ms    = 300,                          \
+    .duck_hold_ms       = 200,                          \
+    .out_rb_size        = MIXER_STREAM_RINGBUFFER_SIZE, \
+    .task_stack         = MIXER_STREAM_TASK_STACK,      \
+    .task_core          = MIXER_STREAM_TASK_CORE,       \
+    .task_prio          = MIXER_STREAM_TASK_PRIO,       \
+    .stack_in_ext       = true,                         \
+}
+
+/**
+ * @brief Mixer stream input configurations
+ */
+typedef struct {
+    audio_element_handle_t  src;            /*!< Element writes PCM to the input, format follows its music info when set.
+                                                 NULL to use format below */
+    int                     sample_rate;    /*!< Input sample rate, 0 for output sample rate */
+    int                     channels;       /*!< Input channels (1 or 2), 0 for output channels */
+    int                     bits;           /*!< Input sample bits (16, 24 or 32), 0 for output sample bits */
+    float                   gain_db;        /*!< Gain of input, up to MIXER_STREAM_GAIN_MAX */
+    int                     fade_in_ms;     /*!< Fade in from mute when attached, 0 to play with `gain_db` at once */
+    bool                    sidechain;      /*!< Input ducks the others while active and is never ducked itself */
+    int                     timeout_ms;     /*!< Time to wait for samples of input in each process, silence is mixed after it.
+                                                 Waits of all inputs in one process end within `frame_ms`,
+                                                 and once an input gave samples the others do not wait */
+    void                    *user_data;     /*!< User data passed by event */
+} mixer_stream_input_cfg_t;
+
+#define MIXER_STREAM_INPUT_CFG_DEFAULT() {              \
+    .timeout_ms         = MIXER_STREAM_INPUT_TIMEOUT_MS, \
+}
+
+/**
+ * @brief      Initialize mixer stream
+ *
+ * @param      config  The mixer stream configuration
+ *
+ * @return     The audio element handle
+ */
+audio_element_handle_t mixer_stream_init(mixer_stream_cfg_t *config);
+
+/**
+ * @brief      Attach a ringbuffer as input, it can be called while the element is running
+ *
+ * @param      el      The mixer stream handle
+ * @param      index   Input index, less than `input_num` of configuration
+ * @param      rb      Ringbuffer written by source pipeline
+ * @param      config  Input configuration
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL   input is attached already or configuration is wrong
+ */
+esp_err_t mixer_stream_attach(audio_element_handle_t el, int index, ringbuf_handle_t rb, mixer_stream_input_cfg_t *config);
+
+/**
+ * @brief      Detach input, its ringbuffer is not read anymore after return
+ *
+ * @param      el      The mixer stream handle
+ * @param      index   Input index
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t mixer_stream_detach(audio_element_handle_t el, int index);
+
+/**
+ * @brief      Ramp gain of input linearly to `gain_db`
+ *
+ * @param      el       The mixer stream handle
+ * @param      index    Input index
+ * @param      gain_db  Target gain, MIXER_STREAM_GAIN_MUTE or less to mute
+ * @param      ramp_ms  Ramp time, 0 to set at once
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL   input is not attached
+ */
+esp_err_t mixer_stream_set_gain(audio_element_handle_t el, int index, float gain_db, int ramp_ms);
+
+/**
+ * @brief      Crossfade from one input to another with equal power curve
+ *
+ * @note       Input `from` fades out and is detached at the end with MIXER_STREAM_EVENT_INPUT_DETACHED.
+ *             Input `to` fades in to its `gain_db`, from mute if none of its samples is mixed yet.
+ *
+ * @param      el       The mixer stream handle
+ * @param      from     Input index fades out
+ * @param      to       Input index fades in
+ * @param      fade_ms  Crossfade time
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL   input is not attached
+ */
+esp_err_t mixer_stream_crossfade(audio_element_handle_t el, int from, int to, int fade_ms);
+
+/**
+ * @brief      No more input will be attached, the element finishes when all inputs are done or detached
+ *
+ * @param      el      The mixer stream handle
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t mixer_stream_finish(audio_element_handle_t el);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
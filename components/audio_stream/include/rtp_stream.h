@@ -0,0 +1,163 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _RTP_STREAM_H_
+#define _RTP_STREAM_H_
+
+#include "audio_error.h"
+#include "audio_element.h"
+#include "audio_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Packet loss concealment callback, called by the RTP reader when a packet is declared lost
+ *
+ * @param      el        The audio element handle
+ * @param      buf       Buffer to be filled with the concealment audio
+ * @param      len       Number of bytes to fill (one packet worth of PCM)
+ * @param      last      Payload of the last played packet (NULL if none), can be used for repetition
+ * @param      last_len  Length of `last`
+ * @param      ctx       User context from `rtp_stream_cfg_t`
+ *
+ * @return     Number of bytes filled, `len` is used if the value is not in range
+ */
+typedef int (*rtp_stream_plc_cb)(audio_element_handle_t el, char *buf, int len, const char *last, int last_len, void *ctx);
+
+/**
+ * @brief   RTP Stream configurations, if any entry is zero then the configuration will be set to default values
+ *
+ *          - AUDIO_STREAM_READER: receive RTP packets on `port`, reorder them in the jitter buffer and output PCM
+ *          - AUDIO_STREAM_WRITER: packetize the incoming PCM into RTP packets and send them to `host`:`port`
+ *
+ *          The payload is linear PCM, 16-bit samples are sent in network byte order (L16, RFC 3551)
+ */
+typedef struct {
+    audio_stream_type_t     type;               /*!< Stream type */
+    const char              *host;              /*!< Writer: destination address. Reader: multicast group to join, NULL for unicast */
+    int                     port;               /*!< Writer: destination port. Reader: local port to bind */
+    int                     sample_rate;        /*!< PCM sample rate, used for the RTP clock */
+    int                     channels;           /*!< PCM channels */
+    int                     bits;               /*!< PCM bits per sample */
+    int                     payload_type;       /*!< RTP payload type, used as is since 0 is a valid static type */
+    uint32_t                ssrc;               /*!< Writer: SSRC, a random one is used if 0 */
+    int                     frame_ms;           /*!< Writer: packetization interval in ms. Reader: expected interval, sizes the jitter buffer slots */
+    int                     multicast_ttl;      /*!< Writer: TTL of multicast packets */
+    int                     jitter_min_ms;      /*!< Reader: lower bound of the adaptive jitter buffer delay */
+    int                     jitter_max_ms;      /*!< Reader: upper bound of the adaptive jitter buffer delay */
+    int                     jitter_slots;       /*!< Reader: number of packet slots, must be power of 2 */
+    int                     timeout_ms;         /*!< Reader: read returns timeout if nothing can be played within this time */
+    rtp_stream_plc_cb       plc;                /*!< Reader: packet loss concealment hook, silence is inserted if NULL */
+    void                    *plc_ctx;           /*!< Reader: user context of `plc` */
+    int                     out_rb_size;        /*!< Size of output ringbuffer */
+    int                     task_stack;         /*!< Task stack size */
+    int                     task_core;          /*!< Task running in core (0 or 1) */
+    int                     task_prio;          /*!< Task priority (based on freeRTOS priority) */
+    bool                    ext_stack;          /*!< Allocate stack on extern ram */
+} rtp_stream_cfg_t;
+
+/**
+ * @brief   RTP Stream statistics
+ */
+typedef struct {
+    uint32_t    packets;        /*!< Packets sent (writer) or received (reader) */
+    uint32_t    lost;           /*!< Packets declared lost and concealed */
+    uint32_t    late;           /*!< Packets dropped because they arrived after their play-out */
+    uint32_t    duplicated;     /*!< Duplicated packets dropped */
+    uint32_t    overflow;       /*!< Packets dropped to keep the delay under `jitter_max_ms` */
+    uint32_t    underruns;      /*!< Jitter buffer ran empty and re-buffered */
+    int         jitter_us;      /*!< Interarrival jitter estimate (RFC 3550) */
+    int         target_ms;      /*!< Current jitter buffer target delay */
+    int         buffered_ms;    /*!< Audio currently held in the jitter buffer */
+} rtp_stream_stats_t;
+
+#define RTP_STREAM_TASK_STACK           (3072)
+#define RTP_STREAM_TASK_CORE            (0)
+#define RTP_STREAM_TASK_PRIO            (6)
+#define RTP_STREAM_RINGBUFFER_SIZE      (4 * 1024)
+#define RTP_STREAM_DEFAULT_PORT         (5004)
+#define RTP_STREAM_PAYLOAD_TYPE         (96)
+#define RTP_STREAM_SAMPLE_RATE          (16000)
+#define RTP_STREAM_CHANNELS             (1)
+#define RTP_STREAM_BITS                 (16)
+#define RTP_STREAM_FRAME_MS             (10)
+#define RTP_STREAM_JITTER_MIN_MS        (20)
+#define RTP_STREAM_JITTER_MAX_MS        (200)
+#define RTP_STREAM_JITTER_SLOTS         (32)
+#define RTP_STREAM_MAX_PAYLOAD          (1400)
+
+#define RTP_STREAM_CFG_DEFAULT() {                  \
+    .type = AUDIO_STREAM_READER,                    \
+    .host = NULL,                                   \
+    .port = RTP_STREAM_DEFAULT_PORT,                \
+    .sample_rate = RTP_STREAM_SAMPLE_RATE,          \
+    .channels = RTP_STREAM_CHANNELS,                \
+    .bits = RTP_STREAM_BITS,                        \
+    .payload_type = RTP_STREAM_PAYLOAD_TYPE,        \
+    .ssrc = 0,                                      \
+    .frame_ms = RTP_STREAM_FRAME_MS,                \
+    .multicast_ttl = 1,                             \
+    .jitter_min_ms = RTP_STREAM_JITTER_MIN_MS,      \
+    .jitter_max_ms = RTP_STREAM_JITTER_MAX_MS,      \
+    .jitter_slots = RTP_STREAM_JITTER_SLOTS,        \
+    .timeout_ms = 1000,                             \
+    .plc = NULL,                                    \
+    .plc_ctx = NULL,                                \
+    .out_rb_size = RTP_STREAM_RINGBUFFER_SIZE,      \
+    .task_stack = RTP_STREAM_TASK_STACK,            \
+    .task_core = RTP_STREAM_TASK_CORE,              \
+    .task_prio = RTP_STREAM_TASK_PRIO,              \
+    .ext_stack = false,                             \
+}
+
+/**
+ * @brief      Create a handle to an Audio Element to receive RTP audio from the network to another Element
+ *             or send the data of other elements as RTP packets, depending on the configuration
+ *             the stream type, either AUDIO_STREAM_READER or AUDIO_STREAM_WRITER.
+ *
+ * @param      config  The configuration
+ *
+ * @return     The Audio Element handle
+ */
+audio_element_handle_t rtp_stream_init(rtp_stream_cfg_t *config);
+
+/**
+ * @brief      Get the statistics of the RTP stream
+ *
+ * @param      el     The audio element handle
+ * @param      stats  The statistics output
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t rtp_stream_get_stats(audio_element_handle_t el, rtp_stream_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -36,6 +36,7 @@ extern "C" {
 typedef enum {
     TCP_STREAM_STATE_NONE,
     TCP_STREAM_STATE_CONNECTED,
+    TCP_STREAM_STATE_RECONNECTED,
 } tcp_stream_status_t;
 
 /**
@@ -64,6 +65,19 @@ typedef struct {
     bool                        ext_stack;          /*!< Allocate stack on extern ram */
     tcp_stream_event_handle_cb  event_handler;      /*!< TCP stream event callback*/
     void                        *event_ctx;         /*!< User context*/
+    int                         out_rb_size;        /*!< Size of output ringbuffer, use default if 0 */
+    bool                        nodelay;            /*!< Set TCP_NODELAY on the socket (disable Nagle in the stack) */
+    bool                        keep_alive_enable;  /*!< Enable TCP keep-alive */
+    int                         keep_alive_idle;    /*!< Keep-alive idle time in seconds, stack default if 0 */
+    int                         keep_alive_interval;/*!< Keep-alive probe interval in seconds, stack default if 0 */
+    int                         keep_alive_count;   /*!< Keep-alive probe count, stack default if 0 */
+    int                         sndbuf_size;        /*!< Socket send buffer size (SO_SNDBUF), stack default if 0 */
+    int                         rcvbuf_size;        /*!< Socket receive buffer size (SO_RCVBUF), stack default if 0 */
+    int                         coalesce_size;      /*!< Writer only: gather small writes up to this many bytes before sending, 0 to disable */
+    int                         coalesce_ms;        /*!< Writer only: latency budget in ms for coalesced data, 0 to only send when full or on finish */
+    int                         reconnect_max;      /*!< Number of reconnect attempts on connect or I/O failure, 0 to disable */
+    int                         reconnect_delay_ms; /*!< Delay before the first reconnect attempt, doubled on each failed attempt */
+    int                         reconnect_delay_max_ms; /*!< Upper bound of the reconnect backoff delay */
 } tcp_stream_cfg_t;
 
 /**
@@ -75,6 +89,10 @@ typedef struct {
 #define TCP_STREAM_BUF_SIZE                 (2048)
 #define TCP_STREAM_TASK_PRIO                (5)
 #define TCP_STREAM_TASK_CORE                (0)
+#define TCP_STREAM_RINGBUFFER_SIZE          (8 * 1024)
+
+#define TCP_STREAM_RECONNECT_DELAY_MS       (100)
+#define TCP_STREAM_RECONNECT_DELAY_MAX_MS   (5000)
 
 #define TCP_SERVER_DEFAULT_RESPONSE_LENGTH  (512)
 
@@ -89,6 +107,14 @@ typedef struct {
     .ext_stack     = true,                      \
     .event_handler = NULL,                      \
     .event_ctx     = NULL,                      \
+    .out_rb_size   = TCP_STREAM_RINGBUFFER_SIZE,\
+    .nodelay       = false,                     \
+    .keep_alive_enable = false,                 \
+    .coalesce_size = 0,                         \
+    .coalesce_ms   = 0,                         \
+    .reconnect_max = 0,                         \
+    .reconnect_delay_ms = TCP_STREAM_RECONNECT_DELAY_MS,         \
+    .reconnect_delay_max_ms = TCP_STREAM_RECONNECT_DELAY_MAX_MS, \
 }
 
 /**
@@ -54,6 +54,11 @@ typedef struct {
     int                     task_core;          /*!< Task running in core (0 or 1) */
     int                     task_prio;          /*!< Task priority (based on freeRTOS priority) */
     bool                    ext_stack;          /*!< Allocate stack on extern ram */
+    bool                    streaming;          /*!< Synthesize sentence by sentence on a separate task, playback starts after the first sentence */
+    int                     synth_rb_size;      /*!< Size of the ringbuffer between the synthesis task and the element (streaming mode) */
+    int                     synth_task_stack;   /*!< Synthesis task stack size (streaming mode) */
+    int                     synth_task_prio;    /*!< Synthesis task priority (streaming mode) */
+    int                     cache_size;         /*!< Bytes of synthesized PCM kept for repeated strings (streaming mode), 0 to disable */
 } tts_stream_cfg_t;
 
 #define TTS_STREAM_BUF_SIZE             (4096)
@@ -61,15 +66,23 @@ typedef struct {
 #define TTS_STREAM_TASK_CORE            (0)
 #define TTS_STREAM_TASK_PRIO            (4)
 #define TTS_STREAM_RINGBUFFER_SIZE      (8 * 1024)
+#define TTS_STREAM_SYNTH_RB_SIZE        (16 * 1024)
+#define TTS_STREAM_SYNTH_TASK_STACK     (3072)
+#define TTS_STREAM_SYNTH_TASK_PRIO      (5)
 
-#define TTS_STREAM_CFG_DEFAULT() {                  \
-    .type = AUDIO_STREAM_READER,                    \
-    .buf_sz = TTS_STREAM_BUF_SIZE,                  \
-    .out_rb_size = TTS_STREAM_RINGBUFFER_SIZE,      \
-    .task_stack = TTS_STREAM_TASK_STACK,            \
-    .task_core = TTS_STREAM_TASK_CORE,              \
-    .task_prio = TTS_STREAM_TASK_PRIO,              \
-    .ext_stack = false,                             \
+#define TTS_STREAM_CFG_DEFAULT() {                      \
+    .type = AUDIO_STREAM_READER,                        \
+    .buf_sz = TTS_STREAM_BUF_SIZE,                      \
+    .out_rb_size = TTS_STREAM_RINGBUFFER_SIZE,          \
+    .task_stack = TTS_STREAM_TASK_STACK,                \
+    .task_core = TTS_STREAM_TASK_CORE,                  \
+    .task_prio = TTS_STREAM_TASK_PRIO,                  \
+    .ext_stack = false,                                 \
+    .streaming = false,                                 \
+    .synth_rb_size = TTS_STREAM_SYNTH_RB_SIZE,          \
+    .synth_task_stack = TTS_STREAM_SYNTH_TASK_STACK,    \
+    .synth_task_prio = TTS_STREAM_SYNTH_TASK_PRIO,      \
+    .cache_size = 0,                                    \
 }
 
 /**
@@ -118,6 +131,18 @@ esp_err_t tts_stream_set_speed(audio_element_handle_t el, tts_voice_speed_t spee
  */
 esp_err_t tts_stream_get_speed(audio_element_handle_t el, tts_voice_speed_t *speed);
 
+/**
+ * @brief      Release the PCM cached for repeated strings, only used in streaming mode.
+ *             The cache is kept in external RAM when it is available.
+ *
+ * @param[in]  el       The audio element handle
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t tts_stream_clear_cache(audio_element_handle_t el);
+
 #ifdef __cplusplus
 }
 #endif
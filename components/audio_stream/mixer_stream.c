@@ -0,0 +1,691 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "mixer_stream.h"
+#include "audio_error.h"
+#include "audio_mem.h"
+#include "esp_log.h"
+
+static const char *TAG = "MIXER_STREAM";
+
+#define MIXER_IDLE_TICKS        (pdMS_TO_TICKS(50))
+#define MIXER_GAIN_SHIFT        (28)                /* Gain in Q28, MIXER_STREAM_GAIN_MAX fits int32 */
+#define MIXER_KERNEL_SHIFT      (14)                /* Gain in Q14 for kernel, int16 sample * gain fits int32 */
+#define MIXER_PHASE_SHIFT       (16)
+#define MIXER_PHASE_ONE         (1 << MIXER_PHASE_SHIFT)
+#define MIXER_PEND_SIZE         (8)
+
+typedef struct {
+    bool                        attached;
+    bool                        done;
+    bool                        started;
+    bool                        detach_on_fade;
+    bool                        equal_power;
+    mixer_stream_input_cfg_t    cfg;
+    ringbuf_handle_t            rb;
+    int                         rate;
+    int                         channels;
+    int                         bits;
+    float                       gain;           /* Linear gain at start of next process */
+    float                       fade_from;
+    float                       fade_to;
+    int                         fade_frames;    /* Output frames of fade, 0 if not fading */
+    int                         fade_pos;
+    uint32_t                    phase;          /* Resampler position between cvt[0] and cvt[1], Q16 */
+    uint32_t                    rem;            /* Remainder of phase in 1 / (output rate), keeps rate exact */
+    int16_t                     *cvt;           /* Samples in output channels at input rate, starts with carried ones */
+    int                         cvt_frames;
+    int                         carry;          /* Frames at head of cvt not consumed by last process */
+    uint8_t                     pend[MIXER_PEND_SIZE];  /* Partial frame read from ringbuffer */
+    int                         pend_len;
+} mixer_input_t;
+
+typedef struct mixer_stream {
+    mixer_stream_cfg_t          cfg;
+    mixer_input_t               *input;
+    int                         frames;         /* Output frames per process */
+    int                         frame_bytes;
+    int32_t                     *acc;
+    int16_t                     *mix;           /* One input resampled to output */
+    uint8_t                     *raw;
+    int                         raw_size;
+    float                       duck;
+    float                       duck_gain;
+    float                       attack_step;
+    float                       release_step;
+    int                         hold_frames;
+    int                         hold_left;
+    int                         threshold;
+    bool                        finish;
+    SemaphoreHandle_t           lock;
+    SemaphoreHandle_t           attached;
+    mixer_stream_event_msg_t    *event;         /* Events are sent after lock released, callback may call APIs */
+    int                         event_num;
+} mixer_stream_t;
+
+static float _mixer_db_to_gain(float db)
+{
+    if (db <= MIXER_STREAM_GAIN_MUTE) {
+        return 0.0f;
+    }
+    if (db > MIXER_STREAM_GAIN_MAX) {
+        db = MIXER_STREAM_GAIN_MAX;
+    }
+    return powf(10.0f, db / 20.0f);
+}
+
+static inline int32_t _mixer_gain_q28(float gain)
+{
+    return (int32_t)(gain * (1 << MIXER_GAIN_SHIFT));
+}
+
+static void _mixer_event(mixer_stream_t *mixer, mixer_stream_event_id_t id, int index)
+{
+    mixer_stream_event_msg_t *msg = &mixer->event[mixer->event_num++];
+    msg->id = id;
+    msg->index = index;
+    msg->user_data = mixer->input[index].cfg.user_data;
+}
+
+static bool _mixer_fmt_valid(int rate, int channels, int bits)
+{
+    return rate > 0 && (channels == 1 || channels == 2) && (bits == 16 || bits == 24 || bits == 32);
+}
+
+static void _mixer_input_format(mixer_stream_t *mixer, mixer_input_t *in)
+{
+    int rate = in->cfg.sample_rate ? in->cfg.sample_rate : mixer->cfg.sample_rate;
+    int channels = in->cfg.channels ? in->cfg.channels : mixer->cfg.channels;
+    int bits = in->cfg.bits ? in->cfg.bits : mixer->cfg.bits;
+    if (in->cfg.src) {
+        audio_element_info_t info = { 0 };
+        audio_element_getinfo(in->cfg.src, &info);
+        if (_mixer_fmt_valid(info.sample_rates, info.channels, info.bits)) {
+            rate = info.sample_rates;
+            channels = info.channels;
+            bits = info.bits;
+        }
+    }
+    if (rate != in->rate || channels != in->channels || bits != in->bits) {
+        if (in->rate) {
+            ESP_LOGI(TAG, "Input changes format to %d Hz, %d bits, %d channels", rate, bits, channels);
+        }
+        in->rate = rate;
+        in->channels = channels;
+        in->bits = bits;
+        in->phase = 0;
+        in->rem = 0;
+        in->carry = 0;
+        in->pend_len = 0;
+    }
+}
+
+/*
+ * Convert input samples to 16 bits in output channels
+ */
+static void _mixer_convert(const uint8_t *raw, int frames, int bits, int in_ch, int16_t *out, int out_ch)
+{
+    if (bits == 16 && in_ch == out_ch) {
+        memcpy(out, raw, frames * in_ch * sizeof(int16_t));
+        return;
+    }
+    for (int i = 0; i < frames; i++) {
+        int32_t s[2];
+        for (int c = 0; c < in_ch; c++) {
+            int k = i * in_ch + c;
+            if (bits == 16) {
+                s[c] = ((const int16_t *)raw)[k];
+            } else if (bits == 24) {
+                s[c] = (int16_t)(raw[k * 3 + 1] | (raw[k * 3 + 2] << 8));
+            } else {
+                s[c] = ((const int32_t *)raw)[k] >> 16;
+            }
+        }
+        if (out_ch == 1) {
+            out[i] = in_ch == 2 ? (int16_t)((s[0] + s[1]) >> 1) : (int16_t)s[0];
+        } else {
+            out[i * 2] = (int16_t)s[0];
+            out[i * 2 + 1] = (int16_t)(in_ch == 2 ? s[1] : s[0]);
+        }
+    }
+}
+
+/*
+ * Read input and resample to `mixer->mix`, waiting `wait` ticks at most, return output frames got
+ */
+static int _mixer_input_read(audio_element_handle_t self, mixer_stream_t *mixer, int index, TickType_t wait)
+{
+    mixer_input_t *in = &mixer->input[index];
+    _mixer_input_format(mixer, in);
+    int ch = mixer->cfg.channels;
+    int frames = mixer->frames;
+    uint32_t step = (uint32_t)(((uint64_t)in->rate << MIXER_PHASE_SHIFT) / mixer->cfg.sample_rate);
+    uint32_t step_rem = (uint32_t)(((uint64_t)in->rate << MIXER_PHASE_SHIFT) % mixer->cfg.sample_rate);
+    bool copy = (step == MIXER_PHASE_ONE && step_rem == 0 && in->phase == 0);
+    // Last index of cvt used by this process, interpolation needs the sample after the last position
+    int last = frames - 1;
+    if (copy == false) {
+        // Remainder adds at most one to phase per frame
+        uint64_t end = in->phase + (uint64_t)(step + 1) * frames;
+        last = (int)((in->phase + (uint64_t)(step + 1) * (frames - 1)) >> MIXER_PHASE_SHIFT) + 1;
+        if ((int)(end >> MIXER_PHASE_SHIFT) > last) {
+            last = (int)(end >> MIXER_PHASE_SHIFT);
+        }
+    }
+    if (last + 1 > in->cvt_frames) {
+        int16_t *cvt = audio_realloc(in->cvt, (last + 1) * ch * sizeof(int16_t));
+        AUDIO_MEM_CHECK(TAG, cvt, return 0);
+        in->cvt = cvt;
+        in->cvt_frames = last + 1;
+    }
+    int in_frame = in->channels * in->bits / 8;
+    int want = last + 1 - in->carry;
+    int got = 0;
+    if (want > 0 && in->done == false) {
+        if (want * in_frame > mixer->raw_size) {
+            uint8_t *raw = audio_realloc(mixer->raw, want * in_frame);
+            AUDIO_MEM_CHECK(TAG, raw, return 0);
+            mixer->raw = raw;
+            mixer->raw_size = want * in_frame;
+        }
+        memcpy(mixer->raw, in->pend, in->pend_len);
+        int ret = audio_element_multi_input(self, (char *)mixer->raw + in->pend_len, want * in_frame - in->pend_len,
+                                            index, wait);
+        if (ret == RB_DONE || ret == RB_ABORT || ret == RB_FAIL) {
+            in->done = true;
+            _mixer_event(mixer, MIXER_STREAM_EVENT_INPUT_DONE, index);
+        }
+        int bytes = in->pend_len + (ret > 0 ? ret : 0);
+        got = bytes / in_frame;
+        in->pend_len = bytes - got * in_frame;
+        memcpy(in->pend, mixer->raw + got * in_frame, in->pend_len);
+        _mixer_convert(mixer->raw, got, in->bits, in->channels, in->cvt + in->carry * ch, ch);
+    }
+    int avail = in->carry + got;
+    if (avail == 0) {
+        return 0;
+    }
+    in->started = true;
+    int outs = 0;
+    int consumed = 0;
+    if (copy) {
+        outs = avail < frames ? avail : frames;
+        memcpy(mixer->mix, in->cvt, outs * ch * sizeof(int16_t));
+        consumed = outs;
+    } else {
+        // Positions before last available sample can be interpolated
+        uint32_t limit = (uint32_t)(avail - 1) << MIXER_PHASE_SHIFT;
+        uint32_t pos = in->phase;
+        uint32_t rem = in->rem;
+        int i = 0;
+        for (; i < frames && pos < limit; i++) {
+            const int16_t *x = in->cvt + (pos >> MIXER_PHASE_SHIFT) * ch;
+            int32_t frac = (pos & (MIXER_PHASE_ONE - 1)) >> 1;
+            for (int c = 0; c < ch; c++) {
+                mixer->mix[i * ch + c] = (int16_t)(x[c] + (((x[c + ch] - x[c]) * frac) >> 15));
+            }
+            pos += step;
+            rem += step_rem;
+            if (rem >= (uint32_t)mixer->cfg.sample_rate) {
+                rem -= mixer->cfg.sample_rate;
+                pos++;
+            }
+        }
+        outs = i;
+        in->rem = rem;
+        consumed = pos >> MIXER_PHASE_SHIFT;
+        in->phase = pos & (MIXER_PHASE_ONE - 1);
+        if (consumed > avail) {
+            consumed = avail;
+            in->phase = 0;
+            in->rem = 0;
+        }
+    }
+    in->carry = avail - consumed;
+    if (in->carry && consumed) {
+        memmove(in->cvt, in->cvt + consumed * ch, in->carry * ch * sizeof(int16_t));
+    }
+    return outs;
+}
+
+/*
+ * Add samples of one input to accumulator with gain ramps from `gain` by `step` per frame, both in Q28
+ */
+static void _mixer_kernel(int32_t *acc, const int16_t *in, int frames, int ch, int32_t gain, int32_t step)
+{
+    int samples = frames * ch;
+    if (step == 0) {
+        int32_t k = gain >> (MIXER_GAIN_SHIFT - MIXER_KERNEL_SHIFT);
+        int i = 0;
+        if (k == (1 << MIXER_KERNEL_SHIFT)) {
+            for (; i < samples; i++) {
+                acc[i] += in[i];
+            }
+            return;
+        }
+        for (; i + 4 <= samples; i += 4) {
+            acc[i] += (in[i] * k) >> MIXER_KERNEL_SHIFT;
+            acc[i + 1] += (in[i + 1] * k) >> MIXER_KERNEL_SHIFT;
+            acc[i + 2] += (in[i + 2] * k) >> MIXER_KERNEL_SHIFT;
+            acc[i + 3] += (in[i + 3] * k) >> MIXER_KERNEL_SHIFT;
+        }
+        for (; i < samples; i++) {
+            acc[i] += (in[i] * k) >> MIXER_KERNEL_SHIFT;
+        }
+        return;
+    }
+    for (int i = 0; i < frames; i++) {
+        int32_t k = gain >> (MIXER_GAIN_SHIFT - MIXER_KERNEL_SHIFT);
+        for (int c = 0; c < ch; c++) {
+            acc[c] += (in[c] * k) >> MIXER_KERNEL_SHIFT;
+        }
+        acc += ch;
+        in += ch;
+        gain += step;
+    }
+}
+
+static void _mixer_saturate(const int32_t *acc, int samples, int bits, void *out)
+{
+    for (int i = 0; i < samples; i++) {
+        int32_t v = acc[i];
+        v = v > INT16_MAX ? INT16_MAX : (v < INT16_MIN ? INT16_MIN : v);
+        if (bits == 16) {
+            ((int16_t *)out)[i] = (int16_t)v;
+        } else {
+            ((int32_t *)out)[i] = v * (1 << 16);
+        }
+    }
+}
+
+/*
+ * Advance fade of input by one process, return gain at end of it
+ */
+static float _mixer_fade(mixer_stream_t *mixer, int index)
+{
+    mixer_input_t *in = &mixer->input[index];
+    if (in->fade_frames == 0) {
+        return in->gain;
+    }
+    in->fade_pos += mixer->frames;
+    if (in->fade_pos >= in->fade_frames) {
+        in->gain = in->fade_to;
+        in->fade_frames = 0;
+        _mixer_event(mixer, MIXER_STREAM_EVENT_FADE_DONE, index);
+        if (in->detach_on_fade) {
+            in->attached = false;
+            _mixer_event(mixer, MIXER_STREAM_EVENT_INPUT_DETACHED, index);
+        }
+        return in->gain;
+    }
+    float t = (float)in->fade_pos / in->fade_frames;
+    float from = in->fade_from;
+    float to = in->fade_to;
+    if (in->equal_power == false) {
+        in->gain = from + (to - from) * t;
+    } else if (to > from) {
+        in->gain = from + (to - from) * sinf(t * (float)M_PI_2);
+    } else {
+        in->gain = to + (from - to) * cosf(t * (float)M_PI_2);
+    }
+    return in->gain;
+}
+
+static void _mixer_duck(mixer_stream_t *mixer, bool trigger)
+{
+    if (trigger) {
+        mixer->hold_left = mixer->hold_frames;
+    } else if (mixer->hold_left > 0) {
+        mixer->hold_left -= mixer->frames;
+    }
+    if (trigger || mixer->hold_left > 0) {
+        mixer->duck -= mixer->attack_step;
+        mixer->duck = mixer->duck < mixer->duck_gain ? mixer->duck_gain : mixer->duck;
+    } else {
+        mixer->duck += mixer->release_step;
+        mixer->duck = mixer->duck > 1.0f ? 1.0f : mixer->duck;
+    }
+}
+
+static esp_err_t _mixer_open(audio_element_handle_t self)
+{
+    return ESP_OK;
+}
+
+static esp_err_t _mixer_close(audio_element_handle_t self)
+{
+    return ESP_OK;
+}
+
+static int _mixer_process(audio_element_handle_t self, char *in_buffer, int in_len)
+{
+    mixer_stream_t *mixer = (mixer_stream_t *)audio_element_getdata(self);
+    int ch = mixer->cfg.channels;
+    xSemaphoreTake(mixer->lock, portMAX_DELAY);
+    int active = 0;
+    for (int i = 0; i < mixer->cfg.input_num; i++) {
+        if (mixer->input[i].attached && mixer->input[i].done == false) {
+            active++;
+        }
+    }
+    if (active == 0) {
+        xSemaphoreGive(mixer->lock);
+        if (mixer->finish) {
+            return AEL_IO_DONE;
+        }
+        xSemaphoreTake(mixer->attached, MIXER_IDLE_TICKS);
+        return AEL_IO_TIMEOUT;
+    }
+    memset(mixer->acc, 0, mixer->frames * ch * sizeof(int32_t));
+    int out_frames = 0;
+    float duck_start = mixer->duck;
+    bool trigger = false;
+    TickType_t start = xTaskGetTickCount();
+    TickType_t budget = pdMS_TO_TICKS(mixer->cfg.frame_ms);
+    // Sidechain inputs are mixed first, their level decides ducking of the others in the same process
+    for (int pass = 0; pass < 2; pass++) {
+        bool sidechain = (pass == 0);
+        for (int i = 0; i < mixer->cfg.input_num; i++) {
+            mixer_input_t *in = &mixer->input[i];
+            if (in->attached == false || in->cfg.sidechain != sidechain) {
+                continue;
+            }
+            // Inputs wait in the same budget of one frame, a stalled one must not hold the whole process,
+            // and once another input has samples the rest only take what is there
+            TickType_t wait = pdMS_TO_TICKS(in->cfg.timeout_ms);
+            TickType_t used = xTaskGetTickCount() - start;
+            TickType_t left = (out_frames || used >= budget) ? 0 : budget - used;
+            wait = wait < left ? wait : left;
+            int got = _mixer_input_read(self, mixer, i, wait);
+            float g0 = in->gain;
+            if (got == 0) {
+                // Fade of starving input waits for its samples, the one done runs to the end
+                if (in->done) {
+                    _mixer_fade(mixer, i);
+                }
+                continue;
+            }
+            float g1 = _mixer_fade(mixer, i);
+            out_frames = got > out_frames ? got : out_frames;
+            if (sidechain) {
+                for (int k = 0; k < got * ch && trigger == false; k++) {
+                    trigger = abs(mixer->mix[k]) >= mixer->threshold;
+                }
+            } else {
+                g0 *= duck_start;
+                g1 *= mixer->duck;
+            }
+            int32_t q0 = _mixer_gain_q28(g0);
+            int32_t step = (_mixer_gain_q28(g1) - q0) / mixer->frames;
+            _mixer_kernel(mixer->acc, mixer->mix, got, ch, q0, step);
+        }
+        if (sidechain) {
+            _mixer_duck(mixer, trigger);
+        }
+    }
+    int event_num = mixer->event_num;
+    mixer->event_num = 0;
+    xSemaphoreGive(mixer->lock);
+
+    for (int i = 0; i < event_num; i++) {
+        if (mixer->cfg.event_cb) {
+            mixer->cfg.event_cb(self, &mixer->event[i], mixer->cfg.event_ctx);
+        }
+    }
+    if (out_frames == 0) {
+        return AEL_IO_TIMEOUT;
+    }
+    _mixer_saturate(mixer->acc, out_frames * ch, mixer->cfg.bits, in_buffer);
+    return audio_element_output(self, in_buffer, out_frames * mixer->frame_bytes);
+}
+
+static void _mixer_free(mixer_stream_t *mixer)
+{
+    if (mixer->input) {
+        for (int i = 0; i < mixer->cfg.input_num; i++) {
+            audio_free(mixer->input[i].cvt);
+        }
+    }
+    if (mixer->lock) {
+        vSemaphoreDelete(mixer->lock);
+    }
+    if (mixer->attached) {
+        vSemaphoreDelete(mixer->attached);
+    }
+    audio_free(mixer->input);
+    audio_free(mixer->acc);
+    audio_free(mixer->mix);
+    audio_free(mixer->raw);
+    audio_free(mixer->event);
+    audio_free(mixer);
+}
+
+static esp_err_t _mixer_destroy(audio_element_handle_t self)
+{
+    mixer_stream_t *mixer = (mixer_stream_t *)audio_element_getdata(self);
+    _mixer_free(mixer);
+    return ESP_OK;
+}
+
+audio_element_handle_t mixer_stream_init(mixer_stream_cfg_t *config)
+{
+    AUDIO_NULL_CHECK(TAG, config, return NULL);
+    if (config->sample_rate <= 0 || (config->channels != 1 && config->channels != 2)
+        || (config->bits != 16 && config->bits != 32)
+        || config->input_num <= 0 || config->input_num > MIXER_STREAM_MAX_INPUT) {
+        ESP_LOGE(TAG, "Not support %d Hz, %d bits, %d channels with %d inputs",
+                 config->sample_rate, config->bits, config->channels, config->input_num);
+        return NULL;
+    }
+    mixer_stream_t *mixer = audio_calloc(1, sizeof(mixer_stream_t));
+    AUDIO_MEM_CHECK(TAG, mixer, return NULL);
+    mixer->cfg = *config;
+    if (mixer->cfg.frame_ms <= 0) {
+        mixer->cfg.frame_ms = MIXER_STREAM_FRAME_MS;
+    }
+    mixer->frames = mixer->cfg.sample_rate * mixer->cfg.frame_ms / 1000;
+    mixer->frames = mixer->frames > 0 ? mixer->frames : 1;
+    mixer->frame_bytes = config->channels * config->bits / 8;
+    mixer->input = audio_calloc(config->input_num, sizeof(mixer_input_t));
+    mixer->acc = audio_calloc(mixer->frames * config->channels, sizeof(int32_t));
+    mixer->mix = audio_calloc(mixer->frames * config->channels, sizeof(int16_t));
+    mixer->event = audio_calloc(config->input_num * 3, sizeof(mixer_stream_event_msg_t));
+    mixer->lock = xSemaphoreCreateMutex();
+    mixer->attached = xSemaphoreCreateBinary();
+    AUDIO_MEM_CHECK(TAG, mixer->input && mixer->acc && mixer->mix && mixer->event && mixer->lock && mixer->attached,
+                    goto _mixer_init_exit);
+
+    mixer->duck = 1.0f;
+    mixer->duck_gain = _mixer_db_to_gain(config->duck_db < 0.0f ? config->duck_db : 0.0f);
+    int attack = config->duck_attack_ms / mixer->cfg.frame_ms;
+    int release = config->duck_release_ms / mixer->cfg.frame_ms;
+    mixer->attack_step = (1.0f - mixer->duck_gain) / (attack > 0 ? attack : 1);
+    mixer->release_step = (1.0f - mixer->duck_gain) / (release > 0 ? release : 1);
+    mixer->hold_frames = config->sample_rate / 1000 * config->duck_hold_ms;
+    mixer->threshold = (int)(_mixer_db_to_gain(config->duck_threshold_db) * INT16_MAX);
+
+    audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
+    cfg.open = _mixer_open;
+    cfg.close = _mixer_close;
+    cfg.process = _mixer_process;
+    cfg.destroy = _mixer_destroy;
+    cfg.task_stack = config->task_stack;
+    cfg.task_prio = config->task_prio;
+    cfg.task_core = config->task_core;
+    cfg.stack_in_ext = config->stack_in_ext;
+    cfg.out_rb_size = config->out_rb_size;
+    cfg.buffer_len = mixer->frames * mixer->frame_bytes;
+    cfg.multi_in_rb_num = config->input_num;
+    cfg.tag = "mixer";
+    audio_element_handle_t el = audio_element_init(&cfg);
+    AUDIO_MEM_CHECK(TAG, el, goto _mixer_init_exit);
+    audio_element_setdata(el, mixer);
+    audio_element_set_music_info(el, config->sample_rate, config->channels, config->bits);
+    return el;
+
+_mixer_init_exit:
+    _mixer_free(mixer);
+    return NULL;
+}
+
+static mixer_input_t *_mixer_get_input(mixer_stream_t *mixer, int index)
+{
+    if (index < 0 || index >= mixer->cfg.input_num || mixer->input[index].attached == false) {
+        ESP_LOGE(TAG, "Input %d is not attached", index);
+        return NULL;
+    }
+    return &mixer->input[index];
+}
+
+esp_err_t mixer_stream_attach(audio_element_handle_t el, int index, ringbuf_handle_t rb, mixer_stream_input_cfg_t *config)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, rb, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, config, return ESP_FAIL);
+    mixer_stream_t *mixer = (mixer_stream_t *)audio_element_getdata(el);
+    if (index < 0 || index >= mixer->cfg.input_num) {
+        ESP_LOGE(TAG, "Invalid input %d", index);
+        return ESP_FAIL;
+    }
+    if (config->sample_rate < 0 || config->channels < 0 || config->channels > 2
+        || (config->bits && config->bits != 16 && config->bits != 24 && config->bits != 32)) {
+        ESP_LOGE(TAG, "Not support input %d Hz, %d bits, %d channels", config->sample_rate, config->bits, config->channels);
+        return ESP_FAIL;
+    }
+    xSemaphoreTake(mixer->lock, portMAX_DELAY);
+    mixer_input_t *in = &mixer->input[index];
+    if (in->attached) {
+        xSemaphoreGive(mixer->lock);
+        ESP_LOGE(TAG, "Input %d is attached already", index);
+        return ESP_FAIL;
+    }
+    // Conversion buffer is kept for next input in this index
+    int16_t *cvt = in->cvt;
+    int cvt_frames = in->cvt_frames;
+    memset(in, 0, sizeof(mixer_input_t));
+    in->cvt = cvt;
+    in->cvt_frames = cvt_frames;
+    in->cfg = *config;
+    in->rb = rb;
+    in->gain = _mixer_db_to_gain(config->gain_db);
+    if (config->fade_in_ms > 0) {
+        in->fade_from = 0.0f;
+        in->fade_to = in->gain;
+        in->fade_frames = mixer->cfg.sample_rate / 1000 * config->fade_in_ms;
+        in->gain = 0.0f;
+    }
+    audio_element_set_multi_input_ringbuf(el, rb, index);
+    in->attached = true;
+    mixer->finish = false;
+    xSemaphoreGive(mixer->lock);
+    xSemaphoreGive(mixer->attached);
+    return ESP_OK;
+}
+
+esp_err_t mixer_stream_detach(audio_element_handle_t el, int index)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_FAIL);
+    mixer_stream_t *mixer = (mixer_stream_t *)audio_element_getdata(el);
+    xSemaphoreTake(mixer->lock, portMAX_DELAY);
+    mixer_input_t *in = _mixer_get_input(mixer, index);
+    if (in) {
+        in->attached = false;
+    }
+    xSemaphoreGive(mixer->lock);
+    return in ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t mixer_stream_set_gain(audio_element_handle_t el, int index, float gain_db, int ramp_ms)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_FAIL);
+    mixer_stream_t *mixer = (mixer_stream_t *)audio_element_getdata(el);
+    xSemaphoreTake(mixer->lock, portMAX_DELAY);
+    mixer_input_t *in = _mixer_get_input(mixer, index);
+    if (in) {
+        in->cfg.gain_db = gain_db;
+        in->fade_from = in->gain;
+        in->fade_to = _mixer_db_to_gain(gain_db);
+        in->fade_frames = ramp_ms > 0 ? mixer->cfg.sample_rate / 1000 * ramp_ms : 0;
+        in->fade_pos = 0;
+        in->equal_power = false;
+        in->detach_on_fade = false;
+        if (in->fade_frames == 0) {
+            in->gain = in->fade_to;
+        }
+    }
+    xSemaphoreGive(mixer->lock);
+    return in ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t mixer_stream_crossfade(audio_element_handle_t el, int from, int to, int fade_ms)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_FAIL);
+    mixer_stream_t *mixer = (mixer_stream_t *)audio_element_getdata(el);
+    if (from == to) {
+        ESP_LOGE(TAG, "Crossfade to same input %d", from);
+        return ESP_FAIL;
+    }
+    xSemaphoreTake(mixer->lock, portMAX_DELAY);
+    mixer_input_t *out = _mixer_get_input(mixer, from);
+    mixer_input_t *in = _mixer_get_input(mixer, to);
+    if (out == NULL || in == NULL) {
+        xSemaphoreGive(mixer->lock);
+        return ESP_FAIL;
+    }
+    int fade_frames = mixer->cfg.sample_rate / 1000 * fade_ms;
+    fade_frames = fade_frames > 0 ? fade_frames : 1;
+    if (in->started == false) {
+        in->gain = 0.0f;
+    }
+    in->fade_from = in->gain;
+    in->fade_to = _mixer_db_to_gain(in->cfg.gain_db);
+    out->fade_from = out->gain;
+    out->fade_to = 0.0f;
+    out->detach_on_fade = true;
+    in->detach_on_fade = false;
+    for (int i = 0; i < 2; i++) {
+        mixer_input_t *fade = i ? in : out;
+        fade->fade_frames = fade_frames;
+        fade->fade_pos = 0;
+        fade->equal_power = true;
+    }
+    xSemaphoreGive(mixer->lock);
+    return ESP_OK;
+}
+
+esp_err_t mixer_stream_finish(audio_element_handle_t el)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_FAIL);
+    mixer_stream_t *mixer = (mixer_stream_t *)audio_element_getdata(el);
+    mixer->finish = true;
+    xSemaphoreGive(mixer->attached);
+    return ESP_OK;
+}
@@ -0,0 +1,576 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "audio_mem.h"
+#include "rtp_stream.h"
+
+static const char *TAG = "RTP_STREAM";
+
+#define RTP_HEADER_SIZE         (12)
+#define RTP_VERSION             (2)
+
+typedef struct {
+    bool                    valid;
+    uint16_t                seq;
+    uint32_t                ts;
+    int                     len;
+    char                    *data;
+} rtp_slot_t;
+
+typedef struct rtp_stream {
+    audio_stream_type_t     type;
+    const char              *host;
+    int                     port;
+    int                     sock;
+    struct sockaddr_in      dest;
+    int                     sample_rate;
+    int                     sample_bytes;
+    int                     frame_bytes;    /* bytes per PCM frame (all channels) */
+    int                     payload_type;
+    int                     frame_ms;
+    int                     multicast_ttl;
+    uint32_t                ssrc;
+    uint16_t                seq;
+    uint32_t                ts;
+    bool                    marker;
+    char                    *pkt;
+    int                     pkt_size;
+    /* Jitter buffer */
+    rtp_slot_t              *slots;
+    int                     slot_num;
+    int                     slot_size;
+    int                     buffered;       /* payload bytes held in slots */
+    bool                    playing;
+    bool                    has_first;
+    uint16_t                play_seq;
+    uint16_t                first_seq;
+    char                    *last;
+    int                     last_len;
+    bool                    has_transit;
+    uint32_t                last_ts;
+    int64_t                 last_arrival_us;
+    int                     jitter_min_ms;
+    int                     jitter_max_ms;
+    int                     timeout_ms;
+    rtp_stream_plc_cb       plc;
+    void                    *plc_ctx;
+    rtp_stream_stats_t      stats;
+} rtp_stream_t;
+
+static inline int _bytes_to_ms(rtp_stream_t *rtp, int bytes)
+{
+    return (int)((int64_t)bytes * 1000 / ((int64_t)rtp->sample_rate * rtp->frame_bytes));
+}
+
+/* Copy PCM samples reversing their byte order (host little endian <-> network big endian) */
+static void _rtp_swap_copy(char *dst, const char *src, int len, int sample_bytes)
+{
+    if (sample_bytes <= 1) {
+        memcpy(dst, src, len);
+        return;
+    }
+    len -= len % sample_bytes;
+    for (int i = 0; i < len; i += sample_bytes) {
+        for (int j = 0; j < sample_bytes; j++) {
+            dst[i + j] = src[i + sample_bytes - 1 - j];
+        }
+    }
+}
+
+static bool _is_multicast(const struct in_addr *addr)
+{
+    return IN_MULTICAST(ntohl(addr->s_addr));
+}
+
+static void _jb_reset(rtp_stream_t *rtp)
+{
+    for (int i = 0; i < rtp->slot_num; i++) {
+        rtp->slots[i].valid = false;
+    }
+    rtp->buffered = 0;
+    rtp->playing = false;
+    rtp->has_first = false;
+}
+
+static int _jb_target_ms(rtp_stream_t *rtp)
+{
+    int target = rtp->frame_ms + rtp->stats.jitter_us * 4 / 1000;
+    if (target < rtp->jitter_min_ms) {
+        target = rtp->jitter_min_ms;
+    }
+    if (target > rtp->jitter_max_ms) {
+        target = rtp->jitter_max_ms;
+    }
+    return target;
+}
+
+static void _jb_update_jitter(rtp_stream_t *rtp, uint32_t ts)
+{
+    int64_t arrival_us = esp_timer_get_time();
+    if (rtp->has_transit) {
+        /* D(i-1,i) = (R(i) - R(i-1)) - (S(i) - S(i-1)), the RTP clock difference is taken modulo 2^32 so a timestamp wrap stays small */
+        int32_t ts_delta = (int32_t)(ts - rtp->last_ts);
+        int64_t d = (arrival_us - rtp->last_arrival_us) - (int64_t)ts_delta * 1000000 / rtp->sample_rate;
+        if (d < 0) {
+            d = -d;
+        }
+        /* J(i) = J(i-1) + (|D(i-1,i)| - J(i-1)) / 16, RFC 3550 A.8 */
+        rtp->stats.jitter_us += (int)((d - rtp->stats.jitter_us) / 16);
+    }
+    rtp->last_ts = ts;
+    rtp->last_arrival_us = arrival_us;
+    rtp->has_transit = true;
+}
+
+static void _jb_put(rtp_stream_t *rtp, uint16_t seq, uint32_t ts, const char *payload, int len)
+{
+    if (len <= 0) {
+        return;
+    }
+    if (len > rtp->slot_size) {
+        ESP_LOGW(TAG, "Payload %d bytes exceeds slot size %d, dropped", len, rtp->slot_size);
+        rtp->stats.overflow++;
+        return;
+    }
+    rtp->stats.packets++;
+    _jb_update_jitter(rtp, ts);
+
+    uint16_t base = rtp->playing ? rtp->play_seq : rtp->first_seq;
+    int16_t diff = (int16_t)(seq - base);
+    if (rtp->playing || rtp->has_first) {
+        if (rtp->playing && diff < 0) {
+            rtp->stats.late++;
+            return;
+        }
+        if (diff >= rtp->slot_num || diff <= -rtp->slot_num) {
+            ESP_LOGW(TAG, "Sequence jump %u -> %u, resync", base, seq);
+            rtp->stats.overflow++;
+            _jb_reset(rtp);
+        }
+    }
+    if (!rtp->playing && (!rtp->has_first || (int16_t)(seq - rtp->first_seq) < 0)) {
+        rtp->first_seq = seq;
+        rtp->has_first = true;
+    }
+    rtp_slot_t *slot = &rtp->slots[seq & (rtp->slot_num - 1)];
+    if (slot->valid) {
+        if (slot->seq == seq) {
+            rtp->stats.duplicated++;
+            return;
+        }
+        rtp->buffered -= slot->len;
+        rtp->stats.overflow++;
+    }
+    memcpy(slot->data, payload, len);
+    slot->seq = seq;
+    slot->ts = ts;
+    slot->len = len;
+    slot->valid = true;
+    rtp->buffered += len;
+}
+
+static int _jb_get(audio_element_handle_t self, rtp_stream_t *rtp, char *buffer, int len)
+{
+    rtp->stats.target_ms = _jb_target_ms(rtp);
+    if (!rtp->playing) {
+        if (!rtp->has_first || _bytes_to_ms(rtp, rtp->buffered) < rtp->stats.target_ms) {
+            return 0;
+        }
+        rtp->playing = true;
+        rtp->play_seq = rtp->first_seq;
+    }
+    while (rtp->buffered > 0) {
+        rtp_slot_t *slot = &rtp->slots[rtp->play_seq & (rtp->slot_num - 1)];
+        bool present = slot->valid && slot->seq == rtp->play_seq;
+        if (present && _bytes_to_ms(rtp, rtp->buffered - slot->len) > rtp->stats.target_ms * 2 + rtp->frame_ms) {
+            /* Too much delay piled up after a burst, skip one packet to catch up */
+            rtp->buffered -= slot->len;
+            slot->valid = false;
+            rtp->play_seq++;
+            rtp->stats.overflow++;
+            continue;
+        }
+        rtp->play_seq++;
+        if (present) {
+            int n = slot->len < len ? slot->len : len;
+            _rtp_swap_copy(buffer, slot->data, n, rtp->sample_bytes);
+            memcpy(rtp->last, buffer, n);
+            rtp->last_len = n;
+            rtp->buffered -= slot->len;
+            slot->valid = false;
+            return n;
+        }
+        /* The packet is still missing while later ones are queued: conceal it */
+        int n = rtp->last_len > 0 ? rtp->last_len : rtp->frame_bytes * rtp->sample_rate * rtp->frame_ms / 1000;
+        if (n > len) {
+            n = len;
+        }
+        int filled = 0;
+        if (rtp->plc) {
+            filled = rtp->plc(self, buffer, n, rtp->last_len ? rtp->last : NULL, rtp->last_len, rtp->plc_ctx);
+        }
+        if (filled <= 0 || filled > n) {
+            memset(buffer, 0, n);
+            filled = n;
+        }
+        rtp->stats.lost++;
+        return filled;
+    }
+    ESP_LOGD(TAG, "Jitter buffer underrun, re-buffering");
+    rtp->stats.underruns++;
+    rtp->playing = false;
+    rtp->has_first = false;
+    return 0;
+}
+
+static void _rtp_recv_all(rtp_stream_t *rtp)
+{
+    while (1) {
+        int len = recv(rtp->sock, rtp->pkt, rtp->pkt_size, MSG_DONTWAIT);
+        if (len < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                ESP_LOGE(TAG, "recv failed, errno: %d", errno);
+            }
+            return;
+        }
+        uint8_t *p = (uint8_t *)rtp->pkt;
+        if (len < RTP_HEADER_SIZE || (p[0] >> 6) != RTP_VERSION) {
+            continue;
+        }
+        int hdr_len = RTP_HEADER_SIZE + (p[0] & 0x0F) * 4;
+        if (p[0] & 0x10) {
+            if (len < hdr_len + 4) {
+                continue;
+            }
+            hdr_len += 4 + ((p[hdr_len + 2] << 8) | p[hdr_len + 3]) * 4;
+        }
+        if (p[0] & 0x20) {
+            len -= p[len - 1];
+        }
+        if (len <= hdr_len) {
+            continue;
+        }
+        uint16_t seq = (p[2] << 8) | p[3];
+        uint32_t ts = ((uint32_t)p[4] << 24) | ((uint32_t)p[5] << 16) | ((uint32_t)p[6] << 8) | p[7];
+        _jb_put(rtp, seq, ts, rtp->pkt + hdr_len, len - hdr_len);
+    }
+}
+
+static esp_err_t _rtp_open(audio_element_handle_t self)
+{
+    rtp_stream_t *rtp = (rtp_stream_t *)audio_element_getdata(self);
+    if (rtp->sock >= 0) {
+        ESP_LOGE(TAG, "Already opened");
+        return ESP_FAIL;
+    }
+    rtp->sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (rtp->sock < 0) {
+        ESP_LOGE(TAG, "Create socket failed, errno: %d", errno);
+        return ESP_FAIL;
+    }
+    memset(&rtp->dest, 0, sizeof(rtp->dest));
+    rtp->dest.sin_family = AF_INET;
+    rtp->dest.sin_port = htons(rtp->port);
+    if (rtp->host && inet_aton(rtp->host, &rtp->dest.sin_addr) == 0) {
+        ESP_LOGE(TAG, "Invalid address %s", rtp->host);
+        goto _rtp_open_exit;
+    }
+    if (rtp->type == AUDIO_STREAM_WRITER) {
+        if (rtp->host == NULL) {
+            ESP_LOGE(TAG, "No destination host for RTP writer");
+            goto _rtp_open_exit;
+        }
+        if (_is_multicast(&rtp->dest.sin_addr)) {
+            uint8_t ttl = rtp->multicast_ttl;
+            setsockopt(rtp->sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+        }
+        rtp->marker = true;
+    } else {
+        int reuse = 1;
+        setsockopt(rtp->sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        struct sockaddr_in local = {
+            .sin_family = AF_INET,
+            .sin_port = htons(rtp->port),
+            .sin_addr.s_addr = htonl(INADDR_ANY),
+        };
+        if (bind(rtp->sock, (struct sockaddr *)&local, sizeof(local)) != 0) {
+            ESP_LOGE(TAG, "Bind port %d failed, errno: %d", rtp->port, errno);
+            goto _rtp_open_exit;
+        }
+        if (rtp->host && _is_multicast(&rtp->dest.sin_addr)) {
+            struct ip_mreq mreq = {
+                .imr_multiaddr = rtp->dest.sin_addr,
+                .imr_interface.s_addr = htonl(INADDR_ANY),
+            };
+            if (setsockopt(rtp->sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0) {
+                ESP_LOGE(TAG, "Join multicast group %s failed, errno: %d", rtp->host, errno);
+                goto _rtp_open_exit;
+            }
+        }
+        _jb_reset(rtp);
+        rtp->last_len = 0;
+        rtp->has_transit = false;
+    }
+    ESP_LOGI(TAG, "RTP %s opened, %s:%d", rtp->type == AUDIO_STREAM_WRITER ? "writer" : "reader",
+             rtp->host ? rtp->host : "any", rtp->port);
+    return ESP_OK;
+
+_rtp_open_exit:
+    close(rtp->sock);
+    rtp->sock = -1;
+    return ESP_FAIL;
+}
+
+static esp_err_t _rtp_read(audio_element_handle_t self, char *buffer, int len, TickType_t ticks_to_wait, void *context)
+{
+    rtp_stream_t *rtp = (rtp_stream_t *)audio_element_getdata(self);
+    int64_t deadline = esp_timer_get_time() + (int64_t)rtp->timeout_ms * 1000;
+    while (1) {
+        _rtp_recv_all(rtp);
+        int n = _jb_get(self, rtp, buffer, len);
+        if (n > 0) {
+            audio_element_update_byte_pos(self, n);
+            return n;
+        }
+        int64_t remain_us = deadline - esp_timer_get_time();
+        if (remain_us <= 0) {
+            return AEL_IO_TIMEOUT;
+        }
+        if (remain_us > rtp->frame_ms * 1000) {
+            remain_us = rtp->frame_ms * 1000;
+        }
+        struct timeval tv = {
+            .tv_sec = 0,
+            .tv_usec = remain_us,
+        };
+        fd_set readset;
+        FD_ZERO(&readset);
+        FD_SET(rtp->sock, &readset);
+        if (select(rtp->sock + 1, &readset, NULL, NULL, &tv) < 0) {
+            ESP_LOGE(TAG, "select failed, errno: %d", errno);
+            return ESP_FAIL;
+        }
+    }
+}
+
+static esp_err_t _rtp_write(audio_element_handle_t self, char *buffer, int len, TickType_t ticks_to_wait, void *context)
+{
+    rtp_stream_t *rtp = (rtp_stream_t *)audio_element_getdata(self);
+    int max_payload = rtp->pkt_size - RTP_HEADER_SIZE;
+    max_payload -= max_payload % rtp->frame_bytes;
+    int sent = 0;
+    while (sent < len) {
+        int payload = len - sent;
+        if (payload > max_payload) {
+            payload = max_payload;
+        }
+        uint8_t *p = (uint8_t *)rtp->pkt;
+        p[0] = RTP_VERSION << 6;
+        p[1] = (rtp->marker ? 0x80 : 0) | (rtp->payload_type & 0x7F);
+        p[2] = rtp->seq >> 8;
+        p[3] = rtp->seq & 0xFF;
+        p[4] = rtp->ts >> 24;
+        p[5] = (rtp->ts >> 16) & 0xFF;
+        p[6] = (rtp->ts >> 8) & 0xFF;
+        p[7] = rtp->ts & 0xFF;
+        p[8] = rtp->ssrc >> 24;
+        p[9] = (rtp->ssrc >> 16) & 0xFF;
+        p[10] = (rtp->ssrc >> 8) & 0xFF;
+        p[11] = rtp->ssrc & 0xFF;
+        _rtp_swap_copy(rtp->pkt + RTP_HEADER_SIZE, buffer + sent, payload, rtp->sample_bytes);
+        if (sendto(rtp->sock, rtp->pkt, RTP_HEADER_SIZE + payload, 0, (struct sockaddr *)&rtp->dest, sizeof(rtp->dest)) < 0) {
+            ESP_LOGW(TAG, "sendto failed, errno: %d", errno);
+            if (errno != ENOMEM) {
+                return ESP_FAIL;
+            }
+        } else {
+            rtp->stats.packets++;
+        }
+        rtp->marker = false;
+        rtp->seq++;
+        rtp->ts += payload / rtp->frame_bytes;
+        sent += payload;
+    }
+    return len;
+}
+
+static esp_err_t _rtp_process(audio_element_handle_t self, char *in_buffer, int in_len)
+{
+    rtp_stream_t *rtp = (rtp_stream_t *)audio_element_getdata(self);
+    int r_size = audio_element_input(self, in_buffer, in_len);
+    int w_size = 0;
+    if (r_size > 0) {
+        w_size = audio_element_output(self, in_buffer, r_size);
+        if (w_size > 0 && rtp->type == AUDIO_STREAM_WRITER) {
+            audio_element_update_byte_pos(self, r_size);
+        }
+    } else {
+        w_size = r_size;
+    }
+    return w_size;
+}
+
+static esp_err_t _rtp_close(audio_element_handle_t self)
+{
+    rtp_stream_t *rtp = (rtp_stream_t *)audio_element_getdata(self);
+    if (rtp->sock < 0) {
+        ESP_LOGE(TAG, "Already closed");
+        return ESP_FAIL;
+    }
+    close(rtp->sock);
+    rtp->sock = -1;
+    if (AEL_STATE_PAUSED != audio_element_get_state(self)) {
+        audio_element_set_byte_pos(self, 0);
+    }
+    return ESP_OK;
+}
+
+static void _rtp_free(rtp_stream_t *rtp)
+{
+    if (rtp->slots) {
+        for (int i = 0; i < rtp->slot_num; i++) {
+            audio_free(rtp->slots[i].data);
+        }
+        audio_free(rtp->slots);
+    }
+    audio_free(rtp->last);
+    audio_free(rtp->pkt);
+    audio_free(rtp);
+}
+
+static esp_err_t _rtp_destroy(audio_element_handle_t self)
+{
+    rtp_stream_t *rtp = (rtp_stream_t *)audio_element_getdata(self);
+    _rtp_free(rtp);
+    return ESP_OK;
+}
+
+esp_err_t rtp_stream_get_stats(audio_element_handle_t el, rtp_stream_stats_t *stats)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, stats, return ESP_FAIL);
+    rtp_stream_t *rtp = (rtp_stream_t *)audio_element_getdata(el);
+    AUDIO_NULL_CHECK(TAG, rtp, return ESP_FAIL);
+    *stats = rtp->stats;
+    stats->buffered_ms = _bytes_to_ms(rtp, rtp->buffered);
+    return ESP_OK;
+}
+
+audio_element_handle_t rtp_stream_init(rtp_stream_cfg_t *config)
+{
+    AUDIO_NULL_CHECK(TAG, config, return NULL);
+    int sample_rate = config->sample_rate ? config->sample_rate : RTP_STREAM_SAMPLE_RATE;
+    int channels = config->channels ? config->channels : RTP_STREAM_CHANNELS;
+    int bits = config->bits ? config->bits : RTP_STREAM_BITS;
+    if (sample_rate < 0 || channels < 0 || bits < 8 || (bits % 8)) {
+        ESP_LOGE(TAG, "Invalid PCM format %d/%d/%d", sample_rate, channels, bits);
+        return NULL;
+    }
+    rtp_stream_t *rtp = audio_calloc(1, sizeof(rtp_stream_t));
+    AUDIO_MEM_CHECK(TAG, rtp, return NULL);
+
+    audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
+    cfg.open = _rtp_open;
+    cfg.close = _rtp_close;
+    cfg.process = _rtp_process;
+    cfg.destroy = _rtp_destroy;
+    cfg.task_stack = config->task_stack;
+    cfg.task_prio = config->task_prio;
+    cfg.task_core = config->task_core;
+    cfg.stack_in_ext = config->ext_stack;
+    cfg.out_rb_size = config->out_rb_size;
+    cfg.tag = "rtp";
+
+    rtp->type = config->type;
+    rtp->host = config->host;
+    rtp->port = config->port ? config->port : RTP_STREAM_DEFAULT_PORT;
+    rtp->sock = -1;
+    rtp->sample_rate = sample_rate;
+    rtp->sample_bytes = bits / 8;
+    rtp->frame_bytes = rtp->sample_bytes * channels;
+    rtp->payload_type = config->payload_type;
+    rtp->frame_ms = config->frame_ms > 0 ? config->frame_ms : RTP_STREAM_FRAME_MS;
+    rtp->multicast_ttl = config->multicast_ttl > 0 ? config->multicast_ttl : 1;
+    rtp->ssrc = config->ssrc ? config->ssrc : esp_random();
+    rtp->seq = esp_random() & 0xFFFF;
+    rtp->ts = esp_random();
+    rtp->jitter_min_ms = config->jitter_min_ms > 0 ? config->jitter_min_ms : RTP_STREAM_JITTER_MIN_MS;
+    rtp->jitter_max_ms = config->jitter_max_ms > 0 ? config->jitter_max_ms : RTP_STREAM_JITTER_MAX_MS;
+    if (rtp->jitter_max_ms < rtp->jitter_min_ms) {
+        rtp->jitter_max_ms = rtp->jitter_min_ms;
+    }
+    rtp->timeout_ms = config->timeout_ms > 0 ? config->timeout_ms : 1000;
+    rtp->plc = config->plc;
+    rtp->plc_ctx = config->plc_ctx;
+    rtp->pkt_size = RTP_HEADER_SIZE + RTP_STREAM_MAX_PAYLOAD;
+    rtp->pkt = audio_calloc(1, rtp->pkt_size);
+    AUDIO_MEM_CHECK(TAG, rtp->pkt, goto _rtp_init_exit);
+
+    int frame_len = rtp->frame_bytes * rtp->sample_rate * rtp->frame_ms / 1000;
+    if (config->type == AUDIO_STREAM_WRITER) {
+        int max_payload = RTP_STREAM_MAX_PAYLOAD - RTP_STREAM_MAX_PAYLOAD % rtp->frame_bytes;
+        cfg.buffer_len = frame_len < max_payload ? frame_len : max_payload;
+        cfg.write = _rtp_write;
+    } else {
+        rtp->slot_num = RTP_STREAM_JITTER_SLOTS;
+        if (config->jitter_slots > 0 && (config->jitter_slots & (config->jitter_slots - 1)) == 0) {
+            rtp->slot_num = config->jitter_slots;
+        }
+        rtp->slot_size = frame_len * 2 < RTP_STREAM_MAX_PAYLOAD ? frame_len * 2 : RTP_STREAM_MAX_PAYLOAD;
+        rtp->slots = audio_calloc(rtp->slot_num, sizeof(rtp_slot_t));
+        AUDIO_MEM_CHECK(TAG, rtp->slots, goto _rtp_init_exit);
+        for (int i = 0; i < rtp->slot_num; i++) {
+            rtp->slots[i].data = audio_calloc(1, rtp->slot_size);
+            AUDIO_MEM_CHECK(TAG, rtp->slots[i].data, goto _rtp_init_exit);
+        }
+        rtp->last = audio_calloc(1, rtp->slot_size);
+        AUDIO_MEM_CHECK(TAG, rtp->last, goto _rtp_init_exit);
+        cfg.buffer_len = rtp->slot_size;
+        cfg.read = _rtp_read;
+    }
+
+    audio_element_handle_t el = audio_element_init(&cfg);
+    AUDIO_MEM_CHECK(TAG, el, goto _rtp_init_exit);
+    audio_element_setdata(el, rtp);
+    audio_element_info_t info = { 0 };
+    audio_element_getinfo(el, &info);
+    info.sample_rates = sample_rate;
+    info.channels = channels;
+    info.bits = bits;
+    audio_element_setinfo(el, &info);
+    return el;
+
+_rtp_init_exit:
+    _rtp_free(rtp);
+    return NULL;
+}
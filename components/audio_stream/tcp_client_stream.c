@@ -24,11 +24,15 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "lwip/sockets.h"
 #include "esp_transport_tcp.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_timer.h"
 #include "audio_mem.h"
 #include "tcp_client_stream.h"
 
@@ -45,6 +49,22 @@ typedef struct tcp_stream {
     int                           timeout_ms;
     tcp_stream_event_handle_cb    hook;
     void                          *ctx;
+    bool                          nodelay;
+    bool                          keep_alive_enable;
+    int                           keep_alive_idle;
+    int                           keep_alive_interval;
+    int                           keep_alive_count;
+    int                           sndbuf_size;
+    int                           rcvbuf_size;
+    char                          *coalesce_buf;
+    int                           coalesce_size;
+    int                           coalesce_fill;
+    int                           coalesce_ms;
+    int64_t                       coalesce_start_us;
+    TickType_t                    saved_input_timeout;
+    int                           reconnect_max;
+    int                           reconnect_delay_ms;
+    int                           reconnect_delay_max_ms;
 } tcp_stream_t;
 
 static int _get_socket_error_code_reason(const char *str, int sockfd)
@@ -77,6 +97,77 @@ static esp_err_t _dispatch_event(audio_element_handle_t el, tcp_stream_t *tcp, v
     return ESP_FAIL;
 }
 
+static void _tcp_set_sockopt(tcp_stream_t *tcp, int level, int optname, int value, const char *name)
+{
+    if (setsockopt(tcp->sock, level, optname, &value, sizeof(value)) != 0) {
+        ESP_LOGW(TAG, "Set %s to %d failed, errno: %d", name, value, errno);
+    }
+}
+
+static void _tcp_apply_sockopts(tcp_stream_t *tcp)
+{
+    if (tcp->nodelay) {
+        _tcp_set_sockopt(tcp, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+    }
+    if (tcp->keep_alive_enable) {
+        _tcp_set_sockopt(tcp, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE");
+        if (tcp->keep_alive_idle > 0) {
+            _tcp_set_sockopt(tcp, IPPROTO_TCP, TCP_KEEPIDLE, tcp->keep_alive_idle, "TCP_KEEPIDLE");
+        }
+        if (tcp->keep_alive_interval > 0) {
+            _tcp_set_sockopt(tcp, IPPROTO_TCP, TCP_KEEPINTVL, tcp->keep_alive_interval, "TCP_KEEPINTVL");
+        }
+        if (tcp->keep_alive_count > 0) {
+            _tcp_set_sockopt(tcp, IPPROTO_TCP, TCP_KEEPCNT, tcp->keep_alive_count, "TCP_KEEPCNT");
+        }
+    }
+    if (tcp->sndbuf_size > 0) {
+        _tcp_set_sockopt(tcp, SOL_SOCKET, SO_SNDBUF, tcp->sndbuf_size, "SO_SNDBUF");
+    }
+    if (tcp->rcvbuf_size > 0) {
+        _tcp_set_sockopt(tcp, SOL_SOCKET, SO_RCVBUF, tcp->rcvbuf_size, "SO_RCVBUF");
+    }
+}
+
+static esp_err_t _tcp_connect(tcp_stream_t *tcp)
+{
+    int delay_ms = tcp->reconnect_delay_ms;
+    for (int retry = 0; ; retry++) {
+        tcp->sock = esp_transport_connect(tcp->t, tcp->host, tcp->port, CONNECT_TIMEOUT_MS);
+        if (tcp->sock >= 0) {
+            _tcp_apply_sockopts(tcp);
+            return ESP_OK;
+        }
+        _get_socket_error_code_reason(__func__, tcp->sock);
+        esp_transport_close(tcp->t);
+        if (retry >= tcp->reconnect_max) {
+            break;
+        }
+        ESP_LOGW(TAG, "Connect to %s:%d failed, retry %d/%d in %d ms", tcp->host, tcp->port, retry + 1, tcp->reconnect_max, delay_ms);
+        vTaskDelay(pdMS_TO_TICKS(delay_ms));
+        delay_ms *= 2;
+        if (delay_ms > tcp->reconnect_delay_max_ms) {
+            delay_ms = tcp->reconnect_delay_max_ms;
+        }
+    }
+    return ESP_FAIL;
+}
+
+static esp_err_t _tcp_reconnect(audio_element_handle_t self, tcp_stream_t *tcp)
+{
+    if (tcp->reconnect_max <= 0) {
+        return ESP_FAIL;
+    }
+    ESP_LOGW(TAG, "Connection lost, reconnecting to %s:%d", tcp->host, tcp->port);
+    esp_transport_close(tcp->t);
+    if (_tcp_connect(tcp) != ESP_OK) {
+        ESP_LOGE(TAG, "Reconnect to %s:%d failed", tcp->host, tcp->port);
+        return ESP_FAIL;
+    }
+    _dispatch_event(self, tcp, NULL, 0, TCP_STREAM_STATE_RECONNECTED);
+    return ESP_OK;
+}
+
 static esp_err_t _tcp_open(audio_element_handle_t self)
 {
     AUDIO_NULL_CHECK(TAG, self, return ESP_FAIL);
@@ -87,16 +178,22 @@ static esp_err_t _tcp_open(audio_element_handle_t self)
         return ESP_FAIL;
     }
     ESP_LOGI(TAG, "Host is %s, port is %d\n", tcp->host, tcp->port);
-    esp_transport_handle_t t = esp_transport_tcp_init();
-    AUDIO_NULL_CHECK(TAG, t, return ESP_FAIL);
-    tcp->sock = esp_transport_connect(t, tcp->host, tcp->port, CONNECT_TIMEOUT_MS);
-    if (tcp->sock < 0) {
-        _get_socket_error_code_reason(__func__,  tcp->sock);
-        esp_transport_destroy(t);
+    if (tcp->t == NULL) {
+        tcp->t = esp_transport_tcp_init();
+        AUDIO_NULL_CHECK(TAG, tcp->t, return ESP_FAIL);
+    }
+    if (_tcp_connect(tcp) != ESP_OK) {
+        esp_transport_destroy(tcp->t);
+        tcp->t = NULL;
         return ESP_FAIL;
     }
     tcp->is_open = true;
-    tcp->t = t;
+    tcp->coalesce_fill = 0;
+    if (tcp->coalesce_buf && tcp->coalesce_ms > 0) {
+        // Wake up the process loop in time to honour the coalescing latency budget
+        tcp->saved_input_timeout = audio_element_get_input_timeout(self);
+        audio_element_set_input_timeout(self, pdMS_TO_TICKS(tcp->coalesce_ms));
+    }
     _dispatch_event(self, tcp, NULL, 0, TCP_STREAM_STATE_CONNECTED);
 
     return ESP_OK;
@@ -112,30 +209,97 @@ static esp_err_t _tcp_read(audio_element_handle_t self, char *buffer, int len, T
             ESP_LOGW(TAG, "TCP server actively closes the connection");
             return ESP_OK;
         }
+        if (_tcp_reconnect(self, tcp) == ESP_OK) {
+            return AEL_IO_TIMEOUT;
+        }
         return ESP_FAIL;
     } else if (rlen == 0) {
         ESP_LOGI(TAG, "Get end of the file");
     } else {
+        // Drain whatever the stack has already queued so one wake-up moves as much as possible downstream
+        int avail = 0;
+        while (rlen < len && ioctl(tcp->sock, FIONREAD, &avail) == 0 && avail > 0) {
+            int n = esp_transport_read(tcp->t, buffer + rlen, len - rlen, 0);
+            if (n <= 0) {
+                break;
+            }
+            rlen += n;
+        }
         audio_element_update_byte_pos(self, rlen);
     }
     ESP_LOGD(TAG, "read len=%d, rlen=%d", len, rlen);
     return rlen;
 }
 
+static int _tcp_send(audio_element_handle_t self, tcp_stream_t *tcp, char *buffer, int len)
+{
+    int sent = 0;
+    int reconnects = 0;
+    while (sent < len) {
+        int wlen = esp_transport_write(tcp->t, buffer + sent, len - sent, tcp->timeout_ms);
+        if (wlen < 0) {
+            _get_socket_error_code_reason(__func__, tcp->sock);
+            // Bound the reconnects per send, a peer that accepts but never drains must not stall the writer forever
+            if (reconnects++ < tcp->reconnect_max && _tcp_reconnect(self, tcp) == ESP_OK) {
+                continue;
+            }
+            ESP_LOGE(TAG, "Send failed after %d reconnect(s), %d/%d bytes sent", reconnects - 1, sent, len);
+            return ESP_FAIL;
+        }
+        sent += wlen;
+    }
+    return sent;
+}
+
+static esp_err_t _tcp_flush(audio_element_handle_t self, tcp_stream_t *tcp)
+{
+    if (tcp->coalesce_fill == 0) {
+        return ESP_OK;
+    }
+    int wlen = _tcp_send(self, tcp, tcp->coalesce_buf, tcp->coalesce_fill);
+    ESP_LOGD(TAG, "flush len=%d, wlen=%d", tcp->coalesce_fill, wlen);
+    tcp->coalesce_fill = 0;
+    return wlen < 0 ? ESP_FAIL : ESP_OK;
+}
+
+static bool _tcp_coalesce_expired(tcp_stream_t *tcp)
+{
+    return tcp->coalesce_fill > 0 && tcp->coalesce_ms > 0
+           && (esp_timer_get_time() - tcp->coalesce_start_us) >= (int64_t)tcp->coalesce_ms * 1000;
+}
+
 static esp_err_t _tcp_write(audio_element_handle_t self, char *buffer, int len, TickType_t ticks_to_wait, void *context)
 {
     tcp_stream_t *tcp = (tcp_stream_t *)audio_element_getdata(self);
-    int wlen = esp_transport_write(tcp->t, buffer, len, tcp->timeout_ms);
-    if (wlen < 0) {
-        _get_socket_error_code_reason(__func__, tcp->sock);
-        return ESP_FAIL;
+    if (tcp->coalesce_buf == NULL || len >= tcp->coalesce_size) {
+        if (_tcp_flush(self, tcp) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        int wlen = _tcp_send(self, tcp, buffer, len);
+        ESP_LOGD(TAG, "write len=%d, rlen=%d", len, wlen);
+        return wlen;
+    }
+    if (tcp->coalesce_fill + len > tcp->coalesce_size) {
+        if (_tcp_flush(self, tcp) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+    if (tcp->coalesce_fill == 0) {
+        tcp->coalesce_start_us = esp_timer_get_time();
+    }
+    memcpy(tcp->coalesce_buf + tcp->coalesce_fill, buffer, len);
+    tcp->coalesce_fill += len;
+    if (tcp->coalesce_fill == tcp->coalesce_size || _tcp_coalesce_expired(tcp)) {
+        if (_tcp_flush(self, tcp) != ESP_OK) {
+            return ESP_FAIL;
+        }
     }
-    ESP_LOGD(TAG, "write len=%d, rlen=%d", len, wlen);
-    return wlen;
+    return len;
 }
 
 static esp_err_t _tcp_process(audio_element_handle_t self, char *in_buffer, int in_len)
 {
+    tcp_stream_t *tcp = (tcp_stream_t *)audio_element_getdata(self);
     int r_size = audio_element_input(self, in_buffer, in_len);
     int w_size = 0;
     if (r_size > 0) {
@@ -144,6 +308,10 @@ static esp_err_t _tcp_process(audio_element_handle_t self, char *in_buffer, int
             audio_element_update_byte_pos(self, r_size);
         }
     } else {
+        if (tcp->type == AUDIO_STREAM_WRITER && tcp->coalesce_fill > 0
+            && (r_size != AEL_IO_TIMEOUT || _tcp_coalesce_expired(tcp))) {
+            _tcp_flush(self, tcp);
+        }
         w_size = r_size;
     }
     return w_size;
@@ -159,6 +327,12 @@ static esp_err_t _tcp_close(audio_element_handle_t self)
         ESP_LOGE(TAG, "Already closed");
         return ESP_FAIL;
     }
+    if (tcp->type == AUDIO_STREAM_WRITER) {
+        _tcp_flush(self, tcp);
+    }
+    if (tcp->coalesce_buf && tcp->coalesce_ms > 0) {
+        audio_element_set_input_timeout(self, tcp->saved_input_timeout);
+    }
     if (-1 == esp_transport_close(tcp->t)) {
         ESP_LOGE(TAG, "TCP stream close failed");
         return ESP_FAIL;
@@ -180,6 +354,9 @@ static esp_err_t _tcp_destroy(audio_element_handle_t self)
         esp_transport_destroy(tcp->t);
         tcp->t = NULL;
     }
+    if (tcp->coalesce_buf) {
+        audio_free(tcp->coalesce_buf);
+    }
     audio_free(tcp);
     return ESP_OK;
 }
@@ -198,6 +375,7 @@ audio_element_handle_t tcp_stream_init(tcp_stream_cfg_t *config)
     cfg.task_prio = config->task_prio;
     cfg.task_core = config->task_core;
     cfg.stack_in_ext = config->ext_stack;
+    cfg.out_rb_size = config->out_rb_size;
     cfg.tag = "tcp_client";
     if (cfg.buffer_len == 0) {
         cfg.buffer_len = TCP_STREAM_BUF_SIZE;
@@ -210,6 +388,25 @@ audio_element_handle_t tcp_stream_init(tcp_stream_cfg_t *config)
     tcp->port = config->port;
     tcp->host = config->host;
     tcp->timeout_ms = config->timeout_ms;
+    tcp->nodelay = config->nodelay;
+    tcp->keep_alive_enable = config->keep_alive_enable;
+    tcp->keep_alive_idle = config->keep_alive_idle;
+    tcp->keep_alive_interval = config->keep_alive_interval;
+    tcp->keep_alive_count = config->keep_alive_count;
+    tcp->sndbuf_size = config->sndbuf_size;
+    tcp->rcvbuf_size = config->rcvbuf_size;
+    tcp->reconnect_max = config->reconnect_max;
+    tcp->reconnect_delay_ms = config->reconnect_delay_ms > 0 ? config->reconnect_delay_ms : TCP_STREAM_RECONNECT_DELAY_MS;
+    tcp->reconnect_delay_max_ms = config->reconnect_delay_max_ms > 0 ? config->reconnect_delay_max_ms : TCP_STREAM_RECONNECT_DELAY_MAX_MS;
+    if (config->type == AUDIO_STREAM_WRITER && config->coalesce_size > 0) {
+        tcp->coalesce_size = config->coalesce_size;
+        tcp->coalesce_ms = config->coalesce_ms;
+        tcp->coalesce_buf = audio_calloc(1, config->coalesce_size);
+        AUDIO_MEM_CHECK(TAG, tcp->coalesce_buf, {
+            audio_free(tcp);
+            return NULL;
+        });
+    }
     if (config->event_handler) {
         tcp->hook = config->event_handler;
         if (config->event_ctx) {
@@ -229,6 +426,9 @@ audio_element_handle_t tcp_stream_init(tcp_stream_cfg_t *config)
 
     return el;
 _tcp_init_exit:
+    if (tcp->coalesce_buf) {
+        audio_free(tcp->coalesce_buf);
+    }
     audio_free(tcp);
     return NULL;
 }
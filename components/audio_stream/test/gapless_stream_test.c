@@ -0,0 +1,351 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "unity.h"
+#include "esp_log.h"
+#include "audio_pipeline.h"
+#include "audio_mem.h"
+#include "raw_stream.h"
+#include "gapless_stream.h"
+#include "playlist.h"
+#include "dram_list.h"
+
+static const char *TAG = "GAPLESS_STREAM_TEST";
+
+#define GAPLESS_TEST_RATE       (44100)
+#define GAPLESS_TEST_CHANNELS   (2)
+#define GAPLESS_TEST_DELAY      (576)
+#define GAPLESS_TEST_PADDING    (1000)
+#define GAPLESS_TEST_JUNK       (30000)
+
+static int16_t sine_at(int n)
+{
+    return (int16_t)(10000 * sin(2 * M_PI * 1000 * n / GAPLESS_TEST_RATE));
+}
+
+/*
+ * Write one track as decoder would output it: junk delay samples, continued sine, junk padding samples
+ */
+static ringbuf_handle_t write_track(int start, int samples)
+{
+    int total = GAPLESS_TEST_DELAY + samples + GAPLESS_TEST_PADDING;
+    ringbuf_handle_t rb = rb_create(total * GAPLESS_TEST_CHANNELS * sizeof(int16_t), 1);
+    TEST_ASSERT_NOT_NULL(rb);
+    int16_t frame[GAPLESS_TEST_CHANNELS];
+    for (int i = 0; i < total; i++) {
+        int16_t v = GAPLESS_TEST_JUNK;
+        if (i >= GAPLESS_TEST_DELAY && i < GAPLESS_TEST_DELAY + samples) {
+            v = sine_at(start + i - GAPLESS_TEST_DELAY);
+        }
+        for (int c = 0; c < GAPLESS_TEST_CHANNELS; c++) {
+            frame[c] = v;
+        }
+        TEST_ASSERT_EQUAL(sizeof(frame), rb_write(rb, (char *)frame, sizeof(frame), 0));
+    }
+    rb_done_write(rb);
+    return rb;
+}
+
+static void count_event(audio_element_handle_t el, gapless_stream_event_msg_t *msg, void *ctx)
+{
+    int *count = (int *)ctx;
+    count[msg->id]++;
+    ESP_LOGI(TAG, "Event %d of slot %d at sample %d", msg->id, msg->slot, (int)msg->pos);
+}
+
+TEST_CASE("gapless stream init memory", "[esp-adf-stream]")
+{
+    gapless_stream_cfg_t gapless_cfg = GAPLESS_STREAM_CFG_DEFAULT();
+    int cnt = 2000;
+    AUDIO_MEM_SHOW("BEFORE GAPLESS_STREAM_INIT MEMORY TEST");
+    while (cnt--) {
+        audio_element_handle_t gapless = gapless_stream_init(&gapless_cfg);
+        TEST_ASSERT_NOT_NULL(gapless);
+        TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(gapless));
+    }
+    AUDIO_MEM_SHOW("AFTER GAPLESS_STREAM_INIT MEMORY TEST");
+}
+
+TEST_CASE("gapless stream boundary discontinuity", "[esp-adf-stream]")
+{
+    const int track_samples[GAPLESS_STREAM_SLOT_NUM] = {4410, 3000};
+    const int total = track_samples[0] + track_samples[1];
+    int event_count[GAPLESS_STREAM_EVENT_TRACK_END + 1] = { 0 };
+
+    gapless_stream_cfg_t gapless_cfg = GAPLESS_STREAM_CFG_DEFAULT();
+    gapless_cfg.event_cb = count_event;
+    gapless_cfg.event_ctx = event_count;
+    audio_element_handle_t gapless = gapless_stream_init(&gapless_cfg);
+    TEST_ASSERT_NOT_NULL(gapless);
+    audio_element_set_music_info(gapless, GAPLESS_TEST_RATE, GAPLESS_TEST_CHANNELS, 16);
+
+    raw_stream_cfg_t raw_cfg = RAW_STREAM_CFG_DEFAULT();
+    raw_cfg.type = AUDIO_STREAM_READER;
+    audio_element_handle_t raw = raw_stream_init(&raw_cfg);
+    TEST_ASSERT_NOT_NULL(raw);
+
+    audio_pipeline_cfg_t pipeline_cfg = DEFAULT_AUDIO_PIPELINE_CONFIG();
+    audio_pipeline_handle_t pipeline = audio_pipeline_init(&pipeline_cfg);
+    TEST_ASSERT_NOT_NULL(pipeline);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(pipeline, gapless, "gapless"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(pipeline, raw, "raw"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_link(pipeline, (const char *[]) {"gapless", "raw"}, 2));
+
+    // Second track continues the sine wave, joined output should be one sine without step at boundary
+    ringbuf_handle_t rb[GAPLESS_STREAM_SLOT_NUM];
+    int start = 0;
+    for (int i = 0; i < GAPLESS_STREAM_SLOT_NUM; i++) {
+        rb[i] = write_track(start, track_samples[i]);
+        start += track_samples[i];
+        audio_element_set_multi_input_ringbuf(gapless, rb[i], i);
+        gapless_stream_track_t track = {
+            .skip_samples = GAPLESS_TEST_DELAY,
+            .total_samples = track_samples[i],
+        };
+        TEST_ASSERT_EQUAL(ESP_OK, gapless_stream_queue(gapless, i, &track));
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, gapless_stream_finish(gapless));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_run(pipeline));
+
+    int16_t *out = audio_calloc(total + 1, GAPLESS_TEST_CHANNELS * sizeof(int16_t));
+    TEST_ASSERT_NOT_NULL(out);
+    int out_bytes = 0;
+    int max_bytes = (total + 1) * GAPLESS_TEST_CHANNELS * sizeof(int16_t);
+    while (out_bytes < max_bytes) {
+        int ret = raw_stream_read(raw, (char *)out + out_bytes, max_bytes - out_bytes);
+        if (ret <= 0) {
+            break;
+        }
+        out_bytes += ret;
+    }
+    int out_samples = out_bytes / (GAPLESS_TEST_CHANNELS * sizeof(int16_t));
+    TEST_ASSERT_EQUAL(total, out_samples);
+
+    // Largest step between neighbour samples inside tracks and at boundary
+    int max_step = 0;
+    int max_error = 0;
+    for (int i = 0; i < out_samples; i++) {
+        int v = out[i * GAPLESS_TEST_CHANNELS];
+        max_error = abs(v - sine_at(i)) > max_error ? abs(v - sine_at(i)) : max_error;
+        if (i && i != track_samples[0]) {
+            int step = abs(v - out[(i - 1) * GAPLESS_TEST_CHANNELS]);
+            max_step = step > max_step ? step : max_step;
+        }
+    }
+    int boundary = track_samples[0];
+    int boundary_step = abs(out[boundary * GAPLESS_TEST_CHANNELS] - out[(boundary - 1) * GAPLESS_TEST_CHANNELS]);
+    // Without trim the boundary would meet padding and delay junk
+    int untrimmed_step = abs(GAPLESS_TEST_JUNK - out[(boundary - 1) * GAPLESS_TEST_CHANNELS]);
+    ESP_LOGI(TAG, "Boundary step %d, max step in track %d, step without trim %d, max error %d",
+             boundary_step, max_step, untrimmed_step, max_error);
+    TEST_ASSERT_LESS_OR_EQUAL(max_step, boundary_step);
+    TEST_ASSERT_EQUAL(0, max_error);
+    TEST_ASSERT_EQUAL(2, event_count[GAPLESS_STREAM_EVENT_TRACK_START]);
+    TEST_ASSERT_EQUAL(2, event_count[GAPLESS_STREAM_EVENT_TRACK_END]);
+
+    audio_free(out);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_stop(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_wait_for_stop(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_terminate(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_unregister(pipeline, gapless));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_unregister(pipeline, raw));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_deinit(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(gapless));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(raw));
+    for (int i = 0; i < GAPLESS_STREAM_SLOT_NUM; i++) {
+        rb_destroy(rb[i]);
+    }
+}
+
+#define GAPLESS_TEST_FRAME      (GAPLESS_TEST_CHANNELS * sizeof(int16_t))
+
+/*
+ * Source of sequencer test: URI "gen://<start>/<samples>" outputs that part of the sine wave, other URIs fail to open
+ */
+typedef struct {
+    int pos;
+    int end;
+} gen_t;
+
+static esp_err_t gen_open(audio_element_handle_t self)
+{
+    gen_t *gen = (gen_t *)audio_element_getdata(self);
+    int samples = 0;
+    if (sscanf(audio_element_get_uri(self), "gen://%d/%d", &gen->pos, &samples) != 2) {
+        return ESP_FAIL;
+    }
+    gen->end = gen->pos + samples;
+    return ESP_OK;
+}
+
+static int gen_read(audio_element_handle_t self, char *buffer, int len, TickType_t ticks_to_wait, void *context)
+{
+    gen_t *gen = (gen_t *)audio_element_getdata(self);
+    int16_t *out = (int16_t *)buffer;
+    int frames = len / GAPLESS_TEST_FRAME;
+    if (frames > gen->end - gen->pos) {
+        frames = gen->end - gen->pos;
+    }
+    for (int i = 0; i < frames; i++, gen->pos++) {
+        for (int c = 0; c < GAPLESS_TEST_CHANNELS; c++) {
+            out[i * GAPLESS_TEST_CHANNELS + c] = sine_at(gen->pos);
+        }
+    }
+    return frames * GAPLESS_TEST_FRAME;
+}
+
+static int pass_process(audio_element_handle_t self, char *in_buffer, int in_len)
+{
+    int r_size = audio_element_input(self, in_buffer, in_len);
+    if (r_size <= 0) {
+        return r_size;
+    }
+    return audio_element_output(self, in_buffer, r_size);
+}
+
+static esp_err_t gen_destroy(audio_element_handle_t self)
+{
+    audio_free(audio_element_getdata(self));
+    return ESP_OK;
+}
+
+typedef struct {
+    int     end_num;
+    char    end_url[8][32];
+} seq_event_t;
+
+static void seq_event(audio_element_handle_t el, gapless_stream_event_msg_t *msg, void *ctx)
+{
+    seq_event_t *event = (seq_event_t *)ctx;
+    // URL stays valid during the callback of track end, sequencer frees it afterwards
+    if (msg->id == GAPLESS_STREAM_EVENT_TRACK_END && event->end_num < 8) {
+        vTaskDelay(20 / portTICK_PERIOD_MS);
+        snprintf(event->end_url[event->end_num++], sizeof(event->end_url[0]), "%s", (char *)msg->user_data);
+    }
+}
+
+TEST_CASE("gapless stream sequencer plays playlist and skips failed source", "[esp-adf-stream]")
+{
+    const char *urls[] = {"gen://0/3000", "gen://missing", "gen://3000/2000", "gen://5000/4000"};
+    const int url_num = sizeof(urls) / sizeof(urls[0]);
+    const int total = 9000;
+    seq_event_t event = { 0 };
+
+    playlist_handle_t playlist = playlist_create();
+    TEST_ASSERT_NOT_NULL(playlist);
+    playlist_operator_handle_t dram = NULL;
+    TEST_ASSERT_EQUAL(ESP_OK, dram_list_create(&dram));
+    TEST_ASSERT_EQUAL(ESP_OK, playlist_add(playlist, dram, 0));
+    for (int i = 0; i < url_num; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, playlist_save(playlist, urls[i]));
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, playlist_set_mode(playlist, false, PLAYLIST_REPEAT_NONE));
+
+    gapless_stream_cfg_t gapless_cfg = GAPLESS_STREAM_CFG_DEFAULT();
+    gapless_cfg.event_cb = seq_event;
+    gapless_cfg.event_ctx = &event;
+    audio_element_handle_t gapless = gapless_stream_init(&gapless_cfg);
+    TEST_ASSERT_NOT_NULL(gapless);
+    audio_element_set_music_info(gapless, GAPLESS_TEST_RATE, GAPLESS_TEST_CHANNELS, 16);
+    raw_stream_cfg_t raw_cfg = RAW_STREAM_CFG_DEFAULT();
+    raw_cfg.type = AUDIO_STREAM_READER;
+    audio_element_handle_t raw = raw_stream_init(&raw_cfg);
+    TEST_ASSERT_NOT_NULL(raw);
+    audio_pipeline_cfg_t pipeline_cfg = DEFAULT_AUDIO_PIPELINE_CONFIG();
+    audio_pipeline_handle_t pipeline = audio_pipeline_init(&pipeline_cfg);
+    TEST_ASSERT_NOT_NULL(pipeline);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(pipeline, gapless, "gapless"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(pipeline, raw, "raw"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_link(pipeline, (const char *[]) {"gapless", "raw"}, 2));
+
+    // Source pipeline of each slot: [gen]->[pass]->slot
+    gapless_stream_seq_cfg_t seq_cfg = GAPLESS_STREAM_SEQ_CFG_DEFAULT();
+    seq_cfg.playlist = playlist;
+    for (int i = 0; i < GAPLESS_STREAM_SLOT_NUM; i++) {
+        audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
+        cfg.open = gen_open;
+        cfg.read = gen_read;
+        cfg.process = pass_process;
+        cfg.destroy = gen_destroy;
+        cfg.tag = "gen";
+        seq_cfg.reader[i] = audio_element_init(&cfg);
+        TEST_ASSERT_NOT_NULL(seq_cfg.reader[i]);
+        audio_element_setdata(seq_cfg.reader[i], audio_calloc(1, sizeof(gen_t)));
+
+        audio_element_cfg_t pass_cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
+        pass_cfg.process = pass_process;
+        pass_cfg.tag = "pass";
+        seq_cfg.decoder[i] = audio_element_init(&pass_cfg);
+        TEST_ASSERT_NOT_NULL(seq_cfg.decoder[i]);
+        audio_element_set_music_info(seq_cfg.decoder[i], GAPLESS_TEST_RATE, GAPLESS_TEST_CHANNELS, 16);
+
+        seq_cfg.pipeline[i] = audio_pipeline_init(&pipeline_cfg);
+        TEST_ASSERT_NOT_NULL(seq_cfg.pipeline[i]);
+        TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(seq_cfg.pipeline[i], seq_cfg.reader[i], "gen"));
+        TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(seq_cfg.pipeline[i], seq_cfg.decoder[i], "pass"));
+        TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_link(seq_cfg.pipeline[i], (const char *[]) {"gen", "pass"}, 2));
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, gapless_stream_seq_start(gapless, &seq_cfg));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_run(pipeline));
+
+    int16_t *out = audio_calloc(total + 1, GAPLESS_TEST_FRAME);
+    TEST_ASSERT_NOT_NULL(out);
+    int out_bytes = 0;
+    int max_bytes = (total + 1) * GAPLESS_TEST_FRAME;
+    while (out_bytes < max_bytes) {
+        int ret = raw_stream_read(raw, (char *)out + out_bytes, max_bytes - out_bytes);
+        if (ret <= 0) {
+            break;
+        }
+        out_bytes += ret;
+    }
+    // Failed source is skipped, the others join into one sine wave
+    TEST_ASSERT_EQUAL(total, out_bytes / GAPLESS_TEST_FRAME);
+    for (int i = 0; i < total; i++) {
+        TEST_ASSERT_EQUAL(sine_at(i), out[i * GAPLESS_TEST_CHANNELS]);
+    }
+    TEST_ASSERT_EQUAL(url_num, event.end_num);
+    for (int i = 0; i < url_num; i++) {
+        TEST_ASSERT_EQUAL_STRING(urls[i], event.end_url[i]);
+    }
+
+    audio_free(out);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_stop(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_wait_for_stop(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, gapless_stream_seq_stop(gapless));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_terminate(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_deinit(pipeline));
+    for (int i = 0; i < GAPLESS_STREAM_SLOT_NUM; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_terminate(seq_cfg.pipeline[i]));
+        TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_deinit(seq_cfg.pipeline[i]));
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, playlist_destroy(playlist));
+}
@@ -0,0 +1,275 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "audio_pipeline.h"
+#include "audio_mem.h"
+#include "raw_stream.h"
+#include "mixer_stream.h"
+
+static const char *TAG = "MIXER_STREAM_TEST";
+
+#define MIXER_TEST_RATE     (16000)
+#define MIXER_TEST_MUSIC    (10000)
+#define MIXER_TEST_VOICE    (2000)
+
+typedef struct {
+    audio_pipeline_handle_t pipeline;
+    audio_element_handle_t  mixer;
+    audio_element_handle_t  raw;
+} mixer_test_t;
+
+/*
+ * Ringbuffer with constant samples as decoder would output them
+ */
+static ringbuf_handle_t write_const(int frames, int channels, int bits, int32_t value, bool done)
+{
+    int frame_size = channels * bits / 8;
+    ringbuf_handle_t rb = rb_create(frames * frame_size, 1);
+    TEST_ASSERT_NOT_NULL(rb);
+    for (int i = 0; i < frames * channels; i++) {
+        if (bits == 16) {
+            int16_t v = (int16_t)value;
+            TEST_ASSERT_EQUAL(sizeof(v), rb_write(rb, (char *)&v, sizeof(v), 0));
+        } else {
+            int32_t v = value * (1 << 16);
+            TEST_ASSERT_EQUAL(sizeof(v), rb_write(rb, (char *)&v, sizeof(v), 0));
+        }
+    }
+    if (done) {
+        rb_done_write(rb);
+    }
+    return rb;
+}
+
+static void count_event(audio_element_handle_t el, mixer_stream_event_msg_t *msg, void *ctx)
+{
+    int (*count)[MIXER_STREAM_MAX_INPUT] = ctx;
+    count[msg->id][msg->index]++;
+    ESP_LOGI(TAG, "Event %d of input %d", msg->id, msg->index);
+}
+
+static void mixer_test_init(mixer_test_t *test, mixer_stream_cfg_t *mixer_cfg)
+{
+    test->mixer = mixer_stream_init(mixer_cfg);
+    TEST_ASSERT_NOT_NULL(test->mixer);
+    raw_stream_cfg_t raw_cfg = RAW_STREAM_CFG_DEFAULT();
+    raw_cfg.type = AUDIO_STREAM_READER;
+    test->raw = raw_stream_init(&raw_cfg);
+    TEST_ASSERT_NOT_NULL(test->raw);
+    audio_pipeline_cfg_t pipeline_cfg = DEFAULT_AUDIO_PIPELINE_CONFIG();
+    test->pipeline = audio_pipeline_init(&pipeline_cfg);
+    TEST_ASSERT_NOT_NULL(test->pipeline);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(test->pipeline, test->mixer, "mixer"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(test->pipeline, test->raw, "raw"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_link(test->pipeline, (const char *[]) {"mixer", "raw"}, 2));
+}
+
+static int mixer_test_read_all(mixer_test_t *test, int16_t *out, int max_frames)
+{
+    int out_bytes = 0;
+    int max_bytes = max_frames * sizeof(int16_t);
+    while (out_bytes < max_bytes) {
+        int ret = raw_stream_read(test->raw, (char *)out + out_bytes, max_bytes - out_bytes);
+        if (ret <= 0) {
+            break;
+        }
+        out_bytes += ret;
+    }
+    return out_bytes / sizeof(int16_t);
+}
+
+static void mixer_test_deinit(mixer_test_t *test)
+{
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_stop(test->pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_wait_for_stop(test->pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_terminate(test->pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_unregister(test->pipeline, test->mixer));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_unregister(test->pipeline, test->raw));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_deinit(test->pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(test->mixer));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(test->raw));
+}
+
+TEST_CASE("mixer stream init memory", "[esp-adf-stream]")
+{
+    mixer_stream_cfg_t mixer_cfg = MIXER_STREAM_CFG_DEFAULT();
+    int cnt = 2000;
+    AUDIO_MEM_SHOW("BEFORE MIXER_STREAM_INIT MEMORY TEST");
+    while (cnt--) {
+        audio_element_handle_t mixer = mixer_stream_init(&mixer_cfg);
+        TEST_ASSERT_NOT_NULL(mixer);
+        TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(mixer));
+    }
+    AUDIO_MEM_SHOW("AFTER MIXER_STREAM_INIT MEMORY TEST");
+}
+
+TEST_CASE("mixer stream format conversion and ducking", "[esp-adf-stream]")
+{
+    int event_count[MIXER_STREAM_EVENT_INPUT_DETACHED + 1][MIXER_STREAM_MAX_INPUT] = { 0 };
+    mixer_stream_cfg_t mixer_cfg = MIXER_STREAM_CFG_DEFAULT();
+    mixer_cfg.sample_rate = MIXER_TEST_RATE;
+    mixer_cfg.channels = 1;
+    mixer_cfg.duck_db = -20.0f;
+    mixer_cfg.duck_attack_ms = 20;
+    mixer_cfg.duck_release_ms = 20;
+    mixer_cfg.duck_hold_ms = 0;
+    mixer_cfg.event_cb = count_event;
+    mixer_cfg.event_ctx = event_count;
+    mixer_test_t test;
+    mixer_test_init(&test, &mixer_cfg);
+
+    // Music in output format for 1s, voice in 8 kHz stereo 32 bits for 0.3s
+    ringbuf_handle_t music_rb = write_const(MIXER_TEST_RATE, 1, 16, MIXER_TEST_MUSIC, true);
+    ringbuf_handle_t voice_rb = write_const(8000 * 3 / 10, 2, 32, MIXER_TEST_VOICE, true);
+    mixer_stream_input_cfg_t music_cfg = MIXER_STREAM_INPUT_CFG_DEFAULT();
+    mixer_stream_input_cfg_t voice_cfg = MIXER_STREAM_INPUT_CFG_DEFAULT();
+    voice_cfg.sample_rate = 8000;
+    voice_cfg.channels = 2;
+    voice_cfg.bits = 32;
+    voice_cfg.sidechain = true;
+    TEST_ASSERT_EQUAL(ESP_OK, mixer_stream_attach(test.mixer, 0, music_rb, &music_cfg));
+    TEST_ASSERT_EQUAL(ESP_FAIL, mixer_stream_attach(test.mixer, 0, voice_rb, &voice_cfg));
+    TEST_ASSERT_EQUAL(ESP_OK, mixer_stream_attach(test.mixer, 1, voice_rb, &voice_cfg));
+    TEST_ASSERT_EQUAL(ESP_OK, mixer_stream_finish(test.mixer));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_run(test.pipeline));
+
+    int16_t *out = audio_calloc(MIXER_TEST_RATE + 1, sizeof(int16_t));
+    TEST_ASSERT_NOT_NULL(out);
+    int frames = mixer_test_read_all(&test, out, MIXER_TEST_RATE + 1);
+    // Music ducked to -20 dB in Q14 gain plus voice
+    int ducked_level = (MIXER_TEST_MUSIC * 1638 >> 14) + MIXER_TEST_VOICE;
+    int ducked = 0;
+    for (int i = 0; i < frames; i++) {
+        ducked += abs(out[i] - ducked_level) <= 2;
+    }
+    ESP_LOGI(TAG, "Output %d frames, first %d, ducked %d frames, last %d", frames, out[0], ducked, out[frames - 1]);
+    TEST_ASSERT_EQUAL(MIXER_TEST_RATE, frames);
+    TEST_ASSERT_EQUAL(MIXER_TEST_MUSIC + MIXER_TEST_VOICE, out[0]);
+    TEST_ASSERT_GREATER_THAN(MIXER_TEST_RATE / 5, ducked);
+    TEST_ASSERT_EQUAL(MIXER_TEST_MUSIC, out[frames - 1]);
+    TEST_ASSERT_EQUAL(1, event_count[MIXER_STREAM_EVENT_INPUT_DONE][0]);
+    TEST_ASSERT_EQUAL(1, event_count[MIXER_STREAM_EVENT_INPUT_DONE][1]);
+
+    audio_free(out);
+    mixer_test_deinit(&test);
+    rb_destroy(music_rb);
+    rb_destroy(voice_rb);
+}
+
+TEST_CASE("mixer stream crossfade between inputs", "[esp-adf-stream]")
+{
+    int event_count[MIXER_STREAM_EVENT_INPUT_DETACHED + 1][MIXER_STREAM_MAX_INPUT] = { 0 };
+    mixer_stream_cfg_t mixer_cfg = MIXER_STREAM_CFG_DEFAULT();
+    mixer_cfg.sample_rate = MIXER_TEST_RATE;
+    mixer_cfg.channels = 1;
+    mixer_cfg.event_cb = count_event;
+    mixer_cfg.event_ctx = event_count;
+    mixer_test_t test;
+    mixer_test_init(&test, &mixer_cfg);
+
+    ringbuf_handle_t from_rb = write_const(MIXER_TEST_RATE, 1, 16, MIXER_TEST_MUSIC, true);
+    ringbuf_handle_t to_rb = write_const(MIXER_TEST_RATE / 2, 1, 16, -MIXER_TEST_MUSIC / 2, true);
+    mixer_stream_input_cfg_t input_cfg = MIXER_STREAM_INPUT_CFG_DEFAULT();
+    TEST_ASSERT_EQUAL(ESP_OK, mixer_stream_attach(test.mixer, 0, from_rb, &input_cfg));
+    TEST_ASSERT_EQUAL(ESP_OK, mixer_stream_attach(test.mixer, 1, to_rb, &input_cfg));
+    TEST_ASSERT_EQUAL(ESP_FAIL, mixer_stream_crossfade(test.mixer, 1, 1, 100));
+    TEST_ASSERT_EQUAL(ESP_OK, mixer_stream_crossfade(test.mixer, 0, 1, 100));
+    TEST_ASSERT_EQUAL(ESP_OK, mixer_stream_finish(test.mixer));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_run(test.pipeline));
+
+    int16_t *out = audio_calloc(MIXER_TEST_RATE, sizeof(int16_t));
+    TEST_ASSERT_NOT_NULL(out);
+    int frames = mixer_test_read_all(&test, out, MIXER_TEST_RATE);
+    ESP_LOGI(TAG, "Output %d frames, first %d, last %d", frames, out[0], out[frames - 1]);
+    // Equal power crossfade from positive to negative level falls without step
+    for (int i = 1; i < frames; i++) {
+        TEST_ASSERT_LESS_OR_EQUAL(out[i - 1], out[i]);
+    }
+    TEST_ASSERT_EQUAL(MIXER_TEST_RATE / 2, frames);
+    TEST_ASSERT_EQUAL(MIXER_TEST_MUSIC, out[0]);
+    TEST_ASSERT_EQUAL(-MIXER_TEST_MUSIC / 2, out[frames - 1]);
+    TEST_ASSERT_EQUAL(1, event_count[MIXER_STREAM_EVENT_FADE_DONE][0]);
+    TEST_ASSERT_EQUAL(1, event_count[MIXER_STREAM_EVENT_FADE_DONE][1]);
+    TEST_ASSERT_EQUAL(1, event_count[MIXER_STREAM_EVENT_INPUT_DETACHED][0]);
+    TEST_ASSERT_EQUAL(0, event_count[MIXER_STREAM_EVENT_INPUT_DONE][0]);
+    TEST_ASSERT_EQUAL(ESP_FAIL, mixer_stream_detach(test.mixer, 0));
+
+    audio_free(out);
+    mixer_test_deinit(&test);
+    rb_destroy(from_rb);
+    rb_destroy(to_rb);
+}
+
+TEST_CASE("mixer stream mixing performance", "[esp-adf-stream]")
+{
+    const int input_num = 4;
+    const int loop = 200;
+    mixer_stream_cfg_t mixer_cfg = MIXER_STREAM_CFG_DEFAULT();
+    mixer_test_t test;
+    mixer_test_init(&test, &mixer_cfg);
+
+    // Input 3 is resampled from 44.1 kHz, the others are mixed in output format
+    int frame_size = mixer_cfg.channels * mixer_cfg.bits / 8;
+    int block = mixer_cfg.sample_rate / 100 * frame_size;
+    char *data = audio_calloc(1, block);
+    TEST_ASSERT_NOT_NULL(data);
+    ringbuf_handle_t rb[MIXER_STREAM_MAX_INPUT] = { 0 };
+    for (int i = 0; i < input_num; i++) {
+        rb[i] = rb_create(block * 2, 1);
+        TEST_ASSERT_NOT_NULL(rb[i]);
+        mixer_stream_input_cfg_t input_cfg = MIXER_STREAM_INPUT_CFG_DEFAULT();
+        input_cfg.sample_rate = i == 3 ? 44100 : 0;
+        input_cfg.gain_db = -6.0f;
+        input_cfg.sidechain = (i == 2);
+        TEST_ASSERT_EQUAL(ESP_OK, mixer_stream_attach(test.mixer, i, rb[i], &input_cfg));
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_run(test.pipeline));
+
+    int64_t start = esp_timer_get_time();
+    for (int k = 0; k < loop; k++) {
+        for (int i = 0; i < input_num; i++) {
+            int size = i == 3 ? 441 * frame_size : block;
+            rb_write(rb[i], data, size, portMAX_DELAY);
+        }
+        raw_stream_read(test.raw, data, block);
+    }
+    int64_t elapse = esp_timer_get_time() - start;
+    // Each loop mixes 10ms audio, ringbuffer transfer is included
+    ESP_LOGI(TAG, "%d inputs of %d Hz %d channels: %d us per 10ms frame", input_num,
+             mixer_cfg.sample_rate, mixer_cfg.channels, (int)(elapse / loop));
+
+    audio_free(data);
+    mixer_test_deinit(&test);
+    for (int i = 0; i < input_num; i++) {
+        rb_destroy(rb[i]);
+    }
+}
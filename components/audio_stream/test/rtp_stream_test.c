@@ -0,0 +1,146 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "audio_pipeline.h"
+#include "audio_mem.h"
+#include "raw_stream.h"
+#include "rtp_stream.h"
+
+static const char *TAG = "RTP_STREAM_TEST";
+
+#define RTP_TEST_PORT           (5006)
+#define RTP_TEST_FRAME_BYTES    (320)   /* 10 ms of 16 kHz mono 16-bit */
+#define RTP_TEST_FRAME_NUM      (300)
+
+TEST_CASE("rtp stream init memory", "[esp-adf-stream]")
+{
+    rtp_stream_cfg_t rtp_cfg = RTP_STREAM_CFG_DEFAULT();
+    int cnt = 2000;
+    AUDIO_MEM_SHOW("BEFORE RTP_STREAM_INIT MEMORY TEST");
+    while (cnt--) {
+        rtp_cfg.type = (cnt & 1) ? AUDIO_STREAM_READER : AUDIO_STREAM_WRITER;
+        audio_element_handle_t rtp = rtp_stream_init(&rtp_cfg);
+        TEST_ASSERT_NOT_NULL(rtp);
+        TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(rtp));
+    }
+    AUDIO_MEM_SHOW("AFTER RTP_STREAM_INIT MEMORY TEST");
+}
+
+TEST_CASE("rtp stream loopback latency", "[esp-adf-stream]")
+{
+    tcpip_adapter_init();
+
+    audio_pipeline_cfg_t pipeline_cfg = DEFAULT_AUDIO_PIPELINE_CONFIG();
+    audio_pipeline_handle_t tx_pipeline = audio_pipeline_init(&pipeline_cfg);
+    audio_pipeline_handle_t rx_pipeline = audio_pipeline_init(&pipeline_cfg);
+    TEST_ASSERT_NOT_NULL(tx_pipeline);
+    TEST_ASSERT_NOT_NULL(rx_pipeline);
+
+    raw_stream_cfg_t raw_cfg = RAW_STREAM_CFG_DEFAULT();
+    raw_cfg.type = AUDIO_STREAM_WRITER;
+    audio_element_handle_t raw_writer = raw_stream_init(&raw_cfg);
+    raw_cfg.type = AUDIO_STREAM_READER;
+    audio_element_handle_t raw_reader = raw_stream_init(&raw_cfg);
+
+    rtp_stream_cfg_t rtp_cfg = RTP_STREAM_CFG_DEFAULT();
+    rtp_cfg.port = RTP_TEST_PORT;
+    rtp_cfg.type = AUDIO_STREAM_WRITER;
+    rtp_cfg.host = "127.0.0.1";
+    audio_element_handle_t rtp_writer = rtp_stream_init(&rtp_cfg);
+    rtp_cfg.type = AUDIO_STREAM_READER;
+    rtp_cfg.host = NULL;
+    audio_element_handle_t rtp_reader = rtp_stream_init(&rtp_cfg);
+    TEST_ASSERT_NOT_NULL(rtp_writer);
+    TEST_ASSERT_NOT_NULL(rtp_reader);
+
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(tx_pipeline, raw_writer, "raw"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(tx_pipeline, rtp_writer, "rtp"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_link(tx_pipeline, (const char *[]) {"raw", "rtp"}, 2));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(rx_pipeline, rtp_reader, "rtp"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(rx_pipeline, raw_reader, "raw"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_link(rx_pipeline, (const char *[]) {"rtp", "raw"}, 2));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_run(rx_pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_run(tx_pipeline));
+
+    char *frame = audio_calloc(1, RTP_TEST_FRAME_BYTES);
+    TEST_ASSERT_NOT_NULL(frame);
+    int64_t latency_sum = 0;
+    int64_t latency_max = 0;
+    int received = 0;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < RTP_TEST_FRAME_NUM; i++) {
+        /* Stamp each frame with its send time, it survives the L16 byte swapping round trip */
+        int64_t now = esp_timer_get_time();
+        memcpy(frame, &now, sizeof(now));
+        TEST_ASSERT_EQUAL(RTP_TEST_FRAME_BYTES, raw_stream_write(raw_writer, frame, RTP_TEST_FRAME_BYTES));
+        while (audio_element_get_output_ringbuf(rtp_reader)
+               && rb_bytes_filled(audio_element_get_output_ringbuf(rtp_reader)) >= RTP_TEST_FRAME_BYTES) {
+            TEST_ASSERT_EQUAL(RTP_TEST_FRAME_BYTES, raw_stream_read(raw_reader, frame, RTP_TEST_FRAME_BYTES));
+            int64_t sent;
+            memcpy(&sent, frame, sizeof(sent));
+            if (sent > start) {
+                int64_t latency = esp_timer_get_time() - sent;
+                latency_sum += latency;
+                latency_max = latency > latency_max ? latency : latency_max;
+                received++;
+            }
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    rtp_stream_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, rtp_stream_get_stats(rtp_reader, &stats));
+    ESP_LOGI(TAG, "Received %d frames, latency avg %d us max %d us, jitter %d us, target %d ms",
+             received, received ? (int)(latency_sum / received) : 0, (int)latency_max, stats.jitter_us, stats.target_ms);
+    ESP_LOGI(TAG, "packets %u lost %u late %u dup %u overflow %u underruns %u",
+             stats.packets, stats.lost, stats.late, stats.duplicated, stats.overflow, stats.underruns);
+    TEST_ASSERT_TRUE(received > RTP_TEST_FRAME_NUM / 2);
+    TEST_ASSERT_EQUAL(0, stats.late);
+    TEST_ASSERT_TRUE(latency_max < (RTP_STREAM_JITTER_MAX_MS + 50) * 1000);
+    audio_free(frame);
+
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_stop(tx_pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_wait_for_stop(tx_pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_terminate(tx_pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_stop(rx_pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_wait_for_stop(rx_pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_terminate(rx_pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_unregister(tx_pipeline, raw_writer));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_unregister(tx_pipeline, rtp_writer));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_unregister(rx_pipeline, rtp_reader));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_unregister(rx_pipeline, raw_reader));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_deinit(tx_pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_deinit(rx_pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(raw_writer));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(rtp_writer));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(rtp_reader));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(raw_reader));
+}
@@ -27,19 +27,23 @@
 #include <stdlib.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 
 #include "unity.h"
 #include "esp_wifi.h"
 #include "esp_http_client.h"
 #include "nvs_flash.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "audio_pipeline.h"
 #include "audio_mem.h"
 #include "audio_element.h"
 #include "audio_event_iface.h"
 
+#include "lwip/sockets.h"
 #include "tcp_client_stream.h"
 #include "fatfs_stream.h"
+#include "raw_stream.h"
 
 #include "esp_peripherals.h"
 #include "periph_wifi.h"
@@ -47,6 +51,11 @@
 #define CONFIG_TCP_URL   "192.168.199.118"
 #define CONFIG_TCP_PORT  8080
 
+#define LOOPBACK_TCP_PORT        8090
+#define LOOPBACK_FRAME_SIZE      64
+#define LOOPBACK_FRAME_NUM       200
+#define LOOPBACK_COALESCE_SIZE   1024
+
 static const char *TAG =  "TCP_CLIENT_STREAM_TEST"
 
 TEST_CASE("tcp client stream init memory", "[esp-adf-stream]")
@@ -239,4 +248,115 @@ TEST_CASE("tcp client stream read", "[esp-adf-stream]")
     TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(tcp_stream_writer));
     TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(fatfs_stream_reader));
     TEST_ASSERT_EQUAL(ESP_OK, esp_periph_set_destroy(set));
-}
\ No newline at end of file
+}
+
+typedef struct {
+    int recv_calls;
+    int recv_bytes;
+    bool listening;
+    bool accepted;
+    SemaphoreHandle_t ready;
+    SemaphoreHandle_t done;
+} loopback_server_t;
+
+static void loopback_server_task(void *pv)
+{
+    loopback_server_t *srv = (loopback_server_t *)pv;
+    char buf[512];
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(LOOPBACK_TCP_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    // Unity asserts must only run in the test task, so just record the outcome here
+    int listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    srv->listening = listen_sock >= 0
+                     && bind(listen_sock, (struct sockaddr *)&addr, sizeof(addr)) == 0
+                     && listen(listen_sock, 1) == 0;
+    xSemaphoreGive(srv->ready);
+    if (srv->listening) {
+        int sock = accept(listen_sock, NULL, NULL);
+        srv->accepted = sock >= 0;
+        if (srv->accepted) {
+            int len;
+            while ((len = recv(sock, buf, sizeof(buf), 0)) > 0) {
+                srv->recv_calls++;
+                srv->recv_bytes += len;
+            }
+            close(sock);
+        }
+    }
+    if (listen_sock >= 0) {
+        close(listen_sock);
+    }
+    xSemaphoreGive(srv->done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("tcp client stream coalesced write over loopback", "[esp-adf-stream]")
+{
+    tcpip_adapter_init();
+
+    loopback_server_t srv = { 0 };
+    srv.ready = xSemaphoreCreateBinary();
+    srv.done = xSemaphoreCreateBinary();
+    TEST_ASSERT_NOT_NULL(srv.ready);
+    TEST_ASSERT_NOT_NULL(srv.done);
+    xTaskCreate(loopback_server_task, "loopback_srv", 3 * 1024, &srv, 5, NULL);
+    TEST_ASSERT_TRUE(xSemaphoreTake(srv.ready, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_TRUE(srv.listening);
+
+    audio_pipeline_cfg_t pipeline_cfg = DEFAULT_AUDIO_PIPELINE_CONFIG();
+    audio_pipeline_handle_t pipeline = audio_pipeline_init(&pipeline_cfg);
+    TEST_ASSERT_NOT_NULL(pipeline);
+
+    raw_stream_cfg_t raw_cfg = RAW_STREAM_CFG_DEFAULT();
+    raw_cfg.type = AUDIO_STREAM_WRITER;
+    audio_element_handle_t raw_writer = raw_stream_init(&raw_cfg);
+    TEST_ASSERT_NOT_NULL(raw_writer);
+
+    tcp_stream_cfg_t tcp_cfg = TCP_STREAM_CFG_DEFAULT();
+    tcp_cfg.type = AUDIO_STREAM_WRITER;
+    tcp_cfg.host = "127.0.0.1";
+    tcp_cfg.port = LOOPBACK_TCP_PORT;
+    tcp_cfg.nodelay = true;
+    tcp_cfg.keep_alive_enable = true;
+    tcp_cfg.coalesce_size = LOOPBACK_COALESCE_SIZE;
+    tcp_cfg.coalesce_ms = 20;
+    tcp_cfg.reconnect_max = 3;
+    audio_element_handle_t tcp_writer = tcp_stream_init(&tcp_cfg);
+    TEST_ASSERT_NOT_NULL(tcp_writer);
+
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(pipeline, raw_writer, "raw"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_register(pipeline, tcp_writer, "tcp"));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_link(pipeline, (const char *[]) {"raw", "tcp"}, 2));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_run(pipeline));
+
+    char frame[LOOPBACK_FRAME_SIZE];
+    memset(frame, 0x5a, sizeof(frame));
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < LOOPBACK_FRAME_NUM; i++) {
+        TEST_ASSERT_EQUAL(LOOPBACK_FRAME_SIZE, raw_stream_write(raw_writer, frame, sizeof(frame)));
+    }
+    audio_element_set_ringbuf_done(raw_writer);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_wait_for_stop(tcp_writer));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_stop(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_wait_for_stop(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_terminate(pipeline));
+    TEST_ASSERT_TRUE(xSemaphoreTake(srv.done, pdMS_TO_TICKS(5000)));
+    TEST_ASSERT_TRUE(srv.accepted);
+    TEST_ASSERT_EQUAL(portMAX_DELAY, audio_element_get_input_timeout(tcp_writer));
+
+    ESP_LOGI(TAG, "Sent %d frames in %d us, server got %d bytes in %d recv calls",
+             LOOPBACK_FRAME_NUM, (int)(esp_timer_get_time() - start), srv.recv_bytes, srv.recv_calls);
+    TEST_ASSERT_EQUAL(LOOPBACK_FRAME_SIZE * LOOPBACK_FRAME_NUM, srv.recv_bytes);
+    TEST_ASSERT_TRUE(srv.recv_calls < LOOPBACK_FRAME_NUM);
+
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_unregister(pipeline, raw_writer));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_unregister(pipeline, tcp_writer));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_pipeline_deinit(pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(raw_writer));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(tcp_writer));
+    vSemaphoreDelete(srv.ready);
+    vSemaphoreDelete(srv.done);
+}
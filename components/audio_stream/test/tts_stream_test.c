@@ -25,6 +25,7 @@
 #include "unity.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "audio_pipeline.h"
 #include "audio_mem.h"
@@ -280,3 +281,39 @@ TEST_CASE("tts stream play-stop and start new chainese string", "[esp-adf-stream
     }
     deinit_tts_stream_test(&pipeline, &tts_stream_reader, &i2s_stream_writer, &set, &evt);
 }
+
+TEST_CASE("tts stream streaming mode plays repeated strings from cache", "[esp-adf-stream]")
+{
+    AUDIO_MEM_SHOW("TTS STREAM STREAMING MODE CACHE TEST");
+    static const char *STRINGS = "乐鑫科技是一家全球化的无晶圆厂半导体公司，团队成员来自全世界的 20 多个国家和地区。";
+    tts_stream_cfg_t tts_cfg = TTS_STREAM_CFG_DEFAULT();
+    tts_cfg.streaming = true;
+    tts_cfg.cache_size = 512 * 1024;
+    audio_element_handle_t tts_stream_reader = tts_stream_init(&tts_cfg);
+    TEST_ASSERT_NOT_NULL(tts_stream_reader);
+    TEST_ASSERT_EQUAL(ESP_OK, tts_stream_set_strings(tts_stream_reader, STRINGS));
+
+    char *buf = audio_calloc(1, TTS_STREAM_BUF_SIZE);
+    TEST_ASSERT_NOT_NULL(buf);
+    int total[2] = { 0 };
+    int64_t first_audio_us[2] = { 0 };
+    for (int i = 0; i < 2; i++) {
+        int64_t start = esp_timer_get_time();
+        TEST_ASSERT_EQUAL(ESP_OK, audio_element_process_init(tts_stream_reader));
+        int len;
+        while ((len = audio_element_input(tts_stream_reader, buf, TTS_STREAM_BUF_SIZE)) > 0) {
+            if (total[i] == 0) {
+                first_audio_us[i] = esp_timer_get_time() - start;
+            }
+            total[i] += len;
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, audio_element_process_deinit(tts_stream_reader));
+        ESP_LOGI("TTS_STREAM_TEST", "Round %d: %d bytes, first audio after %d us", i, total[i], (int)first_audio_us[i]);
+    }
+    TEST_ASSERT_GREATER_THAN(0, total[0]);
+    TEST_ASSERT_EQUAL(total[0], total[1]);
+    TEST_ASSERT_LESS_OR_EQUAL(first_audio_us[0], first_audio_us[1]);
+    audio_free(buf);
+    TEST_ASSERT_EQUAL(ESP_OK, tts_stream_clear_cache(tts_stream_reader));
+    audio_element_deinit(tts_stream_reader);
+}
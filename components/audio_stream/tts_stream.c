@@ -22,9 +22,13 @@
  *
  */
 
+#include <ctype.h>
 #include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "tts_stream.h"
 #include "audio_mem.h"
+#include "audio_thread.h"
 #include "esp_log.h"
 #include "esp_partition.h"
 #include "esp_tts_voice_template.h"
@@ -41,6 +45,17 @@ static const char *TAG = "TTS_STREAM";
     }                                 \
 }while (0)
 
+#define TTS_CACHE_GROW_SIZE     (8 * 1024)
+
+typedef struct tts_cache_entry {
+    uint32_t                hash;
+    unsigned int            speed;
+    char                    *text;              /* Hash only picks candidates, text is compared on hit */
+    int                     len;
+    char                    *pcm;
+    struct tts_cache_entry  *next;
+} tts_cache_entry_t;
+
 /*  */
 typedef struct tts_stream {
     audio_stream_type_t     type;
@@ -50,8 +65,256 @@ typedef struct tts_stream {
     unsigned int            speed;
     spi_flash_mmap_handle_t mmap;
     bool is_open;
+    /* Streaming mode */
+    bool                    streaming;
+    ringbuf_handle_t        synth_rb;
+    int                     synth_task_stack;
+    int                     synth_task_prio;
+    int                     synth_task_core;
+    SemaphoreHandle_t       synth_exit;
+    bool                    synth_running;
+    volatile bool           synth_abort;
+    uint32_t                hash;
+    SemaphoreHandle_t       cache_lock;         /* Guards the cache list, it is filled by the synthesis task */
+    tts_cache_entry_t       *cache;             /* Most recently used first */
+    tts_cache_entry_t       *cache_hit;
+    int                     cache_pos;
+    int                     cache_size;
+    int                     cache_used;
 } tts_stream_t;
 
+static uint32_t _tts_hash(const char *str, unsigned int speed)
+{
+    uint32_t hash = 2166136261u ^ speed;
+    while (*str) {
+        hash ^= (uint8_t)*str++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void _tts_cache_free(tts_cache_entry_t *item)
+{
+    audio_free(item->text);
+    audio_free(item->pcm);
+    audio_free(item);
+}
+
+static tts_cache_entry_t *_tts_cache_find(tts_stream_t *tts_stream, const char *text, uint32_t hash, unsigned int speed)
+{
+    tts_cache_entry_t *prev = NULL;
+    tts_cache_entry_t *item = NULL;
+    xSemaphoreTake(tts_stream->cache_lock, portMAX_DELAY);
+    for (item = tts_stream->cache; item; prev = item, item = item->next) {
+        if (item->hash == hash && item->speed == speed && strcmp(item->text, text) == 0) {
+            if (prev) {
+                prev->next = item->next;
+                item->next = tts_stream->cache;
+                tts_stream->cache = item;
+            }
+            break;
+        }
+    }
+    /* Claimed under the lock, so tts_stream_clear_cache() can not free it in between */
+    tts_stream->cache_hit = item;
+    xSemaphoreGive(tts_stream->cache_lock);
+    return item;
+}
+
+static void _tts_cache_put(tts_stream_t *tts_stream, const char *text, uint32_t hash, unsigned int speed, char *pcm, int len)
+{
+    tts_cache_entry_t *item = audio_calloc(1, sizeof(tts_cache_entry_t));
+    AUDIO_MEM_CHECK(TAG, item, {
+        audio_free(pcm);
+        return;
+    });
+    item->text = audio_strdup(text);
+    AUDIO_MEM_CHECK(TAG, item->text, {
+        audio_free(item);
+        audio_free(pcm);
+        return;
+    });
+    item->hash = hash;
+    item->speed = speed;
+    item->pcm = pcm;
+    item->len = len;
+    xSemaphoreTake(tts_stream->cache_lock, portMAX_DELAY);
+    while (tts_stream->cache && tts_stream->cache_used + len > tts_stream->cache_size) {
+        tts_cache_entry_t **last = &tts_stream->cache;
+        while ((*last)->next) {
+            last = &(*last)->next;
+        }
+        tts_stream->cache_used -= (*last)->len;
+        _tts_cache_free(*last);
+        *last = NULL;
+    }
+    item->next = tts_stream->cache;
+    tts_stream->cache = item;
+    tts_stream->cache_used += len;
+    xSemaphoreGive(tts_stream->cache_lock);
+}
+
+static int _tts_sentence_len(const char *str)
+{
+    const uint8_t *p = (const uint8_t *)str;
+    while (*p) {
+        if (*p == '.' || *p == ',' || *p == ':') {
+            // Not a pause inside a number, e.g. "3.5", "1,000" or "10:30"
+            if (!(p > (const uint8_t *)str && isdigit(p[-1]) && isdigit(p[1]))) {
+                return (const char *)p - str + 1;
+            }
+        } else if (*p == '!' || *p == '?' || *p == ';' || *p == '\n') {
+            return (const char *)p - str + 1;
+        }
+        /* `。` and full width `！` `，` `：` `；` `？` */
+        if ((p[0] == 0xE3 && p[1] == 0x80 && p[2] == 0x82)
+            || (p[0] == 0xEF && p[1] == 0xBC && (p[2] == 0x81 || p[2] == 0x8C || p[2] == 0x9A || p[2] == 0x9B || p[2] == 0x9F))) {
+            return (const char *)p - str + 3;
+        }
+        p++;
+    }
+    return (const char *)p - str;
+}
+
+static void _tts_synth_task(void *pv)
+{
+    audio_element_handle_t self = (audio_element_handle_t)pv;
+    tts_stream_t *tts_stream = (tts_stream_t *)audio_element_getdata(self);
+    char *text = tts_stream->prompt;
+    char *pcm_cache = NULL;
+    int cache_len = 0;
+    int cache_cap = 0;
+    bool cacheable = tts_stream->cache_size > 0;
+
+    while (*text && !tts_stream->synth_abort) {
+        int n = _tts_sentence_len(text);
+        char saved = text[n];
+        text[n] = '\0';
+        if (esp_tts_parse_chinese(tts_stream->tts_handle, text)) {
+            while (!tts_stream->synth_abort) {
+                int rlen = 0;
+                uint8_t *pcm_data = (uint8_t *)esp_tts_stream_play(tts_stream->tts_handle, &rlen, tts_stream->speed);
+                if (rlen <= 0) {
+                    break;
+                }
+                rlen <<= 1;
+                if (rb_write(tts_stream->synth_rb, (char *)pcm_data, rlen, portMAX_DELAY) < 0) {
+                    tts_stream->synth_abort = true;
+                    break;
+                }
+                if (cacheable && cache_len + rlen > cache_cap) {
+                    // Grow by doubling, a chunk of synthesis is small and realloc copies whole PCM
+                    int cap = cache_cap ? cache_cap * 2 : TTS_CACHE_GROW_SIZE;
+                    cap = cap < cache_len + rlen ? cache_len + rlen : cap;
+                    cap = cap > tts_stream->cache_size ? tts_stream->cache_size : cap;
+                    char *p = NULL;
+                    if (cache_len + rlen <= cap) {
+                        p = audio_realloc(pcm_cache, cap);
+                    }
+                    if (p == NULL) {
+                        audio_free(pcm_cache);
+                        pcm_cache = NULL;
+                        cache_len = 0;
+                        cacheable = false;
+                    } else {
+                        pcm_cache = p;
+                        cache_cap = cap;
+                    }
+                }
+                if (cacheable) {
+                    memcpy(pcm_cache + cache_len, pcm_data, rlen);
+                    cache_len += rlen;
+                }
+            }
+            esp_tts_stream_reset(tts_stream->tts_handle);
+        } else {
+            ESP_LOGW(TAG, "Skip the sentence failed to parse, %s", text);
+        }
+        text[n] = saved;
+        text += n;
+    }
+    if (cacheable && cache_len > 0 && !tts_stream->synth_abort) {
+        if (cache_len < cache_cap) {
+            char *p = audio_realloc(pcm_cache, cache_len);
+            pcm_cache = p ? p : pcm_cache;
+        }
+        _tts_cache_put(tts_stream, tts_stream->prompt, tts_stream->hash, tts_stream->speed, pcm_cache, cache_len);
+    } else {
+        audio_free(pcm_cache);
+    }
+    rb_done_write(tts_stream->synth_rb);
+    xSemaphoreGive(tts_stream->synth_exit);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t _tts_stream_open_streaming(audio_element_handle_t self, const char *uri)
+{
+    tts_stream_t *tts_stream = (tts_stream_t *)audio_element_getdata(self);
+    tts_stream->hash = _tts_hash(uri, tts_stream->speed);
+    tts_stream->cache_pos = 0;
+    tts_stream->cache_hit = NULL;
+    if (tts_stream->cache_size > 0) {
+        _tts_cache_find(tts_stream, uri, tts_stream->hash, tts_stream->speed);
+    }
+    if (tts_stream->cache_hit) {
+        ESP_LOGI(TAG, "Play from cache, %d bytes", tts_stream->cache_hit->len);
+        tts_stream->is_open = true;
+        return ESP_OK;
+    }
+    tts_stream->prompt = audio_strdup(uri);
+    AUDIO_MEM_CHECK(TAG, tts_stream->prompt, return ESP_FAIL);
+    rb_reset(tts_stream->synth_rb);
+    tts_stream->synth_abort = false;
+    if (audio_thread_create(NULL, "tts_synth", _tts_synth_task, self, tts_stream->synth_task_stack,
+                            tts_stream->synth_task_prio, false, tts_stream->synth_task_core) != ESP_OK) {
+        ESP_LOGE(TAG, "Create tts synthesis task failed");
+        audio_free(tts_stream->prompt);
+        tts_stream->prompt = NULL;
+        return ESP_FAIL;
+    }
+    tts_stream->synth_running = true;
+    tts_stream->is_open = true;
+    return ESP_OK;
+}
+
+static int _tts_stream_read_streaming(audio_element_handle_t self, char *buffer, int len, TickType_t ticks_to_wait)
+{
+    tts_stream_t *tts_stream = (tts_stream_t *)audio_element_getdata(self);
+    int rlen = 0;
+    if (tts_stream->cache_hit) {
+        rlen = tts_stream->cache_hit->len - tts_stream->cache_pos;
+        if (rlen > len) {
+            rlen = len;
+        }
+        memcpy(buffer, tts_stream->cache_hit->pcm + tts_stream->cache_pos, rlen);
+        tts_stream->cache_pos += rlen;
+    } else {
+        rlen = rb_read(tts_stream->synth_rb, buffer, len, ticks_to_wait);
+        if (rlen == RB_DONE) {
+            rlen = 0;
+        }
+    }
+    if (rlen > 0) {
+        audio_element_update_byte_pos(self, rlen);
+    } else if (rlen == 0) {
+        ESP_LOGW(TAG, "No more data,ret:%d", rlen);
+    }
+    return rlen;
+}
+
+static void _tts_stream_close_streaming(tts_stream_t *tts_stream)
+{
+    if (tts_stream->synth_running) {
+        tts_stream->synth_abort = true;
+        rb_abort(tts_stream->synth_rb);
+        xSemaphoreTake(tts_stream->synth_exit, portMAX_DELAY);
+        tts_stream->synth_running = false;
+    }
+    audio_free(tts_stream->prompt);
+    tts_stream->prompt = NULL;
+    tts_stream->cache_hit = NULL;
+}
+
 static esp_err_t _tts_stream_open(audio_element_handle_t self)
 {
     tts_stream_t *tts_stream = (tts_stream_t *)audio_element_getdata(self);
@@ -62,6 +325,9 @@ static esp_err_t _tts_stream_open(audio_element_handle_t self)
         ESP_LOGE(TAG, "The TTS string is not set");
         return ESP_FAIL;
     }
+    if (tts_stream->streaming) {
+        return _tts_stream_open_streaming(self, uri);
+    }
 
     if (esp_tts_parse_chinese(tts_stream->tts_handle, uri)) {
         tts_stream->is_open = true;
@@ -76,6 +342,9 @@ static esp_err_t _tts_stream_open(audio_element_handle_t self)
 static int _tts_stream_read(audio_element_handle_t self, char *buffer, int len, TickType_t ticks_to_wait, void *context)
 {
     tts_stream_t *tts_stream = (tts_stream_t *)audio_element_getdata(self);
+    if (tts_stream->streaming) {
+        return _tts_stream_read_streaming(self, buffer, len, ticks_to_wait);
+    }
     int rlen = 0;
     uint8_t *pcm_data = (uint8_t *)esp_tts_stream_play(tts_stream->tts_handle, &rlen, tts_stream->speed);
     if (rlen <= 0) {
@@ -102,6 +371,11 @@ static int _tts_stream_process(audio_element_handle_t self, char *in_buffer, int
 static esp_err_t _tts_stream_close(audio_element_handle_t self)
 {
     tts_stream_t *tts_stream = (tts_stream_t *)audio_element_getdata(self);
+    if (tts_stream->streaming) {
+        _tts_stream_close_streaming(tts_stream);
+        tts_stream->is_open = false;
+        return ESP_OK;
+    }
     if (tts_stream->is_open) {
         esp_tts_stream_reset(tts_stream->tts_handle);
         tts_stream->is_open = false;
@@ -112,6 +386,10 @@ static esp_err_t _tts_stream_close(audio_element_handle_t self)
 static esp_err_t _tts_stream_destroy(audio_element_handle_t self)
 {
     tts_stream_t *tts_stream = (tts_stream_t *)audio_element_getdata(self);
+    tts_stream_clear_cache(self);
+    TTS_MEM_CHECK(tts_stream->synth_rb, rb_destroy(tts_stream->synth_rb));
+    TTS_MEM_CHECK(tts_stream->synth_exit, vSemaphoreDelete(tts_stream->synth_exit));
+    TTS_MEM_CHECK(tts_stream->cache_lock, vSemaphoreDelete(tts_stream->cache_lock));
     spi_flash_munmap(tts_stream->mmap);
     esp_tts_voice_set_free(tts_stream->voice);
     esp_tts_destroy(tts_stream->tts_handle);
@@ -147,6 +425,29 @@ esp_err_t tts_stream_get_speed(audio_element_handle_t el, tts_voice_speed_t *spe
     return ESP_OK;
 }
 
+esp_err_t tts_stream_clear_cache(audio_element_handle_t el)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_FAIL);
+    tts_stream_t *tts_stream = (tts_stream_t *)audio_element_getdata(el);
+    if (tts_stream->cache_lock == NULL) {
+        return ESP_OK;
+    }
+    xSemaphoreTake(tts_stream->cache_lock, portMAX_DELAY);
+    if (tts_stream->synth_running || tts_stream->cache_hit) {
+        xSemaphoreGive(tts_stream->cache_lock);
+        ESP_LOGE(TAG, "Can't clear the cache while playing");
+        return ESP_FAIL;
+    }
+    while (tts_stream->cache) {
+        tts_cache_entry_t *item = tts_stream->cache;
+        tts_stream->cache = item->next;
+        _tts_cache_free(item);
+    }
+    tts_stream->cache_used = 0;
+    xSemaphoreGive(tts_stream->cache_lock);
+    return ESP_OK;
+}
+
 audio_element_handle_t tts_stream_init(tts_stream_cfg_t *config)
 {
     audio_element_handle_t el;
@@ -197,6 +498,20 @@ audio_element_handle_t tts_stream_init(tts_stream_cfg_t *config)
         goto _tts_stream_init_exit;
     });
 
+    if (config->streaming) {
+        tts_stream->streaming = true;
+        tts_stream->synth_task_stack = config->synth_task_stack > 0 ? config->synth_task_stack : TTS_STREAM_SYNTH_TASK_STACK;
+        tts_stream->synth_task_prio = config->synth_task_prio > 0 ? config->synth_task_prio : TTS_STREAM_SYNTH_TASK_PRIO;
+        tts_stream->synth_task_core = config->task_core;
+        tts_stream->cache_size = config->cache_size;
+        tts_stream->synth_rb = rb_create(config->synth_rb_size > 0 ? config->synth_rb_size : TTS_STREAM_SYNTH_RB_SIZE, 1);
+        AUDIO_MEM_CHECK(TAG, tts_stream->synth_rb, goto _tts_stream_init_exit);
+        tts_stream->synth_exit = xSemaphoreCreateBinary();
+        AUDIO_MEM_CHECK(TAG, tts_stream->synth_exit, goto _tts_stream_init_exit);
+        tts_stream->cache_lock = xSemaphoreCreateMutex();
+        AUDIO_MEM_CHECK(TAG, tts_stream->cache_lock, goto _tts_stream_init_exit);
+    }
+
     tts_stream->speed = TTS_VOICE_SPEED_3;
     cfg.read = _tts_stream_read;
     el = audio_element_init(&cfg);
@@ -206,6 +521,9 @@ audio_element_handle_t tts_stream_init(tts_stream_cfg_t *config)
     return el;
 
 _tts_stream_init_exit:
+    TTS_MEM_CHECK(tts_stream->synth_rb, rb_destroy(tts_stream->synth_rb));
+    TTS_MEM_CHECK(tts_stream->synth_exit, vSemaphoreDelete(tts_stream->synth_exit));
+    TTS_MEM_CHECK(tts_stream->cache_lock, vSemaphoreDelete(tts_stream->cache_lock));
     TTS_MEM_CHECK(tts_stream->mmap, spi_flash_munmap(tts_stream->mmap));
     TTS_MEM_CHECK(tts_stream->voice, esp_tts_voice_set_free(tts_stream->voice));
     TTS_MEM_CHECK(tts_stream->tts_handle, esp_tts_destroy(tts_stream->tts_handle));
@@ -32,6 +32,8 @@
 #include "audio_common.h"
 #include "audio_mem.h"
 #include "audio_thread.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
 #include "sdkconfig.h"
 
 #include "a2dp_stream.h"
@@ -57,18 +59,20 @@ typedef struct {
 #endif
 
     audio_thread_t a2dp_thread;
-    QueueHandle_t a2dp_queue;
+    ringbuf_handle_t jitter_rb;
+    SemaphoreHandle_t jitter_lock;
+    SemaphoreHandle_t jitter_exit_sem;
+    volatile bool jitter_run;
+    volatile bool jitter_playing;
+    volatile bool source_done;
+    volatile bool source_underrun;
+    int jitter_target_ms;
+    int jitter_max_ms;
+    a2dp_stream_jitter_stats_t jitter_stats;
+    int64_t cb_time_sum;
+    uint32_t cb_count;
 } aadp_info_t;
 
-typedef struct {
-    enum {
-        A2DP_TYPE_SINK ,
-        A2DP_TYPE_DESTORY,
-    } type;
-    void *data;
-    size_t size;
-} a2dp_data_t;
-
 static aadp_info_t s_aadp_handler = { 0 };
 
 int16_t default_volume = 50;
@@ -79,31 +83,119 @@ static void bt_avrc_tg_cb(esp_avrc_tg_cb_event_t event, esp_avrc_tg_cb_param_t *
 static const char *audio_state_str[] = { "Suspended", "Stopped", "Started" };
 static void bt_avrc_ct_cb(esp_avrc_ct_cb_event_t event, esp_avrc_ct_cb_param_t *param);
 
-static void audio_a2dp_stream_thread(void *pvParameters)
+static int a2dp_jitter_ms_to_bytes(audio_element_handle_t el, int ms)
 {
-    (void) pvParameters;
+    audio_element_info_t info = { 0 };
+    audio_element_getinfo(el, &info);
+    return ms * (info.sample_rates / 100) * info.channels * (info.bits / 8) / 10;
+}
 
-    a2dp_data_t recv_msg;
-    bool _aadp_task_run = true;
-    while(_aadp_task_run) {
-        if ( pdTRUE ==  xQueueReceive (s_aadp_handler.a2dp_queue, &recv_msg, portMAX_DELAY) ) {
-            switch (recv_msg.type) {
-            case A2DP_TYPE_SINK:
-                    audio_element_output(s_aadp_handler.sink_stream, (char *)recv_msg.data, recv_msg.size);
-                    audio_free(recv_msg.data);
-                    recv_msg.data = NULL;
-                break;
-            case A2DP_TYPE_DESTORY:
-                _aadp_task_run = false;
-                break;
-            default:
-                break;
+static void a2dp_jitter_cb_time(int64_t start)
+{
+    int elapsed = (int)(esp_timer_get_time() - start);
+    s_aadp_handler.cb_time_sum += elapsed;
+    s_aadp_handler.cb_count++;
+    if (elapsed > s_aadp_handler.jitter_stats.cb_time_max_us) {
+        s_aadp_handler.jitter_stats.cb_time_max_us = elapsed;
+    }
+}
+
+/*
+ * Sink: the BT stack callback only writes into `jitter_rb`, this thread prefills it to the target level
+ * and then drains it into the element output, so a stall downstream never blocks the BT task.
+ */
+static void audio_a2dp_sink_thread(void *pvParameters)
+{
+    audio_element_handle_t el = (audio_element_handle_t)pvParameters;
+    ringbuf_handle_t rb = s_aadp_handler.jitter_rb;
+    char *buf = audio_calloc(1, A2DP_STREAM_JITTER_CHUNK);
+    AUDIO_MEM_CHECK(TAG, buf, s_aadp_handler.jitter_run = false);
+    while (s_aadp_handler.jitter_run) {
+        if (audio_element_get_state(el) != AEL_STATE_RUNNING) {
+            /* Nothing is written while stopped, and the element may be on its way to deinit */
+            s_aadp_handler.jitter_playing = false;
+            vTaskDelay(A2DP_STREAM_JITTER_POLL_MS / portTICK_PERIOD_MS);
+            continue;
+        }
+        int filled = rb_bytes_filled(rb);
+        if (!s_aadp_handler.jitter_playing) {
+            if (filled < a2dp_jitter_ms_to_bytes(el, s_aadp_handler.jitter_target_ms)) {
+                vTaskDelay(A2DP_STREAM_JITTER_POLL_MS / portTICK_PERIOD_MS);
+                continue;
+            }
+            s_aadp_handler.jitter_playing = true;
+        }
+        int max_fill = a2dp_jitter_ms_to_bytes(el, s_aadp_handler.jitter_max_ms);
+        if (filled > max_fill) {
+            /* Drop the oldest audio to bring the latency back to the target */
+            int drop = filled - a2dp_jitter_ms_to_bytes(el, s_aadp_handler.jitter_target_ms);
+            drop &= ~3;
+            if (rb_read(rb, NULL, drop, 0) > 0) {
+                s_aadp_handler.jitter_stats.dropped_bytes += drop;
+            }
+        }
+        int len = rb_read(rb, buf, A2DP_STREAM_JITTER_CHUNK, A2DP_STREAM_JITTER_POLL_MS / portTICK_PERIOD_MS);
+        if (len > 0) {
+            /* The output timeout is bounded, so a stalled consumer cannot keep a2dp_jitter_stop() waiting */
+            int off = 0;
+            while (off < len && s_aadp_handler.jitter_run) {
+                int wlen = audio_element_output(el, buf + off, len - off);
+                if (wlen > 0) {
+                    off += wlen;
+                } else if (wlen != AEL_IO_TIMEOUT) {
+                    break;
+                }
+            }
+        } else if (len == RB_TIMEOUT) {
+            if (audio_element_get_state(el) == AEL_STATE_RUNNING) {
+                s_aadp_handler.jitter_stats.underruns++;
+                audio_element_report_status(el, AEL_STATUS_INPUT_BUFFERING);
             }
+            s_aadp_handler.jitter_playing = false;
+        } else {
+            break;
         }
     }
+    audio_free(buf);
     ESP_LOGI(TAG, "Delete the audio_a2dp_stream_thread");
-    vQueueDelete(s_aadp_handler.a2dp_queue);
-    s_aadp_handler.a2dp_queue = NULL;
+    xSemaphoreGive(s_aadp_handler.jitter_exit_sem);
+    vTaskDelete(NULL);
+}
+
+/*
+ * Source: this thread pulls from the pipeline into `jitter_rb`, the BT stack callback only copies out of it
+ * and pads with silence on underrun.
+ */
+static void audio_a2dp_source_thread(void *pvParameters)
+{
+    audio_element_handle_t el = (audio_element_handle_t)pvParameters;
+    ringbuf_handle_t rb = s_aadp_handler.jitter_rb;
+    char *buf = audio_calloc(1, A2DP_STREAM_JITTER_CHUNK);
+    AUDIO_MEM_CHECK(TAG, buf, s_aadp_handler.jitter_run = false);
+    while (s_aadp_handler.jitter_run) {
+        if (audio_element_get_state(el) != AEL_STATE_RUNNING) {
+            vTaskDelay(A2DP_STREAM_JITTER_POLL_MS / portTICK_PERIOD_MS);
+            continue;
+        }
+        if (s_aadp_handler.source_underrun) {
+            /* Flagged by the BT callback, which must not post events while holding `jitter_lock` */
+            s_aadp_handler.source_underrun = false;
+            audio_element_report_status(el, AEL_STATUS_INPUT_BUFFERING);
+        }
+        int len = audio_element_input(el, buf, A2DP_STREAM_JITTER_CHUNK);
+        if (len > 0) {
+            s_aadp_handler.source_done = false;
+            if (rb_write(rb, buf, len, portMAX_DELAY) < 0) {
+                break;
+            }
+        } else if (len == AEL_IO_DONE || len == AEL_IO_OK) {
+            s_aadp_handler.source_done = true;
+            vTaskDelay(A2DP_STREAM_JITTER_POLL_MS / portTICK_PERIOD_MS);
+        }
+    }
+    audio_free(buf);
+    ESP_LOGI(TAG, "Delete the audio_a2dp_source_thread");
+    xSemaphoreGive(s_aadp_handler.jitter_exit_sem);
     vTaskDelete(NULL);
 }
 
@@ -182,24 +274,28 @@ static void bt_a2d_sink_data_cb(const uint8_t *data, uint32_t len)
     if (s_aadp_handler.user_callback.user_a2d_sink_data_cb) {
         s_aadp_handler.user_callback.user_a2d_sink_data_cb(data, len);
     }
-    if (s_aadp_handler.sink_stream) {
+    if (s_aadp_handler.jitter_lock == NULL) {
+        return;
+    }
+    /* The lock keeps the jitter buffer alive until this callback is done with it, see a2dp_jitter_stop() */
+    xSemaphoreTake(s_aadp_handler.jitter_lock, portMAX_DELAY);
+    ringbuf_handle_t rb = s_aadp_handler.jitter_rb;
+    if (s_aadp_handler.sink_stream && rb) {
         if (audio_element_get_state(s_aadp_handler.sink_stream) == AEL_STATE_RUNNING) {
-            a2dp_data_t send_msg = {0};
-            send_msg.data = (uint8_t *) audio_calloc(1, len);
-            if (!send_msg.data) {
-                ESP_LOGE(TAG, "No ineffecitive memory to allocate(%d)", __LINE__);
-                return;
+            int64_t start = esp_timer_get_time();
+            int avail = rb_bytes_available(rb);
+            if (avail < (int)len) {
+                /* Overrun, make room by dropping the oldest audio rather than blocking the BT task */
+                int drop = (len - avail + 3) & ~3;
+                rb_read(rb, NULL, drop, 0);
+                s_aadp_handler.jitter_stats.overruns++;
+                s_aadp_handler.jitter_stats.dropped_bytes += drop;
             }
-            memcpy(send_msg.data, data, len);
-            send_msg.size = len;
-            send_msg.type = A2DP_TYPE_SINK;
-            if ((!s_aadp_handler.a2dp_queue) || xQueueSend( s_aadp_handler.a2dp_queue, &send_msg, 0)  != pdPASS ) {
-                ESP_LOGW(TAG, "discard a2dp(%p) sink pkt, A2DP_STREAM_QUEUE_SIZE value needs to be expanded", s_aadp_handler.a2dp_queue);
-                audio_free(send_msg.data);
-                send_msg.data = NULL;
-            } 
+            rb_write(rb, (char *)data, len, 0);
+            a2dp_jitter_cb_time(start);
         }
     }
+    xSemaphoreGive(s_aadp_handler.jitter_lock);
 }
 
 static void bt_a2d_source_cb(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *param)
@@ -235,49 +331,118 @@ static void bt_a2d_source_cb(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *param
     }
 }
 
-static int32_t bt_a2d_source_data_cb(uint8_t *data, int32_t len)
+static int32_t bt_a2d_source_fill(uint8_t *data, int32_t len)
 {
-    if (s_aadp_handler.source_stream) {
+    ringbuf_handle_t rb = s_aadp_handler.jitter_rb;
+    if (s_aadp_handler.source_stream && rb) {
         if (audio_element_get_state(s_aadp_handler.source_stream) == AEL_STATE_RUNNING) {
             if (len < 0 || data == NULL) {
                 return 0;
             }
-            len = audio_element_input(s_aadp_handler.source_stream, (char *)data, len);
-            if (len == AEL_IO_DONE) {
+            int64_t start = esp_timer_get_time();
+            int filled = rb_bytes_filled(rb);
+            if (filled == 0 && s_aadp_handler.source_done) {
+                s_aadp_handler.source_done = false;
+                s_aadp_handler.jitter_playing = false;
                 esp_a2d_media_ctrl(ESP_A2D_MEDIA_CTRL_STOP);
                 if (s_aadp_handler.bt_avrc_periph) {
                     esp_periph_send_event(s_aadp_handler.bt_avrc_periph, PERIPH_BLUETOOTH_AUDIO_SUSPENDED, NULL, 0);
                 }
+                return AEL_IO_DONE;
             }
+            if (!s_aadp_handler.jitter_playing) {
+                if (filled < a2dp_jitter_ms_to_bytes(s_aadp_handler.source_stream, s_aadp_handler.jitter_target_ms)
+                    && !s_aadp_handler.source_done) {
+                    memset(data, 0, len);
+                    s_aadp_handler.jitter_stats.inserted_bytes += len;
+                    a2dp_jitter_cb_time(start);
+                    return len;
+                }
+                s_aadp_handler.jitter_playing = true;
+            }
+            int rlen = rb_read(rb, (char *)data, len, 0);
+            if (rlen < 0) {
+                rlen = 0;
+            }
+            if (rlen < len) {
+                /* Underrun, pad with silence and prebuffer again */
+                memset(data + rlen, 0, len - rlen);
+                s_aadp_handler.jitter_stats.inserted_bytes += len - rlen;
+                s_aadp_handler.jitter_stats.underruns++;
+                s_aadp_handler.jitter_playing = false;
+                s_aadp_handler.source_underrun = true;
+            }
+            a2dp_jitter_cb_time(start);
             return len;
         }
     }
     return 0;
 }
 
-static esp_err_t a2dp_sink_destory(audio_element_handle_t self)
+static int32_t bt_a2d_source_data_cb(uint8_t *data, int32_t len)
 {
-    ESP_LOGI(TAG, "a2dp_sink_destory");
-
-    a2dp_data_t destory_msg = {
-        .type = A2DP_TYPE_DESTORY,
-    };
-    if ( xQueueSend( s_aadp_handler.a2dp_queue, &destory_msg, 0 )  != pdPASS ) {
-        ESP_LOGE(TAG, "Destory audio_a2dp_stream_thread failed");
-        return ESP_FAIL;
+    if (s_aadp_handler.jitter_lock == NULL) {
+        return 0;
     }
+    xSemaphoreTake(s_aadp_handler.jitter_lock, portMAX_DELAY);
+    int32_t ret = bt_a2d_source_fill(data, len);
+    xSemaphoreGive(s_aadp_handler.jitter_lock);
+    return ret;
+}
+
+/*
+ * Detach the jitter buffer under the lock so the BT callbacks stop touching it, then wait for the pump thread
+ * to exit before destroying it. A following a2dp_stream_init() can then never see its buffer freed by the old thread.
+ */
+static void a2dp_jitter_stop(void)
+{
+    xSemaphoreTake(s_aadp_handler.jitter_lock, portMAX_DELAY);
+    ringbuf_handle_t rb = s_aadp_handler.jitter_rb;
+    s_aadp_handler.jitter_rb = NULL;
     s_aadp_handler.sink_stream = NULL;
+    s_aadp_handler.source_stream = NULL;
+    s_aadp_handler.jitter_run = false;
+    xSemaphoreGive(s_aadp_handler.jitter_lock);
+    if (rb == NULL) {
+        return;
+    }
+    rb_abort(rb);
+    xSemaphoreTake(s_aadp_handler.jitter_exit_sem, portMAX_DELAY);
+    vSemaphoreDelete(s_aadp_handler.jitter_exit_sem);
+    s_aadp_handler.jitter_exit_sem = NULL;
+    rb_destroy(rb);
+}
+
+static esp_err_t a2dp_sink_destory(audio_element_handle_t self)
+{
+    ESP_LOGI(TAG, "a2dp_sink_destory");
+    a2dp_jitter_stop();
     memset(&s_aadp_handler.user_callback, 0, sizeof(a2dp_stream_user_callback_t));
     return ESP_OK;
 }
 
 static esp_err_t a2dp_source_destory(audio_element_handle_t self)
 {
-    s_aadp_handler.source_stream = NULL;
+    a2dp_jitter_stop();
     memset(&s_aadp_handler.user_callback, 0, sizeof(a2dp_stream_user_callback_t));
     return ESP_OK;
 }
 
+esp_err_t a2dp_stream_get_jitter_stats(audio_element_handle_t el, a2dp_stream_jitter_stats_t *stats)
+{
+    AUDIO_NULL_CHECK(TAG, el, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, stats, return ESP_FAIL);
+    if (el != s_aadp_handler.sink_stream && el != s_aadp_handler.source_stream) {
+        return ESP_FAIL;
+    }
+    xSemaphoreTake(s_aadp_handler.jitter_lock, portMAX_DELAY);
+    memcpy(stats, &s_aadp_handler.jitter_stats, sizeof(a2dp_stream_jitter_stats_t));
+    stats->fill_bytes = s_aadp_handler.jitter_rb ? rb_bytes_filled(s_aadp_handler.jitter_rb) : 0;
+    xSemaphoreGive(s_aadp_handler.jitter_lock);
+    stats->cb_time_avg_us = s_aadp_handler.cb_count ? (int)(s_aadp_handler.cb_time_sum / s_aadp_handler.cb_count) : 0;
+    return ESP_OK;
+}
+
 audio_element_handle_t a2dp_stream_init(a2dp_stream_config_t *config)
 {
     audio_element_handle_t el = NULL;
@@ -288,6 +453,12 @@ audio_element_handle_t a2dp_stream_init(a2dp_stream_config_t *config)
         return NULL;
     }
 
+    if (s_aadp_handler.jitter_lock == NULL) {
+        /* Kept for the lifetime of the static handler, the BT callbacks may run at any time */
+        s_aadp_handler.jitter_lock = xSemaphoreCreateMutex();
+        AUDIO_MEM_CHECK(TAG, s_aadp_handler.jitter_lock, return NULL);
+    }
+
     cfg.task_stack = -1; // No need task
     cfg.tag = "aadp";    
 
@@ -329,20 +500,51 @@ audio_element_handle_t a2dp_stream_init(a2dp_stream_config_t *config)
     
     memcpy(&s_aadp_handler.user_callback, &config->user_callback, sizeof(a2dp_stream_user_callback_t));
 
-    if ( config->type == AUDIO_STREAM_READER ) {
-        s_aadp_handler.a2dp_queue = xQueueCreate(A2DP_STREAM_QUEUE_SIZE, sizeof(a2dp_data_t));
-        if (s_aadp_handler.a2dp_queue == 0) {
-            ESP_LOGE(TAG, "Create a2dp queue failed(%d)", __LINE__);
-            return NULL;
-        }
-        esp_err_t err = audio_thread_create(&s_aadp_handler.a2dp_thread, "audio_a2dp_stream_thread", audio_a2dp_stream_thread, NULL,
-                                A2DP_STREAM_TASK_STACK, A2DP_STREAM_TASK_PRIO, A2DP_STREAM_TASK_IN_EXT, A2DP_STREAM_TASK_CORE);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "Create audio_a2dp_stream_thread failed(%d)", __LINE__);
-            return NULL;
-        }
+    int jitter_size = config->jitter_buffer_size > 0 ? config->jitter_buffer_size : A2DP_STREAM_JITTER_BUFFER_SIZE;
+    s_aadp_handler.jitter_target_ms = config->jitter_target_ms > 0 ? config->jitter_target_ms : A2DP_STREAM_JITTER_TARGET_MS;
+    s_aadp_handler.jitter_max_ms = config->jitter_max_ms > s_aadp_handler.jitter_target_ms ? config->jitter_max_ms : s_aadp_handler.jitter_target_ms * 2;
+    memset(&s_aadp_handler.jitter_stats, 0, sizeof(a2dp_stream_jitter_stats_t));
+    s_aadp_handler.cb_time_sum = 0;
+    s_aadp_handler.cb_count = 0;
+    s_aadp_handler.jitter_playing = false;
+    s_aadp_handler.source_done = false;
+    s_aadp_handler.source_underrun = false;
+    if (config->type == AUDIO_STREAM_WRITER) {
+        audio_element_set_input_timeout(el, A2DP_STREAM_JITTER_POLL_MS / portTICK_PERIOD_MS);
+    } else {
+        audio_element_set_output_timeout(el, A2DP_STREAM_OUTPUT_TIMEOUT_MS / portTICK_PERIOD_MS);
+    }
+    ringbuf_handle_t rb = rb_create(jitter_size, 1);
+    AUDIO_MEM_CHECK(TAG, rb, goto _a2dp_init_failed);
+    s_aadp_handler.jitter_exit_sem = xSemaphoreCreateBinary();
+    AUDIO_MEM_CHECK(TAG, s_aadp_handler.jitter_exit_sem, {
+        rb_destroy(rb);
+        goto _a2dp_init_failed;
+    });
+    xSemaphoreTake(s_aadp_handler.jitter_lock, portMAX_DELAY);
+    s_aadp_handler.jitter_rb = rb;
+    s_aadp_handler.jitter_run = true;
+    xSemaphoreGive(s_aadp_handler.jitter_lock);
+    esp_err_t err = audio_thread_create(&s_aadp_handler.a2dp_thread, "audio_a2dp_stream_thread",
+                            config->type == AUDIO_STREAM_READER ? audio_a2dp_sink_thread : audio_a2dp_source_thread, el,
+                            A2DP_STREAM_TASK_STACK, A2DP_STREAM_TASK_PRIO, A2DP_STREAM_TASK_IN_EXT, A2DP_STREAM_TASK_CORE);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Create audio_a2dp_stream_thread failed(%d)", __LINE__);
+        xSemaphoreTake(s_aadp_handler.jitter_lock, portMAX_DELAY);
+        s_aadp_handler.jitter_rb = NULL;
+        s_aadp_handler.jitter_run = false;
+        xSemaphoreGive(s_aadp_handler.jitter_lock);
+        vSemaphoreDelete(s_aadp_handler.jitter_exit_sem);
+        s_aadp_handler.jitter_exit_sem = NULL;
+        rb_destroy(rb);
+        goto _a2dp_init_failed;
     }
     return el;
+
+_a2dp_init_failed:
+    /* The jitter buffer is not attached at this point, so the element destroy callback only clears the handler */
+    audio_element_deinit(el);
+    return NULL;
 }
 
 esp_err_t a2dp_destroy()
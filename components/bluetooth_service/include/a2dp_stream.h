@@ -56,16 +56,37 @@ typedef struct {
 #if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 0, 0))
     audio_hal_handle_t          audio_hal;
 #endif
+    int                         jitter_buffer_size; /*!< Size of the jitter buffer between the BT stack and the pipeline, default if 0 */
+    int                         jitter_target_ms;   /*!< Audio prebuffered before playback starts or resumes after an underrun, default if 0 */
+    int                         jitter_max_ms;      /*!< Sink only: oldest audio is dropped above this fill level, twice the target if 0 */
 } a2dp_stream_config_t;
 
 /**
- * a2dp task is only created in a2dp sink mode
+ * @brief   A2DP jitter buffer statistics
+ */
+typedef struct {
+    uint32_t    underruns;          /*!< Times the jitter buffer ran empty while playing */
+    uint32_t    overruns;           /*!< Times the sink callback found the jitter buffer full */
+    uint32_t    dropped_bytes;      /*!< Audio dropped on overrun or to reduce latency */
+    uint32_t    inserted_bytes;     /*!< Silence inserted on underrun or prebuffering (source) */
+    int         fill_bytes;         /*!< Current jitter buffer fill level */
+    int         cb_time_max_us;     /*!< Maximum time spent in the BT stack data callback */
+    int         cb_time_avg_us;     /*!< Average time spent in the BT stack data callback */
+} a2dp_stream_jitter_stats_t;
+
+/**
+ * a2dp task moves data between the jitter buffer and the pipeline in both sink and source mode
  */
 #define A2DP_STREAM_TASK_STACK          ( 2 * 1024 )
 #define A2DP_STREAM_TASK_CORE           ( 0 )
 #define A2DP_STREAM_TASK_PRIO           ( 22 )
 #define A2DP_STREAM_TASK_IN_EXT         ( true )
-#define A2DP_STREAM_QUEUE_SIZE          ( 20 )
+
+#define A2DP_STREAM_JITTER_BUFFER_SIZE  ( 32 * 1024 )
+#define A2DP_STREAM_JITTER_TARGET_MS    ( 60 )
+#define A2DP_STREAM_JITTER_CHUNK        ( 1024 )
+#define A2DP_STREAM_JITTER_POLL_MS      ( 10 )
+#define A2DP_STREAM_OUTPUT_TIMEOUT_MS   ( 100 )
 
 /**
  * @brief      Create a handle to an Audio Element to stream data from A2DP to another Element
@@ -78,6 +99,19 @@ typedef struct {
  */
 audio_element_handle_t a2dp_stream_init(a2dp_stream_config_t *config);
 
+/**
+ * @brief      Get the jitter buffer statistics of the A2DP stream.
+ *             The stream also reports `AEL_STATUS_INPUT_BUFFERING` each time the jitter buffer underruns.
+ *
+ * @param[in]  el      The A2DP stream element handle
+ * @param[out] stats   The statistics
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t a2dp_stream_get_jitter_stats(audio_element_handle_t el, a2dp_stream_jitter_stats_t *stats);
+
 /**
  * @brief      Destroy and cleanup A2DP profile.
  *
@@ -38,6 +38,9 @@
 #include "periph_touch.h"
 #include "board.h"
 #include "bluetooth_service.h"
+#include "esp_bt.h"
+#include "esp_bt_main.h"
+#include "a2dp_stream.h"
 
 static const char *TAG = "TEST_BLUETOOTH_SERVICE";
 
@@ -337,3 +340,42 @@ TEST_CASE("Initialize a2dp sink, test avrcp passthrough cmd", "[bluetooth_servic
     TEST_ASSERT_EQUAL(ESP_OK, bluetooth_service_destroy());
     TEST_ASSERT_EQUAL(ESP_OK, nvs_flash_deinit());
 }
+
+TEST_CASE("Create a2dp stream, destroy and re-create it right away", "[bluetooth_service]")
+{
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        err = nvs_flash_init();
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, esp_bt_controller_mem_release(ESP_BT_MODE_BLE));
+    esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
+    TEST_ASSERT_EQUAL(ESP_OK, esp_bt_controller_init(&bt_cfg));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_bt_controller_enable(ESP_BT_MODE_CLASSIC_BT));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_bluedroid_init());
+    TEST_ASSERT_EQUAL(ESP_OK, esp_bluedroid_enable());
+
+    /* The pump thread of the old stream must be gone before the new jitter buffer is created */
+    for (int i = 0; i < 10; i++) {
+        a2dp_stream_config_t a2dp_config = {
+            .type = (i & 1) ? AUDIO_STREAM_WRITER : AUDIO_STREAM_READER,
+        };
+        audio_element_handle_t bt_stream = a2dp_stream_init(&a2dp_config);
+        TEST_ASSERT_NOT_NULL(bt_stream);
+        ESP_LOGI(TAG, "Create a2dp stream repeatedly");
+        TEST_ASSERT_NULL(a2dp_stream_init(&a2dp_config));
+
+        TEST_ASSERT_EQUAL(ESP_OK, audio_element_run(bt_stream));
+        vTaskDelay(i * 5 / portTICK_PERIOD_MS);
+        a2dp_stream_jitter_stats_t stats = { 0 };
+        TEST_ASSERT_EQUAL(ESP_OK, a2dp_stream_get_jitter_stats(bt_stream, &stats));
+        TEST_ASSERT_EQUAL(ESP_OK, audio_element_deinit(bt_stream));
+        TEST_ASSERT_EQUAL(ESP_OK, a2dp_destroy());
+    }
+
+    TEST_ASSERT_EQUAL(ESP_OK, esp_bluedroid_disable());
+    TEST_ASSERT_EQUAL(ESP_OK, esp_bluedroid_deinit());
+    TEST_ASSERT_EQUAL(ESP_OK, esp_bt_controller_disable());
+    TEST_ASSERT_EQUAL(ESP_OK, esp_bt_controller_deinit());
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_flash_deinit());
+}
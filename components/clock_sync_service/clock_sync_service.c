@@ -0,0 +1,342 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include "audio_mem.h"
+#include "audio_error.h"
+#include "audio_mutex.h"
+#include "audio_thread.h"
+#include "clock_sync_service.h"
+
+static const char *TAG = "CLOCK_SYNC";
+
+#define CLOCK_SYNC_MAGIC            (0x434C4B53) /* "CLKS" */
+#define CLOCK_SYNC_RECV_TIMEOUT_MS  (100)
+#define CLOCK_SYNC_FILTER_SIZE      (8)
+#define CLOCK_SYNC_STEP_US          (10000)
+#define CLOCK_SYNC_SKEW_SPAN_US     (5 * 1000000LL)
+#define CLOCK_SYNC_SKEW_RESET_US    (60 * 1000000LL)
+
+/* Exchange packet, fields in host byte order as all nodes are ESP chips */
+typedef struct {
+    uint32_t    magic;
+    uint32_t    seq;
+    int64_t     t1;     /* Slave send time (slave clock) */
+    int64_t     t2;     /* Master receive time (master clock) */
+    int64_t     t3;     /* Master send time (master clock) */
+} __attribute__((packed)) clock_sync_pkt_t;
+
+typedef struct {
+    int64_t     local_us;
+    int64_t     offset_us;
+    int         rtt_us;
+} clock_sync_sample_t;
+
+struct clock_sync_service {
+    clock_sync_cfg_t        cfg;
+    int                     sock;
+    struct sockaddr_in      master;
+    void                    *lock;
+    volatile bool           running;
+    SemaphoreHandle_t       exit_sem;
+    /* Timeline estimate: shared = local + base_offset + skew * (local - base_local) */
+    bool                    synced;
+    int64_t                 base_local;
+    double                  base_offset;
+    double                  skew;
+    int64_t                 skew_ref_local;
+    int64_t                 skew_ref_offset;
+    clock_sync_sample_t     samples[CLOCK_SYNC_FILTER_SIZE];
+    int                     sample_cnt;
+    int                     best_rtt;
+    uint32_t                exchanges;
+};
+
+static inline int64_t _local_now(clock_sync_handle_t cs)
+{
+    return cs->cfg.local_clock ? cs->cfg.local_clock(cs->cfg.clock_ctx) : esp_timer_get_time();
+}
+
+static inline double _offset_at(clock_sync_handle_t cs, int64_t local_us)
+{
+    return cs->base_offset + cs->skew * (double)(local_us - cs->base_local);
+}
+
+static void _clock_sync_update(clock_sync_handle_t cs, int64_t local_us, int64_t offset_us, int rtt_us)
+{
+    cs->samples[cs->sample_cnt % CLOCK_SYNC_FILTER_SIZE] = (clock_sync_sample_t) {
+        .local_us = local_us,
+        .offset_us = offset_us,
+        .rtt_us = rtt_us,
+    };
+    cs->sample_cnt++;
+    /* NTP clock filter: the exchange with the smallest round trip has the least queuing error */
+    int n = cs->sample_cnt < CLOCK_SYNC_FILTER_SIZE ? cs->sample_cnt : CLOCK_SYNC_FILTER_SIZE;
+    clock_sync_sample_t *best = &cs->samples[0];
+    for (int i = 1; i < n; i++) {
+        if (cs->samples[i].rtt_us < best->rtt_us) {
+            best = &cs->samples[i];
+        }
+    }
+
+    mutex_lock(cs->lock);
+    cs->best_rtt = best->rtt_us;
+    cs->exchanges++;
+    if (!cs->synced) {
+        cs->base_local = best->local_us;
+        cs->base_offset = best->offset_us;
+        cs->skew = 0;
+        cs->skew_ref_local = best->local_us;
+        cs->skew_ref_offset = best->offset_us;
+        cs->synced = true;
+        mutex_unlock(cs->lock);
+        ESP_LOGI(TAG, "Synced, offset %lld us, rtt %d us", (long long)offset_us, rtt_us);
+        return;
+    }
+    int64_t span = best->local_us - cs->skew_ref_local;
+    if (span >= CLOCK_SYNC_SKEW_SPAN_US) {
+        double measured = (double)(best->offset_us - cs->skew_ref_offset) / (double)span;
+        cs->skew += (measured - cs->skew) / 4;
+        if (span >= CLOCK_SYNC_SKEW_RESET_US) {
+            cs->skew_ref_local = best->local_us;
+            cs->skew_ref_offset = best->offset_us;
+        }
+    }
+    double predicted = _offset_at(cs, best->local_us);
+    double err = best->offset_us - predicted;
+    cs->base_local = best->local_us;
+    if (err > CLOCK_SYNC_STEP_US || err < -CLOCK_SYNC_STEP_US) {
+        ESP_LOGW(TAG, "Offset step %d us, re-anchor", (int)err);
+        cs->base_offset = best->offset_us;
+    } else {
+        cs->base_offset = predicted + err / 4;
+    }
+    mutex_unlock(cs->lock);
+}
+
+static void _clock_sync_master(clock_sync_handle_t cs)
+{
+    clock_sync_pkt_t pkt;
+    struct sockaddr_in from;
+    socklen_t from_len = sizeof(from);
+    int len = recvfrom(cs->sock, &pkt, sizeof(pkt), 0, (struct sockaddr *)&from, &from_len);
+    int64_t t2 = _local_now(cs);
+    if (len != sizeof(pkt) || pkt.magic != CLOCK_SYNC_MAGIC) {
+        return;
+    }
+    pkt.t2 = t2;
+    pkt.t3 = _local_now(cs);
+    if (sendto(cs->sock, &pkt, sizeof(pkt), 0, (struct sockaddr *)&from, from_len) < 0) {
+        ESP_LOGW(TAG, "Reply failed, errno: %d", errno);
+    }
+}
+
+static void _clock_sync_slave(clock_sync_handle_t cs, uint32_t seq)
+{
+    clock_sync_pkt_t pkt = {
+        .magic = CLOCK_SYNC_MAGIC,
+        .seq = seq,
+        .t1 = _local_now(cs),
+    };
+    if (sendto(cs->sock, &pkt, sizeof(pkt), 0, (struct sockaddr *)&cs->master, sizeof(cs->master)) < 0) {
+        ESP_LOGW(TAG, "Request failed, errno: %d", errno);
+        return;
+    }
+    int64_t deadline = esp_timer_get_time() + (int64_t)cs->cfg.interval_ms * 1000;
+    while (cs->running && esp_timer_get_time() < deadline) {
+        clock_sync_pkt_t resp;
+        int len = recv(cs->sock, &resp, sizeof(resp), 0);
+        int64_t t4 = _local_now(cs);
+        if (len != sizeof(resp) || resp.magic != CLOCK_SYNC_MAGIC || resp.seq != seq) {
+            continue;
+        }
+        int64_t offset = ((resp.t2 - resp.t1) + (resp.t3 - t4)) / 2;
+        int rtt = (int)((t4 - resp.t1) - (resp.t3 - resp.t2));
+        _clock_sync_update(cs, t4, offset, rtt);
+        return;
+    }
+}
+
+static void _clock_sync_task(void *pv)
+{
+    clock_sync_handle_t cs = (clock_sync_handle_t)pv;
+    uint32_t seq = 0;
+    while (cs->running) {
+        if (cs->cfg.role == CLOCK_SYNC_ROLE_MASTER) {
+            _clock_sync_master(cs);
+        } else {
+            int64_t start = esp_timer_get_time();
+            _clock_sync_slave(cs, ++seq);
+            int64_t left_ms = cs->cfg.interval_ms - (esp_timer_get_time() - start) / 1000;
+            if (left_ms > 0 && cs->running) {
+                vTaskDelay(pdMS_TO_TICKS(left_ms));
+            }
+        }
+    }
+    xSemaphoreGive(cs->exit_sem);
+    vTaskDelete(NULL);
+}
+
+static void _clock_sync_free(clock_sync_handle_t cs)
+{
+    if (cs->sock >= 0) {
+        close(cs->sock);
+    }
+    if (cs->exit_sem) {
+        vSemaphoreDelete(cs->exit_sem);
+    }
+    if (cs->lock) {
+        mutex_destroy(cs->lock);
+    }
+    audio_free(cs);
+}
+
+clock_sync_handle_t clock_sync_service_create(clock_sync_cfg_t *cfg)
+{
+    AUDIO_NULL_CHECK(TAG, cfg, return NULL);
+    if (cfg->role == CLOCK_SYNC_ROLE_SLAVE && cfg->master_host == NULL) {
+        ESP_LOGE(TAG, "Slave needs the master host");
+        return NULL;
+    }
+    clock_sync_handle_t cs = audio_calloc(1, sizeof(struct clock_sync_service));
+    AUDIO_MEM_CHECK(TAG, cs, return NULL);
+    memcpy(&cs->cfg, cfg, sizeof(clock_sync_cfg_t));
+    cs->sock = -1;
+    if (cs->cfg.interval_ms <= 0) {
+        cs->cfg.interval_ms = 500;
+    }
+    cs->lock = mutex_create();
+    cs->exit_sem = xSemaphoreCreateBinary();
+    AUDIO_MEM_CHECK(TAG, cs->lock, goto _clock_sync_init_failed);
+    AUDIO_MEM_CHECK(TAG, cs->exit_sem, goto _clock_sync_init_failed);
+
+    cs->sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (cs->sock < 0) {
+        ESP_LOGE(TAG, "Create socket failed, errno: %d", errno);
+        goto _clock_sync_init_failed;
+    }
+    struct timeval tv = {
+        .tv_sec = 0,
+        .tv_usec = CLOCK_SYNC_RECV_TIMEOUT_MS * 1000,
+    };
+    setsockopt(cs->sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    struct sockaddr_in local = {
+        .sin_family = AF_INET,
+        .sin_port = htons(cs->cfg.role == CLOCK_SYNC_ROLE_MASTER ? cs->cfg.port : 0),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(cs->sock, (struct sockaddr *)&local, sizeof(local)) != 0) {
+        ESP_LOGE(TAG, "Bind failed, errno: %d", errno);
+        goto _clock_sync_init_failed;
+    }
+    if (cs->cfg.role == CLOCK_SYNC_ROLE_SLAVE) {
+        cs->master.sin_family = AF_INET;
+        cs->master.sin_port = htons(cs->cfg.port);
+        if (inet_aton(cs->cfg.master_host, &cs->master.sin_addr) == 0) {
+            ESP_LOGE(TAG, "Invalid master address %s", cs->cfg.master_host);
+            goto _clock_sync_init_failed;
+        }
+    } else {
+        /* The master timeline is its own local clock */
+        cs->synced = true;
+    }
+    cs->running = true;
+    if (audio_thread_create(NULL, "clock_sync", _clock_sync_task, cs, cs->cfg.task_stack,
+                            cs->cfg.task_prio, cs->cfg.extern_stack, cs->cfg.task_core) != ESP_OK) {
+        ESP_LOGE(TAG, "Create task failed");
+        goto _clock_sync_init_failed;
+    }
+    return cs;
+
+_clock_sync_init_failed:
+    _clock_sync_free(cs);
+    return NULL;
+}
+
+esp_err_t clock_sync_service_destroy(clock_sync_handle_t handle)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    handle->running = false;
+    xSemaphoreTake(handle->exit_sem, portMAX_DELAY);
+    _clock_sync_free(handle);
+    return ESP_OK;
+}
+
+int64_t clock_sync_local_to_shared(clock_sync_handle_t handle, int64_t local_us)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return local_us);
+    if (handle->cfg.role == CLOCK_SYNC_ROLE_MASTER) {
+        return local_us;
+    }
+    mutex_lock(handle->lock);
+    int64_t shared = handle->synced ? local_us + (int64_t)_offset_at(handle, local_us) : local_us;
+    mutex_unlock(handle->lock);
+    return shared;
+}
+
+int64_t clock_sync_shared_to_local(clock_sync_handle_t handle, int64_t shared_us)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return shared_us);
+    if (handle->cfg.role == CLOCK_SYNC_ROLE_MASTER) {
+        return shared_us;
+    }
+    mutex_lock(handle->lock);
+    int64_t local = shared_us;
+    if (handle->synced) {
+        /* Solve shared = local + base_offset + skew * (local - base_local) for local */
+        local = (int64_t)((shared_us - handle->base_offset + handle->skew * handle->base_local) / (1.0 + handle->skew));
+    }
+    mutex_unlock(handle->lock);
+    return local;
+}
+
+int64_t clock_sync_get_time_us(void *handle)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return esp_timer_get_time());
+    clock_sync_handle_t cs = (clock_sync_handle_t)handle;
+    return clock_sync_local_to_shared(cs, _local_now(cs));
+}
+
+esp_err_t clock_sync_get_status(clock_sync_handle_t handle, clock_sync_status_t *status)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, status, return ESP_FAIL);
+    mutex_lock(handle->lock);
+    status->synced = handle->synced;
+    status->offset_us = handle->synced ? (int64_t)_offset_at(handle, _local_now(handle)) : 0;
+    status->skew_ppm = handle->skew * 1e6;
+    status->rtt_us = handle->best_rtt;
+    status->exchanges = handle->exchanges;
+    mutex_unlock(handle->lock);
+    return ESP_OK;
+}
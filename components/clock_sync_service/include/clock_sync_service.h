@@ -0,0 +1,166 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __CLOCK_SYNC_SERVICE_H__
+#define __CLOCK_SYNC_SERVICE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Clock sync service role
+ */
+typedef enum {
+    CLOCK_SYNC_ROLE_MASTER,     /*!< Owns the shared timeline, answers time requests */
+    CLOCK_SYNC_ROLE_SLAVE,      /*!< Follows the master timeline */
+} clock_sync_role_t;
+
+/**
+ * @brief Local clock source, returns the current local time in microseconds
+ */
+typedef int64_t (*clock_sync_clock_cb)(void *ctx);
+
+/**
+ * @brief Clock sync service configuration
+ */
+typedef struct {
+    clock_sync_role_t   role;           /*!< Role of this node */
+    int                 port;           /*!< Master: UDP port to listen on. Slave: master UDP port */
+    const char          *master_host;   /*!< Slave: IPv4 address of the master */
+    int                 interval_ms;    /*!< Slave: time request interval */
+    int                 task_stack;     /*!< Service task stack */
+    int                 task_prio;      /*!< Service task priority (based on freeRTOS priority) */
+    int                 task_core;      /*!< Service task running in core (0 or 1) */
+    bool                extern_stack;   /*!< Task stack allocate on the extern ram */
+    clock_sync_clock_cb local_clock;    /*!< Local clock to timestamp exchanges with, `esp_timer_get_time` if NULL */
+    void                *clock_ctx;     /*!< User context of `local_clock` */
+} clock_sync_cfg_t;
+
+/**
+ * @brief Clock sync status
+ */
+typedef struct {
+    bool                synced;         /*!< The slave has a valid estimate of the master timeline */
+    int64_t             offset_us;      /*!< Current offset of the shared timeline from the local clock */
+    double              skew_ppm;       /*!< Estimated rate difference of the shared timeline, in ppm */
+    int                 rtt_us;         /*!< Round trip time of the best recent exchange */
+    uint32_t            exchanges;      /*!< Number of completed exchanges */
+} clock_sync_status_t;
+
+#define CLOCK_SYNC_DEFAULT_PORT         (9123)
+
+#define CLOCK_SYNC_DEFAULT_CONFIG() {           \
+    .role = CLOCK_SYNC_ROLE_SLAVE,              \
+    .port = CLOCK_SYNC_DEFAULT_PORT,            \
+    .master_host = NULL,                        \
+    .interval_ms = 500,                         \
+    .task_stack = 3 * 1024,                     \
+    .task_prio = 10,                            \
+    .task_core = 0,                             \
+    .extern_stack = false,                      \
+    .local_clock = NULL,                        \
+    .clock_ctx = NULL,                          \
+}
+
+typedef struct clock_sync_service *clock_sync_handle_t;
+
+/**
+ * @brief      Create the clock sync service and start its task
+ *
+ *             The master answers NTP-style four-timestamp exchanges over UDP, the slaves
+ *             keep a filtered offset and skew estimate of the master clock, so all nodes
+ *             can schedule audio against the same timeline (e.g. with `i2s_stream_play_at`).
+ *
+ * @param      cfg   The configuration
+ *
+ * @return
+ *     - NULL, Fail
+ *     - Others, Success
+ */
+clock_sync_handle_t clock_sync_service_create(clock_sync_cfg_t *cfg);
+
+/**
+ * @brief      Stop the service task and release its resources
+ *
+ * @param      handle   The clock sync handle
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t clock_sync_service_destroy(clock_sync_handle_t handle);
+
+/**
+ * @brief      Get the current time of the shared timeline
+ *
+ * @note       The signature matches `i2s_stream_clock_cb`, the handle is passed as context
+ *
+ * @param      handle   The clock sync handle
+ *
+ * @return     Shared time in microseconds, the local time if the slave is not synced yet
+ */
+int64_t clock_sync_get_time_us(void *handle);
+
+/**
+ * @brief      Convert a local `esp_timer_get_time()` value to the shared timeline
+ *
+ * @param      handle     The clock sync handle
+ * @param      local_us   Local time in microseconds
+ *
+ * @return     Shared time in microseconds
+ */
+int64_t clock_sync_local_to_shared(clock_sync_handle_t handle, int64_t local_us);
+
+/**
+ * @brief      Convert a shared timeline value to local `esp_timer_get_time()` time
+ *
+ * @param      handle      The clock sync handle
+ * @param      shared_us   Shared time in microseconds
+ *
+ * @return     Local time in microseconds
+ */
+int64_t clock_sync_shared_to_local(clock_sync_handle_t handle, int64_t shared_us);
+
+/**
+ * @brief      Get the synchronization status
+ *
+ * @param      handle   The clock sync handle
+ * @param      status   The status output
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t clock_sync_get_status(clock_sync_handle_t handle, clock_sync_status_t *status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLOCK_SYNC_SERVICE_H__ */
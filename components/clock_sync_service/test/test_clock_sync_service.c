@@ -0,0 +1,117 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "audio_mem.h"
+#include "unity.h"
+#include "clock_sync_service.h"
+
+static const char *TAG = "clock_sync_test";
+
+#define TEST_CLOCK_SYNC_PORT    (9124)
+
+TEST_CASE("create without configuration", "[clock_sync_service]")
+{
+    TEST_ASSERT_NULL(clock_sync_service_create(NULL));
+    clock_sync_cfg_t cfg = CLOCK_SYNC_DEFAULT_CONFIG();
+    cfg.master_host = NULL;
+    TEST_ASSERT_NULL(clock_sync_service_create(&cfg));
+}
+
+/* Simulated node clock: esp_timer shifted by a fixed offset and running `skew_ppm` fast */
+typedef struct {
+    int64_t     origin_us;
+    int64_t     offset_us;
+    int         skew_ppm;
+} test_clock_t;
+
+static int64_t test_clock_now(void *ctx)
+{
+    test_clock_t *clk = (test_clock_t *)ctx;
+    int64_t now = esp_timer_get_time();
+    return now + clk->offset_us + (now - clk->origin_us) * clk->skew_ppm / 1000000;
+}
+
+TEST_CASE("master and slaves with skewed clocks over loopback", "[clock_sync_service]")
+{
+    tcpip_adapter_init();
+    AUDIO_MEM_SHOW("MEMORY BEFORE");
+
+    int64_t origin = esp_timer_get_time();
+    test_clock_t master_clk = { .origin_us = origin, .offset_us = 500000, .skew_ppm = 0 };
+    test_clock_t slave_clk[2] = {
+        { .origin_us = origin, .offset_us = -2000000, .skew_ppm = 150 },
+        { .origin_us = origin, .offset_us = 3000000, .skew_ppm = -100 },
+    };
+
+    clock_sync_cfg_t master_cfg = CLOCK_SYNC_DEFAULT_CONFIG();
+    master_cfg.role = CLOCK_SYNC_ROLE_MASTER;
+    master_cfg.port = TEST_CLOCK_SYNC_PORT;
+    master_cfg.local_clock = test_clock_now;
+    master_cfg.clock_ctx = &master_clk;
+    clock_sync_handle_t master = clock_sync_service_create(&master_cfg);
+    TEST_ASSERT_NOT_NULL(master);
+
+    clock_sync_handle_t slaves[2];
+    for (int i = 0; i < 2; i++) {
+        clock_sync_cfg_t slave_cfg = CLOCK_SYNC_DEFAULT_CONFIG();
+        slave_cfg.port = TEST_CLOCK_SYNC_PORT;
+        slave_cfg.master_host = "127.0.0.1";
+        slave_cfg.interval_ms = 100;
+        slave_cfg.local_clock = test_clock_now;
+        slave_cfg.clock_ctx = &slave_clk[i];
+        slaves[i] = clock_sync_service_create(&slave_cfg);
+        TEST_ASSERT_NOT_NULL(slaves[i]);
+    }
+    /* Long enough for the skew estimator, which needs a 5 s span */
+    vTaskDelay(pdMS_TO_TICKS(8000));
+
+    for (int i = 0; i < 2; i++) {
+        clock_sync_status_t status;
+        TEST_ASSERT_EQUAL(ESP_OK, clock_sync_get_status(slaves[i], &status));
+        int64_t now = esp_timer_get_time();
+        int64_t expect_offset = test_clock_now(&master_clk) - test_clock_now(&slave_clk[i]);
+        ESP_LOGI(TAG, "slave %d: offset %lld us (expect %lld), skew %.2f ppm (expect %d), rtt %d us, exchanges %u", i,
+                 (long long)status.offset_us, (long long)expect_offset, status.skew_ppm, -slave_clk[i].skew_ppm,
+                 status.rtt_us, status.exchanges);
+        TEST_ASSERT_TRUE(status.synced);
+        TEST_ASSERT_TRUE(status.exchanges > 10);
+        TEST_ASSERT_INT_WITHIN(1000, 0, (int)(status.offset_us - expect_offset));
+        /* A node running fast sees the shared timeline drift backwards at the same rate */
+        TEST_ASSERT_INT_WITHIN(50, -slave_clk[i].skew_ppm, (int)status.skew_ppm);
+        TEST_ASSERT_INT_WITHIN(1000, 0, (int)(clock_sync_get_time_us(slaves[i]) - clock_sync_get_time_us(master)));
+        TEST_ASSERT_INT_WITHIN(2, 0, (int)(clock_sync_shared_to_local(slaves[i], clock_sync_local_to_shared(slaves[i], now)) - now));
+    }
+
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, clock_sync_service_destroy(slaves[i]));
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, clock_sync_service_destroy(master));
+    AUDIO_MEM_SHOW("MEMORY AFTER");
+}
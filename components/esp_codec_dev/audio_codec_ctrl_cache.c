@@ -0,0 +1,263 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "audio_codec_ctrl_cache.h"
+#include "esp_log.h"
+
+#define TAG "CTRL_Cache"
+
+#define CACHE_REG_NUM       (256)
+#define CACHE_QUEUE_SIZE    (64)
+#define BIT_GET(map, reg)   ((map)[(reg) >> 5] & (1UL << ((reg) & 31)))
+#define BIT_SET(map, reg)   ((map)[(reg) >> 5] |= (1UL << ((reg) & 31)))
+
+typedef struct {
+    audio_codec_ctrl_if_t        base;
+    const audio_codec_ctrl_if_t *bus_if;
+    bool                         burst;
+    bool                         is_open;
+    uint8_t                      value[CACHE_REG_NUM];
+    uint32_t                     valid[CACHE_REG_NUM / 32];
+    uint32_t                     uncached[CACHE_REG_NUM / 32];
+    uint8_t                      queue_reg[CACHE_QUEUE_SIZE];
+    uint8_t                      queue_value[CACHE_QUEUE_SIZE];
+    int                          queue_num;
+    int                          batch_depth;
+    int                          batch_ret;
+} ctrl_cache_t;
+
+static void _cache_invalidate(ctrl_cache_t *cache)
+{
+    memset(cache->valid, 0, sizeof(cache->valid));
+}
+
+static int _cache_flush(ctrl_cache_t *cache)
+{
+    int ret = ESP_CODEC_DEV_OK;
+    int i = 0;
+    while (i < cache->queue_num) {
+        int n = 1;
+        // Queued values are stored continuously so that consecutive registers can be sent directly
+        if (cache->burst) {
+            while (i + n < cache->queue_num && cache->queue_reg[i + n] == cache->queue_reg[i] + n) {
+                n++;
+            }
+        }
+        ret |= cache->bus_if->write_reg(cache->bus_if, cache->queue_reg[i], 1, &cache->queue_value[i], n);
+        i += n;
+    }
+    cache->queue_num = 0;
+    if (ret != ESP_CODEC_DEV_OK) {
+        // Register values are unknown after write fail
+        _cache_invalidate(cache);
+        ESP_LOGE(TAG, "Fail to flush registers");
+        return ESP_CODEC_DEV_WRITE_FAIL;
+    }
+    return ESP_CODEC_DEV_OK;
+}
+
+static bool _cache_hit(ctrl_cache_t *cache, int reg, uint8_t *data, int data_len, bool cmp)
+{
+    for (int i = 0; i < data_len; i++) {
+        if (BIT_GET(cache->uncached, reg + i) || BIT_GET(cache->valid, reg + i) == 0) {
+            return false;
+        }
+        if (cmp && cache->value[reg + i] != data[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void _cache_update(ctrl_cache_t *cache, int reg, uint8_t *data, int data_len)
+{
+    bool drop = false;
+    for (int i = 0; i < data_len; i++) {
+        if (BIT_GET(cache->uncached, reg + i)) {
+            drop = true;
+            continue;
+        }
+        cache->value[reg + i] = data[i];
+        BIT_SET(cache->valid, reg + i);
+    }
+    if (drop) {
+        _cache_invalidate(cache);
+    }
+}
+
+static int _cache_ctrl_open(const audio_codec_ctrl_if_t *ctrl, void *cfg, int cfg_size)
+{
+    if (ctrl == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    ctrl_cache_t *cache = (ctrl_cache_t *) ctrl;
+    cache->is_open = true;
+    return ESP_CODEC_DEV_OK;
+}
+
+static bool _cache_ctrl_is_open(const audio_codec_ctrl_if_t *ctrl)
+{
+    if (ctrl) {
+        ctrl_cache_t *cache = (ctrl_cache_t *) ctrl;
+        return cache->is_open && (cache->bus_if->is_open == NULL || cache->bus_if->is_open(cache->bus_if));
+    }
+    return false;
+}
+
+static int _cache_ctrl_read_reg(const audio_codec_ctrl_if_t *ctrl, int addr, int addr_len, void *data, int data_len)
+{
+    if (ctrl == NULL || data == NULL || data_len <= 0) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    ctrl_cache_t *cache = (ctrl_cache_t *) ctrl;
+    if (cache->is_open == false) {
+        return ESP_CODEC_DEV_WRONG_STATE;
+    }
+    bool cachable = (addr_len == 1 && addr >= 0 && addr + data_len <= CACHE_REG_NUM);
+    if (cachable && _cache_hit(cache, addr, (uint8_t *) data, data_len, false)) {
+        memcpy(data, &cache->value[addr], data_len);
+        return ESP_CODEC_DEV_OK;
+    }
+    // Queued writes must reach codec before read from it
+    int ret = _cache_flush(cache);
+    if (ret != ESP_CODEC_DEV_OK) {
+        cache->batch_ret = ret;
+    }
+    ret = cache->bus_if->read_reg(cache->bus_if, addr, addr_len, data, data_len);
+    if (ret == ESP_CODEC_DEV_OK && cachable) {
+        for (int i = 0; i < data_len; i++) {
+            if (BIT_GET(cache->uncached, addr + i) == 0) {
+                cache->value[addr + i] = ((uint8_t *) data)[i];
+                BIT_SET(cache->valid, addr + i);
+            }
+        }
+    }
+    return ret;
+}
+
+static int _cache_ctrl_write_reg(const audio_codec_ctrl_if_t *ctrl, int addr, int addr_len, void *data, int data_len)
+{
+    if (ctrl == NULL || data == NULL || data_len <= 0) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    ctrl_cache_t *cache = (ctrl_cache_t *) ctrl;
+    if (cache->is_open == false) {
+        return ESP_CODEC_DEV_WRONG_STATE;
+    }
+    int ret;
+    if (addr_len != 1 || addr < 0 || addr + data_len > CACHE_REG_NUM) {
+        ret = _cache_flush(cache);
+        if (ret != ESP_CODEC_DEV_OK) {
+            cache->batch_ret = ret;
+        }
+        return cache->bus_if->write_reg(cache->bus_if, addr, addr_len, data, data_len);
+    }
+    uint8_t *v = (uint8_t *) data;
+    if (_cache_hit(cache, addr, v, data_len, true)) {
+        return ESP_CODEC_DEV_OK;
+    }
+    if (cache->batch_depth == 0) {
+        ret = cache->bus_if->write_reg(cache->bus_if, addr, addr_len, data, data_len);
+        if (ret == ESP_CODEC_DEV_OK) {
+            _cache_update(cache, addr, v, data_len);
+        } else {
+            _cache_invalidate(cache);
+        }
+        return ret;
+    }
+    for (int i = 0; i < data_len; i++) {
+        if (cache->queue_num == CACHE_QUEUE_SIZE) {
+            ret = _cache_flush(cache);
+            if (ret != ESP_CODEC_DEV_OK) {
+                cache->batch_ret = ret;
+            }
+        }
+        cache->queue_reg[cache->queue_num] = (uint8_t) (addr + i);
+        cache->queue_value[cache->queue_num] = v[i];
+        cache->queue_num++;
+    }
+    // Cache take queued value so that later read in batch not access bus
+    _cache_update(cache, addr, v, data_len);
+    return ESP_CODEC_DEV_OK;
+}
+
+static int _cache_ctrl_batch(const audio_codec_ctrl_if_t *ctrl, bool start)
+{
+    if (ctrl == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    ctrl_cache_t *cache = (ctrl_cache_t *) ctrl;
+    if (start) {
+        cache->batch_depth++;
+        return ESP_CODEC_DEV_OK;
+    }
+    if (cache->batch_depth == 0) {
+        return ESP_CODEC_DEV_WRONG_STATE;
+    }
+    cache->batch_depth--;
+    if (cache->batch_depth) {
+        return ESP_CODEC_DEV_OK;
+    }
+    int ret = _cache_flush(cache);
+    if (cache->batch_ret != ESP_CODEC_DEV_OK) {
+        ret = cache->batch_ret;
+        cache->batch_ret = ESP_CODEC_DEV_OK;
+    }
+    return ret;
+}
+
+static int _cache_ctrl_close(const audio_codec_ctrl_if_t *ctrl)
+{
+    if (ctrl == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    ctrl_cache_t *cache = (ctrl_cache_t *) ctrl;
+    if (cache->is_open) {
+        _cache_flush(cache);
+    }
+    cache->batch_depth = 0;
+    cache->batch_ret = ESP_CODEC_DEV_OK;
+    _cache_invalidate(cache);
+    cache->is_open = false;
+    return ESP_CODEC_DEV_OK;
+}
+
+int audio_codec_ctrl_cache_invalidate(const audio_codec_ctrl_if_t *ctrl_if)
+{
+    if (ctrl_if == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    _cache_invalidate((ctrl_cache_t *) ctrl_if);
+    return ESP_CODEC_DEV_OK;
+}
+
+const audio_codec_ctrl_if_t *audio_codec_new_ctrl_cache(audio_codec_ctrl_cache_cfg_t *cfg)
+{
+    if (cfg == NULL || cfg->bus_if == NULL || cfg->bus_if->read_reg == NULL || cfg->bus_if->write_reg == NULL ||
+        (cfg->uncached_num && cfg->uncached_regs == NULL)) {
+        ESP_LOGE(TAG, "Bad configuration");
+        return NULL;
+    }
+    ctrl_cache_t *cache = calloc(1, sizeof(ctrl_cache_t));
+    if (cache == NULL) {
+        ESP_LOGE(TAG, "No memory for instance");
+        return NULL;
+    }
+    cache->base.open = _cache_ctrl_open;
+    cache->base.is_open = _cache_ctrl_is_open;
+    cache->base.read_reg = _cache_ctrl_read_reg;
+    cache->base.write_reg = _cache_ctrl_write_reg;
+    cache->base.close = _cache_ctrl_close;
+    cache->base.batch = _cache_ctrl_batch;
+    cache->bus_if = cfg->bus_if;
+    cache->burst = cfg->burst;
+    for (int i = 0; i < cfg->uncached_num; i++) {
+        BIT_SET(cache->uncached, cfg->uncached_regs[i]);
+    }
+    cache->is_open = true;
+    return &cache->base;
+}
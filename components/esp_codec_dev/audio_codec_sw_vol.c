@@ -3,17 +3,40 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
-#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include "audio_codec_sw_vol.h"
 
 #define GAIN_0DB_SHIFT (15)
+#define GAIN_MAX       ((1 << 16) - 1)
+/* Gain is kept constant inside one block of frames and ramped between blocks */
+#define RAMP_FRAMES    (16)
+
+#define SAT16(v)       ((v) > INT16_MAX ? INT16_MAX : ((v) < INT16_MIN ? INT16_MIN : (v)))
+#define SAT24(v)       ((v) > 0x7FFFFF ? 0x7FFFFF : ((v) < -0x800000 ? -0x800000 : (v)))
+#define SAT32(v)       ((v) > INT32_MAX ? INT32_MAX : ((v) < INT32_MIN ? INT32_MIN : (v)))
+#define GAIN_MIN_DB    (-96)
+#define GAIN_MAX_DB    (6)
+
+/* Q15 gain of each integer dB from GAIN_MIN_DB to GAIN_MAX_DB, fractional dB is interpolated */
+static const uint16_t db_gain_table[] = {
+    0,     0,     0,     0,     0,     0,     1,     1,     1,     1,
+    1,     1,     2,     2,     2,     2,     3,     3,     4,     4,
+    5,     5,     6,     7,     8,     9,     10,    11,    13,    14,
+    16,    18,    20,    23,    26,    29,    32,    36,    41,    46,
+    51,    58,    65,    73,    82,    92,    103,   116,   130,   146,
+    164,   184,   206,   231,   260,   292,   327,   367,   412,   462,
+    519,   582,   653,   733,   823,   923,   1036,  1162,  1304,  1463,
+    1642,  1842,  2067,  2319,  2602,  2920,  3276,  3676,  4125,  4628,
+    5193,  5827,  6538,  7335,  8230,  9235,  10362, 11626, 13045, 14636,
+    16422, 18426, 20675, 23197, 26028, 29204, 32768, 36766, 41252, 46286,
+    51933, 58270, 65380,
+};
 
 typedef struct {
     audio_codec_vol_if_t        base;
     esp_codec_dev_sample_info_t fs;
-    uint16_t                    gain;
+    int                         gain;
     bool                        is_open;
     int                         cur;
     int                         step;
@@ -37,7 +60,7 @@ static int _sw_vol_open(const audio_codec_vol_if_t *h, esp_codec_dev_sample_info
     if (vol == NULL || fs == NULL) {
         return ESP_CODEC_DEV_INVALID_ARG;
     }
-    if (fs->bits_per_sample != 16) {
+    if (fs->bits_per_sample != 16 && fs->bits_per_sample != 24 && fs->bits_per_sample != 32) {
         return ESP_CODEC_DEV_NOT_SUPPORT;
     }
     vol->fs = *fs;
@@ -47,80 +70,162 @@ static int _sw_vol_open(const audio_codec_vol_if_t *h, esp_codec_dev_sample_info
     return ESP_CODEC_DEV_OK;
 }
 
+/*
+ * Kernels apply one constant gain to `n` samples, the loops have no branch except the saturation
+ * so that the compiler can unroll them. Input and output can be the same buffer.
+ */
+static void _vol_apply_16(const int16_t *in, int16_t *out, int n, int gain)
+{
+    for (int i = 0; i < n; i++) {
+        int32_t v = ((int32_t) in[i] * gain) >> GAIN_0DB_SHIFT;
+        out[i] = (int16_t) SAT16(v);
+    }
+}
+
+static void _vol_apply_24(const uint8_t *in, uint8_t *out, int n, int gain)
+{
+    for (int i = 0; i < n; i++) {
+        // Packed little endian 24 bits, shift up to sign extend
+        int32_t s = (int32_t) (((uint32_t) in[0] << 8) | ((uint32_t) in[1] << 16) | ((uint32_t) in[2] << 24)) >> 8;
+        int64_t v = ((int64_t) s * gain) >> GAIN_0DB_SHIFT;
+        s = (int32_t) SAT24(v);
+        out[0] = (uint8_t) s;
+        out[1] = (uint8_t) (s >> 8);
+        out[2] = (uint8_t) (s >> 16);
+        in += 3;
+        out += 3;
+    }
+}
+
+static void _vol_apply_32(const int32_t *in, int32_t *out, int n, int gain)
+{
+    for (int i = 0; i < n; i++) {
+        int64_t v = ((int64_t) in[i] * gain) >> GAIN_0DB_SHIFT;
+        out[i] = (int32_t) SAT32(v);
+    }
+}
+
+static void _vol_apply(audio_vol_t *vol, const uint8_t *in, uint8_t *out, int frames, int gain)
+{
+    int n = frames * vol->fs.channel;
+    if (gain == 0) {
+        memset(out, 0, frames * vol->block_size);
+        return;
+    }
+    if (gain == (1 << GAIN_0DB_SHIFT)) {
+        if (in != out) {
+            memcpy(out, in, frames * vol->block_size);
+        }
+        return;
+    }
+    switch (vol->fs.bits_per_sample) {
+        case 16:
+            _vol_apply_16((const int16_t *) in, (int16_t *) out, n, gain);
+            break;
+        case 24:
+            _vol_apply_24(in, out, n, gain);
+            break;
+        default:
+            _vol_apply_32((const int32_t *) in, (int32_t *) out, n, gain);
+            break;
+    }
+}
+
 static int _sw_vol_process(const audio_codec_vol_if_t *h, uint8_t *in, int len,
                            uint8_t *out, int out_len)
 {
     audio_vol_t *vol = (audio_vol_t *) h;
-    if (vol == NULL) {
+    if (vol == NULL || in == NULL || out == NULL) {
         return ESP_CODEC_DEV_INVALID_ARG;
     }
     if (vol->is_open == false) {
         return ESP_CODEC_DEV_WRONG_STATE;
     }
-    int sample = len / vol->block_size;
-    if (vol->fs.bits_per_sample == 16) {
-        int16_t *v_in = (int16_t *) in;
-        int16_t *v_out = (int16_t *) out;
-        if (vol->cur == vol->gain) {
-            if (vol->gain == 0) {
-                memset(out, 0, len);
-                return 0;
-            } else {
-                for (int i = 0; i < sample; i++) {
-                    for (int j = 0; j < vol->fs.channel; j++) {
-                        *(v_out++) = ((*v_in++) * vol->cur) >> GAIN_0DB_SHIFT;
-                    }
-                }
-                return 0;
-            }
-        }
-        for (int i = 0; i < sample; i++) {
-            for (int j = 0; j < vol->fs.channel; j++) {
-                *(v_out++) = ((*v_in++) * vol->cur) >> GAIN_0DB_SHIFT;
-            }
-            if (vol->step) {
-                vol->cur += vol->step;
-                if (vol->step > 0) {
-                    if (vol->cur > vol->gain) {
-                        vol->cur = vol->gain;
-                        vol->step = 0;
-                    }
-                } else {
-                    if (vol->cur < vol->gain) {
-                        vol->cur = vol->gain;
-                        vol->step = 0;
-                    }
-                }
-            }
+    if (out_len < len) {
+        len = out_len;
+    }
+    int frames = len / vol->block_size;
+    // Keep partial frame at tail untouched
+    if (in != out && len > frames * vol->block_size) {
+        memcpy(out + frames * vol->block_size, in + frames * vol->block_size, len - frames * vol->block_size);
+    }
+    // Ramp block by block until reach target gain then process the rest in one call
+    while (vol->step && frames > 0) {
+        int n = frames < RAMP_FRAMES ? frames : RAMP_FRAMES;
+        _vol_apply(vol, in, out, n, vol->cur);
+        in += n * vol->block_size;
+        out += n * vol->block_size;
+        frames -= n;
+        vol->cur += vol->step;
+        if ((vol->step > 0 && vol->cur >= vol->gain) || (vol->step < 0 && vol->cur <= vol->gain)) {
+            vol->cur = vol->gain;
+            vol->step = 0;
         }
     }
+    if (frames > 0) {
+        _vol_apply(vol, in, out, frames, vol->cur);
+    }
     return 0;
 }
 
-static int _sw_vol_set(const audio_codec_vol_if_t *h, float db_value)
+static int _db_to_gain(float db_value)
 {
-    audio_vol_t *vol = (audio_vol_t *) h;
-    if (vol == NULL) {
-        return ESP_CODEC_DEV_INVALID_ARG;
+    if (db_value <= GAIN_MIN_DB) {
+        return 0;
     }
-    // Support set volume when not opened
-    int gain;
-    if (db_value <= -96.0) {
-        gain = 0;
-    } else {
-        gain = (int) (exp(db_value / 20 * log(10)) * (1 << GAIN_0DB_SHIFT));
+    if (db_value > GAIN_MAX_DB) {
+        return GAIN_MAX;
+    }
+    // Index and fraction in 1/256 dB
+    int pos = (int) ((db_value - GAIN_MIN_DB) * 256 + 0.5);
+    int idx = pos >> 8;
+    int frac = pos & 0xFF;
+    if (frac == 0) {
+        return db_gain_table[idx];
     }
-    vol->gain = gain;
+    return (db_gain_table[idx] * (256 - frac) + db_gain_table[idx + 1] * frac) >> 8;
+}
+
+static void _sw_vol_update_step(audio_vol_t *vol)
+{
     if (vol->is_open) {
-        float step = (float) (vol->gain - vol->cur) * 1000 / vol->duration / vol->fs.sample_rate;
+        float step = (float) (vol->gain - vol->cur) * 1000 * RAMP_FRAMES / vol->duration / vol->fs.sample_rate;
         vol->step = (int) step;
-        if (step == 0) {
+        if (vol->step == 0) {
             vol->cur = vol->gain;
         }
     } else {
         vol->step = 0;
         vol->cur = vol->gain;
     }
+}
+
+static int _sw_vol_set(const audio_codec_vol_if_t *h, float db_value)
+{
+    audio_vol_t *vol = (audio_vol_t *) h;
+    if (vol == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    // Support set volume when not opened
+    vol->gain = _db_to_gain(db_value);
+    _sw_vol_update_step(vol);
+    return ESP_CODEC_DEV_OK;
+}
+
+int audio_codec_sw_vol_scale(const audio_codec_vol_if_t *h, float db_value)
+{
+    audio_vol_t *vol = (audio_vol_t *) h;
+    if (vol == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    // Gain jumps to target directly when not opened, no need to scale
+    if (vol->is_open == false) {
+        return ESP_CODEC_DEV_OK;
+    }
+    int cur = (int) (((int64_t) vol->cur * _db_to_gain(db_value)) >> GAIN_0DB_SHIFT);
+    vol->cur = cur > GAIN_MAX ? GAIN_MAX : cur;
+    // Ramp again from the scaled gain to target
+    _sw_vol_update_step(vol);
     return ESP_CODEC_DEV_OK;
 }
 
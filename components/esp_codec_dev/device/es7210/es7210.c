@@ -390,11 +390,13 @@ static int es7210_enable(const audio_codec_if_t *h, bool enable)
         return ESP_CODEC_DEV_OK;
     }
     int ret = 0;
+    audio_codec_ctrl_batch_begin(codec->ctrl_if);
     if (enable) {
         ret |= es7210_start(codec, codec->off_reg);
     } else {
         ret |= es7210_stop(codec);
     }
+    ret |= audio_codec_ctrl_batch_end(codec->ctrl_if);
     if (ret == ESP_CODEC_DEV_OK) {
         ESP_LOGD(TAG, "Codec is %s", enable ? "enabled" : "disabled");
         codec->enabled = enable;
@@ -412,6 +414,8 @@ static int es7210_open(const audio_codec_if_t *h, void *cfg, int cfg_size)
     }
     int ret = 0;
     codec->ctrl_if = codec_cfg->ctrl_if;
+    // Send register table together when control interface support batch
+    audio_codec_ctrl_batch_begin(codec->ctrl_if);
     ret |= es7210_write_reg(codec, ES7210_RESET_REG00, 0xff);
     ret |= es7210_write_reg(codec, ES7210_RESET_REG00, 0x41);
     ret |= es7210_write_reg(codec, ES7210_CLOCK_OFF_REG01, 0x3f);
@@ -421,10 +425,12 @@ static int es7210_open(const audio_codec_if_t *h, void *cfg, int cfg_size)
     ret |= es7210_write_reg(codec, ES7210_ADC12_HPF1_REG22, 0x0a);
     ret |= es7210_write_reg(codec, ES7210_ADC34_HPF2_REG20, 0x0a);
     ret |= es7210_write_reg(codec, ES7210_ADC34_HPF1_REG21, 0x2a);
+    ret |= audio_codec_ctrl_batch_end(codec->ctrl_if);
     if (ret != 0) {
         ESP_LOGE(TAG, "Write register fail");
         return ESP_CODEC_DEV_WRITE_FAIL;
     }
+    audio_codec_ctrl_batch_begin(codec->ctrl_if);
     if (codec_cfg->master_mode) {
         ESP_LOGI(TAG, "Work in Master mode");
         ret |= es7210_update_reg_bit(codec, ES7210_MODE_CONFIG_REG08, 0x01, 0x01);
@@ -455,6 +461,7 @@ static int es7210_open(const audio_codec_if_t *h, void *cfg, int cfg_size)
     }
     ret |= es7210_mic_select(codec, codec->mic_select);
     ret |= _es7210_set_channel_gain(codec, 0xF, 30.0);
+    ret |= audio_codec_ctrl_batch_end(codec->ctrl_if);
     if (ret != 0) {
         return ESP_CODEC_DEV_WRITE_FAIL;
     }
@@ -486,9 +493,11 @@ static int es7210_set_fs(const audio_codec_if_t *h, esp_codec_dev_sample_info_t
     if (es7210_is_tdm_mode(codec) && fs->channel <= 2 && fs->channel_mask == 0) {
         bits >>= 1;
     }
+    audio_codec_ctrl_batch_begin(codec->ctrl_if);
     ret |= es7210_set_bits(codec, bits);
     ret |= es7210_config_sample(codec, fs->sample_rate);
     ret |= es7210_config_fmt(codec, ES_I2S_NORMAL);
+    ret |= audio_codec_ctrl_batch_end(codec->ctrl_if);
     return ret == 0 ? ESP_CODEC_DEV_OK : ESP_CODEC_DEV_WRITE_FAIL;
 }
 
@@ -60,6 +60,7 @@ static int es7243_adc_set_gain(audio_codec_es7243_t *codec, float db)
 static int es7243_adc_enable(audio_codec_es7243_t *codec, bool enable)
 {
     int ret = ESP_CODEC_DEV_OK;
+    audio_codec_ctrl_batch_begin(codec->ctrl_if);
     if (enable) {
         // slave mode only
         ret |= es7243_write_reg(codec, 0x00, 0x01);
@@ -76,6 +77,7 @@ static int es7243_adc_enable(audio_codec_es7243_t *codec, bool enable)
         ret |= es7243_write_reg(codec, 0x08, 0x4B);
         ret |= es7243_write_reg(codec, 0x09, 0x9F);
     }
+    ret |= audio_codec_ctrl_batch_end(codec->ctrl_if);
     ESP_LOGI(TAG, "Set enable %d", enable);
     return ret;
 }
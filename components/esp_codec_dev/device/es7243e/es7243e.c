@@ -42,6 +42,7 @@ static int es7243e_write_reg(audio_codec_es7243e_t *codec, int reg, int value)
 int es7243e_adc_enable(audio_codec_es7243e_t *codec, bool enable)
 {
     int ret = ESP_CODEC_DEV_OK;
+    audio_codec_ctrl_batch_begin(codec->ctrl_if);
     if (enable) {
         // slave mode only
         ret |= es7243e_write_reg(codec, 0xF9, 0x00);
@@ -68,6 +69,7 @@ int es7243e_adc_enable(audio_codec_es7243e_t *codec, bool enable)
         ret |= es7243e_write_reg(codec, 0x01, 0x30);
         ret |= es7243e_write_reg(codec, 0x01, 0x00);
     }
+    ret |= audio_codec_ctrl_batch_end(codec->ctrl_if);
     return ret;
 }
 
@@ -81,6 +83,8 @@ static int es7243e_open(const audio_codec_if_t *h, void *cfg, int cfg_size)
     codec->ctrl_if = codec_cfg->ctrl_if;
 
     int ret = 0;
+    // Send register table together when control interface support batch
+    audio_codec_ctrl_batch_begin(codec->ctrl_if);
     ret |= es7243e_write_reg(codec, 0x01, 0x3A);
     ret |= es7243e_write_reg(codec, 0x00, 0x80);
     ret |= es7243e_write_reg(codec, 0xF9, 0x00);
@@ -121,6 +125,7 @@ static int es7243e_open(const audio_codec_if_t *h, void *cfg, int cfg_size)
     ret |= es7243e_write_reg(codec, 0x01, 0x3A);
     ret |= es7243e_write_reg(codec, 0x16, 0x3F);
     ret |= es7243e_write_reg(codec, 0x16, 0x00);
+    ret |= audio_codec_ctrl_batch_end(codec->ctrl_if);
     if (ret != 0 || es7243e_adc_enable(codec, true)) {
         ESP_LOGI(TAG, "Fail to write register");
         return ESP_CODEC_DEV_WRITE_FAIL;
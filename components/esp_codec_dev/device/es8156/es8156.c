@@ -147,6 +147,8 @@ static int es8156_open(const audio_codec_if_t *h, void *cfg, int cfg_size)
     codec->pa_pin = codec_cfg->pa_pin;
     codec->pa_reverted = codec_cfg->pa_reverted;
 
+    // Send register table together when control interface support batch
+    audio_codec_ctrl_batch_begin(codec->ctrl_if);
     ret |= es8156_write_reg(codec, 0x02, 0x04);
     ret |= es8156_write_reg(codec, 0x20, 0x2A);
     ret |= es8156_write_reg(codec, 0x21, 0x3C);
@@ -165,6 +167,7 @@ static int es8156_open(const audio_codec_if_t *h, void *cfg, int cfg_size)
     ret |= es8156_write_reg(codec, 0x00, 0x02);
     ret |= es8156_write_reg(codec, 0x00, 0x03);
     ret |= es8156_write_reg(codec, 0x25, 0x20);
+    ret |= audio_codec_ctrl_batch_end(codec->ctrl_if);
     if (ret != 0) {
         return ESP_CODEC_DEV_WRITE_FAIL;
     }
@@ -180,7 +183,9 @@ static int es8156_close(const audio_codec_if_t *h)
         return ESP_CODEC_DEV_INVALID_ARG;
     }
     if (codec->is_open) {
+        audio_codec_ctrl_batch_begin(codec->ctrl_if);
         es8156_stop(codec);
+        audio_codec_ctrl_batch_end(codec->ctrl_if);
         es8156_pa_power(codec, ES_PA_DISABLE);
         codec->is_open = false;
     }
@@ -200,12 +205,16 @@ static int es8156_enable(const audio_codec_if_t *h, bool enable)
     if (codec->enabled == enable) {
         return ESP_CODEC_DEV_OK;
     }
+    audio_codec_ctrl_batch_begin(codec->ctrl_if);
     if (enable) {
         ret = es8156_start(codec);
+        // Registers must be set before PA power on
+        ret |= audio_codec_ctrl_batch_end(codec->ctrl_if);
         es8156_pa_power(codec, ES_PA_ENABLE);
     } else {
         es8156_pa_power(codec, ES_PA_DISABLE);
         ret = es8156_stop(codec);
+        ret |= audio_codec_ctrl_batch_end(codec->ctrl_if);
     }
     if (ret == ESP_CODEC_DEV_OK) {
         codec->enabled = enable;
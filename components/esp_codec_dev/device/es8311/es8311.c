@@ -496,6 +496,8 @@ static int es8311_open(const audio_codec_if_t *h, void *cfg, int cfg_size)
     }
     int regv;
     int ret = ESP_CODEC_DEV_OK;
+    // Send register table together when control interface support batch
+    audio_codec_ctrl_batch_begin(codec->cfg.ctrl_if);
     ret |= es8311_write_reg(codec, ES8311_CLK_MANAGER_REG01, 0x30);
     ret |= es8311_write_reg(codec, ES8311_CLK_MANAGER_REG02, 0x00);
     ret |= es8311_write_reg(codec, ES8311_CLK_MANAGER_REG03, 0x10);
@@ -550,6 +552,7 @@ static int es8311_open(const audio_codec_if_t *h, void *cfg, int cfg_size)
     } else {
         ret |= es8311_write_reg(codec, ES8311_GPIO_REG44, 0);
     }
+    ret |= audio_codec_ctrl_batch_end(codec->cfg.ctrl_if);
     if (ret != 0) {
         return ESP_CODEC_DEV_WRITE_FAIL;
     }
@@ -565,7 +568,9 @@ static int es8311_close(const audio_codec_if_t *h)
         return ESP_CODEC_DEV_INVALID_ARG;
     }
     if (codec->is_open) {
+        audio_codec_ctrl_batch_begin(codec->cfg.ctrl_if);
         es8311_suspend(codec);
+        audio_codec_ctrl_batch_end(codec->cfg.ctrl_if);
         es8311_pa_power(codec, ES_PA_DISABLE);
         codec->is_open = false;
     }
@@ -578,9 +583,11 @@ static int es8311_set_fs(const audio_codec_if_t *h, esp_codec_dev_sample_info_t
     if (codec == NULL || codec->is_open == false) {
         return ESP_CODEC_DEV_INVALID_ARG;
     }
+    audio_codec_ctrl_batch_begin(codec->cfg.ctrl_if);
     es8311_set_bits_per_sample(codec, fs->bits_per_sample);
     es8311_config_fmt(codec, ES_I2S_NORMAL);
     es8311_config_sample(codec, fs->sample_rate);
+    audio_codec_ctrl_batch_end(codec->cfg.ctrl_if);
     return ESP_CODEC_DEV_OK;
 }
 
@@ -597,12 +604,16 @@ static int es8311_enable(const audio_codec_if_t *h, bool enable)
     if (enable == codec->enabled) {
         return ESP_CODEC_DEV_OK;
     }
+    audio_codec_ctrl_batch_begin(codec->cfg.ctrl_if);
     if (enable) {
         ret = es8311_start(codec);
+        // Registers must be set before PA power on
+        ret |= audio_codec_ctrl_batch_end(codec->cfg.ctrl_if);
         es8311_pa_power(codec, ES_PA_ENABLE);
     } else {
         es8311_pa_power(codec, ES_PA_DISABLE);
         ret = es8311_suspend(codec);
+        ret |= audio_codec_ctrl_batch_end(codec->cfg.ctrl_if);
     }
     if (ret == ESP_CODEC_DEV_OK) {
         codec->enabled = enable;
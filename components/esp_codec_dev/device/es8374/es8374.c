@@ -617,12 +617,15 @@ static int es8374_open(const audio_codec_if_t *h, void *cfg, int cfg_size)
     es_i2s_clock_t clkdiv;
     clkdiv.lclk_div = LCLK_DIV_256;
     clkdiv.sclk_div = MCLK_DIV_4;
+    // Send register table together when control interface support batch
+    audio_codec_ctrl_batch_begin(codec->cfg.ctrl_if);
     ret |= es8374_stop(codec);
     ret |= es8374_init_reg(codec, (BIT_LENGTH_16BITS << 4) | ES_I2S_NORMAL, clkdiv, DAC_OUTPUT_ALL,
                            ADC_INPUT_LINPUT1_RINPUT1);
     ret |= _set_mic_gain(codec, 15);
     ret |= es8374_set_d2se_pga(codec, D2SE_PGA_GAIN_EN);
     ret |= es8374_config_fmt(codec, ES_I2S_NORMAL);
+    ret |= audio_codec_ctrl_batch_end(codec->cfg.ctrl_if);
     if (ret != 0) {
         return ESP_CODEC_DEV_WRITE_FAIL;
     }
@@ -637,8 +640,10 @@ static int es8374_close(const audio_codec_if_t *h)
         return ESP_CODEC_DEV_INVALID_ARG;
     }
     if (codec->is_open) {
+        audio_codec_ctrl_batch_begin(codec->cfg.ctrl_if);
         es8374_stop(codec);
         es8374_write_reg(codec, 0x00, 0x7F); // IC Reset and STOP
+        audio_codec_ctrl_batch_end(codec->cfg.ctrl_if);
         es8374_pa_power(codec, false);
         codec->is_open = false;
     }
@@ -652,8 +657,10 @@ static int es8374_set_fs(const audio_codec_if_t *h, esp_codec_dev_sample_info_t
         return ESP_CODEC_DEV_INVALID_ARG;
     }
     int ret = 0;
+    audio_codec_ctrl_batch_begin(codec->cfg.ctrl_if);
     ret |= es8374_config_fmt(codec, ES_I2S_NORMAL);
     ret |= es8374_set_bits_per_sample(codec, fs->bits_per_sample);
+    ret |= audio_codec_ctrl_batch_end(codec->cfg.ctrl_if);
     return ESP_CODEC_DEV_OK;
 }
 
@@ -670,13 +677,17 @@ static int es8374_enable(const audio_codec_if_t *h, bool enable)
     if (codec->enabled == enable) {
         return ESP_CODEC_DEV_OK;
     }
+    audio_codec_ctrl_batch_begin(codec->cfg.ctrl_if);
     if (enable) {
         ret = es8374_start(codec);
+        // Registers must be set before PA power on
+        ret |= audio_codec_ctrl_batch_end(codec->cfg.ctrl_if);
         es8374_pa_power(codec, true);
     } else {
         es8374_pa_power(codec, false);
         ret = es8374_stop(codec);
         es8374_write_reg(codec, 0x00, 0x7F); // IC Reset and STOP
+        ret |= audio_codec_ctrl_batch_end(codec->cfg.ctrl_if);
     }
     if (ret == ESP_CODEC_DEV_OK) {
         codec->enabled = enable;
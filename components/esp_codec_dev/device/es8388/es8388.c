@@ -224,6 +224,8 @@ static int es8388_open(const audio_codec_if_t *h, void *cfg, int cfg_size)
     codec->pa_reverted = codec_cfg->pa_reverted;
     codec->codec_mode = codec_cfg->codec_mode;
 
+    // Send register table together when control interface support batch
+    audio_codec_ctrl_batch_begin(codec->ctrl_if);
     // 0x04 mute/0x00 unmute&ramp;
     res |= es8388_write_reg(codec, ES8388_DACCONTROL3, 0x04);
     /* Chip Control and Power Management */
@@ -272,6 +274,7 @@ static int es8388_open(const audio_codec_if_t *h, void *cfg, int cfg_size)
     // ALC for Microphone
     res |= es8388_set_adc_dac_volume(codec, ESP_CODEC_DEV_WORK_MODE_ADC, 0, 0); // 0db
     res |= es8388_write_reg(codec, ES8388_ADCPOWER, 0x09); // Power on ADC
+    res |= audio_codec_ctrl_batch_end(codec->ctrl_if);
     if (res != 0) {
         ESP_LOGI(TAG, "Fail to write register");
         return ESP_CODEC_DEV_WRITE_FAIL;
@@ -293,11 +296,14 @@ static int es8388_enable(const audio_codec_if_t *h, bool enable)
         return ESP_CODEC_DEV_OK;
     }
     int res;
+    audio_codec_ctrl_batch_begin(codec->ctrl_if);
     if (enable == false) {
         es8388_pa_power(codec, false);
         res = es8388_stop(codec, codec->codec_mode);
+        res |= audio_codec_ctrl_batch_end(codec->ctrl_if);
     } else {
         res = es8388_start(codec, codec->codec_mode);
+        res |= audio_codec_ctrl_batch_end(codec->ctrl_if);
         es8388_pa_power(codec, true);
     }
     if (res == ESP_CODEC_DEV_OK) {
@@ -346,8 +352,10 @@ static int es8388_set_fs(const audio_codec_if_t *h, esp_codec_dev_sample_info_t
         return ESP_CODEC_DEV_WRONG_STATE;
     }
     int res = 0;
+    audio_codec_ctrl_batch_begin(codec->ctrl_if);
     res |= es8388_config_fmt(codec, ESP_CODEC_DEV_WORK_MODE_BOTH, ES_I2S_NORMAL);
     res |= es8388_set_bits_per_sample(codec, ESP_CODEC_DEV_WORK_MODE_BOTH, fs->bits_per_sample);
+    res |= audio_codec_ctrl_batch_end(codec->ctrl_if);
     return res;
 }
 
@@ -15,6 +15,12 @@ extern "C" {
 
 #define ES7210_CODEC_DEFAULT_ADDR (0x80)
 
+/**
+ * @brief ES7210 uncached registers for `audio_codec_new_ctrl_cache`
+ *        Register 0x00 is the reset control, writing it restores other registers to defaults
+ */
+#define ES7210_CODEC_UNCACHED_REGS { 0x00 }
+
 #define ES7120_SEL_MIC1           (uint8_t)(1 << 0)
 #define ES7120_SEL_MIC2           (uint8_t)(1 << 1)
 #define ES7120_SEL_MIC3           (uint8_t)(1 << 2)
@@ -15,6 +15,12 @@ extern "C" {
 
 #define ES7243E_CODEC_DEFAULT_ADDR (0x20)
 
+/**
+ * @brief ES7243E uncached registers for `audio_codec_new_ctrl_cache`
+ *        Register 0x00 is the reset control
+ */
+#define ES7243E_CODEC_UNCACHED_REGS { 0x00 }
+
 /**
  * @brief ES7243E codec configuration
  */
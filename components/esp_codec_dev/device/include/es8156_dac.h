@@ -17,6 +17,12 @@ extern "C" {
 
 #define ES8156_CODEC_DEFAULT_ADDR (0x10)
 
+/**
+ * @brief ES8156 uncached registers for `audio_codec_new_ctrl_cache`
+ *        Register 0x00 is the reset control
+ */
+#define ES8156_CODEC_UNCACHED_REGS { 0x00 }
+
 /**
  * @brief ES8156 codec configuration
  */
@@ -17,6 +17,12 @@ extern "C" {
 
 #define ES8311_CODEC_DEFAULT_ADDR (0x30)
 
+/**
+ * @brief ES8311 uncached registers for `audio_codec_new_ctrl_cache`
+ *        Register 0x00 resets digital part, clock manager and state machine
+ */
+#define ES8311_CODEC_UNCACHED_REGS { 0x00 }
+
 /**
  * @brief ES8311 codec configuration
  */
@@ -17,6 +17,13 @@ extern "C" {
 
 #define TAS5805M_CODEC_DEFAULT_ADDR (0x5c)
 
+/**
+ * @brief TAS5805M uncached registers for `audio_codec_new_ctrl_cache`
+ *        Register 0x00 selects page and 0x7f selects book, so addresses alias across pages
+ *        Register 0x01 is the reset control
+ */
+#define TAS5805M_CODEC_UNCACHED_REGS { 0x00, 0x01, 0x7f }
+
 /**
  * @brief TAS5805M codec configuration
  */
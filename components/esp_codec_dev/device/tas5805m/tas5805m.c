@@ -53,13 +53,18 @@ static int tas5805m_transmit_registers(audio_codec_tas5805m_t *codec, const tas5
 {
     int i = 0;
     int ret = 0;
+    // Send register table together when control interface support batch
+    audio_codec_ctrl_batch_begin(codec->cfg.ctrl_if);
     while (i < size) {
         switch (conf_buf[i].offset) {
             case CFG_META_SWITCH:
                 // Used in legacy applications.  Ignored here.
                 break;
             case CFG_META_DELAY:
+                // Registers before delay must reach codec before waiting
+                audio_codec_ctrl_batch_end(codec->cfg.ctrl_if);
                 esp_codec_dev_sleep(conf_buf[i].value);
+                audio_codec_ctrl_batch_begin(codec->cfg.ctrl_if);
                 break;
             case CFG_META_BURST:
                 ret = tas5805m_write_data(codec, conf_buf[i + 1].offset, (uint8_t *) (&conf_buf[i + 1].value),
@@ -72,6 +77,9 @@ static int tas5805m_transmit_registers(audio_codec_tas5805m_t *codec, const tas5
         }
         i++;
     }
+    if (audio_codec_ctrl_batch_end(codec->cfg.ctrl_if) != ESP_CODEC_DEV_OK) {
+        ret = ESP_CODEC_DEV_WRITE_FAIL;
+    }
     if (ret != ESP_CODEC_DEV_OK) {
         ESP_LOGE(TAG, "Fail to load configuration to tas5805m");
         return ret;
@@ -9,11 +9,15 @@
 #include "audio_codec_if.h"
 #include "audio_codec_data_if.h"
 #include "audio_codec_sw_vol.h"
+#include "esp_codec_dev_os.h"
 #include "esp_log.h"
 
 #define TAG                 "Adev_Codec"
 
 #define VOL_TRANSITION_TIME (50)
+#define VOL_BUF_SIZE        (1536)
+#define VOL_TABLE_SIZE      (101)
+#define VOL_HW_STEP_MAX     (6.0)
 
 typedef struct {
     const audio_codec_if_t      *codec_if;
@@ -29,6 +33,20 @@ typedef struct {
     bool                         sw_vol_alloced;
     esp_codec_dev_vol_curve_t    vol_curve;
     bool                         disable_when_closed;
+    uint8_t                     *vol_buf;
+    int                          out_block_size;
+    esp_codec_dev_sample_info_t  fs;
+    float                       *vol_table;
+    void                        *vol_lock;
+    bool                         vol_split;
+    float                        hw_vol_step;
+    int                          hw_vol_delay;
+    float                        target_db;
+    bool                         target_pending;
+    float                        hw_vol_db;
+    float                        scheduled_hw_db;
+    bool                         hw_step_scheduled;
+    int                          hw_delay_left;
 } codec_dev_t;
 
 static bool _verify_codec_ready(codec_dev_t *dev)
@@ -112,6 +130,135 @@ static float _get_vol_db(esp_codec_dev_vol_curve_t *curve, int vol)
     return 0.0;
 }
 
+static void _update_vol_table(codec_dev_t *dev)
+{
+    // Volume to dB for volume 0 - 100 is precomputed when curve changed
+    if (dev->vol_table == NULL) {
+        dev->vol_table = (float *) malloc(VOL_TABLE_SIZE * sizeof(float));
+        if (dev->vol_table == NULL) {
+            return;
+        }
+    }
+    for (int i = 0; i < VOL_TABLE_SIZE; i++) {
+        dev->vol_table[i] = _get_vol_db(&dev->vol_curve, i);
+    }
+}
+
+static float _lookup_vol_db(codec_dev_t *dev, int vol)
+{
+    if (dev->vol_table && vol >= 0 && vol < VOL_TABLE_SIZE) {
+        return dev->vol_table[vol];
+    }
+    return _get_vol_db(&dev->vol_curve, vol);
+}
+
+static bool _vol_crossover_enabled(codec_dev_t *dev)
+{
+    return dev->vol_split && dev->sw_vol && dev->codec_if && dev->codec_if->set_vol;
+}
+
+static void _split_vol(float db_value, float hw_step, float *hw_db, float *sw_db)
+{
+    // Hardware takes whole steps not lower than target, software takes the residual attenuation
+    *hw_db = hw_step > 0 ? ceilf(db_value / hw_step) * hw_step : 0.0;
+    *sw_db = db_value - *hw_db;
+}
+
+static void _set_vol_direct(codec_dev_t *dev, float db_value)
+{
+    float hw_db, sw_db;
+    _split_vol(db_value, dev->hw_vol_step, &hw_db, &sw_db);
+    dev->codec_if->set_vol(dev->codec_if, hw_db);
+    dev->hw_vol_db = hw_db;
+    dev->sw_vol->set_vol(dev->sw_vol, sw_db);
+    if (dev->hw_vol_step == 0) {
+        dev->vol_split = false;
+    }
+}
+
+static void _plan_vol(codec_dev_t *dev, float db_value)
+{
+    if (dev->output_opened == false) {
+        // No writer running, apply directly
+        _set_vol_direct(dev, db_value);
+        return;
+    }
+    // Writer owns hardware and software split during playback, only post the target to it
+    esp_codec_dev_mutex_lock(dev->vol_lock);
+    dev->target_db = db_value;
+    dev->target_pending = true;
+    esp_codec_dev_mutex_unlock(dev->vol_lock);
+}
+
+static void _set_hw_vol(codec_dev_t *dev, float hw_db)
+{
+    // Register write goes through control interface (I2C or SPI) in the writer context
+    dev->codec_if->set_vol(dev->codec_if, hw_db);
+    dev->hw_vol_db = hw_db;
+}
+
+static void _apply_vol_plan(codec_dev_t *dev, int size)
+{
+    if (_vol_crossover_enabled(dev) == false) {
+        return;
+    }
+    int frames = dev->out_block_size > 0 ? size / dev->out_block_size : 0;
+    if (dev->hw_step_scheduled) {
+        // Data compensated for the new step starts playing once queued data before it drained
+        if (dev->hw_delay_left > 0) {
+            dev->hw_delay_left -= frames;
+            return;
+        }
+        dev->hw_step_scheduled = false;
+        _set_hw_vol(dev, dev->scheduled_hw_db);
+    }
+    esp_codec_dev_mutex_lock(dev->vol_lock);
+    bool pending = dev->target_pending;
+    float db_value = dev->target_db;
+    float hw_step = dev->hw_vol_step;
+    int delay_ms = dev->hw_vol_delay;
+    dev->target_pending = false;
+    esp_codec_dev_mutex_unlock(dev->vol_lock);
+    if (pending == false) {
+        return;
+    }
+    float hw_db, sw_db;
+    _split_vol(db_value, hw_step, &hw_db, &sw_db);
+    if (hw_db != dev->hw_vol_db) {
+        // Opposite jump in software from this buffer on, hardware follows when this buffer reaches DAC
+        audio_codec_sw_vol_scale(dev->sw_vol, dev->hw_vol_db - hw_db);
+        int delay = (int) ((int64_t) dev->fs.sample_rate * delay_ms / 1000);
+        if (delay > 0) {
+            dev->scheduled_hw_db = hw_db;
+            dev->hw_step_scheduled = true;
+            dev->hw_delay_left = delay - frames;
+        } else {
+            _set_hw_vol(dev, hw_db);
+        }
+    }
+    dev->sw_vol->set_vol(dev->sw_vol, sw_db);
+}
+
+static void _flush_vol_plan(codec_dev_t *dev)
+{
+    // Called when no data is being written, so no need to compensate
+    if (_vol_crossover_enabled(dev) == false) {
+        return;
+    }
+    if (dev->hw_step_scheduled) {
+        dev->hw_step_scheduled = false;
+        _set_hw_vol(dev, dev->scheduled_hw_db);
+    }
+    esp_codec_dev_mutex_lock(dev->vol_lock);
+    bool pending = dev->target_pending;
+    float db_value = dev->target_db;
+    dev->target_pending = false;
+    esp_codec_dev_mutex_unlock(dev->vol_lock);
+    if (pending) {
+        _set_vol_direct(dev, db_value);
+    }
+}
+
 static void _update_codec_setting(codec_dev_t *dev)
 {
     esp_codec_dev_handle_t h = (esp_codec_dev_handle_t) dev;
@@ -138,7 +285,13 @@ esp_codec_dev_handle_t esp_codec_dev_new(esp_codec_dev_cfg_t *cfg)
     dev->codec_if = cfg->codec_if;
     dev->data_if = cfg->data_if;
     if (cfg->dev_type & ESP_CODEC_DEV_TYPE_OUT) {
+        dev->vol_lock = esp_codec_dev_mutex_create();
+        if (dev->vol_lock == NULL) {
+            free(dev);
+            return NULL;
+        }
         _get_default_vol_curve(&dev->vol_curve);
+        _update_vol_table(dev);
     }
     dev->disable_when_closed = true;
     return (esp_codec_dev_handle_t) dev;
@@ -176,7 +329,12 @@ int esp_codec_dev_open(esp_codec_dev_handle_t handle, esp_codec_dev_sample_info_
     const audio_codec_if_t *codec = dev->codec_if;
     const audio_codec_data_if_t *data_if = dev->data_if;
     if (data_if->set_fmt) {
-        data_if->set_fmt(data_if, dev->dev_caps, fs);
+        int ret = data_if->set_fmt(data_if, dev->dev_caps, fs);
+        if (ret != ESP_CODEC_DEV_OK) {
+            ESP_LOGE(TAG, "Fail to set data format ret %d", ret);
+            dev->input_opened = dev->output_opened = false;
+            return ret;
+        }
     }
     if (data_if->enable) {
         data_if->enable(data_if, dev->dev_caps, true);
@@ -196,7 +354,7 @@ int esp_codec_dev_open(esp_codec_dev_handle_t handle, esp_codec_dev_sample_info_
         }
     }
     if (dev->output_opened) {
-        if (codec == NULL || codec->set_vol == NULL) {
+        if (codec == NULL || codec->set_vol == NULL || dev->vol_split) {
             if (dev->sw_vol == NULL) {
                 dev->sw_vol = audio_codec_new_sw_vol();
                 dev->sw_vol_alloced = true;
@@ -205,13 +363,71 @@ int esp_codec_dev_open(esp_codec_dev_handle_t handle, esp_codec_dev_sample_info_
         if (dev->sw_vol) {
             dev->sw_vol->open(dev->sw_vol, fs, VOL_TRANSITION_TIME);
         }
+        dev->out_block_size = (fs->bits_per_sample * fs->channel) >> 3;
     }
+    memcpy(&dev->fs, fs, sizeof(esp_codec_dev_sample_info_t));
     // update settings to avoid lost after re-enable
     _update_codec_setting(dev);
+    _flush_vol_plan(dev);
     ESP_LOGI(TAG, "Open codec device OK");
     return ESP_CODEC_DEV_OK;
 }
 
+int esp_codec_dev_reconfigure(esp_codec_dev_handle_t handle, esp_codec_dev_sample_info_t *fs)
+{
+    codec_dev_t *dev = (codec_dev_t *) handle;
+    if (dev == NULL || fs == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    if (dev->input_opened == false && dev->output_opened == false) {
+        return ESP_CODEC_DEV_WRONG_STATE;
+    }
+    bool rate_changed = (fs->sample_rate != dev->fs.sample_rate);
+    bool layout_changed = (fs->bits_per_sample != dev->fs.bits_per_sample || fs->channel != dev->fs.channel ||
+                           fs->channel_mask != dev->fs.channel_mask);
+    if (rate_changed == false && layout_changed == false) {
+        return ESP_CODEC_DEV_OK;
+    }
+    // Only clock and slot settings are changed, codec keeps enabled and volume settings kept in registers
+    const audio_codec_data_if_t *data_if = dev->data_if;
+    int ret = ESP_CODEC_DEV_OK;
+    if (data_if->set_fmt) {
+        ret = data_if->set_fmt(data_if, dev->dev_caps, fs);
+        if (ret != ESP_CODEC_DEV_OK) {
+            ESP_LOGE(TAG, "Fail to set data format ret %d", ret);
+            return ret;
+        }
+    }
+    if (data_if->enable) {
+        data_if->enable(data_if, dev->dev_caps, true);
+    }
+    const audio_codec_if_t *codec = dev->codec_if;
+    if (codec && codec->set_fs) {
+        ret = codec->set_fs(codec, fs);
+        if (ret != ESP_CODEC_DEV_OK) {
+            ESP_LOGE(TAG, "Fail to set codec format ret %d", ret);
+            // Roll data interface back so that it still matches the codec
+            if (data_if->set_fmt) {
+                data_if->set_fmt(data_if, dev->dev_caps, &dev->fs);
+            }
+            if (data_if->enable) {
+                data_if->enable(data_if, dev->dev_caps, true);
+            }
+            return ret;
+        }
+    }
+    if (dev->output_opened) {
+        if (layout_changed && dev->sw_vol) {
+            dev->sw_vol->open(dev->sw_vol, fs, VOL_TRANSITION_TIME);
+        }
+        dev->out_block_size = (fs->bits_per_sample * fs->channel) >> 3;
+    }
+    memcpy(&dev->fs, fs, sizeof(esp_codec_dev_sample_info_t));
+    ESP_LOGD(TAG, "Reconfigure to %d Hz %d bits %d channel", (int) fs->sample_rate, fs->bits_per_sample,
+             fs->channel);
+    return ESP_CODEC_DEV_OK;
+}
+
 int esp_codec_dev_read(esp_codec_dev_handle_t handle, void *data, int len)
 {
     codec_dev_t *dev = (codec_dev_t *) handle;
@@ -241,6 +457,7 @@ int esp_codec_dev_write(esp_codec_dev_handle_t handle, void *data, int len)
     if (data_if->write) {
         // Soft volume process firstly
         if (dev->sw_vol) {
+            _apply_vol_plan(dev, len);
             dev->sw_vol->process(dev->sw_vol, (uint8_t *) data, len, (uint8_t *) data, len);
         }
         return data_if->write(data_if, (uint8_t *) data, len);
@@ -248,6 +465,100 @@ int esp_codec_dev_write(esp_codec_dev_handle_t handle, void *data, int len)
     return ESP_CODEC_DEV_NOT_SUPPORT;
 }
 
+int esp_codec_dev_read_async(esp_codec_dev_handle_t handle, void *data, int len,
+                             audio_codec_data_done_cb_t done, void *ctx)
+{
+    codec_dev_t *dev = (codec_dev_t *) handle;
+    if (dev == NULL || data == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    if (dev->input_opened == false) {
+        return ESP_CODEC_DEV_WRONG_STATE;
+    }
+    const audio_codec_data_if_t *data_if = dev->data_if;
+    if (data_if->read_async) {
+        return data_if->read_async(data_if, (uint8_t *) data, len, done, ctx);
+    }
+    // Fallback to blocking read when data interface not support
+    if (data_if->read == NULL) {
+        return ESP_CODEC_DEV_NOT_SUPPORT;
+    }
+    int ret = data_if->read(data_if, (uint8_t *) data, len);
+    if (done) {
+        done(data_if, (uint8_t *) data, len, ret, ctx);
+    }
+    return ESP_CODEC_DEV_OK;
+}
+
+int esp_codec_dev_write_async(esp_codec_dev_handle_t handle, void *data, int len,
+                              audio_codec_data_done_cb_t done, void *ctx)
+{
+    codec_dev_t *dev = (codec_dev_t *) handle;
+    if (dev == NULL || data == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    if (dev->output_opened == false) {
+        return ESP_CODEC_DEV_WRONG_STATE;
+    }
+    const audio_codec_data_if_t *data_if = dev->data_if;
+    if (data_if->write_async == NULL && data_if->write == NULL) {
+        return ESP_CODEC_DEV_NOT_SUPPORT;
+    }
+    // Volume is processed in submit order so that ramp keeps continuous
+    if (dev->sw_vol) {
+        _apply_vol_plan(dev, len);
+        dev->sw_vol->process(dev->sw_vol, (uint8_t *) data, len, (uint8_t *) data, len);
+    }
+    if (data_if->write_async) {
+        return data_if->write_async(data_if, (uint8_t *) data, len, done, ctx);
+    }
+    int ret = data_if->write(data_if, (uint8_t *) data, len);
+    if (done) {
+        done(data_if, (uint8_t *) data, len, ret, ctx);
+    }
+    return ESP_CODEC_DEV_OK;
+}
+
+int esp_codec_dev_write_const(esp_codec_dev_handle_t handle, const void *data, int len)
+{
+    codec_dev_t *dev = (codec_dev_t *) handle;
+    if (dev == NULL || data == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    if (dev->output_opened == false) {
+        return ESP_CODEC_DEV_WRONG_STATE;
+    }
+    const audio_codec_data_if_t *data_if = dev->data_if;
+    if (data_if->write == NULL) {
+        return ESP_CODEC_DEV_NOT_SUPPORT;
+    }
+    if (dev->sw_vol == NULL) {
+        return data_if->write(data_if, (uint8_t *) data, len);
+    }
+    if (dev->vol_buf == NULL) {
+        dev->vol_buf = (uint8_t *) malloc(VOL_BUF_SIZE);
+        if (dev->vol_buf == NULL) {
+            return ESP_CODEC_DEV_NO_MEM;
+        }
+    }
+    // Process into internal buffer by whole frames so that ramp and channels keep aligned
+    int block = dev->out_block_size > 0 ? dev->out_block_size : 1;
+    int max_size = VOL_BUF_SIZE / block * block;
+    const uint8_t *src = (const uint8_t *) data;
+    while (len > 0) {
+        int size = len > max_size ? max_size : len;
+        _apply_vol_plan(dev, size);
+        dev->sw_vol->process(dev->sw_vol, (uint8_t *) src, size, dev->vol_buf, size);
+        int ret = data_if->write(data_if, dev->vol_buf, size);
+        if (ret != ESP_CODEC_DEV_OK) {
+            return ret;
+        }
+        src += size;
+        len -= size;
+    }
+    return ESP_CODEC_DEV_OK;
+}
+
 int esp_codec_dev_set_vol_curve(esp_codec_dev_handle_t handle, esp_codec_dev_vol_curve_t *curve)
 {
     codec_dev_t *dev = (codec_dev_t *) handle;
@@ -266,6 +577,7 @@ int esp_codec_dev_set_vol_curve(esp_codec_dev_handle_t handle, esp_codec_dev_vol
     dev->vol_curve.vol_map = new_map;
     memcpy(dev->vol_curve.vol_map, curve->vol_map, size);
     dev->vol_curve.count = curve->count;
+    _update_vol_table(dev);
     return ESP_CODEC_DEV_OK;
 }
 
@@ -280,8 +592,12 @@ int esp_codec_dev_set_out_vol(esp_codec_dev_handle_t handle, int volume)
         return ret;
     }
     const audio_codec_if_t *codec = dev->codec_if;
-    float db_value = _get_vol_db(&dev->vol_curve, volume);
+    float db_value = _lookup_vol_db(dev, volume);
     dev->volume = volume;
+    if (_vol_crossover_enabled(dev)) {
+        _plan_vol(dev, db_value);
+        return ESP_CODEC_DEV_OK;
+    }
     // Prefer to use software volume setting
     if (dev->sw_vol) {
         dev->sw_vol->set_vol(dev->sw_vol, db_value);
@@ -294,6 +610,45 @@ int esp_codec_dev_set_out_vol(esp_codec_dev_handle_t handle, int volume)
     return ESP_CODEC_DEV_NOT_SUPPORT;
 }
 
+int esp_codec_dev_set_vol_crossover(esp_codec_dev_handle_t handle, float hw_step_db, int out_delay_ms)
+{
+    codec_dev_t *dev = (codec_dev_t *) handle;
+    if (dev == NULL || hw_step_db < 0 || hw_step_db > VOL_HW_STEP_MAX || out_delay_ms < 0) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    int ret = _verify_codec_setting(dev, true);
+    if (ret != ESP_CODEC_DEV_OK) {
+        return ret;
+    }
+    const audio_codec_if_t *codec = dev->codec_if;
+    if (codec == NULL || codec->set_vol == NULL) {
+        return ESP_CODEC_DEV_NOT_SUPPORT;
+    }
+    // Compensation jump needs internal software volume
+    if (hw_step_db > 0 && dev->sw_vol && dev->sw_vol_alloced == false) {
+        ESP_LOGE(TAG, "Crossover not support customized volume handler");
+        return ESP_CODEC_DEV_NOT_SUPPORT;
+    }
+    if (dev->output_opened && dev->sw_vol == NULL) {
+        dev->sw_vol = audio_codec_new_sw_vol();
+        if (dev->sw_vol == NULL) {
+            return ESP_CODEC_DEV_NO_MEM;
+        }
+        dev->sw_vol_alloced = true;
+        dev->sw_vol->open(dev->sw_vol, &dev->fs, VOL_TRANSITION_TIME);
+    }
+    esp_codec_dev_mutex_lock(dev->vol_lock);
+    dev->hw_vol_step = hw_step_db;
+    dev->hw_vol_delay = out_delay_ms;
+    esp_codec_dev_mutex_unlock(dev->vol_lock);
+    // When disabled, hardware goes back to 0dB through the same compensated path
+    if (hw_step_db > 0 || dev->vol_split) {
+        dev->vol_split = true;
+        return esp_codec_dev_set_out_vol(handle, dev->volume);
+    }
+    return ESP_CODEC_DEV_OK;
+}
+
 int esp_codec_dev_set_vol_handler(esp_codec_dev_handle_t handle, const audio_codec_vol_if_t *vol_handler)
 {
     codec_dev_t *dev = (codec_dev_t *) handle;
@@ -307,6 +662,10 @@ int esp_codec_dev_set_vol_handler(esp_codec_dev_handle_t handle, const audio_cod
     if (dev->sw_vol == vol_handler) {
         return ESP_CODEC_DEV_OK;
     }
+    if (dev->vol_split) {
+        ESP_LOGE(TAG, "Customized volume handler not support crossover");
+        return ESP_CODEC_DEV_NOT_SUPPORT;
+    }
     if (dev->sw_vol) {
         if (dev->sw_vol_alloced) {
             audio_codec_delete_vol_if(dev->sw_vol);
@@ -485,6 +844,9 @@ int esp_codec_dev_close(esp_codec_dev_handle_t handle)
     if (dev->sw_vol) {
         dev->sw_vol->close(dev->sw_vol);
     }
+    if (dev->output_opened) {
+        _flush_vol_plan(dev);
+    }
     dev->output_opened = dev->input_opened = false;
     return ESP_CODEC_DEV_OK;
 }
@@ -497,10 +859,19 @@ void esp_codec_dev_delete(esp_codec_dev_handle_t handle)
         if (dev->vol_curve.vol_map) {
             free(dev->vol_curve.vol_map);
         }
+        if (dev->vol_table) {
+            free(dev->vol_table);
+        }
         // Only delete software vol when alloced internally
         if (dev->sw_vol && dev->sw_vol_alloced) {
             audio_codec_delete_vol_if(dev->sw_vol);
         }
+        if (dev->vol_buf) {
+            free(dev->vol_buf);
+        }
+        if (dev->vol_lock) {
+            esp_codec_dev_mutex_delete(dev->vol_lock);
+        }
         free(dev);
     }
 }
@@ -37,6 +37,39 @@ int audio_codec_delete_ctrl_if(const audio_codec_ctrl_if_t *h)
     return ESP_CODEC_DEV_INVALID_ARG;
 }
 
+int audio_codec_ctrl_batch_begin(const audio_codec_ctrl_if_t *h)
+{
+    if (h == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    return h->batch ? h->batch(h, true) : ESP_CODEC_DEV_OK;
+}
+
+int audio_codec_ctrl_batch_end(const audio_codec_ctrl_if_t *h)
+{
+    if (h == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    return h->batch ? h->batch(h, false) : ESP_CODEC_DEV_OK;
+}
+
+int audio_codec_ctrl_update_bits(const audio_codec_ctrl_if_t *h, int reg, int reg_len, uint8_t mask, uint8_t value)
+{
+    if (h == NULL || h->read_reg == NULL || h->write_reg == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    uint8_t old = 0;
+    int ret = h->read_reg(h, reg, reg_len, &old, 1);
+    if (ret != ESP_CODEC_DEV_OK) {
+        return ret;
+    }
+    uint8_t new_value = (old & ~mask) | (value & mask);
+    if (new_value == old) {
+        return ESP_CODEC_DEV_OK;
+    }
+    return h->write_reg(h, reg, reg_len, &new_value, 1);
+}
+
 int audio_codec_delete_data_if(const audio_codec_data_if_t *h)
 {
     if (h) {
@@ -0,0 +1,56 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef _AUDIO_CODEC_CTRL_CACHE_H_
+#define _AUDIO_CODEC_CTRL_CACHE_H_
+
+#include "audio_codec_ctrl_if.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Register cache control configuration
+ */
+typedef struct {
+    const audio_codec_ctrl_if_t *bus_if;        /*!< Control interface to access codec registers (I2C or SPI) */
+    bool                         burst;         /*!< Codec auto increases register address, consecutive writes in batch
+                                                     are sent in one transaction */
+    const uint8_t               *uncached_regs; /*!< Registers always accessed through bus, write to them drops whole cache
+                                                     Must list status, software reset, page and book select registers,
+                                                     codec drivers provide them as `<CODEC>_CODEC_UNCACHED_REGS` */
+    int                          uncached_num;  /*!< Number of uncached registers */
+} audio_codec_ctrl_cache_cfg_t;
+
+/**
+ * @brief         New control interface with register cache
+ *                Notes: it wraps `bus_if` and keep shadow value of one byte address registers
+ *                       Write with same value as cached is skipped, read of cached register not access bus
+ *                       Supports batch so that codec driver can send register table together
+ *                       Registers must only be accessed through this interface after created
+ *                       Cache is keyed by one byte address only, for paged codecs it is correct only when the page
+ *                       and book registers are uncached so that switching page drops the cache
+ *                       `bus_if` is not deleted when delete this interface
+ * @param         cfg: Cache configuration
+ * @return        NULL: Wrong configuration or memory not enough
+ *                -Others: Control interface with cache
+ */
+const audio_codec_ctrl_if_t *audio_codec_new_ctrl_cache(audio_codec_ctrl_cache_cfg_t *cfg);
+
+/**
+ * @brief         Drop all cached register values
+ *                Notes: call it after codec reset by hardware (power or reset pin)
+ * @param         ctrl_if: Control interface created by `audio_codec_new_ctrl_cache`
+ * @return        ESP_CODEC_DEV_OK: Drop success
+ *                ESP_CODEC_DEV_INVALID_ARG: Input is NULL pointer
+ */
+int audio_codec_ctrl_cache_invalidate(const audio_codec_ctrl_if_t *ctrl_if);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,39 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef _AUDIO_CODEC_SW_VOL_H_
+#define _AUDIO_CODEC_SW_VOL_H_
+
+#include "audio_codec_vol_if.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief         New software volume processor interface
+ *                Notes: support 16bits, 24bits (packed) and 32bits input, output saturates when gain is above 0dB
+ *                       Gain ramps in blocks of 16 frames, output buffer can be same as input or another one
+ * @return        NULL: Memory not enough
+ *                -Others: Software volume interface handle
+ */
+const audio_codec_vol_if_t* audio_codec_new_sw_vol(void);
+
+/**
+ * @brief         Scale current gain of software volume at once, ramp target is not changed
+ *                Notes: used to compensate a gain step made in hardware so that output level keeps continuous
+ *                       Gain ramps from scaled value to target afterwards
+ * @param         h: Software volume interface created by `audio_codec_new_sw_vol`
+ * @param         db_value: Gain to scale (unit dB)
+ * @return        ESP_CODEC_DEV_OK: Scale success
+ *                ESP_CODEC_DEV_INVALID_ARG: Invalid arguments
+ */
+int audio_codec_sw_vol_scale(const audio_codec_vol_if_t *h, float db_value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -54,6 +54,22 @@ esp_codec_dev_handle_t esp_codec_dev_new(esp_codec_dev_cfg_t *codec_dev_cfg);
  */
 int esp_codec_dev_open(esp_codec_dev_handle_t codec, esp_codec_dev_sample_info_t *fs);
 
+/**
+ * @brief         Change audio sample information of opened codec device
+ *                Notes: only data interface clock and slot settings and codec clock dividers are updated
+ *                       Codec is not reopened or re-enabled, volume and mute settings are kept
+ *                       Do nothing if sample information not changed
+ *                       Read or write running in other task is finished before reconfiguration
+ * @param         codec: Codec device handle
+ * @param         fs: New audio sample information
+ * @return        ESP_CODEC_DEV_OK: Reconfigure success
+ *                ESP_CODEC_DEV_INVALID_ARG: Invalid arguments
+ *                ESP_CODEC_DEV_WRONG_STATE: Codec device not opened
+ *                ESP_CODEC_DEV_NOT_SUPPORT: Sample information not supported
+ *                Others: Error returned by data interface or codec driver, previous setting is restored
+ */
+int esp_codec_dev_reconfigure(esp_codec_dev_handle_t codec, esp_codec_dev_sample_info_t *fs);
+
 /**
  * @brief         Read data from codec
  * @param         codec: Codec device handle
@@ -80,6 +96,56 @@ int esp_codec_dev_read(esp_codec_dev_handle_t codec, void *data, int len);
  */
 int esp_codec_dev_write(esp_codec_dev_handle_t codec, void *data, int len);
 
+/**
+ * @brief         Submit buffer to read from codec and return without waiting
+ *                Notes: `done` is called from driver task when buffer is filled, keep buffer valid until then
+ *                When data interface not support asynchronous read, it reads directly and calls `done` before return
+ * @param         codec: Codec device handle
+ * @param         data: Buffer to be filled
+ * @param         len: Data length to be read
+ * @param         done: Callback when read finished
+ * @param         ctx: User context for callback
+ * @return        ESP_CODEC_DEV_OK: Submit success
+ *                ESP_CODEC_DEV_INVALID_ARG: Invalid arguments
+ *                ESP_CODEC_DEV_NOT_SUPPORT: Codec not support
+ *                ESP_CODEC_DEV_WRONG_STATE: Driver not open yet
+ */
+int esp_codec_dev_read_async(esp_codec_dev_handle_t codec, void *data, int len,
+                             audio_codec_data_done_cb_t done, void *ctx);
+
+/**
+ * @brief         Submit data to write to codec and return without waiting
+ *                Notes: software volume is processed on input data directly before submit
+ *                `done` is called from driver task when buffer can be reused, so that caller can fill next buffer while DMA runs
+ *                When data interface not support asynchronous write, it writes directly and calls `done` before return
+ * @param         codec: Codec device handle
+ * @param         data: Data to be wrote
+ * @param         len: Data length to be wrote
+ * @param         done: Callback when write finished
+ * @param         ctx: User context for callback
+ * @return        ESP_CODEC_DEV_OK: Submit success
+ *                ESP_CODEC_DEV_INVALID_ARG: Invalid arguments
+ *                ESP_CODEC_DEV_NOT_SUPPORT: Codec not support
+ *                ESP_CODEC_DEV_WRONG_STATE: Driver not open yet
+ */
+int esp_codec_dev_write_async(esp_codec_dev_handle_t codec, void *data, int len,
+                              audio_codec_data_done_cb_t done, void *ctx);
+
+/**
+ * @brief         Write data to codec without changing input data
+ *                Notes: when enable software volume, data is processed into internal buffer then wrote
+ *                It is useful when input data is read only or shared with others
+ * @param         codec: Codec device handle
+ * @param         data: Data to be wrote
+ * @param         len: Data length to be wrote
+ * @return        ESP_CODEC_DEV_OK: Write success
+ *                ESP_CODEC_DEV_INVALID_ARG: Invalid arguments
+ *                ESP_CODEC_DEV_NOT_SUPPORT: Codec not support
+ *                ESP_CODEC_DEV_WRONG_STATE: Driver not open yet
+ *                ESP_CODEC_DEV_NO_MEM: Not enough memory for internal buffer
+ */
+int esp_codec_dev_write_const(esp_codec_dev_handle_t codec, const void *data, int len);
+
 /**
  * @brief         Set codec hardware gain
  * @param         codec: Codec device handle
@@ -99,11 +165,34 @@ int esp_codec_dev_set_out_vol(esp_codec_dev_handle_t codec, int volume);
  * @param         vol_handler: Software volume process interface
  * @return        ESP_CODEC_DEV_OK: Set volume handler success
  *                ESP_CODEC_DEV_INVALID_ARG: Invalid arguments
- *                ESP_CODEC_DEV_NOT_SUPPORT: Codec not support output mode
+ *                ESP_CODEC_DEV_NOT_SUPPORT: Codec not support output mode or volume crossover is enabled
  *                ESP_CODEC_DEV_WRONG_STATE: Driver not open yet
  */
 int esp_codec_dev_set_vol_handler(esp_codec_dev_handle_t codec, const audio_codec_vol_if_t* vol_handler);
 
+/**
+ * @brief         Split output volume between codec hardware volume and software volume
+ *                Notes: codec volume is set in whole steps of `hw_step_db` not lower than the target
+ *                       Software volume takes the fine residual (-hw_step_db to 0dB) and ramps it
+ *                       During playback volume is only posted, the writer applies it at next buffer boundary
+ *                       When hardware step changes, software gain jumps opposite from that buffer on, and the codec
+ *                       register is written once `out_delay_ms` of data is written after it, when it reaches DAC
+ *                       `out_delay_ms` should cover data queued after write (DMA buffers and async queue)
+ *                       Alignment error is less than one written buffer, use small writes for better alignment
+ *                       Register is written through control interface (I2C or SPI) in the caller of write API
+ *                       Not support customized volume handler set by `esp_codec_dev_set_vol_handler`
+ * @param         codec: Codec device handle
+ * @param         hw_step_db: Hardware volume step (unit dB, max 6dB), set to 0 to use software volume only
+ * @param         out_delay_ms: Output latency from write to DAC (unit ms), 0 to write register directly
+ * @return        ESP_CODEC_DEV_OK: Set crossover success
+ *                ESP_CODEC_DEV_INVALID_ARG: Invalid arguments
+ *                ESP_CODEC_DEV_NOT_SUPPORT: Codec not support output mode or hardware volume,
+ *                                           or customized volume handler is used
+ *                ESP_CODEC_DEV_WRONG_STATE: Driver not open yet
+ *                ESP_CODEC_DEV_NO_MEM: Not enough memory for software volume
+ */
+int esp_codec_dev_set_vol_crossover(esp_codec_dev_handle_t codec, float hw_step_db, int out_delay_ms);
+
 /**
  * @brief         Set codec volume curve
  *                Notes: When volume curve not provided, it will use internally volume curve which is:
@@ -0,0 +1,84 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef _ESP_CODEC_DEV_MIXER_H_
+#define _ESP_CODEC_DEV_MIXER_H_
+
+#include "esp_codec_dev.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_CODEC_DEV_MIXER_MAX_INPUT (4)
+
+/**
+ * @brief Software mixer configuration
+ *        Notes: mixer task mixes all enabled inputs every `frame_ms` and writes result into `out_dev`
+ *               `out_dev` need opened with `fs` before create mixer
+ */
+typedef struct {
+    esp_codec_dev_handle_t      out_dev;    /*!< Output codec device which mixed data write to */
+    esp_codec_dev_sample_info_t fs;         /*!< Output format, support 16 or 32 bits, 1 or 2 channels */
+    int                         frame_ms;   /*!< Mix period (unit ms), set 0 to use default 10ms */
+    float                       duck_db;    /*!< Gain applied on other inputs when ducking input is playing */
+    int                         duck_ms;    /*!< Ducking transition time (unit ms) */
+    int                         task_prio;  /*!< Priority of mixer task */
+    int                         task_core;  /*!< Core of mixer task, -1 for no affinity */
+    int                         task_stack; /*!< Stack size of mixer task */
+} esp_codec_dev_mixer_cfg_t;
+
+/**
+ * @brief Software mixer input configuration
+ */
+typedef struct {
+    int  buffer_ms;    /*!< Buffer time of this input (unit ms), writer blocks when buffer full */
+    int  prebuffer_ms; /*!< Data buffered (unit ms) before input is mixed, again after each underrun
+                            set 0 to use one mix period, limited to `buffer_ms` minus one mix period */
+    bool duck_others;  /*!< Duck other inputs when this input has data, use for notification or prompt */
+} esp_codec_dev_mixer_input_cfg_t;
+
+/**
+ * @brief Software mixer handle
+ */
+typedef void *esp_codec_dev_mixer_handle_t;
+
+/**
+ * @brief         New software mixer
+ * @param         cfg: Mixer configuration
+ * @return        NULL: Wrong configuration or not enough memory
+ *                -Others: Mixer handle
+ */
+esp_codec_dev_mixer_handle_t esp_codec_dev_mixer_new(esp_codec_dev_mixer_cfg_t *cfg);
+
+/**
+ * @brief         New mixer input as codec data interface
+ *                Notes: create a virtual codec device by `esp_codec_dev_new` using this data interface (set `codec_if` to NULL)
+ *                Each virtual device can write with its own sample format (16 or 32 bits, 1 or 2 channels, same sample rate as mixer)
+ *                And has its own software volume through `esp_codec_dev_set_out_vol`
+ *                Delete it through `audio_codec_delete_data_if` after virtual device deleted
+ * @param         mixer: Mixer handle
+ * @param         cfg: Input configuration
+ * @return        NULL: Reach max input number or not enough memory
+ *                -Others: Codec data interface
+ */
+const audio_codec_data_if_t *esp_codec_dev_mixer_new_input(esp_codec_dev_mixer_handle_t mixer,
+                                                           esp_codec_dev_mixer_input_cfg_t *cfg);
+
+/**
+ * @brief         Delete software mixer
+ *                Notes: all inputs need deleted before
+ * @param         mixer: Mixer handle
+ * @return        ESP_CODEC_DEV_OK: Delete success
+ *                ESP_CODEC_DEV_INVALID_ARG: Invalid arguments
+ *                ESP_CODEC_DEV_WRONG_STATE: Some input not deleted yet
+ */
+int esp_codec_dev_mixer_delete(esp_codec_dev_mixer_handle_t mixer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
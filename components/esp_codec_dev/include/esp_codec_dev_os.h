@@ -16,6 +16,31 @@ extern "C" {
  */
 void esp_codec_dev_sleep(int ms);
 
+/**
+ * @brief         Create mutex
+ * @return        NULL: Not enough memory
+ *                Others: Mutex handle
+ */
+void *esp_codec_dev_mutex_create(void);
+
+/**
+ * @brief         Lock mutex, wait until got
+ * @param         mutex: Mutex handle
+ */
+void esp_codec_dev_mutex_lock(void *mutex);
+
+/**
+ * @brief         Unlock mutex
+ * @param         mutex: Mutex handle
+ */
+void esp_codec_dev_mutex_unlock(void *mutex);
+
+/**
+ * @brief         Delete mutex
+ * @param         mutex: Mutex handle
+ */
+void esp_codec_dev_mutex_delete(void *mutex);
+
 #ifdef __cplusplus
 }
 #endif
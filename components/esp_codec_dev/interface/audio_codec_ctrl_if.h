@@ -25,6 +25,7 @@ struct audio_codec_ctrl_if_t {
     int (*write_reg)(const audio_codec_ctrl_if_t *ctrl,
                       int reg, int reg_len, void *data, int data_len);       /*!< Write data to codec device register */
     int (*close)(const audio_codec_ctrl_if_t *ctrl);                         /*!< Close codec control interface */
+    int (*batch)(const audio_codec_ctrl_if_t *ctrl, bool start);             /*!< Start to queue register writes or flush them (optional) */
 };
 
 /**
@@ -35,6 +36,42 @@ struct audio_codec_ctrl_if_t {
  */
 int audio_codec_delete_ctrl_if(const audio_codec_ctrl_if_t *ctrl_if);
 
+/**
+ * @brief         Start to batch register writes
+ *                Notes: when control interface supports batch, writes are queued and sent together when batch end
+ *                Batch can be nested, writes are sent when outermost batch end
+ *                Do not put delay between register writes into batch
+ * @param         ctrl_if: Audio codec interface
+ * @return        ESP_CODEC_DEV_OK: Start success or batch not supported
+ *                ESP_CODEC_DEV_INVALID_ARG: Input is NULL pointer
+ */
+int audio_codec_ctrl_batch_begin(const audio_codec_ctrl_if_t *ctrl_if);
+
+/**
+ * @brief         End batch and send queued register writes
+ * @param         ctrl_if: Audio codec interface
+ * @return        ESP_CODEC_DEV_OK: All queued writes success or batch not supported
+ *                ESP_CODEC_DEV_INVALID_ARG: Input is NULL pointer
+ *                ESP_CODEC_DEV_WRITE_FAIL: Fail to write some registers
+ */
+int audio_codec_ctrl_batch_end(const audio_codec_ctrl_if_t *ctrl_if);
+
+/**
+ * @brief         Update bits of one byte register
+ *                Notes: register is not wrote when value not changed
+ *                       Register is not wrote either when read fail, unlike drivers which write it with
+ *                       read value treated as 0
+ * @param         ctrl_if: Audio codec interface
+ * @param         reg: Register address
+ * @param         reg_len: Register address length
+ * @param         mask: Bits to be updated
+ * @param         value: New value of bits
+ * @return        ESP_CODEC_DEV_OK: Update success
+ *                ESP_CODEC_DEV_INVALID_ARG: Input is NULL pointer
+ *                Others: Fail to read or write register
+ */
+int audio_codec_ctrl_update_bits(const audio_codec_ctrl_if_t *ctrl_if, int reg, int reg_len, uint8_t mask, uint8_t value);
+
 #ifdef __cplusplus
 }
 #endif
@@ -14,6 +14,12 @@ extern "C" {
 
 typedef struct audio_codec_data_if_t audio_codec_data_if_t;
 
+/**
+ * @brief Callback when asynchronous read or write is done
+ *        Notes: `data` can be reused by caller after this callback, `ret` is the result of the transfer
+ */
+typedef void (*audio_codec_data_done_cb_t)(const audio_codec_data_if_t *h, uint8_t *data, int size, int ret, void *ctx);
+
 /**
  * @brief Audio codec data interface structure
  */
@@ -29,6 +35,10 @@ struct audio_codec_data_if_t {
     int (*read)(const audio_codec_data_if_t *h, uint8_t *data, int size);  /*!< Read data from data interface */
     int (*write)(const audio_codec_data_if_t *h, uint8_t *data, int size); /*!< Write data to data interface */
     int (*close)(const audio_codec_data_if_t *h);                          /*!< Close data interface */
+    int (*read_async)(const audio_codec_data_if_t *h, uint8_t *data, int size,
+                      audio_codec_data_done_cb_t done, void *ctx);          /*!< Submit buffer to read and return directly (optional) */
+    int (*write_async)(const audio_codec_data_if_t *h, uint8_t *data, int size,
+                       audio_codec_data_done_cb_t done, void *ctx);         /*!< Submit buffer to write and return directly (optional) */
 };
 
 /**
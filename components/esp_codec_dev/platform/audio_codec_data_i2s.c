@@ -8,6 +8,10 @@
 #include "audio_codec_data_if.h"
 #include "esp_codec_dev_defaults.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
 #include "esp_idf_version.h"
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
 #include "driver/i2s_std.h"
@@ -16,11 +20,35 @@
 #else
 #include "driver/i2s.h"
 #endif
-#include "esp_codec_dev_os.h"
 #include "esp_log.h"
 
 #define TAG "I2S_IF"
 
+// Requests pending besides the one in transfer, caller can prepare next buffer while DMA runs
+#define I2S_ASYNC_QUEUE_LEN  (2)
+#define I2S_ASYNC_TASK_STACK (3072)
+#define I2S_ASYNC_TASK_PRIO  (15)
+
+// Set while the direction has no transfer in flight
+#define I2S_IN_IDLE_BIT      (1 << 0)
+#define I2S_OUT_IDLE_BIT     (1 << 1)
+// Set while no reconfiguration is requested
+#define I2S_RUN_BIT          (1 << 2)
+
+typedef struct {
+    uint8_t                   *data;
+    int                        size;
+    audio_codec_data_done_cb_t done;
+    void                      *ctx;
+} i2s_async_req_t;
+
+typedef struct {
+    QueueHandle_t     req_q;
+    SemaphoreHandle_t exit_sem;
+    bool              playback;
+    void             *i2s_data;
+} i2s_async_t;
+
 typedef struct {
     audio_codec_data_if_t       base;
     bool                        is_open;
@@ -31,8 +59,12 @@ typedef struct {
     bool                        in_enable;
     bool                        in_disable_pending;
     bool                        out_disable_pending;
-    bool                        in_reconfig;
-    bool                        out_reconfig;
+    bool                        reconfig;
+    SemaphoreHandle_t           state_lock;
+    SemaphoreHandle_t           cfg_lock;
+    EventGroupHandle_t          io_evt;
+    i2s_async_t                *in_async;
+    i2s_async_t                *out_async;
     esp_codec_dev_sample_info_t in_fs;
     esp_codec_dev_sample_info_t out_fs;
     esp_codec_dev_sample_info_t fs;
@@ -283,11 +315,7 @@ static int check_fs_compatible(i2s_data_t *i2s_data, bool playback, esp_codec_de
     ESP_LOGI(TAG, "Mode %d need extend bits %d to %d", !playback, run_bits, want_bits);
     do {
         if (want_bits > run_bits) {
-            if (playback == false) {
-                i2s_data->out_reconfig = true;
-            } else {
-                i2s_data->in_reconfig = true;
-            }
+            // Peer channel is locked by caller, running transfer is already finished
             ret = _i2s_drv_enable(i2s_data, !playback, false);
             if (ret != ESP_CODEC_DEV_OK) {
                 break;
@@ -310,7 +338,6 @@ static int check_fs_compatible(i2s_data_t *i2s_data, bool playback, esp_codec_de
             }
         }
     } while (0);
-    i2s_data->out_reconfig = i2s_data->in_reconfig = false;
     return ret;
 }
 #endif
@@ -326,9 +353,70 @@ static int _i2s_data_open(const audio_codec_data_if_t *h, void *data_cfg, int cf
     i2s_data->port = i2s_cfg->port;
     i2s_data->out_handle = i2s_cfg->tx_handle;
     i2s_data->in_handle = i2s_cfg->rx_handle;
+    if (i2s_data->state_lock == NULL) {
+        i2s_data->state_lock = xSemaphoreCreateMutex();
+    }
+    if (i2s_data->cfg_lock == NULL) {
+        i2s_data->cfg_lock = xSemaphoreCreateMutex();
+    }
+    if (i2s_data->io_evt == NULL) {
+        i2s_data->io_evt = xEventGroupCreate();
+    }
+    if (i2s_data->state_lock == NULL || i2s_data->cfg_lock == NULL || i2s_data->io_evt == NULL) {
+        return ESP_CODEC_DEV_NO_MEM;
+    }
+    xEventGroupSetBits(i2s_data->io_evt, I2S_IN_IDLE_BIT | I2S_OUT_IDLE_BIT | I2S_RUN_BIT);
     return ESP_CODEC_DEV_OK;
 }
 
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+/*
+ * Transfers and reconfiguration hand over through `reconfig` instead of sharing a mutex for the whole transfer:
+ * once reconfiguration is requested no new transfer starts, so a control task never starves behind a streaming loop.
+ * `state_lock` is only held to check the request and update the idle bit.
+ */
+static void _i2s_io_begin(i2s_data_t *i2s_data, bool playback)
+{
+    EventBits_t idle_bit = playback ? I2S_OUT_IDLE_BIT : I2S_IN_IDLE_BIT;
+    while (1) {
+        xEventGroupWaitBits(i2s_data->io_evt, I2S_RUN_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+        xSemaphoreTake(i2s_data->state_lock, portMAX_DELAY);
+        if (i2s_data->reconfig == false) {
+            xEventGroupClearBits(i2s_data->io_evt, idle_bit);
+            xSemaphoreGive(i2s_data->state_lock);
+            return;
+        }
+        xSemaphoreGive(i2s_data->state_lock);
+    }
+}
+
+static void _i2s_io_end(i2s_data_t *i2s_data, bool playback)
+{
+    xEventGroupSetBits(i2s_data->io_evt, playback ? I2S_OUT_IDLE_BIT : I2S_IN_IDLE_BIT);
+}
+
+static void _i2s_reconfig_begin(i2s_data_t *i2s_data)
+{
+    // Serialize reconfiguration callers, transfers never take this lock
+    xSemaphoreTake(i2s_data->cfg_lock, portMAX_DELAY);
+    xSemaphoreTake(i2s_data->state_lock, portMAX_DELAY);
+    i2s_data->reconfig = true;
+    xEventGroupClearBits(i2s_data->io_evt, I2S_RUN_BIT);
+    xSemaphoreGive(i2s_data->state_lock);
+    // Running transfers finish their buffer, new ones park in _i2s_io_begin
+    xEventGroupWaitBits(i2s_data->io_evt, I2S_IN_IDLE_BIT | I2S_OUT_IDLE_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+}
+
+static void _i2s_reconfig_end(i2s_data_t *i2s_data)
+{
+    xSemaphoreTake(i2s_data->state_lock, portMAX_DELAY);
+    i2s_data->reconfig = false;
+    xEventGroupSetBits(i2s_data->io_evt, I2S_RUN_BIT);
+    xSemaphoreGive(i2s_data->state_lock);
+    xSemaphoreGive(i2s_data->cfg_lock);
+}
+#endif
+
 static bool _i2s_data_is_open(const audio_codec_data_if_t *h)
 {
     i2s_data_t *i2s_data = (i2s_data_t *) h;
@@ -420,6 +508,8 @@ static int _i2s_data_set_fmt(const audio_codec_data_if_t *h, esp_codec_dev_type_
         return ESP_CODEC_DEV_NOT_SUPPORT;
     }
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    // Wait for running transfers to finish so that reconfiguration does not cut a buffer in middle
+    _i2s_reconfig_begin(i2s_data);
     // disable internally
     if (dev_type & ESP_CODEC_DEV_TYPE_OUT) {
         _i2s_drv_enable(i2s_data, true, false);
@@ -439,6 +529,7 @@ static int _i2s_data_set_fmt(const audio_codec_data_if_t *h, esp_codec_dev_type_
     } else {
         ret = check_fs_compatible(i2s_data, dev_type & ESP_CODEC_DEV_TYPE_OUT ? true : false, fs);
     }
+    _i2s_reconfig_end(i2s_data);
     return ret;
 #else
     // When use multichannel data
@@ -479,12 +570,10 @@ static int _i2s_data_read(const audio_codec_data_if_t *h, uint8_t *data, int siz
     if (rx_chan == NULL) {
         return ESP_CODEC_DEV_DRV_ERR;
     }
-    if (i2s_data->in_reconfig) {
-        memset(data, 0, size);
-        esp_codec_dev_sleep(10);
-        return ESP_CODEC_DEV_OK;
-    }
+    // Block during reconfiguration instead of returning fake data
+    _i2s_io_begin(i2s_data, false);
     int ret = i2s_channel_read(rx_chan, data, size, &bytes_read, 1000);
+    _i2s_io_end(i2s_data, false);
 #else
     int ret = i2s_read(i2s_data->port, data, size, &bytes_read, portMAX_DELAY);
 #endif
@@ -506,23 +595,143 @@ static int _i2s_data_write(const audio_codec_data_if_t *h, uint8_t *data, int si
     if (tx_chan == NULL) {
         return ESP_CODEC_DEV_DRV_ERR;
     }
-    if (i2s_data->out_reconfig) {
-        esp_codec_dev_sleep(10);
-        return ESP_CODEC_DEV_OK;
-    }
+    // Block during reconfiguration so that no data is dropped
+    _i2s_io_begin(i2s_data, true);
     int ret = i2s_channel_write(tx_chan, data, size, &bytes_written, 1000);
+    _i2s_io_end(i2s_data, true);
 #else
     int ret = i2s_write(i2s_data->port, data, size, &bytes_written, portMAX_DELAY);
 #endif
     return ret == 0 ? ESP_CODEC_DEV_OK : ESP_CODEC_DEV_DRV_ERR;
 }
 
+static void _i2s_async_task(void *arg)
+{
+    i2s_async_t *async = (i2s_async_t *) arg;
+    i2s_data_t *i2s_data = (i2s_data_t *) async->i2s_data;
+    i2s_async_req_t req;
+    while (xQueueReceive(async->req_q, &req, portMAX_DELAY) == pdTRUE) {
+        // Empty request to quit
+        if (req.data == NULL) {
+            break;
+        }
+        int ret;
+        if (async->playback) {
+            ret = _i2s_data_write(&i2s_data->base, req.data, req.size);
+        } else {
+            ret = _i2s_data_read(&i2s_data->base, req.data, req.size);
+        }
+        if (req.done) {
+            req.done(&i2s_data->base, req.data, req.size, ret, req.ctx);
+        }
+    }
+    xSemaphoreGive(async->exit_sem);
+    vTaskDelete(NULL);
+}
+
+static void _i2s_async_stop(i2s_async_t *async)
+{
+    if (async == NULL) {
+        return;
+    }
+    i2s_async_req_t req = { 0 };
+    xQueueSend(async->req_q, &req, portMAX_DELAY);
+    xSemaphoreTake(async->exit_sem, portMAX_DELAY);
+    vQueueDelete(async->req_q);
+    vSemaphoreDelete(async->exit_sem);
+    free(async);
+}
+
+static i2s_async_t *_i2s_async_start(i2s_data_t *i2s_data, bool playback)
+{
+    i2s_async_t *async = (i2s_async_t *) calloc(1, sizeof(i2s_async_t));
+    if (async == NULL) {
+        return NULL;
+    }
+    async->playback = playback;
+    async->i2s_data = i2s_data;
+    async->req_q = xQueueCreate(I2S_ASYNC_QUEUE_LEN, sizeof(i2s_async_req_t));
+    async->exit_sem = xSemaphoreCreateBinary();
+    if (async->req_q && async->exit_sem &&
+        xTaskCreate(_i2s_async_task, playback ? "I2S_AsyncW" : "I2S_AsyncR", I2S_ASYNC_TASK_STACK,
+                    async, I2S_ASYNC_TASK_PRIO, NULL) == pdPASS) {
+        return async;
+    }
+    ESP_LOGE(TAG, "Fail to start async %s", playback ? "write" : "read");
+    if (async->req_q) {
+        vQueueDelete(async->req_q);
+    }
+    if (async->exit_sem) {
+        vSemaphoreDelete(async->exit_sem);
+    }
+    free(async);
+    return NULL;
+}
+
+static int _i2s_data_submit(i2s_data_t *i2s_data, bool playback, uint8_t *data, int size,
+                            audio_codec_data_done_cb_t done, void *ctx)
+{
+    if (i2s_data == NULL || data == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    if (i2s_data->is_open == false) {
+        return ESP_CODEC_DEV_WRONG_STATE;
+    }
+    i2s_async_t **async = playback ? &i2s_data->out_async : &i2s_data->in_async;
+    // Several tasks may submit the first request at the same time
+    xSemaphoreTake(i2s_data->state_lock, portMAX_DELAY);
+    if (*async == NULL) {
+        *async = _i2s_async_start(i2s_data, playback);
+    }
+    xSemaphoreGive(i2s_data->state_lock);
+    if (*async == NULL) {
+        return ESP_CODEC_DEV_NO_MEM;
+    }
+    i2s_async_req_t req = {
+        .data = data,
+        .size = size,
+        .done = done,
+        .ctx = ctx,
+    };
+    // Block only when all buffers are in use
+    xQueueSend((*async)->req_q, &req, portMAX_DELAY);
+    return ESP_CODEC_DEV_OK;
+}
+
+static int _i2s_data_read_async(const audio_codec_data_if_t *h, uint8_t *data, int size,
+                                audio_codec_data_done_cb_t done, void *ctx)
+{
+    return _i2s_data_submit((i2s_data_t *) h, false, data, size, done, ctx);
+}
+
+static int _i2s_data_write_async(const audio_codec_data_if_t *h, uint8_t *data, int size,
+                                 audio_codec_data_done_cb_t done, void *ctx)
+{
+    return _i2s_data_submit((i2s_data_t *) h, true, data, size, done, ctx);
+}
+
 static int _i2s_data_close(const audio_codec_data_if_t *h)
 {
     i2s_data_t *i2s_data = (i2s_data_t *) h;
     if (i2s_data == NULL) {
         return ESP_CODEC_DEV_INVALID_ARG;
     }
+    // Finish pending asynchronous transfers firstly
+    _i2s_async_stop(i2s_data->in_async);
+    _i2s_async_stop(i2s_data->out_async);
+    i2s_data->in_async = i2s_data->out_async = NULL;
+    if (i2s_data->state_lock) {
+        vSemaphoreDelete(i2s_data->state_lock);
+        i2s_data->state_lock = NULL;
+    }
+    if (i2s_data->cfg_lock) {
+        vSemaphoreDelete(i2s_data->cfg_lock);
+        i2s_data->cfg_lock = NULL;
+    }
+    if (i2s_data->io_evt) {
+        vEventGroupDelete(i2s_data->io_evt);
+        i2s_data->io_evt = NULL;
+    }
     memset(&i2s_data->fs, 0, sizeof(esp_codec_dev_sample_info_t));
     memset(&i2s_data->in_fs, 0, sizeof(esp_codec_dev_sample_info_t));
     memset(&i2s_data->out_fs, 0, sizeof(esp_codec_dev_sample_info_t));
@@ -544,8 +753,11 @@ const audio_codec_data_if_t *audio_codec_new_i2s_data(audio_codec_i2s_cfg_t *i2s
     i2s_data->base.write = _i2s_data_write;
     i2s_data->base.set_fmt = _i2s_data_set_fmt;
     i2s_data->base.close = _i2s_data_close;
+    i2s_data->base.read_async = _i2s_data_read_async;
+    i2s_data->base.write_async = _i2s_data_write_async;
     int ret = _i2s_data_open(&i2s_data->base, i2s_cfg, sizeof(audio_codec_i2s_cfg_t));
     if (ret != 0) {
+        _i2s_data_close(&i2s_data->base);
         free(i2s_data);
         return NULL;
     }
@@ -0,0 +1,487 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/stream_buffer.h"
+#include "esp_codec_dev_mixer.h"
+#include "esp_log.h"
+
+#define TAG                   "Adev_Mixer"
+
+#define MIXER_DEFAULT_FRAME_MS (10)
+#define MIXER_CONVERT_FRAMES   (128)
+#define MIXER_GAIN_0DB         (1 << 15)
+#define MIXER_DEFAULT_STACK    (4096)
+
+typedef struct mixer_t mixer_t;
+
+typedef struct {
+    audio_codec_data_if_t       base;
+    mixer_t                    *mixer;
+    esp_codec_dev_sample_info_t fs;
+    StreamBufferHandle_t        sb;
+    SemaphoreHandle_t           write_lock;
+    int                         buffer_ms;
+    int                         prebuffer_size;
+    bool                        duck_others;
+    bool                        enabled;
+    bool                        started;
+    uint8_t                    *cvt_buf;
+} mixer_input_t;
+
+struct mixer_t {
+    esp_codec_dev_mixer_cfg_t cfg;
+    mixer_input_t            *inputs[ESP_CODEC_DEV_MIXER_MAX_INPUT];
+    SemaphoreHandle_t         lock;
+    SemaphoreHandle_t         exit_sem;
+    TaskHandle_t              task;
+    bool                      running;
+    int                       frame_size;
+    int                       mix_size;
+    int                       duck_gain;
+    int                       duck_cur;
+    int                       duck_step;
+    int64_t                  *acc;
+    uint8_t                  *in_buf;
+    uint8_t                  *out_buf;
+};
+
+static bool _mixer_fmt_supported(esp_codec_dev_sample_info_t *fs)
+{
+    return (fs->bits_per_sample == 16 || fs->bits_per_sample == 32) && (fs->channel == 1 || fs->channel == 2);
+}
+
+static bool _mixer_fmt_same(esp_codec_dev_sample_info_t *a, esp_codec_dev_sample_info_t *b)
+{
+    return a->bits_per_sample == b->bits_per_sample && a->channel == b->channel;
+}
+
+static inline int32_t _mixer_get_sample(uint8_t *data, int bits, int idx)
+{
+    return bits == 16 ? (int32_t) ((int16_t *) data)[idx] << 16 : ((int32_t *) data)[idx];
+}
+
+static void _mixer_convert(esp_codec_dev_sample_info_t *in_fs, uint8_t *in, int frames,
+                           esp_codec_dev_sample_info_t *out_fs, uint8_t *out)
+{
+    for (int i = 0; i < frames; i++) {
+        int32_t l = _mixer_get_sample(in, in_fs->bits_per_sample, i * in_fs->channel);
+        int32_t r = in_fs->channel == 2 ? _mixer_get_sample(in, in_fs->bits_per_sample, i * 2 + 1) : l;
+        if (out_fs->channel == 1) {
+            l = (l >> 1) + (r >> 1);
+        }
+        for (int j = 0; j < out_fs->channel; j++) {
+            int32_t v = j ? r : l;
+            if (out_fs->bits_per_sample == 16) {
+                ((int16_t *) out)[i * out_fs->channel + j] = (int16_t) (v >> 16);
+            } else {
+                ((int32_t *) out)[i * out_fs->channel + j] = v;
+            }
+        }
+    }
+}
+
+static void _mixer_accumulate(mixer_t *mixer, int size, int gain_start, int gain_end)
+{
+    int channel = mixer->cfg.fs.channel;
+    int frames = size / mixer->frame_size;
+    int mix_frames = mixer->mix_size / mixer->frame_size;
+    int bits = mixer->cfg.fs.bits_per_sample;
+    for (int i = 0; i < frames; i++) {
+        // Gain ramps linearly across whole mix period
+        int64_t gain = gain_start + (int64_t) (gain_end - gain_start) * i / mix_frames;
+        for (int j = 0; j < channel; j++) {
+            int idx = i * channel + j;
+            int64_t v = bits == 16 ? ((int16_t *) mixer->in_buf)[idx] : ((int32_t *) mixer->in_buf)[idx];
+            mixer->acc[idx] += (v * gain) >> 15;
+        }
+    }
+}
+
+static void _mixer_saturate(mixer_t *mixer)
+{
+    int samples = mixer->mix_size / (mixer->cfg.fs.bits_per_sample >> 3);
+    if (mixer->cfg.fs.bits_per_sample == 16) {
+        int16_t *out = (int16_t *) mixer->out_buf;
+        for (int i = 0; i < samples; i++) {
+            int64_t v = mixer->acc[i];
+            out[i] = (int16_t) (v > INT16_MAX ? INT16_MAX : (v < INT16_MIN ? INT16_MIN : v));
+        }
+    } else {
+        int32_t *out = (int32_t *) mixer->out_buf;
+        for (int i = 0; i < samples; i++) {
+            int64_t v = mixer->acc[i];
+            out[i] = (int32_t) (v > INT32_MAX ? INT32_MAX : (v < INT32_MIN ? INT32_MIN : v));
+        }
+    }
+}
+
+static void _mixer_task(void *arg)
+{
+    mixer_t *mixer = (mixer_t *) arg;
+    TickType_t period = pdMS_TO_TICKS(mixer->cfg.frame_ms);
+    if (period == 0) {
+        period = 1;
+    }
+    while (mixer->running) {
+        TickType_t period_start = xTaskGetTickCount();
+        xSemaphoreTake(mixer->lock, portMAX_DELAY);
+        int active = 0;
+        int mixed = 0;
+        bool duck = false;
+        for (int i = 0; i < ESP_CODEC_DEV_MIXER_MAX_INPUT; i++) {
+            mixer_input_t *input = mixer->inputs[i];
+            if (input && input->enabled) {
+                active++;
+                if (input->duck_others && xStreamBufferBytesAvailable(input->sb) > 0) {
+                    duck = true;
+                }
+            }
+        }
+        if (active == 0) {
+            xSemaphoreGive(mixer->lock);
+            // Wait until some input enabled
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        int duck_start = mixer->duck_cur;
+        int duck_target = duck ? mixer->duck_gain : MIXER_GAIN_0DB;
+        if (mixer->duck_cur < duck_target) {
+            mixer->duck_cur = mixer->duck_cur + mixer->duck_step > duck_target ? duck_target : mixer->duck_cur + mixer->duck_step;
+        } else if (mixer->duck_cur > duck_target) {
+            mixer->duck_cur = mixer->duck_cur - mixer->duck_step < duck_target ? duck_target : mixer->duck_cur - mixer->duck_step;
+        }
+        memset(mixer->acc, 0, mixer->mix_size / (mixer->cfg.fs.bits_per_sample >> 3) * sizeof(int64_t));
+        for (int i = 0; i < ESP_CODEC_DEV_MIXER_MAX_INPUT; i++) {
+            mixer_input_t *input = mixer->inputs[i];
+            if (input == NULL || input->enabled == false) {
+                continue;
+            }
+            // Take whole frames only, writer may be in middle of sending
+            int size = xStreamBufferBytesAvailable(input->sb) / mixer->frame_size * mixer->frame_size;
+            if (input->started == false) {
+                // Wait for prebuffer so that a slow writer does not get silence inserted every period
+                if (size < input->prebuffer_size) {
+                    continue;
+                }
+                input->started = true;
+            }
+            if (size < mixer->mix_size) {
+                // Underrun, play what is left and prebuffer again
+                input->started = false;
+            } else {
+                size = mixer->mix_size;
+            }
+            if (size == 0) {
+                continue;
+            }
+            xStreamBufferReceive(input->sb, mixer->in_buf, size, 0);
+            mixed++;
+            if (input->duck_others) {
+                _mixer_accumulate(mixer, size, MIXER_GAIN_0DB, MIXER_GAIN_0DB);
+            } else {
+                _mixer_accumulate(mixer, size, duck_start, mixer->duck_cur);
+            }
+        }
+        xSemaphoreGive(mixer->lock);
+        _mixer_saturate(mixer);
+        // Silence is wrote when inputs underrun to keep output timing
+        esp_codec_dev_write(mixer->cfg.out_dev, mixer->out_buf, mixer->mix_size);
+        if (mixed == 0) {
+            // Output may accept silence without blocking, pace it by frame time instead of spinning
+            TickType_t spent = xTaskGetTickCount() - period_start;
+            if (spent < period) {
+                vTaskDelay(period - spent);
+            }
+        }
+    }
+    xSemaphoreGive(mixer->exit_sem);
+    vTaskDelete(NULL);
+}
+
+static int _mixer_input_open(const audio_codec_data_if_t *h, void *data_cfg, int cfg_size)
+{
+    return ESP_CODEC_DEV_OK;
+}
+
+static bool _mixer_input_is_open(const audio_codec_data_if_t *h)
+{
+    return h != NULL;
+}
+
+static int _mixer_input_enable(const audio_codec_data_if_t *h, esp_codec_dev_type_t dev_type, bool enable)
+{
+    mixer_input_t *input = (mixer_input_t *) h;
+    if (input == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    if ((dev_type & ESP_CODEC_DEV_TYPE_OUT) == 0) {
+        return ESP_CODEC_DEV_NOT_SUPPORT;
+    }
+    mixer_t *mixer = input->mixer;
+    xSemaphoreTake(mixer->lock, portMAX_DELAY);
+    input->enabled = enable;
+    input->started = false;
+    xSemaphoreGive(mixer->lock);
+    if (enable) {
+        xTaskNotifyGive(mixer->task);
+        return ESP_CODEC_DEV_OK;
+    }
+    // Writer sees disabled within one send period and quits, reset fails if it is still blocked in sending
+    xSemaphoreTake(input->write_lock, portMAX_DELAY);
+    xSemaphoreTake(mixer->lock, portMAX_DELAY);
+    // Drop data not played yet
+    xStreamBufferReset(input->sb);
+    xSemaphoreGive(mixer->lock);
+    xSemaphoreGive(input->write_lock);
+    return ESP_CODEC_DEV_OK;
+}
+
+static int _mixer_input_set_fmt(const audio_codec_data_if_t *h, esp_codec_dev_type_t dev_type, esp_codec_dev_sample_info_t *fs)
+{
+    mixer_input_t *input = (mixer_input_t *) h;
+    if (input == NULL || fs == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    mixer_t *mixer = input->mixer;
+    if (_mixer_fmt_supported(fs) == false || fs->sample_rate != mixer->cfg.fs.sample_rate) {
+        ESP_LOGE(TAG, "Not support format bits:%d channel:%d rate:%d",
+                 fs->bits_per_sample, fs->channel, (int) fs->sample_rate);
+        return ESP_CODEC_DEV_NOT_SUPPORT;
+    }
+    input->fs = *fs;
+    if (_mixer_fmt_same(fs, &mixer->cfg.fs) == false && input->cvt_buf == NULL) {
+        input->cvt_buf = (uint8_t *) malloc(MIXER_CONVERT_FRAMES * mixer->frame_size);
+        if (input->cvt_buf == NULL) {
+            return ESP_CODEC_DEV_NO_MEM;
+        }
+    }
+    return ESP_CODEC_DEV_OK;
+}
+
+static bool _mixer_input_enabled(mixer_input_t *input)
+{
+    xSemaphoreTake(input->mixer->lock, portMAX_DELAY);
+    bool enabled = input->enabled;
+    xSemaphoreGive(input->mixer->lock);
+    return enabled;
+}
+
+static int _mixer_input_send(mixer_input_t *input, uint8_t *data, int size)
+{
+    // Block one mix period at most so that disable is noticed
+    TickType_t wait = pdMS_TO_TICKS(input->mixer->cfg.frame_ms) + 1;
+    while (size > 0) {
+        if (_mixer_input_enabled(input) == false) {
+            return ESP_CODEC_DEV_WRONG_STATE;
+        }
+        int sent = (int) xStreamBufferSend(input->sb, data, size, wait);
+        data += sent;
+        size -= sent;
+    }
+    return ESP_CODEC_DEV_OK;
+}
+
+static int _mixer_input_write(const audio_codec_data_if_t *h, uint8_t *data, int size)
+{
+    mixer_input_t *input = (mixer_input_t *) h;
+    if (input == NULL || data == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    if (_mixer_input_enabled(input) == false || input->fs.sample_rate == 0) {
+        return ESP_CODEC_DEV_WRONG_STATE;
+    }
+    mixer_t *mixer = input->mixer;
+    int ret = ESP_CODEC_DEV_OK;
+    xSemaphoreTake(input->write_lock, portMAX_DELAY);
+    if (_mixer_fmt_same(&input->fs, &mixer->cfg.fs)) {
+        ret = _mixer_input_send(input, data, size);
+        xSemaphoreGive(input->write_lock);
+        return ret;
+    }
+    int in_frame_size = input->fs.bits_per_sample * input->fs.channel >> 3;
+    int frames = size / in_frame_size;
+    while (frames > 0 && ret == ESP_CODEC_DEV_OK) {
+        int n = frames > MIXER_CONVERT_FRAMES ? MIXER_CONVERT_FRAMES : frames;
+        _mixer_convert(&input->fs, data, n, &mixer->cfg.fs, input->cvt_buf);
+        ret = _mixer_input_send(input, input->cvt_buf, n * mixer->frame_size);
+        data += n * in_frame_size;
+        frames -= n;
+    }
+    xSemaphoreGive(input->write_lock);
+    return ret;
+}
+
+static int _mixer_input_close(const audio_codec_data_if_t *h)
+{
+    mixer_input_t *input = (mixer_input_t *) h;
+    if (input == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    mixer_t *mixer = input->mixer;
+    if (mixer == NULL) {
+        return ESP_CODEC_DEV_OK;
+    }
+    xSemaphoreTake(mixer->lock, portMAX_DELAY);
+    for (int i = 0; i < ESP_CODEC_DEV_MIXER_MAX_INPUT; i++) {
+        if (mixer->inputs[i] == input) {
+            mixer->inputs[i] = NULL;
+            break;
+        }
+    }
+    xSemaphoreGive(mixer->lock);
+    vStreamBufferDelete(input->sb);
+    vSemaphoreDelete(input->write_lock);
+    if (input->cvt_buf) {
+        free(input->cvt_buf);
+        input->cvt_buf = NULL;
+    }
+    input->mixer = NULL;
+    return ESP_CODEC_DEV_OK;
+}
+
+const audio_codec_data_if_t *esp_codec_dev_mixer_new_input(esp_codec_dev_mixer_handle_t handle,
+                                                           esp_codec_dev_mixer_input_cfg_t *cfg)
+{
+    mixer_t *mixer = (mixer_t *) handle;
+    if (mixer == NULL || cfg == NULL) {
+        return NULL;
+    }
+    mixer_input_t *input = (mixer_input_t *) calloc(1, sizeof(mixer_input_t));
+    if (input == NULL) {
+        return NULL;
+    }
+    int buffer_ms = cfg->buffer_ms > mixer->cfg.frame_ms ? cfg->buffer_ms : mixer->cfg.frame_ms * 2;
+    int size = (int) (mixer->cfg.fs.sample_rate * buffer_ms / 1000) * mixer->frame_size;
+    input->sb = xStreamBufferCreate(size, 1);
+    input->write_lock = xSemaphoreCreateMutex();
+    if (input->sb == NULL || input->write_lock == NULL) {
+        if (input->sb) {
+            vStreamBufferDelete(input->sb);
+        }
+        if (input->write_lock) {
+            vSemaphoreDelete(input->write_lock);
+        }
+        free(input);
+        return NULL;
+    }
+    input->mixer = mixer;
+    input->buffer_ms = buffer_ms;
+    // Prebuffer one mix period at least, and leave one period of room for writer
+    int prebuffer_ms = cfg->prebuffer_ms > 0 ? cfg->prebuffer_ms : mixer->cfg.frame_ms;
+    if (prebuffer_ms > buffer_ms - mixer->cfg.frame_ms) {
+        prebuffer_ms = buffer_ms - mixer->cfg.frame_ms;
+    }
+    input->prebuffer_size = (int) (mixer->cfg.fs.sample_rate * prebuffer_ms / 1000) * mixer->frame_size;
+    input->duck_others = cfg->duck_others;
+    input->base.open = _mixer_input_open;
+    input->base.is_open = _mixer_input_is_open;
+    input->base.enable = _mixer_input_enable;
+    input->base.set_fmt = _mixer_input_set_fmt;
+    input->base.write = _mixer_input_write;
+    input->base.close = _mixer_input_close;
+    xSemaphoreTake(mixer->lock, portMAX_DELAY);
+    int i;
+    for (i = 0; i < ESP_CODEC_DEV_MIXER_MAX_INPUT; i++) {
+        if (mixer->inputs[i] == NULL) {
+            mixer->inputs[i] = input;
+            break;
+        }
+    }
+    xSemaphoreGive(mixer->lock);
+    if (i == ESP_CODEC_DEV_MIXER_MAX_INPUT) {
+        ESP_LOGE(TAG, "Reach max input number %d", ESP_CODEC_DEV_MIXER_MAX_INPUT);
+        vStreamBufferDelete(input->sb);
+        vSemaphoreDelete(input->write_lock);
+        free(input);
+        return NULL;
+    }
+    return &input->base;
+}
+
+static void _mixer_free(mixer_t *mixer)
+{
+    if (mixer->lock) {
+        vSemaphoreDelete(mixer->lock);
+    }
+    if (mixer->exit_sem) {
+        vSemaphoreDelete(mixer->exit_sem);
+    }
+    free(mixer->acc);
+    free(mixer->in_buf);
+    free(mixer->out_buf);
+    free(mixer);
+}
+
+esp_codec_dev_mixer_handle_t esp_codec_dev_mixer_new(esp_codec_dev_mixer_cfg_t *cfg)
+{
+    if (cfg == NULL || cfg->out_dev == NULL || cfg->fs.sample_rate == 0 || _mixer_fmt_supported(&cfg->fs) == false) {
+        ESP_LOGE(TAG, "Wrong mixer configuration");
+        return NULL;
+    }
+    mixer_t *mixer = (mixer_t *) calloc(1, sizeof(mixer_t));
+    if (mixer == NULL) {
+        return NULL;
+    }
+    mixer->cfg = *cfg;
+    if (mixer->cfg.frame_ms <= 0) {
+        mixer->cfg.frame_ms = MIXER_DEFAULT_FRAME_MS;
+    }
+    if (mixer->cfg.task_stack <= 0) {
+        mixer->cfg.task_stack = MIXER_DEFAULT_STACK;
+    }
+    mixer->frame_size = cfg->fs.bits_per_sample * cfg->fs.channel >> 3;
+    int frames = (int) (cfg->fs.sample_rate * mixer->cfg.frame_ms / 1000);
+    mixer->mix_size = frames * mixer->frame_size;
+    mixer->duck_gain = cfg->duck_db >= 0.0 ? MIXER_GAIN_0DB : (int) (powf(10, cfg->duck_db / 20) * MIXER_GAIN_0DB);
+    mixer->duck_cur = MIXER_GAIN_0DB;
+    int duck_periods = cfg->duck_ms / mixer->cfg.frame_ms;
+    mixer->duck_step = (MIXER_GAIN_0DB - mixer->duck_gain) / (duck_periods > 0 ? duck_periods : 1);
+    if (mixer->duck_step == 0) {
+        mixer->duck_step = 1;
+    }
+    mixer->acc = (int64_t *) malloc(frames * cfg->fs.channel * sizeof(int64_t));
+    mixer->in_buf = (uint8_t *) malloc(mixer->mix_size);
+    mixer->out_buf = (uint8_t *) malloc(mixer->mix_size);
+    mixer->lock = xSemaphoreCreateMutex();
+    mixer->exit_sem = xSemaphoreCreateBinary();
+    if (mixer->acc == NULL || mixer->in_buf == NULL || mixer->out_buf == NULL ||
+        mixer->lock == NULL || mixer->exit_sem == NULL) {
+        _mixer_free(mixer);
+        return NULL;
+    }
+    mixer->running = true;
+    if (xTaskCreatePinnedToCore(_mixer_task, "Adev_Mixer", mixer->cfg.task_stack, mixer, cfg->task_prio, &mixer->task,
+                                cfg->task_core < 0 ? tskNO_AFFINITY : cfg->task_core) != pdPASS) {
+        ESP_LOGE(TAG, "Fail to create mixer task");
+        _mixer_free(mixer);
+        return NULL;
+    }
+    return (esp_codec_dev_mixer_handle_t) mixer;
+}
+
+int esp_codec_dev_mixer_delete(esp_codec_dev_mixer_handle_t handle)
+{
+    mixer_t *mixer = (mixer_t *) handle;
+    if (mixer == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    for (int i = 0; i < ESP_CODEC_DEV_MIXER_MAX_INPUT; i++) {
+        if (mixer->inputs[i]) {
+            ESP_LOGE(TAG, "Need delete all inputs firstly");
+            return ESP_CODEC_DEV_WRONG_STATE;
+        }
+    }
+    mixer->running = false;
+    xTaskNotifyGive(mixer->task);
+    xSemaphoreTake(mixer->exit_sem, portMAX_DELAY);
+    _mixer_free(mixer);
+    return ESP_CODEC_DEV_OK;
+}
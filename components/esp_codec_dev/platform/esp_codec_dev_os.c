@@ -5,6 +5,7 @@
  */
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_idf_version.h"
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
 #define TICK_PER_MS portTICK_PERIOD_MS
@@ -16,3 +17,23 @@ void esp_codec_dev_sleep(int ms)
 {
     vTaskDelay(ms / TICK_PER_MS);
 }
+
+void *esp_codec_dev_mutex_create(void)
+{
+    return (void *) xSemaphoreCreateMutex();
+}
+
+void esp_codec_dev_mutex_lock(void *mutex)
+{
+    xSemaphoreTake((SemaphoreHandle_t) mutex, portMAX_DELAY);
+}
+
+void esp_codec_dev_mutex_unlock(void *mutex)
+{
+    xSemaphoreGive((SemaphoreHandle_t) mutex);
+}
+
+void esp_codec_dev_mutex_delete(void *mutex)
+{
+    vSemaphoreDelete((SemaphoreHandle_t) mutex);
+}
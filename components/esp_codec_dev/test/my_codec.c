@@ -57,10 +57,11 @@ static bool my_codec_data_is_open(const audio_codec_data_if_t *h)
     return data_if->is_open;
 }
 
-static int my_codec_data_set_fmt(const audio_codec_data_if_t *h, esp_codec_dev_sample_info_t *fs)
+static int my_codec_data_set_fmt(const audio_codec_data_if_t *h, esp_codec_dev_type_t dev_type, esp_codec_dev_sample_info_t *fs)
 {
     my_codec_data_t *data_if = (my_codec_data_t *) h;
     memcpy(&data_if->fmt, fs, sizeof(esp_codec_dev_sample_info_t));
+    data_if->set_fmt_count++;
     return 0;
 }
 
@@ -123,8 +124,10 @@ static bool my_codec_ctrl_is_open(const audio_codec_ctrl_if_t *ctrl)
 static int my_codec_ctrl_read_addr(const audio_codec_ctrl_if_t *ctrl, int addr, int addr_len, void *data, int data_len)
 {
     my_codec_ctrl_t *ctrl_if = (my_codec_ctrl_t *) ctrl;
-    if (data_len == 1 && addr < MY_CODEC_REG_MAX) {
-        *(uint8_t *) data = ctrl_if->reg[addr];
+    // Burst access to consecutive registers is one bus transaction
+    if (data_len >= 1 && addr + data_len <= MY_CODEC_REG_MAX) {
+        memcpy(data, ctrl_if->reg + addr, data_len);
+        ctrl_if->read_count++;
         return 0;
     }
     return -1;
@@ -133,8 +136,9 @@ static int my_codec_ctrl_read_addr(const audio_codec_ctrl_if_t *ctrl, int addr,
 static int my_codec_ctrl_write_addr(const audio_codec_ctrl_if_t *ctrl, int addr, int addr_len, void *data, int data_len)
 {
     my_codec_ctrl_t *ctrl_if = (my_codec_ctrl_t *) ctrl;
-    if (data_len == 1 && addr < MY_CODEC_REG_MAX) {
-        ctrl_if->reg[addr] = *(uint8_t *) data;
+    if (data_len >= 1 && addr + data_len <= MY_CODEC_REG_MAX) {
+        memcpy(ctrl_if->reg + addr, data, data_len);
+        ctrl_if->write_count++;
         return 0;
     }
     return -1;
@@ -180,11 +184,13 @@ static int my_codec_open(const audio_codec_if_t *h, void *cfg, int cfg_size)
     esp_codec_dev_sleep(10);
     codec->gpio_if->set(MY_CODEC_RESET_PIN, true);
     esp_codec_dev_sleep(10);
-    // Set initial register
+    // Set initial register, send together when control interface support batch
     uint8_t reg = 0;
+    audio_codec_ctrl_batch_begin(codec->ctrl_if);
     codec->ctrl_if->write_reg(codec->ctrl_if, MY_CODEC_REG_VOL, 1, &reg, 1);
     reg = 0;
     codec->ctrl_if->write_reg(codec->ctrl_if, MY_CODEC_REG_MUTE, 1, &reg, 1);
+    audio_codec_ctrl_batch_end(codec->ctrl_if);
     codec->is_open = true;
     return 0;
 }
@@ -230,8 +236,16 @@ static int my_codec_enable(const audio_codec_if_t *h, bool enable)
 static int my_codec_set_fs(const audio_codec_if_t *h, esp_codec_dev_sample_info_t *fs)
 {
     my_codec_t *codec = (my_codec_t *) h;
-    memcpy(&codec->fs, fs, sizeof(esp_codec_dev_sample_info_t));
-    return 0;
+    // Suppose clock divider of codec only support up to 96kHz
+    if (fs->sample_rate > 96000) {
+        return ESP_CODEC_DEV_NOT_SUPPORT;
+    }
+    uint8_t rate = (uint8_t) (fs->sample_rate / 1000);
+    int ret = codec->ctrl_if->write_reg(codec->ctrl_if, MY_CODEC_REG_RATE, 1, &rate, 1);
+    if (ret == 0) {
+        memcpy(&codec->fs, fs, sizeof(esp_codec_dev_sample_info_t));
+    }
+    return ret;
 }
 
 static int my_codec_mute(const audio_codec_if_t *h, bool mute)
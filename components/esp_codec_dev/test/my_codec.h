@@ -35,6 +35,7 @@ typedef enum {
     MY_CODEC_REG_MIC_GAIN, /*!< Register for microphone gain */
     MY_CODEC_REG_MIC_MUTE, /*!< Register to mute microphone */
     MY_CODEC_REG_SUSPEND,  /*!< Register to suspend codec chip */
+    MY_CODEC_REG_RATE,     /*!< Register for sample rate in kHz */
     MY_CODEC_REG_MAX,
 } my_codec_reg_type_t;
 
@@ -42,6 +43,8 @@ typedef struct {
     audio_codec_ctrl_if_t base;
     uint8_t               reg[MY_CODEC_REG_MAX];
     bool                  is_open;
+    int                   read_count;  /*!< Bus read transactions */
+    int                   write_count; /*!< Bus write transactions */
 } my_codec_ctrl_t;
 
 /**
@@ -53,6 +56,7 @@ typedef struct {
     int                         read_idx;
     int                         write_idx;
     bool                        is_open;
+    int                         set_fmt_count; /*!< Times of format settings */
 } my_codec_data_t;
 
 /**
@@ -0,0 +1,267 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "unity.h"
+#include "esp_codec_dev.h"
+#include "esp_codec_dev_mixer.h"
+#include "esp_codec_dev_os.h"
+
+#define TEST_RATE (16000)
+
+/*
+ * Data interface to capture range of mixed output
+ */
+typedef struct {
+    audio_codec_data_if_t base;
+    int16_t               max;
+    int16_t               min;
+    int                   match_count;
+    int16_t               match;
+} capture_data_t;
+
+static bool capture_is_open(const audio_codec_data_if_t *h)
+{
+    return true;
+}
+
+static int capture_write(const audio_codec_data_if_t *h, uint8_t *data, int size)
+{
+    capture_data_t *cap = (capture_data_t *) h;
+    int16_t *v = (int16_t *) data;
+    for (int i = 0; i < size / 2; i++) {
+        if (v[i] > cap->max) {
+            cap->max = v[i];
+        }
+        if (v[i] < cap->min) {
+            cap->min = v[i];
+        }
+        if (v[i] == cap->match) {
+            cap->match_count++;
+        }
+    }
+    return ESP_CODEC_DEV_OK;
+}
+
+static void capture_reset(capture_data_t *cap, int16_t match)
+{
+    cap->max = INT16_MIN;
+    cap->min = INT16_MAX;
+    cap->match = match;
+    cap->match_count = 0;
+}
+
+static esp_codec_dev_handle_t new_mixer_writer(const audio_codec_data_if_t *input, int bits, int channel)
+{
+    esp_codec_dev_cfg_t dev_cfg = {
+        .dev_type = ESP_CODEC_DEV_TYPE_OUT,
+        .data_if = input,
+    };
+    esp_codec_dev_handle_t dev = esp_codec_dev_new(&dev_cfg);
+    TEST_ASSERT_NOT_NULL(dev);
+    esp_codec_dev_sample_info_t fs = {
+        .bits_per_sample = bits,
+        .channel = channel,
+        .sample_rate = TEST_RATE,
+    };
+    TEST_ESP_OK(esp_codec_dev_open(dev, &fs));
+    TEST_ESP_OK(esp_codec_dev_set_out_vol(dev, 100));
+    return dev;
+}
+
+static void write_const(esp_codec_dev_handle_t dev, int bits, int channel, int32_t value, int ms)
+{
+    int samples = TEST_RATE * ms / 1000 * channel;
+    void *data = malloc(samples * bits / 8);
+    TEST_ASSERT_NOT_NULL(data);
+    for (int i = 0; i < samples; i++) {
+        if (bits == 16) {
+            ((int16_t *) data)[i] = (int16_t) value;
+        } else {
+            ((int32_t *) data)[i] = value;
+        }
+    }
+    TEST_ESP_OK(esp_codec_dev_write(dev, data, samples * bits / 8));
+    free(data);
+}
+
+TEST_CASE("esp codec dev software mixer test", "[esp_codec_dev]")
+{
+    capture_data_t *cap = (capture_data_t *) calloc(1, sizeof(capture_data_t));
+    TEST_ASSERT_NOT_NULL(cap);
+    cap->base.is_open = capture_is_open;
+    cap->base.write = capture_write;
+    esp_codec_dev_cfg_t out_cfg = {
+        .dev_type = ESP_CODEC_DEV_TYPE_OUT,
+        .data_if = &cap->base,
+    };
+    esp_codec_dev_handle_t out_dev = esp_codec_dev_new(&out_cfg);
+    TEST_ASSERT_NOT_NULL(out_dev);
+    esp_codec_dev_sample_info_t fs = {
+        .bits_per_sample = 16,
+        .channel = 2,
+        .sample_rate = TEST_RATE,
+    };
+    TEST_ESP_OK(esp_codec_dev_open(out_dev, &fs));
+    TEST_ESP_OK(esp_codec_dev_set_out_vol(out_dev, 100));
+
+    esp_codec_dev_mixer_cfg_t mixer_cfg = {
+        .out_dev = out_dev,
+        .fs = fs,
+        .frame_ms = 10,
+        .duck_db = -20.0,
+        .duck_ms = 20,
+        .task_prio = 5,
+        .task_core = -1,
+    };
+    esp_codec_dev_mixer_handle_t mixer = esp_codec_dev_mixer_new(&mixer_cfg);
+    TEST_ASSERT_NOT_NULL(mixer);
+    esp_codec_dev_mixer_input_cfg_t input_cfg = {
+        .buffer_ms = 200,
+    };
+    const audio_codec_data_if_t *music_if = esp_codec_dev_mixer_new_input(mixer, &input_cfg);
+    const audio_codec_data_if_t *other_if = esp_codec_dev_mixer_new_input(mixer, &input_cfg);
+    input_cfg.duck_others = true;
+    const audio_codec_data_if_t *notify_if = esp_codec_dev_mixer_new_input(mixer, &input_cfg);
+    TEST_ASSERT_NOT_NULL(music_if);
+    TEST_ASSERT_NOT_NULL(other_if);
+    TEST_ASSERT_NOT_NULL(notify_if);
+    // Mixer deny delete when input still exists
+    TEST_ASSERT_EQUAL(ESP_CODEC_DEV_WRONG_STATE, esp_codec_dev_mixer_delete(mixer));
+
+    // Single writer pass through
+    esp_codec_dev_handle_t music = new_mixer_writer(music_if, 16, 2);
+    capture_reset(cap, 1000);
+    write_const(music, 16, 2, 1000, 100);
+    esp_codec_dev_sleep(200);
+    TEST_ASSERT_EQUAL(1000, cap->max);
+    TEST_ASSERT_EQUAL(0, cap->min);
+    TEST_ASSERT_GREATER_THAN(0, cap->match_count);
+
+    // Mix with writer in another format, output saturate instead of wrap
+    esp_codec_dev_handle_t other = new_mixer_writer(other_if, 32, 1);
+    capture_reset(cap, INT16_MAX);
+    write_const(music, 16, 2, 30000, 100);
+    write_const(other, 32, 1, 30000 << 16, 100);
+    esp_codec_dev_sleep(200);
+    TEST_ASSERT_EQUAL(INT16_MAX, cap->max);
+    TEST_ASSERT_EQUAL(0, cap->min);
+    TEST_ASSERT_GREATER_THAN(0, cap->match_count);
+    esp_codec_dev_close(other);
+
+    // Music ducked to -20dB when notification playing
+    esp_codec_dev_handle_t notify = new_mixer_writer(notify_if, 16, 1);
+    capture_reset(cap, 10000 * 3276 >> 15);
+    write_const(music, 16, 2, 10000, 150);
+    write_const(notify, 16, 1, 0, 150);
+    esp_codec_dev_sleep(300);
+    TEST_ASSERT_GREATER_THAN(0, cap->match_count);
+
+    esp_codec_dev_delete(music);
+    esp_codec_dev_delete(other);
+    esp_codec_dev_delete(notify);
+    audio_codec_delete_data_if(music_if);
+    audio_codec_delete_data_if(other_if);
+    audio_codec_delete_data_if(notify_if);
+    TEST_ESP_OK(esp_codec_dev_mixer_delete(mixer));
+    esp_codec_dev_delete(out_dev);
+    free(cap);
+}
+
+typedef struct {
+    esp_codec_dev_handle_t dev;
+    int                    ret;
+    bool                   done;
+} blocked_writer_t;
+
+static void blocked_writer_task(void *arg)
+{
+    blocked_writer_t *writer = (blocked_writer_t *) arg;
+    int size = TEST_RATE * 2;
+    int16_t *data = (int16_t *) malloc(size);
+    if (data) {
+        for (int i = 0; i < size / 2; i++) {
+            data[i] = 3000;
+        }
+        // One second of data into 40ms buffer, stay blocked until device closed
+        writer->ret = esp_codec_dev_write(writer->dev, data, size);
+        free(data);
+    }
+    writer->done = true;
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("esp codec dev software mixer close blocked writer and prebuffer", "[esp_codec_dev]")
+{
+    capture_data_t *cap = (capture_data_t *) calloc(1, sizeof(capture_data_t));
+    TEST_ASSERT_NOT_NULL(cap);
+    cap->base.is_open = capture_is_open;
+    cap->base.write = capture_write;
+    esp_codec_dev_cfg_t out_cfg = {
+        .dev_type = ESP_CODEC_DEV_TYPE_OUT,
+        .data_if = &cap->base,
+    };
+    esp_codec_dev_handle_t out_dev = esp_codec_dev_new(&out_cfg);
+    TEST_ASSERT_NOT_NULL(out_dev);
+    esp_codec_dev_sample_info_t fs = {
+        .bits_per_sample = 16,
+        .channel = 1,
+        .sample_rate = TEST_RATE,
+    };
+    TEST_ESP_OK(esp_codec_dev_open(out_dev, &fs));
+    TEST_ESP_OK(esp_codec_dev_set_out_vol(out_dev, 100));
+    esp_codec_dev_mixer_cfg_t mixer_cfg = {
+        .out_dev = out_dev,
+        .fs = fs,
+        .frame_ms = 10,
+        .task_prio = 5,
+        .task_core = -1,
+    };
+    esp_codec_dev_mixer_handle_t mixer = esp_codec_dev_mixer_new(&mixer_cfg);
+    TEST_ASSERT_NOT_NULL(mixer);
+    esp_codec_dev_mixer_input_cfg_t input_cfg = {
+        .buffer_ms = 40,
+        .prebuffer_ms = 20,
+    };
+    const audio_codec_data_if_t *input_if = esp_codec_dev_mixer_new_input(mixer, &input_cfg);
+    TEST_ASSERT_NOT_NULL(input_if);
+    esp_codec_dev_handle_t dev = new_mixer_writer(input_if, 16, 1);
+
+    // Writer blocked on full buffer quits when device closed
+    blocked_writer_t writer = {
+        .dev = dev,
+    };
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(blocked_writer_task, "blocked_writer", 4096, &writer, 5, NULL));
+    esp_codec_dev_sleep(100);
+    TEST_ASSERT_FALSE(writer.done);
+    TEST_ESP_OK(esp_codec_dev_close(dev));
+    esp_codec_dev_sleep(50);
+    TEST_ASSERT_TRUE(writer.done);
+    TEST_ASSERT_NOT_EQUAL(ESP_CODEC_DEV_OK, writer.ret);
+
+    // Data of closed writer is dropped, less than prebuffer is not played
+    esp_codec_dev_sample_info_t in_fs = fs;
+    TEST_ESP_OK(esp_codec_dev_open(dev, &in_fs));
+    TEST_ESP_OK(esp_codec_dev_set_out_vol(dev, 100));
+    capture_reset(cap, 1000);
+    write_const(dev, 16, 1, 1000, 10);
+    esp_codec_dev_sleep(50);
+    TEST_ASSERT_EQUAL(0, cap->max);
+    write_const(dev, 16, 1, 1000, 20);
+    esp_codec_dev_sleep(100);
+    // Volume may still ramp up after open
+    TEST_ASSERT_GREATER_THAN(0, cap->max);
+    TEST_ASSERT_LESS_OR_EQUAL(1000, cap->max);
+
+    esp_codec_dev_delete(dev);
+    audio_codec_delete_data_if(input_if);
+    TEST_ESP_OK(esp_codec_dev_mixer_delete(mixer));
+    esp_codec_dev_delete(out_dev);
+    free(cap);
+}
@@ -10,6 +10,8 @@
 #include "unity.h"
 #include "my_codec.h"
 #include "esp_codec_dev_defaults.h"
+#include "audio_codec_ctrl_cache.h"
+#include "audio_codec_sw_vol.h"
 
 // Customized volume curve taken from android framework
 static esp_codec_dev_vol_map_t volume_maps[] = {
@@ -19,6 +21,13 @@ static esp_codec_dev_vol_map_t volume_maps[] = {
     {.vol = 100, .db_value = 0.0},
 };
 
+static void async_done(const audio_codec_data_if_t *h, uint8_t *data, int size, int ret, void *ctx)
+{
+    if (ret == ESP_CODEC_DEV_OK) {
+        *(int *) ctx = size;
+    }
+}
+
 /*
  * Test case for esp_codec_dev API using customized interface
  */
@@ -115,7 +124,52 @@ TEST_CASE("esp codec dev API test", "[esp_codec_dev]")
     TEST_ESP_OK(ret);
     TEST_ASSERT_EQUAL(512, codec_data->write_idx);
 
+    // Asynchronous write fallback to blocking write when data interface not support it
+    int done_size = 0;
+    ret = esp_codec_dev_write_async(dev, data, 256, async_done, &done_size);
+    TEST_ESP_OK(ret);
+    TEST_ASSERT_EQUAL(256, done_size);
+    TEST_ASSERT_EQUAL(768, codec_data->write_idx);
+    ret = esp_codec_dev_read_async(dev, data, 128, async_done, &done_size);
+    TEST_ESP_OK(ret);
+    TEST_ASSERT_EQUAL(128, done_size);
+
+    // Reconfigure only update format, codec not re-enabled and settings not re-applied
+    int fmt_count = codec_data->set_fmt_count;
+    codec_ctrl->write_count = 0;
+    ret = esp_codec_dev_reconfigure(dev, &fs);
+    TEST_ESP_OK(ret);
+    TEST_ASSERT_EQUAL(fmt_count, codec_data->set_fmt_count);
+    TEST_ASSERT_EQUAL(0, codec_ctrl->write_count);
+    fs.sample_rate = 16000;
+    ret = esp_codec_dev_reconfigure(dev, &fs);
+    TEST_ESP_OK(ret);
+    TEST_ASSERT_EQUAL(fmt_count + 1, codec_data->set_fmt_count);
+    TEST_ASSERT_EQUAL(16000, codec_data->fmt.sample_rate);
+    // Only rate register written, volume and mute not re-applied
+    TEST_ASSERT_EQUAL(1, codec_ctrl->write_count);
+    TEST_ASSERT_EQUAL(16, codec_ctrl->reg[MY_CODEC_REG_RATE]);
+    // Codec not support the rate, data interface rolled back to previous format
+    codec_ctrl->write_count = 0;
+    fs.sample_rate = 192000;
+    ret = esp_codec_dev_reconfigure(dev, &fs);
+    TEST_ASSERT_EQUAL(ESP_CODEC_DEV_NOT_SUPPORT, ret);
+    TEST_ASSERT_EQUAL(16000, codec_data->fmt.sample_rate);
+    TEST_ASSERT_EQUAL(16, codec_ctrl->reg[MY_CODEC_REG_RATE]);
+    TEST_ASSERT_EQUAL(0, codec_ctrl->write_count);
+    fs.sample_rate = 16000;
+    ret = esp_codec_dev_write(dev, data, 512);
+    TEST_ESP_OK(ret);
+    // Close and open again write all registers
+    esp_codec_dev_close(dev);
+    fs.sample_rate = 48000;
+    ret = esp_codec_dev_open(dev, &fs);
+    TEST_ESP_OK(ret);
+    TEST_ASSERT_GREATER_THAN(0, codec_ctrl->write_count);
+
     esp_codec_dev_close(dev);
+    ret = esp_codec_dev_reconfigure(dev, &fs);
+    TEST_ASSERT_EQUAL(ESP_CODEC_DEV_WRONG_STATE, ret);
 
     // Test for volume curve settings
     ret = esp_codec_dev_set_vol_curve(dev, &vol_curve);
@@ -266,6 +320,263 @@ TEST_CASE("esp codec dev wrong argument test", "[esp_codec_dev]")
     audio_codec_delete_gpio_if(gpio_if);
 }
 
+TEST_CASE("esp codec dev register cache and batch test", "[esp_codec_dev]")
+{
+    const audio_codec_ctrl_if_t *bus_if = my_codec_ctrl_new();
+    TEST_ASSERT_NOT_NULL(bus_if);
+    my_codec_ctrl_t *bus = (my_codec_ctrl_t *) bus_if;
+    uint8_t uncached_regs[] = { MY_CODEC_REG_SUSPEND };
+    audio_codec_ctrl_cache_cfg_t cache_cfg = {
+        .bus_if = bus_if,
+        .burst = true,
+        .uncached_regs = uncached_regs,
+        .uncached_num = sizeof(uncached_regs),
+    };
+    const audio_codec_ctrl_if_t *ctrl_if = audio_codec_new_ctrl_cache(&cache_cfg);
+    TEST_ASSERT_NOT_NULL(ctrl_if);
+    uint8_t v = 10;
+    // Same value written again is skipped, read of written register served by cache
+    TEST_ESP_OK(ctrl_if->write_reg(ctrl_if, MY_CODEC_REG_VOL, 1, &v, 1));
+    TEST_ESP_OK(ctrl_if->write_reg(ctrl_if, MY_CODEC_REG_VOL, 1, &v, 1));
+    v = 0;
+    TEST_ESP_OK(ctrl_if->read_reg(ctrl_if, MY_CODEC_REG_VOL, 1, &v, 1));
+    TEST_ASSERT_EQUAL(10, v);
+    TEST_ASSERT_EQUAL(1, bus->write_count);
+    TEST_ASSERT_EQUAL(0, bus->read_count);
+
+    // Update bits read bus once, unchanged value not written
+    TEST_ESP_OK(audio_codec_ctrl_update_bits(ctrl_if, MY_CODEC_REG_MUTE, 1, 0x01, 0x01));
+    TEST_ESP_OK(audio_codec_ctrl_update_bits(ctrl_if, MY_CODEC_REG_MUTE, 1, 0x01, 0x01));
+    TEST_ASSERT_EQUAL(1, bus->read_count);
+    TEST_ASSERT_EQUAL(2, bus->write_count);
+    TEST_ASSERT_EQUAL(1, bus->reg[MY_CODEC_REG_MUTE]);
+
+    // Consecutive registers in nested batch sent in one transaction when outermost batch end
+    bus->write_count = 0;
+    TEST_ESP_OK(audio_codec_ctrl_batch_begin(ctrl_if));
+    for (int i = MY_CODEC_REG_VOL; i <= MY_CODEC_REG_MIC_MUTE; i++) {
+        v = 0x20 + i;
+        TEST_ESP_OK(audio_codec_ctrl_batch_begin(ctrl_if));
+        TEST_ESP_OK(ctrl_if->write_reg(ctrl_if, i, 1, &v, 1));
+        TEST_ESP_OK(audio_codec_ctrl_batch_end(ctrl_if));
+    }
+    TEST_ASSERT_EQUAL(0, bus->write_count);
+    TEST_ESP_OK(audio_codec_ctrl_batch_end(ctrl_if));
+    TEST_ASSERT_EQUAL(1, bus->write_count);
+    for (int i = MY_CODEC_REG_VOL; i <= MY_CODEC_REG_MIC_MUTE; i++) {
+        TEST_ASSERT_EQUAL(0x20 + i, bus->reg[i]);
+    }
+    TEST_ASSERT(audio_codec_ctrl_batch_end(ctrl_if) != ESP_CODEC_DEV_OK);
+
+    // Uncached register always go through bus and drop whole cache
+    bus->write_count = 0;
+    bus->read_count = 0;
+    v = 1;
+    TEST_ESP_OK(ctrl_if->write_reg(ctrl_if, MY_CODEC_REG_SUSPEND, 1, &v, 1));
+    TEST_ESP_OK(ctrl_if->write_reg(ctrl_if, MY_CODEC_REG_SUSPEND, 1, &v, 1));
+    TEST_ASSERT_EQUAL(2, bus->write_count);
+    TEST_ESP_OK(ctrl_if->read_reg(ctrl_if, MY_CODEC_REG_VOL, 1, &v, 1));
+    TEST_ASSERT_EQUAL(1, bus->read_count);
+
+    // Page or reset register queued in batch, same value written after it still reach codec
+    bus->write_count = 0;
+    TEST_ESP_OK(audio_codec_ctrl_batch_begin(ctrl_if));
+    uint8_t page = 0;
+    TEST_ESP_OK(ctrl_if->write_reg(ctrl_if, MY_CODEC_REG_SUSPEND, 1, &page, 1));
+    TEST_ESP_OK(ctrl_if->write_reg(ctrl_if, MY_CODEC_REG_VOL, 1, &v, 1));
+    TEST_ESP_OK(audio_codec_ctrl_batch_end(ctrl_if));
+    TEST_ASSERT_EQUAL(2, bus->write_count);
+    audio_codec_delete_ctrl_if(ctrl_if);
+
+    // Without burst each register is one transaction
+    cache_cfg.burst = false;
+    ctrl_if = audio_codec_new_ctrl_cache(&cache_cfg);
+    TEST_ASSERT_NOT_NULL(ctrl_if);
+    bus->write_count = 0;
+    TEST_ESP_OK(audio_codec_ctrl_batch_begin(ctrl_if));
+    for (int i = MY_CODEC_REG_VOL; i <= MY_CODEC_REG_MIC_MUTE; i++) {
+        v = 0x30 + i;
+        TEST_ESP_OK(ctrl_if->write_reg(ctrl_if, i, 1, &v, 1));
+    }
+    TEST_ESP_OK(audio_codec_ctrl_batch_end(ctrl_if));
+    TEST_ASSERT_EQUAL(MY_CODEC_REG_MIC_MUTE + 1, bus->write_count);
+    audio_codec_delete_ctrl_if(ctrl_if);
+    audio_codec_delete_ctrl_if(bus_if);
+}
+
+TEST_CASE("esp codec dev register cache codec bus access test", "[esp_codec_dev]")
+{
+    const audio_codec_ctrl_if_t *bus_if = my_codec_ctrl_new();
+    TEST_ASSERT_NOT_NULL(bus_if);
+    my_codec_ctrl_t *bus = (my_codec_ctrl_t *) bus_if;
+    audio_codec_ctrl_cache_cfg_t cache_cfg = {
+        .bus_if = bus_if,
+        .burst = true,
+    };
+    const audio_codec_ctrl_if_t *ctrl_if = audio_codec_new_ctrl_cache(&cache_cfg);
+    TEST_ASSERT_NOT_NULL(ctrl_if);
+    const audio_codec_data_if_t *data_if = my_codec_data_new();
+    TEST_ASSERT_NOT_NULL(data_if);
+    const audio_codec_gpio_if_t *gpio_if = audio_codec_new_gpio();
+    TEST_ASSERT_NOT_NULL(gpio_if);
+    my_codec_cfg_t codec_cfg = {
+        .ctrl_if = ctrl_if,
+        .gpio_if = gpio_if,
+    };
+    // Initial volume and mute registers are consecutive, sent in one transaction
+    const audio_codec_if_t *codec_if = my_codec_new(&codec_cfg);
+    TEST_ASSERT_NOT_NULL(codec_if);
+    TEST_ASSERT_EQUAL(1, bus->write_count);
+    esp_codec_dev_cfg_t dev_cfg = {
+        .dev_type = ESP_CODEC_DEV_TYPE_OUT,
+        .codec_if = codec_if,
+        .data_if = data_if,
+    };
+    esp_codec_dev_handle_t dev = esp_codec_dev_new(&dev_cfg);
+    TEST_ASSERT_NOT_NULL(dev);
+    esp_codec_dev_sample_info_t fs = {
+        .bits_per_sample = 16,
+        .sample_rate = 48000,
+        .channel = 2,
+    };
+    // Open write rate, wakeup and volume, mute restored with same value is skipped
+    bus->write_count = 0;
+    TEST_ESP_OK(esp_codec_dev_open(dev, &fs));
+    TEST_ASSERT_EQUAL(3, bus->write_count);
+
+    // Same volume set again not access bus
+    bus->write_count = 0;
+    TEST_ESP_OK(esp_codec_dev_set_out_vol(dev, 60));
+    TEST_ESP_OK(esp_codec_dev_set_out_vol(dev, 60));
+    TEST_ASSERT_EQUAL(1, bus->write_count);
+
+    // Sample rate changed only write rate register
+    bus->write_count = 0;
+    fs.sample_rate = 16000;
+    TEST_ESP_OK(esp_codec_dev_reconfigure(dev, &fs));
+    TEST_ASSERT_EQUAL(1, bus->write_count);
+
+    // Open again only write suspend and mute registers changed by close, rate and volume kept
+    esp_codec_dev_close(dev);
+    bus->write_count = 0;
+    TEST_ESP_OK(esp_codec_dev_open(dev, &fs));
+    TEST_ASSERT_EQUAL(2, bus->write_count);
+    TEST_ASSERT_EQUAL(0, bus->read_count);
+    TEST_ASSERT_EQUAL(16, bus->reg[MY_CODEC_REG_RATE]);
+    TEST_ASSERT_EQUAL(0, bus->reg[MY_CODEC_REG_SUSPEND]);
+    TEST_ASSERT_EQUAL(0, bus->reg[MY_CODEC_REG_MUTE]);
+
+    esp_codec_dev_close(dev);
+    esp_codec_dev_delete(dev);
+    audio_codec_delete_codec_if(codec_if);
+    audio_codec_delete_ctrl_if(ctrl_if);
+    audio_codec_delete_ctrl_if(bus_if);
+    audio_codec_delete_data_if(data_if);
+    audio_codec_delete_gpio_if(gpio_if);
+}
+
+TEST_CASE("esp codec dev volume crossover test", "[esp_codec_dev]")
+{
+    const audio_codec_ctrl_if_t *ctrl_if = my_codec_ctrl_new();
+    TEST_ASSERT_NOT_NULL(ctrl_if);
+    my_codec_ctrl_t *codec_ctrl = (my_codec_ctrl_t *) ctrl_if;
+    const audio_codec_data_if_t *data_if = my_codec_data_new();
+    TEST_ASSERT_NOT_NULL(data_if);
+    const audio_codec_gpio_if_t *gpio_if = audio_codec_new_gpio();
+    TEST_ASSERT_NOT_NULL(gpio_if);
+    my_codec_cfg_t codec_cfg = {
+        .ctrl_if = ctrl_if,
+        .gpio_if = gpio_if,
+        .hw_gain = {
+            .pa_voltage = 3.3,
+            .codec_dac_voltage = 3.3, // No extra hardware gain so that register equals to -dB
+        },
+    };
+    const audio_codec_if_t *codec_if = my_codec_new(&codec_cfg);
+    TEST_ASSERT_NOT_NULL(codec_if);
+    esp_codec_dev_cfg_t dev_cfg = {
+        .dev_type = ESP_CODEC_DEV_TYPE_OUT,
+        .codec_if = codec_if,
+        .data_if = data_if,
+    };
+    esp_codec_dev_handle_t dev = esp_codec_dev_new(&dev_cfg);
+    TEST_ASSERT_NOT_NULL(dev);
+    TEST_ASSERT(esp_codec_dev_set_vol_crossover(dev, 10.0, 0) != ESP_CODEC_DEV_OK);
+    TEST_ESP_OK(esp_codec_dev_set_vol_crossover(dev, 6.0, 0));
+    esp_codec_dev_sample_info_t fs = {
+        .bits_per_sample = 16,
+        .sample_rate = 16000,
+        .channel = 1,
+    };
+    TEST_ESP_OK(esp_codec_dev_open(dev, &fs));
+    // 100ms data so that software ramp finished
+    int samples = 1600;
+    int16_t *data = (int16_t *) malloc(samples * sizeof(int16_t));
+    TEST_ASSERT_NOT_NULL(data);
+
+    // Default curve: volume 50 is -25dB, hardware -24dB with software -1dB
+    TEST_ESP_OK(esp_codec_dev_set_out_vol(dev, 50));
+    for (int i = 0; i < samples; i++) {
+        data[i] = 10000;
+    }
+    TEST_ESP_OK(esp_codec_dev_write(dev, data, samples * sizeof(int16_t)));
+    TEST_ASSERT_EQUAL(24, codec_ctrl->reg[MY_CODEC_REG_VOL]);
+    TEST_ASSERT_EQUAL(10000 * 29204 >> 15, data[samples - 1]);
+
+    // Volume 52 is -24dB, only software changes
+    codec_ctrl->write_count = 0;
+    TEST_ESP_OK(esp_codec_dev_set_out_vol(dev, 52));
+    for (int i = 0; i < samples; i++) {
+        data[i] = 10000;
+    }
+    TEST_ESP_OK(esp_codec_dev_write(dev, data, samples * sizeof(int16_t)));
+    TEST_ASSERT_EQUAL(0, codec_ctrl->write_count);
+    TEST_ASSERT_EQUAL(10000, data[samples - 1]);
+
+    // Volume 60 is -20dB, hardware step up to -18dB applied when write
+    // Software jumps -6dB at once to keep level then ramps to -2dB
+    TEST_ESP_OK(esp_codec_dev_set_out_vol(dev, 60));
+    TEST_ASSERT_EQUAL(24, codec_ctrl->reg[MY_CODEC_REG_VOL]);
+    for (int i = 0; i < samples; i++) {
+        data[i] = 10000;
+    }
+    TEST_ESP_OK(esp_codec_dev_write(dev, data, samples * sizeof(int16_t)));
+    TEST_ASSERT_EQUAL(18, codec_ctrl->reg[MY_CODEC_REG_VOL]);
+    TEST_ASSERT_EQUAL(10000 * 16422 >> 15, data[0]);
+    TEST_ASSERT_EQUAL(10000 * 26028 >> 15, data[samples - 1]);
+
+    // Customized volume handler can not do compensation jump
+    const audio_codec_vol_if_t *vol_if = audio_codec_new_sw_vol();
+    TEST_ASSERT_NOT_NULL(vol_if);
+    TEST_ASSERT_EQUAL(ESP_CODEC_DEV_NOT_SUPPORT, esp_codec_dev_set_vol_handler(dev, vol_if));
+    audio_codec_delete_vol_if(vol_if);
+
+    // 50ms output delay: volume 72 is -14dB, software jumps -6dB from -2dB
+    // Hardware -12dB is written after 800 samples written
+    TEST_ESP_OK(esp_codec_dev_set_vol_crossover(dev, 6.0, 50));
+    TEST_ESP_OK(esp_codec_dev_set_out_vol(dev, 72));
+    for (int i = 0; i < samples; i++) {
+        data[i] = 10000;
+    }
+    TEST_ESP_OK(esp_codec_dev_write(dev, data, samples * sizeof(int16_t)));
+    TEST_ASSERT_EQUAL(18, codec_ctrl->reg[MY_CODEC_REG_VOL]);
+    TEST_ASSERT_EQUAL(10000 * (26028 * 16422 >> 15) >> 15, data[0]);
+    TEST_ESP_OK(esp_codec_dev_write(dev, data, samples * sizeof(int16_t)));
+    TEST_ASSERT_EQUAL(12, codec_ctrl->reg[MY_CODEC_REG_VOL]);
+
+    // Disable crossover restore hardware volume to 0dB when write
+    TEST_ESP_OK(esp_codec_dev_set_vol_crossover(dev, 0, 0));
+    TEST_ESP_OK(esp_codec_dev_write(dev, data, samples * sizeof(int16_t)));
+    TEST_ASSERT_EQUAL(0, codec_ctrl->reg[MY_CODEC_REG_VOL]);
+
+    free(data);
+    esp_codec_dev_delete(dev);
+    audio_codec_delete_codec_if(codec_if);
+    audio_codec_delete_ctrl_if(ctrl_if);
+    audio_codec_delete_data_if(data_if);
+    audio_codec_delete_gpio_if(gpio_if);
+}
+
 TEST_CASE("esp codec dev feature should not support", "[esp_codec_dev]")
 {
     const audio_codec_ctrl_if_t *ctrl_if = my_codec_ctrl_new();
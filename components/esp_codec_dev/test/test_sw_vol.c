@@ -0,0 +1,206 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "unity.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "audio_codec_sw_vol.h"
+
+#define TAG             "SW_VOL_TEST"
+#define TEST_FRAMES     (480)
+#define TEST_CHANNEL    (2)
+#define TEST_RATE       (48000)
+
+static int32_t get_sample(uint8_t *data, int bits, int idx)
+{
+    if (bits == 16) {
+        return ((int16_t *) data)[idx];
+    }
+    if (bits == 24) {
+        uint8_t *p = data + idx * 3;
+        return (int32_t) (((uint32_t) p[0] << 8) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 24)) >> 8;
+    }
+    return ((int32_t *) data)[idx];
+}
+
+static void set_sample(uint8_t *data, int bits, int idx, int32_t v)
+{
+    if (bits == 16) {
+        ((int16_t *) data)[idx] = (int16_t) v;
+    } else if (bits == 24) {
+        uint8_t *p = data + idx * 3;
+        p[0] = (uint8_t) v;
+        p[1] = (uint8_t) (v >> 8);
+        p[2] = (uint8_t) (v >> 16);
+    } else {
+        ((int32_t *) data)[idx] = v;
+    }
+}
+
+// Reference: multiply with Q15 gain, floor and clip, one sample at a time
+static int32_t ref_sample(int32_t v, int bits, int gain)
+{
+    int64_t max = (1LL << (bits - 1)) - 1;
+    int64_t r = ((int64_t) v * gain) >> 15;
+    if (r > max) {
+        r = max;
+    } else if (r < -max - 1) {
+        r = -max - 1;
+    }
+    return (int32_t) r;
+}
+
+static void fill_data(uint8_t *data, int bits, int n)
+{
+    int64_t max = (1LL << (bits - 1)) - 1;
+    srand(bits);
+    for (int i = 0; i < n; i++) {
+        // Mix full scale values to check saturation
+        int64_t v = (i % 7 == 0) ? ((i & 8) ? max : -max - 1) : ((int64_t) rand() % (2 * max) - max);
+        set_sample(data, bits, i, (int32_t) v);
+    }
+}
+
+static void check_const_gain(int bits, float db)
+{
+    esp_codec_dev_sample_info_t fs = {
+        .bits_per_sample = bits,
+        .channel = TEST_CHANNEL,
+        .sample_rate = TEST_RATE,
+    };
+    int n = TEST_FRAMES * TEST_CHANNEL;
+    int size = n * bits / 8;
+    uint8_t *in = (uint8_t *) malloc(size);
+    uint8_t *out = (uint8_t *) malloc(size);
+    uint8_t *ref = (uint8_t *) malloc(size);
+    TEST_ASSERT_NOT_NULL(in);
+    TEST_ASSERT_NOT_NULL(out);
+    TEST_ASSERT_NOT_NULL(ref);
+    fill_data(in, bits, n);
+    int gain = db <= -96.0 ? 0 : (int) (exp(db / 20 * log(10)) * (1 << 15));
+    if (gain > 65535) {
+        gain = 65535;
+    }
+    for (int i = 0; i < n; i++) {
+        set_sample(ref, bits, i, ref_sample(get_sample(in, bits, i), bits, gain));
+    }
+    // Set volume before open so that no ramp
+    const audio_codec_vol_if_t *vol = audio_codec_new_sw_vol();
+    TEST_ASSERT_NOT_NULL(vol);
+    TEST_ASSERT_EQUAL(ESP_CODEC_DEV_OK, vol->set_vol(vol, db));
+    TEST_ASSERT_EQUAL(ESP_CODEC_DEV_OK, vol->open(vol, &fs, 50));
+    // Out of place keeps input untouched
+    TEST_ASSERT_EQUAL(0, vol->process(vol, in, size, out, size));
+    TEST_ASSERT_EQUAL_MEMORY(ref, out, size);
+    // In place give same result
+    TEST_ASSERT_EQUAL(0, vol->process(vol, in, size, in, size));
+    TEST_ASSERT_EQUAL_MEMORY(ref, in, size);
+    vol->close(vol);
+    audio_codec_delete_vol_if(vol);
+    free(in);
+    free(out);
+    free(ref);
+}
+
+TEST_CASE("sw volume bit exact with reference", "[esp_codec_dev]")
+{
+    float db_list[] = { -96.0, -20.0, -6.0, 0.0, 3.0, 6.0 };
+    int bits_list[] = { 16, 24, 32 };
+    for (int i = 0; i < sizeof(bits_list) / sizeof(bits_list[0]); i++) {
+        for (int j = 0; j < sizeof(db_list) / sizeof(db_list[0]); j++) {
+            check_const_gain(bits_list[i], db_list[j]);
+        }
+    }
+}
+
+TEST_CASE("sw volume ramp in place and out of place", "[esp_codec_dev]")
+{
+    int bits_list[] = { 16, 24, 32 };
+    for (int i = 0; i < sizeof(bits_list) / sizeof(bits_list[0]); i++) {
+        int bits = bits_list[i];
+        esp_codec_dev_sample_info_t fs = {
+            .bits_per_sample = bits,
+            .channel = TEST_CHANNEL,
+            .sample_rate = TEST_RATE,
+        };
+        int n = TEST_FRAMES * TEST_CHANNEL;
+        int size = n * bits / 8;
+        uint8_t *in = (uint8_t *) malloc(size);
+        uint8_t *out = (uint8_t *) malloc(size);
+        uint8_t *in_place = (uint8_t *) malloc(size);
+        TEST_ASSERT_NOT_NULL(in);
+        TEST_ASSERT_NOT_NULL(out);
+        TEST_ASSERT_NOT_NULL(in_place);
+        const audio_codec_vol_if_t *vol = audio_codec_new_sw_vol();
+        const audio_codec_vol_if_t *vol_in_place = audio_codec_new_sw_vol();
+        TEST_ASSERT_NOT_NULL(vol);
+        TEST_ASSERT_NOT_NULL(vol_in_place);
+        vol->set_vol(vol, 0.0);
+        vol_in_place->set_vol(vol_in_place, 0.0);
+        vol->open(vol, &fs, 5);
+        vol_in_place->open(vol_in_place, &fs, 5);
+        // Ramp down to -20dB within 5ms
+        vol->set_vol(vol, -20.0);
+        vol_in_place->set_vol(vol_in_place, -20.0);
+        for (int k = 0; k < n; k++) {
+            set_sample(in, bits, k, 1 << (bits - 2));
+        }
+        memcpy(in_place, in, size);
+        TEST_ASSERT_EQUAL(0, vol->process(vol, in, size, out, size));
+        TEST_ASSERT_EQUAL(0, vol_in_place->process(vol_in_place, in_place, size, in_place, size));
+        TEST_ASSERT_EQUAL_MEMORY(out, in_place, size);
+        // Gain only goes down and reach target gain at last
+        int32_t last = get_sample(out, bits, 0);
+        for (int k = 1; k < n; k++) {
+            int32_t v = get_sample(out, bits, k);
+            TEST_ASSERT_LESS_OR_EQUAL(last, v);
+            last = v;
+        }
+        int gain = (int) (exp(-20.0 / 20 * log(10)) * (1 << 15));
+        TEST_ASSERT_EQUAL(ref_sample(1 << (bits - 2), bits, gain), last);
+        vol->close(vol);
+        vol_in_place->close(vol_in_place);
+        audio_codec_delete_vol_if(vol);
+        audio_codec_delete_vol_if(vol_in_place);
+        free(in);
+        free(out);
+        free(in_place);
+    }
+}
+
+TEST_CASE("sw volume process performance", "[esp_codec_dev]")
+{
+    int bits_list[] = { 16, 24, 32 };
+    int loop = 100;
+    for (int i = 0; i < sizeof(bits_list) / sizeof(bits_list[0]); i++) {
+        int bits = bits_list[i];
+        esp_codec_dev_sample_info_t fs = {
+            .bits_per_sample = bits,
+            .channel = TEST_CHANNEL,
+            .sample_rate = TEST_RATE,
+        };
+        int size = TEST_FRAMES * TEST_CHANNEL * bits / 8;
+        uint8_t *data = (uint8_t *) calloc(1, size);
+        TEST_ASSERT_NOT_NULL(data);
+        const audio_codec_vol_if_t *vol = audio_codec_new_sw_vol();
+        TEST_ASSERT_NOT_NULL(vol);
+        vol->set_vol(vol, -10.0);
+        vol->open(vol, &fs, 50);
+        int64_t start = esp_timer_get_time();
+        for (int k = 0; k < loop; k++) {
+            vol->process(vol, data, size, data, size);
+        }
+        int64_t elapse = esp_timer_get_time() - start;
+        // Each process handles 10ms audio
+        ESP_LOGI(TAG, "%d bits: %d us per 10ms frame", bits, (int) (elapse / loop));
+        vol->close(vol);
+        audio_codec_delete_vol_if(vol);
+        free(data);
+    }
+}
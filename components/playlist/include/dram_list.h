@@ -196,6 +196,19 @@ esp_err_t dram_list_remove_by_url_id(playlist_operator_handle_t handle, uint16_t
  */
 esp_err_t dram_list_destroy(playlist_operator_handle_t handle);
 
+/**
+ * @brief Set shuffle and repeat mode of dram playlist
+ *
+ * @param handle     Playlist handle
+ * @param shuffle    Play in shuffled order
+ * @param repeat     Behavior at both ends of playlist
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t dram_list_set_mode(playlist_operator_handle_t handle, bool shuffle, playlist_repeat_t repeat);
+
 #ifdef __cplusplus
 }
 #endif
@@ -45,6 +45,9 @@ esp_err_t flash_list_create(playlist_operator_handle_t *handle);
 /**
  * @brief Save URL to nvs flash list
  *
+ * @note  File names are packed into pages, the latest page is kept in RAM and written to nvs
+ *        when it is full or by `flash_list_save_commit`
+ *
  * @param handle    Playlist handle
  * @param url       URL to be saved
  *
@@ -172,6 +175,43 @@ int flash_list_get_url_id(playlist_operator_handle_t handle);
  */
 esp_err_t flash_list_destroy(playlist_operator_handle_t handle);
 
+/**
+ * @brief Start buffering URLs saved to flash playlist
+ *
+ * @note  The latest page of file names is always buffered, so it does nothing and is kept for batch save API
+ *
+ * @param handle     Playlist handle
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t flash_list_save_begin(playlist_operator_handle_t handle);
+
+/**
+ * @brief Write the latest page of buffered URLs to nvs
+ *
+ * @param handle     Playlist handle
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t flash_list_save_commit(playlist_operator_handle_t handle);
+
+/**
+ * @brief Set shuffle and repeat mode of flash playlist
+ *
+ * @param handle     Playlist handle
+ * @param shuffle    Play in shuffled order
+ * @param repeat     Behavior at both ends of playlist
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t flash_list_set_mode(playlist_operator_handle_t handle, bool shuffle, playlist_repeat_t repeat);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,122 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _MEDIA_PROBE_H_
+#define _MEDIA_PROBE_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEDIA_PROBE_TITLE_SIZE      (64)
+#define MEDIA_PROBE_ARTIST_SIZE     (40)
+
+/**
+ * @brief Container or stream format found by probe
+ */
+typedef enum {
+    MEDIA_PROBE_FORMAT_UNKNOWN = 0, /*!< Not recognized */
+    MEDIA_PROBE_FORMAT_MP3,         /*!< MPEG audio, with or without ID3 tag */
+    MEDIA_PROBE_FORMAT_WAV,         /*!< RIFF WAVE */
+    MEDIA_PROBE_FORMAT_FLAC,        /*!< Native FLAC */
+    MEDIA_PROBE_FORMAT_AAC,         /*!< AAC in ADTS */
+    MEDIA_PROBE_FORMAT_M4A,         /*!< MP4 or M4A */
+} media_probe_format_t;
+
+#define MEDIA_PROBE_FLAG_VALID      (1 << 0)    /*!< Record is filled by probe */
+#define MEDIA_PROBE_FLAG_ESTIMATED  (1 << 1)    /*!< Duration is estimated from bitrate and file size */
+#define MEDIA_PROBE_FLAG_GAPLESS    (1 << 2)    /*!< Encoder delay and padding are signalled by LAME tag or iTunSMPB */
+
+/**
+ * @brief Fixed-size metadata record, 128 bytes, strings are UTF-8 and '\0' terminated
+ */
+typedef struct {
+    uint8_t  format;                            /*!< media_probe_format_t */
+    uint8_t  flags;                             /*!< MEDIA_PROBE_FLAG_xxx */
+    uint8_t  channels;                          /*!< Channels, 0 if unknown */
+    uint8_t  bits;                              /*!< Bits per sample, 0 if unknown or compressed */
+    uint32_t sample_rate;                       /*!< Sample rate, 0 if unknown */
+    uint32_t duration_ms;                       /*!< Duration in milliseconds, 0 if unknown */
+    uint32_t bitrate;                           /*!< Average bitrate in bits per second, 0 if unknown */
+    uint16_t enc_delay;                         /*!< Samples added by encoder at start, valid with MEDIA_PROBE_FLAG_GAPLESS */
+    uint16_t enc_padding;                       /*!< Samples added by encoder at end, valid with MEDIA_PROBE_FLAG_GAPLESS */
+    uint32_t total_samples;                     /*!< Samples per channel without delay and padding, 0 if not exactly known */
+    char     title[MEDIA_PROBE_TITLE_SIZE];     /*!< Title from tag, empty if none */
+    char     artist[MEDIA_PROBE_ARTIST_SIZE];   /*!< Artist from tag, empty if none */
+} media_probe_info_t;
+
+#define MEDIA_PROBE_FRAME_HEADER_SIZE   (7)     /*!< Bytes needed by `media_probe_frame` */
+
+/**
+ * @brief Frame information from MP3 or AAC ADTS frame header
+ */
+typedef struct {
+    uint8_t  format;                            /*!< MEDIA_PROBE_FORMAT_MP3 or MEDIA_PROBE_FORMAT_AAC */
+    uint8_t  channels;                          /*!< Channels */
+    uint16_t samples;                           /*!< Samples per channel in frame */
+    uint32_t sample_rate;                       /*!< Sample rate */
+    uint32_t bytes;                             /*!< Frame size including header */
+} media_probe_frame_t;
+
+/**
+ * @brief Read tags and stream header of an audio file, only the bytes needed are read
+ *
+ * @note  Supported: ID3v2 and ID3v1 tags, MP3 (Xing, VBRI or constant bitrate), WAV fmt and data chunk,
+ *        FLAC STREAMINFO and Vorbis comment, AAC ADTS (duration estimated from first frames), MP4 mvhd and ilst.
+ *        Encoder delay and padding are read from LAME tag of MP3 and iTunSMPB of MP4.
+ *
+ * @param      path  Path of file, or URL starts with "file:/"
+ * @param[out] info  Metadata, cleared before probe
+ *
+ * @return
+ *     - ESP_OK                 success, `info->format` may still be MEDIA_PROBE_FORMAT_UNKNOWN
+ *     - ESP_ERR_INVALID_ARG    invalid parameters
+ *     - ESP_ERR_NOT_SUPPORTED  URL of other scheme than "file:/", e.g. "http://", nothing is logged
+ *     - ESP_FAIL               fail to open file
+ */
+esp_err_t media_probe_file(const char *path, media_probe_info_t *info);
+
+/**
+ * @brief Parse MP3 or AAC ADTS frame header
+ *
+ * @note  Free format MP3 frames have no size in header and are not recognized
+ *
+ * @param      header  MEDIA_PROBE_FRAME_HEADER_SIZE bytes at start of frame
+ * @param[out] frame   Frame information
+ *
+ * @return
+ *     - ESP_OK                 success
+ *     - ESP_ERR_NOT_FOUND      not a frame header
+ *     - ESP_ERR_INVALID_ARG    invalid parameters
+ */
+esp_err_t media_probe_frame(const uint8_t *header, media_probe_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
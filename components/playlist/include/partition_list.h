@@ -174,6 +174,19 @@ esp_err_t partition_list_show(playlist_operator_handle_t handle);
  */
 esp_err_t partition_list_destroy(playlist_operator_handle_t handle);
 
+/**
+ * @brief Set shuffle and repeat mode of partition playlist
+ *
+ * @param handle     Playlist handle
+ * @param shuffle    Play in shuffled order
+ * @param repeat     Behavior at both ends of playlist
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t partition_list_set_mode(playlist_operator_handle_t handle, bool shuffle, playlist_repeat_t repeat);
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,6 +26,8 @@
 #define _PLAY_LIST_H_
 
 #include "esp_log.h"
+#include "media_probe.h"
+#include "seek_index.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,6 +44,15 @@ typedef enum {
     PLAYLIST_PARTITION      /*!< Playlist in partition */
 } playlist_type_t;
 
+/**
+ * @brief Behavior of next and prev at both ends of playlist
+ */
+typedef enum {
+    PLAYLIST_REPEAT_ALL = 0,  /*!< Wrap around to the other end, default */
+    PLAYLIST_REPEAT_ONE,      /*!< Next and prev keep the current URL */
+    PLAYLIST_REPEAT_NONE,     /*!< Next and prev fail with ESP_ERR_NOT_FOUND at both ends */
+} playlist_repeat_t;
+
 /**
  * @brief All types of Playlists' operation
  */
@@ -60,6 +71,12 @@ typedef struct {
     playlist_type_t      type;                                          /*!< Type of playlist */
     esp_err_t (*remove_by_url)(void *playlist, const char *url);        /*!< Remove the corresponding url */
     esp_err_t (*remove_by_id)(void *playlist, uint16_t url_id);         /*!< Remove url by id */
+    esp_err_t (*save_begin)(void *playlist);                            /*!< Start buffering saved URLs, optional */
+    esp_err_t (*save_commit)(void *playlist);                           /*!< Write buffered URLs to storage, optional */
+    esp_err_t (*set_mode)(void *playlist, bool shuffle, playlist_repeat_t repeat); /*!< Set play order and repeat mode, optional */
+    esp_err_t (*get_meta)(void *playlist, int url_id, media_probe_info_t *info);    /*!< Get saved metadata of url, optional */
+    esp_err_t (*get_seek_index)(void *playlist, int url_id, seek_index_t *index);   /*!< Get saved seek index of url, optional */
+    esp_err_t (*save_seek_index)(void *playlist, int url_id, const seek_index_t *index); /*!< Save seek index of url, optional */
 
 } playlist_operation_t;
 
@@ -187,6 +204,110 @@ int playlist_get_current_list_url_id(playlist_handle_t handle);
  */
 esp_err_t playlist_save(playlist_handle_t handle, const char *url);
 
+/**
+ * @brief Start a batch save in current playlist
+ *
+ * @note  URLs saved by `playlist_save` after this call are kept in RAM and written together by `playlist_save_commit`,
+ *        so that storage is synchronized once instead of once per URL. Only sdcard playlist buffers URLs now,
+ *        other playlists save URLs directly.
+ *
+ * @param handle  Playlist handle
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t playlist_save_begin(playlist_handle_t handle);
+
+/**
+ * @brief Write URLs buffered since `playlist_save_begin` to current playlist and end the batch save
+ *
+ * @param handle  Playlist handle
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t playlist_save_commit(playlist_handle_t handle);
+
+/**
+ * @brief Save several URLs to the current playlist in one batch
+ *
+ * @param handle  Playlist handle
+ * @param url     Array of URLs to be saved
+ * @param url_num Number of URLs
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t playlist_save_batch(playlist_handle_t handle, const char *url[], int url_num);
+
+/**
+ * @brief Set play mode of current playlist
+ *
+ * @note  When shuffle is enabled, next and prev follow a random order which starts from the current URL,
+ *        URLs saved later are put at random positions not played yet. Choose by url id is not affected.
+ *
+ * @param handle   Playlist handle
+ * @param shuffle  Play in shuffled order
+ * @param repeat   Behavior at both ends of playlist
+ *
+ * @return
+ *     - ESP_OK                 success
+ *     - ESP_ERR_NOT_SUPPORTED  current playlist not support play mode
+ *     - ESP_FAIL               failed
+ */
+esp_err_t playlist_set_mode(playlist_handle_t handle, bool shuffle, playlist_repeat_t repeat);
+
+/**
+ * @brief Get metadata of url in current playlist, which is probed when url saved
+ *
+ * @note  Only sdcard playlist keeps metadata, and only after `sdcard_list_enable_meta` is called
+ *
+ * @param      handle  Playlist handle
+ * @param      url_id  Url id in current playlist
+ * @param[out] info    Title, artist, duration and stream format of url
+ *
+ * @return
+ *     - ESP_OK                 success
+ *     - ESP_ERR_NOT_FOUND      no metadata for this url
+ *     - ESP_ERR_NOT_SUPPORTED  current playlist not support metadata
+ *     - ESP_FAIL               failed
+ */
+esp_err_t playlist_get_meta(playlist_handle_t handle, int url_id, media_probe_info_t *info);
+
+/**
+ * @brief Get seek index of url in current playlist
+ *
+ * @note  Only sdcard playlist keeps seek index
+ *
+ * @param      handle  Playlist handle
+ * @param      url_id  Url id in current playlist
+ * @param[out] index   Seek index saved by `playlist_save_seek_index`
+ *
+ * @return
+ *     - ESP_OK                 success
+ *     - ESP_ERR_NOT_FOUND      no seek index for this url
+ *     - ESP_ERR_NOT_SUPPORTED  current playlist not support seek index
+ *     - ESP_FAIL               failed
+ */
+esp_err_t playlist_get_seek_index(playlist_handle_t handle, int url_id, seek_index_t *index);
+
+/**
+ * @brief Save seek index of url in current playlist, so that url can be seeked without scanning next time
+ *
+ * @param handle  Playlist handle
+ * @param url_id  Url id in current playlist
+ * @param index   Seek index built by `seek_index_build_file` or by stream while playing
+ *
+ * @return
+ *     - ESP_OK                 success
+ *     - ESP_ERR_NOT_SUPPORTED  current playlist not support seek index
+ *     - ESP_FAIL               failed
+ */
+esp_err_t playlist_save_seek_index(playlist_handle_t handle, int url_id, const seek_index_t *index);
+
 /**
  * @brief Next URl in current playlist
  *
@@ -275,6 +396,8 @@ esp_err_t playlist_remove_by_url_id(playlist_handle_t handle, uint16_t url_id);
 /**
  * @brief Judge whether the url exists in current playlist
  *
+ * @note  Each playlist keeps hash of its URLs in RAM, only URLs with same hash are read from storage
+ *
  * @param handle   Playlist handle
  * @param url      The url to be checked
  *
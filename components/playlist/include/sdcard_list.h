@@ -172,6 +172,104 @@ esp_err_t sdcard_list_destroy(playlist_operator_handle_t handle);
  */
 esp_err_t sdcard_list_save(playlist_operator_handle_t handle, const char *url);
 
+/**
+ * @brief Start buffering URLs saved to sdcard playlist
+ *
+ * @note  Buffered URLs are appended to files without sync when buffer is full, or before other operations read the list
+ *
+ * @param handle     Playlist handle
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t sdcard_list_save_begin(playlist_operator_handle_t handle);
+
+/**
+ * @brief Append buffered URLs to sdcard playlist files, sync them once and stop buffering
+ *
+ * @param handle     Playlist handle
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t sdcard_list_save_commit(playlist_operator_handle_t handle);
+
+/**
+ * @brief Set shuffle and repeat mode of sdcard playlist
+ *
+ * @param handle     Playlist handle
+ * @param shuffle    Play in shuffled order
+ * @param repeat     Behavior at both ends of playlist
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t sdcard_list_set_mode(playlist_operator_handle_t handle, bool shuffle, playlist_repeat_t repeat);
+
+/**
+ * @brief Enable or disable metadata of sdcard playlist
+ *
+ * @note  When enabled, every saved local file is probed by `media_probe_file` and a fixed-size record is written
+ *        at position of its url id, urls saved before enabled have no metadata.
+ *        Records are kept on card after the playlist is destroyed, and used as cache when enabled next time:
+ *        a file is probed again only when its url, size or modification time differs from the cached record.
+ *        Disable removes all records.
+ *
+ * @param handle  Playlist handle
+ * @param enable  Probe saved URLs or not
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t sdcard_list_enable_meta(playlist_operator_handle_t handle, bool enable);
+
+/**
+ * @brief Get metadata of url in sdcard playlist
+ *
+ * @param      handle  Playlist handle
+ * @param      url_id  Url id
+ * @param[out] info    Metadata of url
+ *
+ * @return
+ *     - ESP_OK             success
+ *     - ESP_ERR_NOT_FOUND  no record or format not recognized
+ *     - ESP_FAIL           failed
+ */
+esp_err_t sdcard_list_get_meta(playlist_operator_handle_t handle, int url_id, media_probe_info_t *info);
+
+/**
+ * @brief Save seek index of url in sdcard playlist
+ *
+ * @note  Records are written at position of url id in a file next to the url file, and removed with urls by reset
+ *
+ * @param handle  Playlist handle
+ * @param url_id  Url id
+ * @param index   Seek index
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t sdcard_list_save_seek_index(playlist_operator_handle_t handle, int url_id, const seek_index_t *index);
+
+/**
+ * @brief Get seek index of url in sdcard playlist
+ *
+ * @param      handle  Playlist handle
+ * @param      url_id  Url id
+ * @param[out] index   Seek index
+ *
+ * @return
+ *     - ESP_OK             success
+ *     - ESP_ERR_NOT_FOUND  no seek index saved for url
+ *     - ESP_FAIL           failed
+ */
+esp_err_t sdcard_list_get_seek_index(playlist_operator_handle_t handle, int url_id, seek_index_t *index);
+
 #ifdef __cplusplus
 }
 #endif
@@ -25,12 +25,59 @@
 #ifndef _SDCARD_SCAN_H_
 #define _SDCARD_SCAN_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 typedef void (*sdcard_scan_cb_t)(void *user_data, char *url);
 
+/**
+ * @brief Callback to receive scanned files, `url` are valid only in this call
+ */
+typedef void (*sdcard_scan_batch_cb_t)(void *user_data, char *url[], int url_num);
+
+#define SDCARD_SCAN_DEFAULT_BATCH_NUM   (32)
+#define SDCARD_SCAN_TASK_STACK          (3 * 1024)
+#define SDCARD_SCAN_TASK_PRIO           (5)
+#define SDCARD_SCAN_TASK_CORE           (0)
+
+/**
+ * @brief Configuration of `sdcard_scan_with_cfg`
+ */
+typedef struct {
+    const char              *path;              /*!< The path to be scanned */
+    int                     depth;              /*!< The depth of file scanning, same as `sdcard_scan` */
+    const char              **file_extension;   /*!< File extension of files that are supposed to be saved, NULL to save all files */
+    int                     filter_num;         /*!< Number of filters */
+    sdcard_scan_batch_cb_t  batch_cb;           /*!< Callback to receive scanned files */
+    int                     batch_num;          /*!< Max number of files in one callback, 0 to use SDCARD_SCAN_DEFAULT_BATCH_NUM */
+    int                     worker_num;         /*!< Number of directories scanned at the same time, the caller task is one of them */
+    int                     task_stack;         /*!< Stack size of each worker task besides the caller */
+    int                     task_prio;          /*!< Priority of worker tasks */
+    int                     task_core;          /*!< Core of worker tasks */
+    bool                    stack_in_ext;       /*!< Allocate stack of worker tasks on external memory */
+    void                    *user_data;         /*!< The data to be used by callback function */
+} sdcard_scan_cfg_t;
+
+#define SDCARD_SCAN_CFG_DEFAULT() {                 \
+    .path = "/sdcard",                              \
+    .depth = 0,                                     \
+    .file_extension = NULL,                         \
+    .filter_num = 0,                                \
+    .batch_cb = NULL,                               \
+    .batch_num = SDCARD_SCAN_DEFAULT_BATCH_NUM,     \
+    .worker_num = 1,                                \
+    .task_stack = SDCARD_SCAN_TASK_STACK,           \
+    .task_prio = SDCARD_SCAN_TASK_PRIO,             \
+    .task_core = SDCARD_SCAN_TASK_CORE,             \
+    .stack_in_ext = false,                          \
+    .user_data = NULL,                              \
+}
+
 /**
  * @brief Scan files in SD card and use callback function to save files that meet filtering conditions.
  *
@@ -51,6 +98,22 @@ typedef void (*sdcard_scan_cb_t)(void *user_data, char *url);
  */
 esp_err_t sdcard_scan(sdcard_scan_cb_t cb, const char *path, int depth, const char *file_extension[], int filter_num, void *user_data);
 
+/**
+ * @brief Scan files in SD card without recursion, deliver files in batch and optionally scan directories in parallel
+ *
+ * @note   Directories are kept in a stack and each worker reuses one path buffer, so stack usage does not grow with depth.
+ *         Files in a directory are reported before files in its sub directories.
+ *         When `worker_num` is larger than 1, `worker_num - 1` tasks are created and the callback may be called from
+ *         any of them, but never at the same time. Order of directories is not kept then.
+ *
+ * @param cfg   Scan configuration
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t sdcard_scan_with_cfg(const sdcard_scan_cfg_t *cfg);
+
 #ifdef __cplusplus
 }
 #endif
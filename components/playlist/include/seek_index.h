@@ -0,0 +1,177 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _SEEK_INDEX_H_
+#define _SEEK_INDEX_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SEEK_INDEX_MAGIC            (0x58444953)    /*!< "SIDX" */
+#define SEEK_INDEX_POINT_NUM        (125)
+#define SEEK_INDEX_INTERVAL_MS      (500)           /*!< Time between points at start, doubled every time index is full */
+#define SEEK_INDEX_FLAG_COMPLETE    (1 << 0)        /*!< All frames of stream are indexed, `total_samples` and `end_pos` are valid */
+
+/**
+ * @brief Frame position of a time point
+ */
+typedef struct {
+    uint32_t sample;                            /*!< Samples per channel before the frame */
+    uint32_t pos;                               /*!< Byte offset of the frame in stream */
+} seek_index_point_t;
+
+/**
+ * @brief Fixed-size seek index record, 1024 bytes, points are sorted and about `interval` samples apart
+ */
+typedef struct seek_index {
+    uint32_t           magic;                           /*!< SEEK_INDEX_MAGIC if filled by builder */
+    uint8_t            format;                          /*!< media_probe_format_t, MP3 or AAC */
+    uint8_t            flags;                           /*!< SEEK_INDEX_FLAG_xxx */
+    uint16_t           num;                             /*!< Number of points */
+    uint32_t           sample_rate;                     /*!< Sample rate of stream */
+    uint32_t           interval;                        /*!< Samples between points */
+    uint32_t           total_samples;                   /*!< Samples per channel of whole stream */
+    uint32_t           end_pos;                         /*!< Byte offset after the last frame */
+    seek_index_point_t point[SEEK_INDEX_POINT_NUM];     /*!< Time points */
+} seek_index_t;
+
+typedef struct seek_index_builder *seek_index_builder_handle_t;
+
+/**
+ * @brief Create a builder which parses MP3 or AAC ADTS frame headers of a stream
+ *
+ * @note  The builder records points into `index` while stream is read from start.
+ *        After `seek_index_builder_seek`, it drops frames before the target so that reading starts at the right frame.
+ *        Points are only recorded when frame position and time are both known, so a partially built index
+ *        is still valid and is extended when stream is played again.
+ *
+ * @param index  Index to fill and to seek with, must be valid until builder destroyed
+ *
+ * @return
+ *     - NULL   failed
+ *     - Others builder handle
+ */
+seek_index_builder_handle_t seek_index_builder_create(seek_index_t *index);
+
+/**
+ * @brief Tell builder that stream is (re)opened at `pos`
+ *
+ * @note  Builder keeps its state if `pos` is where it stopped, which is the case of resume and
+ *        of a position got from `seek_index_builder_seek`. Otherwise it records from the beginning when `pos` is 0
+ *        and index is not complete, or ignores the data.
+ *
+ * @param builder  Builder handle
+ * @param pos      Byte offset of the first data to feed
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t seek_index_builder_begin(seek_index_builder_handle_t builder, uint32_t pos);
+
+/**
+ * @brief Prepare to read from a time
+ *
+ * @param      builder  Builder handle
+ * @param      time_ms  Time to play from
+ * @param[out] pos      Byte offset to open stream at, always at a frame start
+ *
+ * @return
+ *     - ESP_OK             success
+ *     - ESP_ERR_NOT_FOUND  no point in index
+ *     - ESP_FAIL           failed
+ */
+esp_err_t seek_index_builder_seek(seek_index_builder_handle_t builder, uint32_t time_ms, uint32_t *pos);
+
+/**
+ * @brief Feed stream data read in order
+ *
+ * @param builder  Builder handle
+ * @param data     Stream data
+ * @param len      Length of data
+ *
+ * @return
+ *     - Bytes at start of data which belong to frames before seek target and should be dropped
+ */
+int seek_index_builder_feed(seek_index_builder_handle_t builder, const void *data, int len);
+
+/**
+ * @brief Tell builder that end of stream is reached, index is marked complete if all frames are recorded
+ *
+ * @param builder  Builder handle
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t seek_index_builder_finish(seek_index_builder_handle_t builder);
+
+/**
+ * @brief Destroy builder, index is kept
+ *
+ * @param builder  Builder handle
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL failed
+ */
+esp_err_t seek_index_builder_destroy(seek_index_builder_handle_t builder);
+
+/**
+ * @brief Build complete index of a file by reading the whole file
+ *
+ * @param      path   Path of file, or URL starts with "file:/"
+ * @param[out] index  Seek index
+ *
+ * @return
+ *     - ESP_OK                 success
+ *     - ESP_ERR_NOT_FOUND      not an MP3 or AAC ADTS file
+ *     - ESP_ERR_INVALID_ARG    invalid parameters
+ *     - ESP_FAIL               fail to open or read file
+ */
+esp_err_t seek_index_build_file(const char *path, seek_index_t *index);
+
+/**
+ * @brief Find the last point at or before a time
+ *
+ * @param      index    Seek index
+ * @param      time_ms  Time
+ * @param[out] point    Point found
+ *
+ * @return
+ *     - ESP_OK                 success
+ *     - ESP_ERR_NOT_FOUND      index is empty or invalid
+ *     - ESP_ERR_INVALID_ARG    invalid parameters
+ */
+esp_err_t seek_index_lookup(const seek_index_t *index, uint32_t time_ms, seek_index_point_t *point);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -136,6 +136,172 @@ esp_err_t playlist_save(playlist_handle_t handle, const char *url)
     return ret;
 }
 
+esp_err_t playlist_save_begin(playlist_handle_t handle)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, handle->cur_playlist, return ESP_FAIL);
+
+    esp_err_t ret = ESP_OK;
+    mutex_lock(handle->playlist_operate_lock);
+
+    playlist_info_t *cur_list = handle->cur_playlist;
+    playlist_operator_handle_t cur_handle = cur_list->list_handle;
+    playlist_operation_t operation = {0};
+    cur_handle->get_operation(&operation);
+
+    if (operation.save_begin) {
+        ret = operation.save_begin(cur_handle);
+    }
+    mutex_unlock(handle->playlist_operate_lock);
+    return ret;
+}
+
+esp_err_t playlist_save_commit(playlist_handle_t handle)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, handle->cur_playlist, return ESP_FAIL);
+
+    esp_err_t ret = ESP_OK;
+    mutex_lock(handle->playlist_operate_lock);
+
+    playlist_info_t *cur_list = handle->cur_playlist;
+    playlist_operator_handle_t cur_handle = cur_list->list_handle;
+    playlist_operation_t operation = {0};
+    cur_handle->get_operation(&operation);
+
+    if (operation.save_commit) {
+        ret = operation.save_commit(cur_handle);
+    }
+    mutex_unlock(handle->playlist_operate_lock);
+    return ret;
+}
+
+esp_err_t playlist_save_batch(playlist_handle_t handle, const char *url[], int url_num)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, handle->cur_playlist, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, url, return ESP_FAIL);
+
+    esp_err_t ret = ESP_OK;
+    mutex_lock(handle->playlist_operate_lock);
+
+    playlist_info_t *cur_list = handle->cur_playlist;
+    playlist_operator_handle_t cur_handle = cur_list->list_handle;
+    playlist_operation_t operation = {0};
+    cur_handle->get_operation(&operation);
+
+    if (operation.save_begin) {
+        ret = operation.save_begin(cur_handle);
+    }
+    for (int i = 0; i < url_num && ret == ESP_OK; i++) {
+        ret = operation.save(cur_handle, url[i]);
+    }
+    if (operation.save_commit) {
+        // Commit anyway to flush what is saved, but report the first failure
+        esp_err_t commit_ret = operation.save_commit(cur_handle);
+        if (ret == ESP_OK) {
+            ret = commit_ret;
+        }
+    }
+    mutex_unlock(handle->playlist_operate_lock);
+    return ret;
+}
+
+esp_err_t playlist_set_mode(playlist_handle_t handle, bool shuffle, playlist_repeat_t repeat)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, handle->cur_playlist, return ESP_FAIL);
+
+    esp_err_t ret = ESP_OK;
+    mutex_lock(handle->playlist_operate_lock);
+
+    playlist_info_t *cur_list = handle->cur_playlist;
+    playlist_operator_handle_t cur_handle = cur_list->list_handle;
+    playlist_operation_t operation = {0};
+    cur_handle->get_operation(&operation);
+
+    if (operation.set_mode) {
+        ret = operation.set_mode(cur_handle, shuffle, repeat);
+    } else {
+        ESP_LOGE(TAG, "Play mode is not supported by current playlist");
+        ret = ESP_ERR_NOT_SUPPORTED;
+    }
+    mutex_unlock(handle->playlist_operate_lock);
+    return ret;
+}
+
+esp_err_t playlist_get_meta(playlist_handle_t handle, int url_id, media_probe_info_t *info)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, handle->cur_playlist, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, info, return ESP_FAIL);
+
+    esp_err_t ret = ESP_OK;
+    mutex_lock(handle->playlist_operate_lock);
+
+    playlist_info_t *cur_list = handle->cur_playlist;
+    playlist_operator_handle_t cur_handle = cur_list->list_handle;
+    playlist_operation_t operation = {0};
+    cur_handle->get_operation(&operation);
+
+    if (operation.get_meta) {
+        ret = operation.get_meta(cur_handle, url_id, info);
+    } else {
+        ESP_LOGE(TAG, "Metadata is not supported by current playlist");
+        ret = ESP_ERR_NOT_SUPPORTED;
+    }
+    mutex_unlock(handle->playlist_operate_lock);
+    return ret;
+}
+
+esp_err_t playlist_get_seek_index(playlist_handle_t handle, int url_id, seek_index_t *index)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, handle->cur_playlist, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, index, return ESP_FAIL);
+
+    esp_err_t ret = ESP_OK;
+    mutex_lock(handle->playlist_operate_lock);
+
+    playlist_info_t *cur_list = handle->cur_playlist;
+    playlist_operator_handle_t cur_handle = cur_list->list_handle;
+    playlist_operation_t operation = {0};
+    cur_handle->get_operation(&operation);
+
+    if (operation.get_seek_index) {
+        ret = operation.get_seek_index(cur_handle, url_id, index);
+    } else {
+        ESP_LOGE(TAG, "Seek index is not supported by current playlist");
+        ret = ESP_ERR_NOT_SUPPORTED;
+    }
+    mutex_unlock(handle->playlist_operate_lock);
+    return ret;
+}
+
+esp_err_t playlist_save_seek_index(playlist_handle_t handle, int url_id, const seek_index_t *index)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, handle->cur_playlist, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, index, return ESP_FAIL);
+
+    esp_err_t ret = ESP_OK;
+    mutex_lock(handle->playlist_operate_lock);
+
+    playlist_info_t *cur_list = handle->cur_playlist;
+    playlist_operator_handle_t cur_handle = cur_list->list_handle;
+    playlist_operation_t operation = {0};
+    cur_handle->get_operation(&operation);
+
+    if (operation.save_seek_index) {
+        ret = operation.save_seek_index(cur_handle, url_id, index);
+    } else {
+        ESP_LOGE(TAG, "Seek index is not supported by current playlist");
+        ret = ESP_ERR_NOT_SUPPORTED;
+    }
+    mutex_unlock(handle->playlist_operate_lock);
+    return ret;
+}
+
 esp_err_t playlist_reset(playlist_handle_t handle)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
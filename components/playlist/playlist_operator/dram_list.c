@@ -23,29 +23,20 @@
  */
 
 #include <string.h>
-#include "sys/queue.h"
 #include "audio_error.h"
 #include "audio_mem.h"
 #include "dram_list.h"
+#include "playlist_index.h"
 
 static const char *TAG = "DRAM_LIST";
 
-/**
- * @brief List node save URL
- */
-typedef struct url_info {
-    char *url_name;                /*!< URL string */
-    int   url_id;
-    TAILQ_ENTRY(url_info) entries; /*!< list node */
-} url_info_t;
-
 /**
  * @brief Dram list management unit
  */
 typedef struct dram_list {
-    uint16_t url_num;                         /*!< Number of URLs in dram playlist */
-    url_info_t *cur_node;                     /*!< Current node of URL on dram list */
-    TAILQ_HEAD(info, url_info) url_info_list; /*!< List of URL nodes */
+    char             **url;                   /*!< URL strings indexed by url id */
+    uint16_t         url_cap;                 /*!< Capacity of URL array */
+    playlist_index_t index;                   /*!< Play position and play order */
 } dram_list_t;
 
 esp_err_t dram_list_get_operation(playlist_operation_t *operation);
@@ -65,7 +56,7 @@ esp_err_t dram_list_create(playlist_operator_handle_t *handle)
     dram_handle->playlist = dram_list;
     dram_handle->get_operation = dram_list_get_operation;
 
-    TAILQ_INIT(&dram_list->url_info_list);
+    playlist_index_init(&dram_list->index, false);
     *handle = dram_handle;
     return ESP_OK;
 }
@@ -74,32 +65,33 @@ esp_err_t dram_list_save(playlist_operator_handle_t handle, const char *url)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
     AUDIO_NULL_CHECK(TAG, url, return ESP_FAIL);
-    size_t url_len = strlen(url);
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    url_info_t *list_node = (url_info_t *)audio_calloc(1, sizeof(url_info_t));
-    AUDIO_NULL_CHECK(TAG, list_node, return ESP_FAIL);
-    list_node->url_name = (char *)audio_calloc(1, url_len + 1);
-    list_node->url_id = playlist->url_num;
-    AUDIO_NULL_CHECK(TAG, list_node->url_name, {
-        audio_free(list_node);
-        list_node = NULL;
+    uint16_t url_num = playlist->index.url_num;
+    if (url_num == playlist->url_cap) {
+        if (url_num == UINT16_MAX) {
+            ESP_LOGE(TAG, "Too many urls in playlist");
+            return ESP_FAIL;
+        }
+        uint32_t cap = playlist->url_cap ? playlist->url_cap * 2 : 16;
+        if (cap > UINT16_MAX) {
+            cap = UINT16_MAX;
+        }
+        char **new_url = (char **)audio_realloc(playlist->url, cap * sizeof(char *));
+        AUDIO_NULL_CHECK(TAG, new_url, return ESP_FAIL);
+        playlist->url = new_url;
+        playlist->url_cap = cap;
+    }
+    char *url_name = audio_strdup(url);
+    AUDIO_NULL_CHECK(TAG, url_name, return ESP_FAIL);
+    playlist_offset_t offset = {0};
+    offset.len = strlen(url);
+    if (playlist_index_append(&playlist->index, &offset, playlist_index_hash(url)) != ESP_OK) {
+        audio_free(url_name);
         return ESP_FAIL;
-    });
-#if defined(__GNUC__) && (__GNUC__ >= 6)
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wstringop-truncation"
-    strncpy(list_node->url_name, url, url_len); // causes compilation warning although the extra byte is accounted for in the calloc
-#pragma GCC diagnostic pop
-#endif
-    TAILQ_INSERT_TAIL(&playlist->url_info_list, list_node, entries);
-
-    if (NULL == playlist->cur_node) {
-        ESP_LOGD(TAG, "Set the first url as the default url");
-        playlist->cur_node = list_node;
     }
-    playlist->url_num ++;
+    playlist->url[url_num] = url_name;
     return ESP_OK;
 }
 
@@ -110,7 +102,7 @@ esp_err_t dram_list_next(playlist_operator_handle_t handle, int step, char **url
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    if (playlist->url_num == 0) {
+    if (playlist->index.url_num == 0) {
         ESP_LOGE(TAG, "Please add urls to playlist first");
         return ESP_FAIL;
     }
@@ -119,16 +111,14 @@ esp_err_t dram_list_next(playlist_operator_handle_t handle, int step, char **url
         return ESP_FAIL;
     }
 
-    url_info_t *tmp = playlist->cur_node;
-    for (int i = 0; i < step; i++) {
-        tmp = TAILQ_NEXT(playlist->cur_node, entries);
-        if (tmp == NULL) {
-            ESP_LOGD(TAG, "Already the last url of the playlist");
-            tmp = TAILQ_FIRST(&playlist->url_info_list);
-        }
-        playlist->cur_node = tmp;
+    uint16_t id = 0;
+    esp_err_t ret = playlist_index_step(&playlist->index, step, true, &id);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Already the last url of the playlist");
+        return ret;
     }
-    *url_buff = tmp->url_name;
+    playlist->index.cur_id = id;
+    *url_buff = playlist->url[id];
 
     return ESP_OK;
 }
@@ -140,7 +130,7 @@ esp_err_t dram_list_prev(playlist_operator_handle_t handle, int step, char **url
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    if (playlist->url_num == 0) {
+    if (playlist->index.url_num == 0) {
         ESP_LOGE(TAG, "Please add urls to playlist first");
         return ESP_FAIL;
     }
@@ -149,16 +139,14 @@ esp_err_t dram_list_prev(playlist_operator_handle_t handle, int step, char **url
         return ESP_FAIL;
     }
 
-    url_info_t *tmp = playlist->cur_node;
-    for (int i = 0; i < step; i++) {
-        tmp = TAILQ_PREV(playlist->cur_node, info, entries);
-        if (tmp == NULL) {
-            ESP_LOGD(TAG, "Already the first url of the playlist");
-            tmp = TAILQ_LAST(&playlist->url_info_list, info);
-        }
-        playlist->cur_node = tmp;
+    uint16_t id = 0;
+    esp_err_t ret = playlist_index_step(&playlist->index, step, false, &id);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Already the first url of the playlist");
+        return ret;
     }
-    *url_buff = tmp->url_name;
+    playlist->index.cur_id = id;
+    *url_buff = playlist->url[id];
 
     return ESP_OK;
 }
@@ -170,13 +158,12 @@ esp_err_t dram_list_current(playlist_operator_handle_t handle, char **url_buff)
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    if (playlist->url_num == 0) {
+    if (playlist->index.url_num == 0) {
         ESP_LOGE(TAG, "Please add urls to playlist first");
         return ESP_FAIL;
     }
 
-    url_info_t *cur_node = playlist->cur_node;
-    *url_buff = cur_node->url_name;
+    *url_buff = playlist->url[playlist->index.cur_id];
     return ESP_OK;
 }
 
@@ -187,17 +174,17 @@ esp_err_t dram_list_choose(playlist_operator_handle_t handle, int url_id, char *
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    if (playlist->url_num == 0) {
+    if (playlist->index.url_num == 0) {
         ESP_LOGE(TAG, "Please add urls tp playlist first");
         return ESP_FAIL;
     }
-    if ((url_id < 0) || (url_id >= playlist->url_num)) {
+    if ((url_id < 0) || (url_id >= playlist->index.url_num)) {
         ESP_LOGE(TAG, "Invalid url id to be choosen");
         return ESP_FAIL;
     }
-    // rewind pointer
-    playlist->cur_node = TAILQ_FIRST(&playlist->url_info_list);
-    return dram_list_next(handle, url_id, url_buff);
+    playlist->index.cur_id = url_id;
+    *url_buff = playlist->url[url_id];
+    return ESP_OK;
 }
 
 esp_err_t dram_list_show(playlist_operator_handle_t handle)
@@ -206,9 +193,8 @@ esp_err_t dram_list_show(playlist_operator_handle_t handle)
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    url_info_t *item, *tmp;
-    TAILQ_FOREACH_SAFE(item, &playlist->url_info_list, entries, tmp) {
-        ESP_LOGI(TAG, "URL: %s", item->url_name);
+    for (int i = 0; i < playlist->index.url_num; i++) {
+        ESP_LOGI(TAG, "URL: %s", playlist->url[i]);
     }
     return ESP_OK;
 }
@@ -219,33 +205,33 @@ bool dram_list_exist(playlist_operator_handle_t handle, const char *url)
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    url_info_t *item, *tmp;
-    TAILQ_FOREACH_SAFE(item, &playlist->url_info_list, entries, tmp) {
-        if (strlen(url) != strlen(item->url_name)) {
-            continue;
-        }
-        if (strcmp(item->url_name, url) == 0) {
+    uint32_t probe = 0;
+    uint32_t hash = playlist_index_hash(url);
+    int id;
+    while ((id = playlist_index_find_next(&playlist->index, hash, &probe)) >= 0) {
+        if (strcmp(playlist->url[id], url) == 0) {
             return true;
         }
     }
     return false;
 }
 
+static void dram_list_free_url(dram_list_t *playlist)
+{
+    for (int i = 0; i < playlist->index.url_num; i++) {
+        audio_free(playlist->url[i]);
+        playlist->url[i] = NULL;
+    }
+}
+
 esp_err_t dram_list_reset(playlist_operator_handle_t handle)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    url_info_t *item, *tmp;
-    TAILQ_FOREACH_SAFE(item, &playlist->url_info_list, entries, tmp) {
-        audio_free(item->url_name);
-        item->url_name = NULL;
-        TAILQ_REMOVE(&playlist->url_info_list, item, entries);
-        audio_free(item);
-        item = NULL;
-    }
-    playlist->url_num = 0;
+    dram_list_free_url(playlist);
+    playlist_index_reset(&playlist->index);
     return ESP_OK;
 }
 
@@ -255,7 +241,7 @@ int dram_list_get_url_num(playlist_operator_handle_t handle)
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    return playlist->url_num;
+    return playlist->index.url_num;
 }
 
 int dram_list_get_url_id(playlist_operator_handle_t handle)
@@ -264,94 +250,69 @@ int dram_list_get_url_id(playlist_operator_handle_t handle)
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    if (playlist->url_num == 0) {
+    if (playlist->index.url_num == 0) {
         ESP_LOGE(TAG, "Please add urls to playlist first");
         return ESP_FAIL;
     }
 
-    url_info_t *cur_node = playlist->cur_node;
-    return cur_node->url_id;
+    return playlist->index.cur_id;
 }
 
-esp_err_t dram_list_remove_by_url(playlist_operator_handle_t handle, const char *url)
+esp_err_t dram_list_remove_by_url_id(playlist_operator_handle_t handle, uint16_t url_id)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
-    bool _find_flag = false;
 
-    url_info_t *item, *tmp;
-    TAILQ_FOREACH_SAFE(item, &playlist->url_info_list, entries, tmp) {
-        if (strlen(url) != strlen(item->url_name)) {
-            continue;
-        }
-        if (strcmp(url, item->url_name) == 0) {
-            audio_free(item->url_name);
-            item->url_name = NULL;
-            TAILQ_REMOVE(&playlist->url_info_list, item, entries);
-            audio_free(item);
-            item = NULL;
-            playlist->url_num--;
-            _find_flag = true;
-            continue;
-        }
-        if (_find_flag) {
-            item->url_id--;
-        }
-    }
-    if (_find_flag) {
-        return ESP_OK;
-    } else {
-        ESP_LOGE(TAG, "Cannot find the url, fail to remove");
+    if (url_id >= playlist->index.url_num) {
+        ESP_LOGE(TAG, "Cannot find the url id, fail to remove");
         return ESP_ERR_NOT_FOUND;
     }
+    audio_free(playlist->url[url_id]);
+    memmove(&playlist->url[url_id], &playlist->url[url_id + 1], (playlist->index.url_num - url_id - 1) * sizeof(char *));
+    return playlist_index_remove(&playlist->index, url_id);
 }
 
-esp_err_t dram_list_remove_by_url_id(playlist_operator_handle_t handle, uint16_t url_id)
+esp_err_t dram_list_remove_by_url(playlist_operator_handle_t handle, const char *url)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
     bool _find_flag = false;
 
-    url_info_t *item, *tmp;
-    TAILQ_FOREACH_SAFE(item, &playlist->url_info_list, entries, tmp) {
-        if (item->url_id == url_id) {
-            audio_free(item->url_name);
-            item->url_name = NULL;
-            TAILQ_REMOVE(&playlist->url_info_list, item, entries);
-            audio_free(item);
-            item = NULL;
-            playlist->url_num--;
+    // Remove all the same urls as before
+    for (int i = playlist->index.url_num - 1; i >= 0; i--) {
+        if (strcmp(url, playlist->url[i]) == 0) {
+            dram_list_remove_by_url_id(handle, i);
             _find_flag = true;
-            continue;
-        }
-        if (_find_flag) {
-            item->url_id--;
         }
     }
     if (_find_flag) {
         return ESP_OK;
     } else {
-        ESP_LOGE(TAG, "Cannot find the url id, fail to remove");
+        ESP_LOGE(TAG, "Cannot find the url, fail to remove");
         return ESP_ERR_NOT_FOUND;
     }
 }
 
+esp_err_t dram_list_set_mode(playlist_operator_handle_t handle, bool shuffle, playlist_repeat_t repeat)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    dram_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+
+    return playlist_index_set_mode(&playlist->index, shuffle, repeat);
+}
+
 esp_err_t dram_list_destroy(playlist_operator_handle_t handle)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
     dram_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    url_info_t *item, *tmp;
-    TAILQ_FOREACH_SAFE(item, &playlist->url_info_list, entries, tmp) {
-        audio_free(item->url_name);
-        item->url_name = NULL;
-        TAILQ_REMOVE(&playlist->url_info_list, item, entries);
-        audio_free(item);
-        item = NULL;
-    }
+    dram_list_free_url(playlist);
+    audio_free(playlist->url);
+    playlist_index_deinit(&playlist->index);
     audio_free(playlist);
     handle->playlist = NULL;
     audio_free(handle);
@@ -374,6 +335,7 @@ esp_err_t dram_list_get_operation(playlist_operation_t *operation)
     operation->get_url_id  = (void *)dram_list_get_url_id;
     operation->remove_by_url = (void *)dram_list_remove_by_url;
     operation->remove_by_id  = (void *)dram_list_remove_by_url_id;
+    operation->set_mode      = (void *)dram_list_set_mode;
     operation->type = PLAYLIST_DRAM;
     return ESP_OK;
 }
@@ -26,11 +26,14 @@
 #include "audio_error.h"
 #include "audio_mem.h"
 #include "flash_list.h"
+#include "playlist_index.h"
 #include "nvs_flash.h"
 
 #define DEFAULT_NVS_NAME_SPACE    "NVS"
 #define NVS_NAME_SPACE_MAX_LENGTH  16
 #define NVS_FLASH_URL_MAX_LENGTH   2048
+#define FLASH_LIST_PAGE_SIZE       1024
+#define FLASH_LIST_PAGE_KEY_LENGTH 8
 
 static const char *TAG = "FLASH_LIST";
 
@@ -40,37 +43,66 @@ static const char *TAG = "FLASH_LIST";
 typedef struct flash_list {
     char *name_space;            /*!< nvs name space */
     nvs_handle url_nvs_handle;   /*!< nvs handle */
-    uint16_t url_num;            /*!< number of URLs */
-    int16_t cur_url_id;          /*!< current URL id */
-    char *cur_url;               /*!< point to current URL */
+    playlist_index_t index;      /*!< play position and recently read URLs */
+    char *page;                  /*!< Latest page of leaf names, saved as one nvs blob */
+    uint16_t page_id;            /*!< Id of latest page */
+    uint16_t page_used;          /*!< Used size of latest page */
+    bool page_dirty;             /*!< Latest page not written to nvs, written when it is full or committed */
+    char *read_page;             /*!< Cache of page read from nvs */
+    int32_t read_page_id;        /*!< Id of cached page, -1 if invalid */
 } flash_list_t;
 
 esp_err_t flash_list_get_operation(playlist_operation_t *operation);
 
-static esp_err_t flash_list_choose_id(flash_list_t *playlist, int id, char **url_buff)
+static esp_err_t write_page_to_flash(flash_list_t *playlist)
 {
-    esp_err_t ret = ESP_OK;
-
-    if (playlist->cur_url) {
-        audio_free(playlist->cur_url);
+    char key[FLASH_LIST_PAGE_KEY_LENGTH];
+    snprintf(key, sizeof(key), "p%u", playlist->page_id);
+    esp_err_t ret = nvs_set_blob(playlist->url_nvs_handle, key, playlist->page, playlist->page_used);
+    ret |= nvs_commit(playlist->url_nvs_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Flash save page %u failed, ret: %d", playlist->page_id, ret);
+        return ESP_FAIL;
     }
+    playlist->page_dirty = false;
+    return ESP_OK;
+}
 
-    playlist->cur_url = (char *)audio_calloc(1, NVS_FLASH_URL_MAX_LENGTH);
-    AUDIO_NULL_CHECK(TAG, playlist->cur_url, {
-        ESP_LOGE(TAG, "Allocate memory failed!");
-        return ESP_FAIL;
-    });
+static esp_err_t read_leaf_from_flash(void *ctx, uint32_t pos, char *buf, uint16_t len)
+{
+    flash_list_t *playlist = (flash_list_t *)ctx;
+    uint16_t page_id = pos / FLASH_LIST_PAGE_SIZE;
+    uint16_t off = pos % FLASH_LIST_PAGE_SIZE;
 
-    size_t len = NVS_FLASH_URL_MAX_LENGTH;
-    ret = nvs_get_str(playlist->url_nvs_handle, (const char *)&id, playlist->cur_url, &len);
+    if (page_id == playlist->page_id) {
+        memcpy(buf, playlist->page + off, len);
+        return ESP_OK;
+    }
+    if (playlist->read_page_id != page_id) {
+        char key[FLASH_LIST_PAGE_KEY_LENGTH];
+        size_t size = FLASH_LIST_PAGE_SIZE;
+        snprintf(key, sizeof(key), "p%u", page_id);
+        if (nvs_get_blob(playlist->url_nvs_handle, key, playlist->read_page, &size) != ESP_OK) {
+            playlist->read_page_id = -1;
+            ESP_LOGE(TAG, "Flash read page %u failed", page_id);
+            return ESP_FAIL;
+        }
+        playlist->read_page_id = page_id;
+    }
+    memcpy(buf, playlist->read_page + off, len);
+    return ESP_OK;
+}
 
-    if (ret != ESP_OK) {
+static esp_err_t flash_list_choose_id(flash_list_t *playlist, int id, char **url_buff)
+{
+    char *url = playlist_index_get_url(&playlist->index, id, read_leaf_from_flash, playlist);
+    if (url == NULL) {
         ESP_LOGE(TAG, "Flash list choose url id failed");
         return ESP_FAIL;
     }
 
-    *url_buff = playlist->cur_url;
-    playlist->cur_url_id = id;
+    *url_buff = url;
+    playlist->index.cur_id = id;
     return ESP_OK;
 }
 
@@ -97,9 +129,16 @@ esp_err_t flash_list_create(playlist_operator_handle_t *handle)
 
     flash_handle->playlist = flash_list;
     flash_handle->get_operation = flash_list_get_operation;
+    playlist_index_init(&flash_list->index, true);
+    flash_list->read_page_id = -1;
 
     flash_list->name_space = audio_calloc(1, NVS_NAME_SPACE_MAX_LENGTH);
-    AUDIO_NULL_CHECK(TAG, flash_list, {
+    flash_list->page = audio_calloc(1, FLASH_LIST_PAGE_SIZE);
+    flash_list->read_page = audio_calloc(1, FLASH_LIST_PAGE_SIZE);
+    AUDIO_NULL_CHECK(TAG, flash_list->name_space && flash_list->page && flash_list->read_page, {
+        audio_free(flash_list->name_space);
+        audio_free(flash_list->page);
+        audio_free(flash_list->read_page);
         audio_free(flash_handle);
         audio_free(flash_list);
         return ESP_FAIL;
@@ -110,6 +149,8 @@ esp_err_t flash_list_create(playlist_operator_handle_t *handle)
     if (ret != ESP_OK) {
         audio_free(flash_handle);
         audio_free(flash_list->name_space);
+        audio_free(flash_list->page);
+        audio_free(flash_list->read_page);
         audio_free(flash_list);
         ESP_LOGE(TAG, "Flash playlist open failed, please check");
     }
@@ -130,15 +171,61 @@ esp_err_t flash_list_save(playlist_operator_handle_t handle, const char *url)
     flash_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    ret |= nvs_set_str(playlist->url_nvs_handle, (const char *)&playlist->url_num, url);
-    ret |= nvs_commit(playlist->url_nvs_handle);
-
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Flash save url failed, URL: %s, ret: %d", url, ret);
+    // Leaf names are packed into pages, a leaf never straddles two pages
+    playlist_offset_t offset;
+    const char *leaf = NULL;
+    if (playlist_index_split_url(&playlist->index, url, &offset.dir, &leaf) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    offset.len = strlen(leaf);
+    if (offset.len > FLASH_LIST_PAGE_SIZE) {
+        ESP_LOGE(TAG, "The file name is too long to save, please change the FLASH_LIST_PAGE_SIZE and retry");
         return ESP_FAIL;
     }
+    // Latest page stays in RAM and is written only when full, playlist keeps unchanged if any step fails
+    uint16_t page_id = playlist->page_id;
+    uint16_t page_used = playlist->page_used;
+    if (page_used + offset.len > FLASH_LIST_PAGE_SIZE) {
+        if (playlist->page_dirty) {
+            ret = write_page_to_flash(playlist);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Flash save url failed, URL: %s", url);
+            return ESP_FAIL;
+        }
+        page_id++;
+        page_used = 0;
+    }
+    offset.pos = page_id * FLASH_LIST_PAGE_SIZE + page_used;
+    if (playlist_index_append(&playlist->index, &offset, playlist_index_hash(url)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    memcpy(playlist->page + page_used, leaf, offset.len);
+    playlist->page_id = page_id;
+    playlist->page_used = page_used + offset.len;
+    playlist->page_dirty = true;
+    return ESP_OK;
+}
 
-    playlist->url_num ++;
+esp_err_t flash_list_save_begin(playlist_operator_handle_t handle)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    flash_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+
+    // Latest page is always buffered in RAM, nothing to prepare
+    return ESP_OK;
+}
+
+esp_err_t flash_list_save_commit(playlist_operator_handle_t handle)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    flash_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+
+    if (playlist->page_dirty) {
+        return write_page_to_flash(playlist);
+    }
     return ESP_OK;
 }
 
@@ -149,12 +236,10 @@ esp_err_t flash_list_show(playlist_operator_handle_t handle)
     flash_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    size_t len = NVS_FLASH_URL_MAX_LENGTH;
     char *out_str = audio_calloc(1, NVS_FLASH_URL_MAX_LENGTH);
-    for (int i = 0; i < playlist->url_num; i++) {
-        memset(out_str, 0, NVS_FLASH_URL_MAX_LENGTH);
-        len = NVS_FLASH_URL_MAX_LENGTH;
-        ret = nvs_get_str(playlist->url_nvs_handle, (const char *)&i, out_str, &len);
+    AUDIO_NULL_CHECK(TAG, out_str, return ESP_FAIL);
+    for (int i = 0; i < playlist->index.url_num; i++) {
+        ret = playlist_index_read_url(&playlist->index, i, read_leaf_from_flash, playlist, out_str, NVS_FLASH_URL_MAX_LENGTH);
         ESP_LOGI(TAG, "ID:%d 	URL: %s", i, out_str);
     }
     audio_free(out_str);
@@ -168,7 +253,7 @@ esp_err_t flash_list_next(playlist_operator_handle_t handle, int step, char **ur
     flash_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    if (playlist->url_num == 0) {
+    if (playlist->index.url_num == 0) {
         ESP_LOGE(TAG, "No url, please save urls to playlist first");
         return ESP_FAIL;
     }
@@ -177,11 +262,11 @@ esp_err_t flash_list_next(playlist_operator_handle_t handle, int step, char **ur
         return ESP_FAIL;
     }
 
-    int id = 0, total_step = 0;
-    total_step = playlist->cur_url_id + step;
-    id = total_step;
-    if (total_step >= playlist->url_num) {
-        id = total_step % playlist->url_num;
+    uint16_t id = 0;
+    esp_err_t ret = playlist_index_step(&playlist->index, step, true, &id);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Already the last url of the playlist");
+        return ret;
     }
     return flash_list_choose_id(playlist, id, url_buff);
 }
@@ -193,7 +278,7 @@ esp_err_t flash_list_prev(playlist_operator_handle_t handle, int step, char **ur
     flash_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    if (playlist->url_num == 0) {
+    if (playlist->index.url_num == 0) {
         ESP_LOGE(TAG, "No url, please save urls to playlist first");
         return ESP_FAIL;
     }
@@ -201,15 +286,11 @@ esp_err_t flash_list_prev(playlist_operator_handle_t handle, int step, char **ur
         ESP_LOGE(TAG, "Steps should be larger than 0");
         return ESP_FAIL;
     }
-    int id = 0, total_step = 0;
-    total_step = playlist->cur_url_id - step;
-    id = total_step;
-    if (total_step < 0) {
-        if (total_step % playlist->url_num == 0) {
-            id = 0;
-        } else {
-            id = playlist->url_num + total_step % playlist->url_num;
-        }
+    uint16_t id = 0;
+    esp_err_t ret = playlist_index_step(&playlist->index, step, false, &id);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Already the first url of the playlist");
+        return ret;
     }
     return flash_list_choose_id(playlist, id, url_buff);
 }
@@ -224,12 +305,12 @@ esp_err_t flash_list_current(playlist_operator_handle_t handle, char **url_buff)
         ESP_LOGE(TAG, "Invalid parameters, line: %d, func:%s", __LINE__, __FUNCTION__);
         return ESP_FAIL;
     }
-    if (playlist->url_num == 0) {
+    if (playlist->index.url_num == 0) {
         ESP_LOGE(TAG, "No url, please save urls to playlist first");
         return ESP_FAIL;
     }
 
-    return flash_list_choose_id(playlist, playlist->cur_url_id, url_buff);
+    return flash_list_choose_id(playlist, playlist->index.cur_id, url_buff);
 }
 
 esp_err_t flash_list_choose(playlist_operator_handle_t handle, int url_id, char **url_buff)
@@ -239,11 +320,11 @@ esp_err_t flash_list_choose(playlist_operator_handle_t handle, int url_id, char
     flash_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    if (playlist->url_num == 0) {
+    if (playlist->index.url_num == 0) {
         ESP_LOGE(TAG, "No url, please save urls to playlist first");
         return ESP_FAIL;
     }
-    if ((url_id < 0) || (url_id >= playlist->url_num)) {
+    if ((url_id < 0) || (url_id >= playlist->index.url_num)) {
         ESP_LOGE(TAG, "Invalid url id to be choosen");
         return ESP_FAIL;
     }
@@ -258,39 +339,22 @@ esp_err_t flash_list_reset(playlist_operator_handle_t handle)
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
     nvs_erase_all(playlist->url_nvs_handle);
-    if (playlist->cur_url) {
-        audio_free(playlist->cur_url);
-        playlist->cur_url = NULL;
-    }
-
-    playlist->cur_url_id = 0;
-    playlist->url_num = 0;
+    nvs_commit(playlist->url_nvs_handle);
+    playlist_index_reset(&playlist->index);
+    playlist->page_id = 0;
+    playlist->page_used = 0;
+    playlist->page_dirty = false;
+    playlist->read_page_id = -1;
     return ESP_OK;
 }
 
 bool flash_list_exist(playlist_operator_handle_t handle, const char *url)
 {
-    esp_err_t ret = ESP_OK;
-    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, handle, return false);
     flash_list_t *playlist = handle->playlist;
-    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, playlist, return false);
 
-    size_t len = NVS_FLASH_URL_MAX_LENGTH;
-    char *out_str = audio_calloc(1, NVS_FLASH_URL_MAX_LENGTH);
-    for (int i = 0; i < playlist->url_num; i++) {
-        memset(out_str, 0, NVS_FLASH_URL_MAX_LENGTH);
-        len = NVS_FLASH_URL_MAX_LENGTH;
-        ret = nvs_get_str(playlist->url_nvs_handle, (const char *)&i, out_str, &len);
-        if (strlen(url) != strlen(out_str)) {
-            continue;
-        }
-        if (strcmp(url, out_str) == 0) {
-            audio_free(out_str);
-            return true;
-        }
-    }
-    audio_free(out_str);
-    return ret;
+    return playlist_index_exist(&playlist->index, url, read_leaf_from_flash, playlist);
 }
 
 int flash_list_get_url_num(playlist_operator_handle_t handle)
@@ -299,7 +363,7 @@ int flash_list_get_url_num(playlist_operator_handle_t handle)
     flash_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    return playlist->url_num;
+    return playlist->index.url_num;
 }
 
 int flash_list_get_url_id(playlist_operator_handle_t handle)
@@ -307,7 +371,16 @@ int flash_list_get_url_id(playlist_operator_handle_t handle)
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
     flash_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
-    return playlist->cur_url_id;
+    return playlist->index.cur_id;
+}
+
+esp_err_t flash_list_set_mode(playlist_operator_handle_t handle, bool shuffle, playlist_repeat_t repeat)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    flash_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+
+    return playlist_index_set_mode(&playlist->index, shuffle, repeat);
 }
 
 esp_err_t flash_list_destroy(playlist_operator_handle_t handle)
@@ -320,10 +393,9 @@ esp_err_t flash_list_destroy(playlist_operator_handle_t handle)
     nvs_close(playlist->url_nvs_handle);
     audio_free(playlist->name_space);
     playlist->name_space = NULL;
-    if (playlist->cur_url) {
-        audio_free(playlist->cur_url);
-        playlist->cur_url = NULL;
-    }
+    audio_free(playlist->page);
+    audio_free(playlist->read_page);
+    playlist_index_deinit(&playlist->index);
     audio_free(playlist);
     handle->playlist = NULL;
     audio_free(handle);
@@ -335,6 +407,8 @@ esp_err_t flash_list_get_operation(playlist_operation_t *operation)
     AUDIO_NULL_CHECK(TAG, operation, return ESP_FAIL);
     operation->show = (void *)flash_list_show;
     operation->save = (void *)flash_list_save;
+    operation->save_begin  = (void *)flash_list_save_begin;
+    operation->save_commit = (void *)flash_list_save_commit;
     operation->next = (void *)flash_list_next;
     operation->prev = (void *)flash_list_prev;
     operation->reset   = (void *)flash_list_reset;
@@ -344,6 +418,7 @@ esp_err_t flash_list_get_operation(playlist_operation_t *operation)
     operation->destroy = (void *)flash_list_destroy;
     operation->get_url_num = (void *)flash_list_get_url_num;
     operation->get_url_id  = (void *)flash_list_get_url_id;
+    operation->set_mode    = (void *)flash_list_set_mode;
     operation->type = PLAYLIST_FLASH;
     return ESP_OK;
 }
@@ -27,6 +27,7 @@
 #include "audio_mem.h"
 #include "audio_error.h"
 #include "partition_list.h"
+#include "playlist_index.h"
 
 #define DEFAULT_PARTITION_TYPE               ESP_PARTITION_TYPE_DATA
 #define DEFAULT_PARTITION_URL_SUB_TYPE       0x06
@@ -42,45 +43,29 @@ static const char *TAG = "PARTITION_LIST";
 typedef struct partition_list {
     const esp_partition_t *url_part;    /*!< URL partition handle */
     const esp_partition_t *offset_part; /*!< offset partition handle */
-    uint16_t url_num;                   /*!< number of URLs */
-    uint16_t cur_url_id;                /*!< current URL id */
     uint32_t total_size_offset_part;    /*!< size of partition to save URLs */
     uint32_t total_size_url_part;       /*!< size of partition to save offset */
-    char     *cur_url;                  /*!< point to current URL */
+    playlist_index_t index;             /*!< offsets of URLs, play position and recently read URLs */
 } partition_list_t;
 
 esp_err_t partition_list_get_operation(playlist_operation_t *operation);
 
-static esp_err_t partition_list_choose_id(partition_list_t *playlist, int id, char **url_buff)
+static esp_err_t read_leaf_from_partition(void *ctx, uint32_t pos, char *buf, uint16_t len)
 {
-    esp_err_t ret = ESP_OK;
-    uint32_t pos = 0;
-    uint16_t  size = 0;
-    int offset = id * (sizeof(uint32_t) + sizeof(uint16_t));
-
-    ret |= esp_partition_read(playlist->offset_part, offset, &pos, sizeof(uint32_t));
-    ret |= esp_partition_read(playlist->offset_part, offset + sizeof(uint32_t), &size, sizeof(uint16_t));
-
-    if (playlist->cur_url) {
-        audio_free(playlist->cur_url);
-    }
-
-    playlist->cur_url = (char *)audio_calloc(1, size + 1);
-    AUDIO_NULL_CHECK(TAG, playlist->cur_url, {
-        ESP_LOGE(TAG, "Fail to allocate memory for url");
-        return ESP_FAIL;
-    });
-
-    ret |= esp_partition_read(playlist->url_part, pos, playlist->cur_url, size);
-    playlist->cur_url[size] = 0;
+    partition_list_t *playlist = (partition_list_t *)ctx;
+    return esp_partition_read(playlist->url_part, pos, buf, len);
+}
 
-    if (ret != ESP_OK) {
+static esp_err_t partition_list_choose_id(partition_list_t *playlist, int id, char **url_buff)
+{
+    char *url = playlist_index_get_url(&playlist->index, id, read_leaf_from_partition, playlist);
+    if (url == NULL) {
         ESP_LOGE(TAG, "There is a mistake when choose id in partition playlist!");
         return ESP_FAIL;
     }
 
-    *url_buff = playlist->cur_url;
-    playlist->cur_url_id = id;
+    *url_buff = url;
+    playlist->index.cur_id = id;
     return ESP_OK;
 }
 
@@ -98,6 +83,7 @@ esp_err_t partition_list_create(playlist_operator_handle_t *handle)
 
     partition_handle->playlist = partition_list;
     partition_handle->get_operation = partition_list_get_operation;
+    playlist_index_init(&partition_list->index, true);
 
     esp_err_t ret = ESP_OK;
     partition_list->url_part = esp_partition_find_first(DEFAULT_PARTITION_TYPE, DEFAULT_PARTITION_URL_SUB_TYPE, NULL);
@@ -125,22 +111,27 @@ esp_err_t partition_list_save(playlist_operator_handle_t handle, const char *url
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
     esp_err_t ret = ESP_OK;
-    uint16_t len = strlen(url);
+    // Only leaf name is written, directory part is shared in directory table
+    playlist_offset_t offset;
+    const char *leaf = NULL;
+    if (playlist_index_split_url(&playlist->index, url, &offset.dir, &leaf) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    offset.pos = playlist->total_size_url_part;
+    offset.len = strlen(leaf);
 
-    ret |= esp_partition_write(playlist->offset_part, playlist->total_size_offset_part, &playlist->total_size_url_part, sizeof(uint32_t));
-    playlist->total_size_offset_part += sizeof(uint32_t);
-    ret |= esp_partition_write(playlist->offset_part, playlist->total_size_offset_part, &len, sizeof(uint16_t));
-    playlist->total_size_offset_part += sizeof(uint16_t);
-    ret |= esp_partition_write(playlist->url_part, playlist->total_size_url_part, url, len);
-    playlist->total_size_url_part += len;
+    ret |= esp_partition_write(playlist->offset_part, playlist->total_size_offset_part, &offset, sizeof(playlist_offset_t));
+    ret |= esp_partition_write(playlist->url_part, playlist->total_size_url_part, leaf, offset.len);
 
     if (ret != ESP_OK) {
-        playlist->total_size_offset_part -= (sizeof(uint32_t) + sizeof(uint16_t));
-        playlist->total_size_url_part -= len;
         ESP_LOGE(TAG, "Failed to save URL to partition list ");
         return ESP_FAIL;
     }
-    playlist->url_num++;
+    if (playlist_index_append(&playlist->index, &offset, playlist_index_hash(url)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    playlist->total_size_offset_part += sizeof(playlist_offset_t);
+    playlist->total_size_url_part += offset.len;
 
     return ESP_OK;
 }
@@ -152,7 +143,7 @@ esp_err_t partition_list_next(playlist_operator_handle_t handle, int step, char
     partition_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    if (playlist->url_num == 0) {
+    if (playlist->index.url_num == 0) {
         ESP_LOGE(TAG, "No url, please save urls to playlist first");
         return ESP_FAIL;
     }
@@ -161,13 +152,12 @@ esp_err_t partition_list_next(playlist_operator_handle_t handle, int step, char
         return ESP_FAIL;
     }
 
-    int id = 0, total_step = 0;
-    total_step = playlist->cur_url_id + step;
-    id = total_step;
-    if (total_step >= playlist->url_num) {
-        id = total_step % playlist->url_num;
+    uint16_t id = 0;
+    esp_err_t ret = playlist_index_step(&playlist->index, step, true, &id);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Already the last url of the playlist");
+        return ret;
     }
-
     return partition_list_choose_id(playlist, id, url_buff);
 }
 
@@ -178,7 +168,7 @@ esp_err_t partition_list_prev(playlist_operator_handle_t handle, int step, char
     partition_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    if (playlist->url_num == 0) {
+    if (playlist->index.url_num == 0) {
         ESP_LOGE(TAG, "No url, please save urls to playlist first");
         return ESP_FAIL;
     }
@@ -187,18 +177,12 @@ esp_err_t partition_list_prev(playlist_operator_handle_t handle, int step, char
         return ESP_FAIL;
     }
 
-    int id = 0, total_step = 0;
-    total_step = playlist->cur_url_id - step;
-    id = total_step;
-
-    if (total_step < 0) {
-        if (total_step % playlist->url_num == 0) {
-            id = 0;
-        } else {
-            id = playlist->url_num + total_step % playlist->url_num;
-        }
+    uint16_t id = 0;
+    esp_err_t ret = playlist_index_step(&playlist->index, step, false, &id);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Already the first url of the playlist");
+        return ret;
     }
-
     return partition_list_choose_id(playlist, id, url_buff);
 }
 
@@ -209,11 +193,11 @@ esp_err_t partition_list_current(playlist_operator_handle_t handle, char **url_b
     partition_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    if (playlist->url_num == 0) {
+    if (playlist->index.url_num == 0) {
         ESP_LOGE(TAG, "No url, please save urls to playlist first");
         return ESP_FAIL;
     }
-    return partition_list_choose_id(playlist, playlist->cur_url_id, url_buff);
+    return partition_list_choose_id(playlist, playlist->index.cur_id, url_buff);
 }
 
 esp_err_t partition_list_choose(playlist_operator_handle_t handle, int url_id, char **url_buff)
@@ -223,11 +207,11 @@ esp_err_t partition_list_choose(playlist_operator_handle_t handle, int url_id, c
     partition_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    if (playlist->url_num == 0) {
+    if (playlist->index.url_num == 0) {
         ESP_LOGE(TAG, "No url, please save urls to playlist first");
         return ESP_FAIL;
     }
-    if ((url_id < 0) || (url_id >= playlist->url_num)) {
+    if ((url_id < 0) || (url_id >= playlist->index.url_num)) {
         ESP_LOGE(TAG, "Invalid url id to be choosen");
         return ESP_FAIL;
     }
@@ -242,18 +226,12 @@ esp_err_t partition_list_show(playlist_operator_handle_t handle)
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
     esp_err_t ret = ESP_OK;
-    uint32_t pos = 0, offset = 0;
-    uint16_t  size = 0;
     char *url = audio_calloc(1, PARTITION_LIST_URL_MAX_LENGTH);
+    AUDIO_NULL_CHECK(TAG, url, return ESP_FAIL);
 
     ESP_LOGI(TAG, "ID   URL");
-    for (int i = 0; i < playlist->url_num; i++) {
-        memset(url, 0, PARTITION_LIST_URL_MAX_LENGTH);
-        ret |= esp_partition_read(playlist->offset_part, offset, &pos, sizeof(uint32_t));
-        offset += sizeof(uint32_t);
-        ret |= esp_partition_read(playlist->offset_part, offset, &size, sizeof(uint16_t));
-        offset += sizeof(uint16_t);
-        ret |= esp_partition_read(playlist->url_part, pos, url, size);
+    for (int i = 0; i < playlist->index.url_num; i++) {
+        ret |= playlist_index_read_url(&playlist->index, i, read_leaf_from_partition, playlist, url, PARTITION_LIST_URL_MAX_LENGTH);
         ESP_LOGI(TAG, "%d   %s", i, url);
     }
 
@@ -267,29 +245,7 @@ bool partition_list_exist(playlist_operator_handle_t handle, const char *url)
     partition_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    esp_err_t ret = ESP_OK;
-    uint32_t pos = 0, offset = 0;
-    uint16_t  size = 0;
-    char *url_buff = audio_calloc(1, PARTITION_LIST_URL_MAX_LENGTH);
-
-    for (int i = 0; i < playlist->url_num; i++) {
-        memset(url_buff, 0, PARTITION_LIST_URL_MAX_LENGTH);
-        ret |= esp_partition_read(playlist->offset_part, offset, &pos, sizeof(uint32_t));
-        offset += sizeof(uint32_t);
-        ret |= esp_partition_read(playlist->offset_part, offset, &size, sizeof(uint16_t));
-        offset += sizeof(uint16_t);
-        ret |= esp_partition_read(playlist->url_part, pos, url_buff, size);
-        if (strlen(url) != strlen(url_buff)) {
-            continue;
-        }
-        if (strcmp(url, url_buff) == 0) {
-            audio_free(url_buff);
-            return true;
-        }
-    }
-
-    audio_free(url_buff);
-    return false;
+    return playlist_index_exist(&playlist->index, url, read_leaf_from_partition, playlist);
 }
 
 esp_err_t partition_list_reset(playlist_operator_handle_t handle)
@@ -303,13 +259,7 @@ esp_err_t partition_list_reset(playlist_operator_handle_t handle)
     const esp_partition_t *offset_part = playlist->offset_part;
     ret |= esp_partition_erase_range(url_part, 0, url_part->size);
     ret |= esp_partition_erase_range(offset_part, 0, offset_part->size);
-    if (playlist->cur_url) {
-        audio_free(playlist->cur_url);
-        playlist->cur_url = NULL;
-    }
-
-    playlist->url_num = 0;
-    playlist->cur_url_id = 0;
+    playlist_index_reset(&playlist->index);
     playlist->total_size_offset_part = 0;
     playlist->total_size_url_part = 0;
     return ret;
@@ -321,7 +271,7 @@ int partition_list_get_url_num(playlist_operator_handle_t handle)
     partition_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    return playlist->url_num;
+    return playlist->index.url_num;
 }
 
 int partition_list_get_url_id(playlist_operator_handle_t handle)
@@ -330,7 +280,16 @@ int partition_list_get_url_id(playlist_operator_handle_t handle)
     partition_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    return playlist->cur_url_id;
+    return playlist->index.cur_id;
+}
+
+esp_err_t partition_list_set_mode(playlist_operator_handle_t handle, bool shuffle, playlist_repeat_t repeat)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    partition_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+
+    return playlist_index_set_mode(&playlist->index, shuffle, repeat);
 }
 
 esp_err_t partition_list_destroy(playlist_operator_handle_t handle)
@@ -344,10 +303,7 @@ esp_err_t partition_list_destroy(playlist_operator_handle_t handle)
     const esp_partition_t *offset_part = playlist->offset_part;
     ret |= esp_partition_erase_range(url_part, 0, url_part->size);
     ret |= esp_partition_erase_range(offset_part, 0, offset_part->size);
-    if (playlist->cur_url) {
-        audio_free(playlist->cur_url);
-        playlist->cur_url = NULL;
-    }
+    playlist_index_deinit(&playlist->index);
     audio_free(playlist);
     handle->playlist = NULL;
     audio_free(handle);
@@ -368,6 +324,7 @@ esp_err_t partition_list_get_operation(playlist_operation_t *operation)
     operation->destroy = (void *)partition_list_destroy;
     operation->get_url_num = (void *)partition_list_get_url_num;
     operation->get_url_id  = (void *)partition_list_get_url_id;
+    operation->set_mode    = (void *)partition_list_set_mode;
     operation->type = PLAYLIST_PARTITION;
     return ESP_OK;
 }
@@ -0,0 +1,477 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include "esp_system.h"
+#include "audio_error.h"
+#include "audio_mem.h"
+#include "playlist_index.h"
+
+#define PLAYLIST_INDEX_BUCKET_MIN   (64)
+#define PLAYLIST_INDEX_CMP_SIZE     (64)
+
+static const char *TAG = "PLAYLIST_INDEX";
+
+static esp_err_t grow_array(void **array, uint16_t *cap, uint16_t need, int elem_size)
+{
+    if (need <= *cap) {
+        return ESP_OK;
+    }
+    uint32_t new_cap = *cap ? *cap : 64;
+    while (new_cap < need) {
+        new_cap <<= 1;
+    }
+    if (new_cap > UINT16_MAX) {
+        new_cap = UINT16_MAX;
+    }
+    void *new_array = audio_realloc(*array, new_cap * elem_size);
+    AUDIO_NULL_CHECK(TAG, new_array, return ESP_FAIL);
+    *array = new_array;
+    *cap = new_cap;
+    return ESP_OK;
+}
+
+static esp_err_t reserve_order(playlist_index_t *index, uint16_t need)
+{
+    // Both arrays share one capacity, grow order_pos with a copy of capacity
+    uint16_t cap = index->order_cap;
+    if (grow_array((void **)&index->order_pos, &cap, need, sizeof(uint16_t)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    return grow_array((void **)&index->order, &index->order_cap, need, sizeof(uint16_t));
+}
+
+static void free_order(playlist_index_t *index)
+{
+    audio_free(index->order);
+    audio_free(index->order_pos);
+    index->order = NULL;
+    index->order_pos = NULL;
+    index->order_cap = 0;
+}
+
+static void swap_order(playlist_index_t *index, uint16_t a, uint16_t b)
+{
+    uint16_t id = index->order[a];
+    index->order[a] = index->order[b];
+    index->order[b] = id;
+    index->order_pos[index->order[a]] = a;
+    index->order_pos[index->order[b]] = b;
+}
+
+static void insert_bucket(playlist_index_t *index, uint16_t id)
+{
+    uint32_t mask = index->bucket_num - 1;
+    uint32_t slot = index->hash[id] & mask;
+    while (index->bucket[slot]) {
+        slot = (slot + 1) & mask;
+    }
+    index->bucket[slot] = id + 1;
+}
+
+static esp_err_t rebuild_bucket(playlist_index_t *index, uint32_t bucket_num)
+{
+    if (bucket_num != index->bucket_num) {
+        uint16_t *bucket = audio_calloc(bucket_num, sizeof(uint16_t));
+        AUDIO_NULL_CHECK(TAG, bucket, return ESP_FAIL);
+        audio_free(index->bucket);
+        index->bucket = bucket;
+        index->bucket_num = bucket_num;
+    } else {
+        memset(index->bucket, 0, bucket_num * sizeof(uint16_t));
+    }
+    for (int i = 0; i < index->url_num; i++) {
+        insert_bucket(index, i);
+    }
+    return ESP_OK;
+}
+
+void playlist_index_init(playlist_index_t *index, bool keep_offset)
+{
+    memset(index, 0, sizeof(playlist_index_t));
+    index->keep_offset = keep_offset;
+    index->repeat = PLAYLIST_REPEAT_ALL;
+    playlist_index_cache_clear(index);
+}
+
+void playlist_index_deinit(playlist_index_t *index)
+{
+    audio_free(index->offset);
+    audio_free(index->arena);
+    audio_free(index->dir_buf);
+    audio_free(index->dir_pos);
+    audio_free(index->hash);
+    audio_free(index->bucket);
+    free_order(index);
+    memset(index, 0, sizeof(playlist_index_t));
+}
+
+void playlist_index_reset(playlist_index_t *index)
+{
+    index->url_num = 0;
+    index->cur_id = 0;
+    index->dir_num = 0;
+    index->dir_buf_size = 0;
+    index->last_dir = 0;
+    if (index->bucket) {
+        memset(index->bucket, 0, index->bucket_num * sizeof(uint16_t));
+    }
+    playlist_index_cache_clear(index);
+}
+
+esp_err_t playlist_index_append(playlist_index_t *index, const playlist_offset_t *offset, uint32_t hash)
+{
+    uint16_t id = index->url_num;
+    if (id == UINT16_MAX) {
+        ESP_LOGE(TAG, "Too many urls in playlist");
+        return ESP_FAIL;
+    }
+    if (index->keep_offset) {
+        if (grow_array((void **)&index->offset, &index->offset_cap, id + 1, sizeof(playlist_offset_t)) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        index->offset[id] = *offset;
+    }
+    if (grow_array((void **)&index->hash, &index->hash_cap, id + 1, sizeof(uint32_t)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    index->hash[id] = hash;
+    // Keep load factor of hash set under 3/4 so that probe chains stay short
+    if ((id + 1) * 4 > index->bucket_num * 3) {
+        uint32_t bucket_num = index->bucket_num ? index->bucket_num * 2 : PLAYLIST_INDEX_BUCKET_MIN;
+        if (rebuild_bucket(index, bucket_num) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+    if (index->shuffle) {
+        if (reserve_order(index, id + 1) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        index->order[id] = id;
+        index->order_pos[id] = id;
+        // Swap with a position after current one, so new URL is played in this round
+        uint16_t first = id ? index->order_pos[index->cur_id] + 1 : 0;
+        swap_order(index, id, first + esp_random() % (id + 1 - first));
+    }
+    insert_bucket(index, id);
+    index->url_num++;
+    return ESP_OK;
+}
+
+esp_err_t playlist_index_remove(playlist_index_t *index, uint16_t id)
+{
+    if (id >= index->url_num) {
+        return ESP_FAIL;
+    }
+    uint16_t num = index->url_num - 1;
+    if (index->keep_offset) {
+        memmove(&index->offset[id], &index->offset[id + 1], (num - id) * sizeof(playlist_offset_t));
+    }
+    memmove(&index->hash[id], &index->hash[id + 1], (num - id) * sizeof(uint32_t));
+    if (index->shuffle) {
+        uint16_t pos = index->order_pos[id];
+        memmove(&index->order[pos], &index->order[pos + 1], (num - pos) * sizeof(uint16_t));
+        for (int i = 0; i < num; i++) {
+            if (index->order[i] > id) {
+                index->order[i]--;
+            }
+            index->order_pos[index->order[i]] = i;
+        }
+    }
+    if (index->cur_id > id || (index->cur_id == num && num)) {
+        index->cur_id--;
+    }
+    index->url_num = num;
+    // Ids changed, cached URLs can not be found by id any more
+    playlist_index_cache_clear(index);
+    return rebuild_bucket(index, index->bucket_num);
+}
+
+esp_err_t playlist_index_get_offset(playlist_index_t *index, uint16_t id, playlist_offset_t *offset)
+{
+    if (index->keep_offset == false || id >= index->url_num) {
+        return ESP_FAIL;
+    }
+    *offset = index->offset[id];
+    return ESP_OK;
+}
+
+esp_err_t playlist_index_split_url(playlist_index_t *index, const char *url, uint16_t *dir, const char **leaf)
+{
+    const char *slash = strrchr(url, '/');
+    uint32_t len = slash ? slash - url + 1 : 0;
+    *leaf = url + len;
+    // URLs are mostly saved directory by directory, check the latest one first
+    for (int i = 0; i < index->dir_num; i++) {
+        uint16_t k = (index->last_dir + i) % index->dir_num;
+        const char *d = index->dir_buf + index->dir_pos[k];
+        if (strncmp(d, url, len) == 0 && d[len] == '\0') {
+            index->last_dir = k;
+            *dir = k;
+            return ESP_OK;
+        }
+    }
+    if (index->dir_num == UINT16_MAX) {
+        ESP_LOGE(TAG, "Too many directories in playlist");
+        return ESP_FAIL;
+    }
+    if (grow_array((void **)&index->dir_pos, &index->dir_cap, index->dir_num + 1, sizeof(uint32_t)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    if (index->dir_buf_size + len + 1 > index->dir_buf_cap) {
+        uint32_t cap = index->dir_buf_cap ? index->dir_buf_cap : 256;
+        while (cap < index->dir_buf_size + len + 1) {
+            cap <<= 1;
+        }
+        char *buf = audio_realloc(index->dir_buf, cap);
+        AUDIO_NULL_CHECK(TAG, buf, return ESP_FAIL);
+        index->dir_buf = buf;
+        index->dir_buf_cap = cap;
+    }
+    index->dir_pos[index->dir_num] = index->dir_buf_size;
+    memcpy(index->dir_buf + index->dir_buf_size, url, len);
+    index->dir_buf[index->dir_buf_size + len] = '\0';
+    index->dir_buf_size += len + 1;
+    index->last_dir = index->dir_num;
+    *dir = index->dir_num++;
+    return ESP_OK;
+}
+
+char *playlist_index_get_url(playlist_index_t *index, uint16_t id, playlist_index_read_t read, void *ctx)
+{
+    char *url = playlist_index_cache_find(index, id);
+    if (url) {
+        return url;
+    }
+    playlist_offset_t offset;
+    if (playlist_index_get_offset(index, id, &offset) != ESP_OK) {
+        return NULL;
+    }
+    const char *dir = index->dir_buf + index->dir_pos[offset.dir];
+    uint16_t dir_len = strlen(dir);
+    url = playlist_index_cache_alloc(index, id, dir_len + offset.len);
+    if (url == NULL) {
+        return NULL;
+    }
+    memcpy(url, dir, dir_len);
+    if (read(ctx, offset.pos, url + dir_len, offset.len) != ESP_OK) {
+        ESP_LOGE(TAG, "Fail to read url, id: %d", id);
+        playlist_index_cache_clear(index);
+        return NULL;
+    }
+    return url;
+}
+
+esp_err_t playlist_index_read_url(playlist_index_t *index, uint16_t id, playlist_index_read_t read, void *ctx, char *buf, int size)
+{
+    playlist_offset_t offset;
+    if (playlist_index_get_offset(index, id, &offset) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    const char *dir = index->dir_buf + index->dir_pos[offset.dir];
+    int dir_len = strlen(dir);
+    if (dir_len + offset.len >= size) {
+        return ESP_FAIL;
+    }
+    memcpy(buf, dir, dir_len);
+    if (read(ctx, offset.pos, buf + dir_len, offset.len) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    buf[dir_len + offset.len] = '\0';
+    return ESP_OK;
+}
+
+uint32_t playlist_index_hash(const char *url)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    while (*url) {
+        hash ^= (uint8_t)*url++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+int playlist_index_find_next(playlist_index_t *index, uint32_t hash, uint32_t *probe)
+{
+    if (index->bucket_num == 0) {
+        return -1;
+    }
+    uint32_t mask = index->bucket_num - 1;
+    while (*probe < index->bucket_num) {
+        uint16_t slot = index->bucket[(hash + *probe) & mask];
+        (*probe)++;
+        if (slot == 0) {
+            break;
+        }
+        if (index->hash[slot - 1] == hash) {
+            return slot - 1;
+        }
+    }
+    *probe = index->bucket_num;
+    return -1;
+}
+
+bool playlist_index_exist(playlist_index_t *index, const char *url, playlist_index_read_t read, void *ctx)
+{
+    uint32_t probe = 0;
+    uint32_t url_len = strlen(url);
+    uint32_t hash = playlist_index_hash(url);
+    int id;
+    while ((id = playlist_index_find_next(index, hash, &probe)) >= 0) {
+        playlist_offset_t offset;
+        if (playlist_index_get_offset(index, id, &offset) != ESP_OK) {
+            return false;
+        }
+        const char *dir = index->dir_buf + index->dir_pos[offset.dir];
+        uint32_t dir_len = strlen(dir);
+        if (dir_len + offset.len != url_len || strncmp(dir, url, dir_len)) {
+            continue;
+        }
+        // Compare leaf name piece by piece, no need to allocate for long URL
+        char buf[PLAYLIST_INDEX_CMP_SIZE];
+        const char *leaf = url + dir_len;
+        uint32_t pos = 0;
+        while (pos < offset.len) {
+            uint16_t len = offset.len - pos > sizeof(buf) ? sizeof(buf) : offset.len - pos;
+            if (read(ctx, offset.pos + pos, buf, len) != ESP_OK) {
+                return false;
+            }
+            if (memcmp(buf, leaf + pos, len)) {
+                break;
+            }
+            pos += len;
+        }
+        if (pos == offset.len) {
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t playlist_index_step(playlist_index_t *index, int step, bool forward, uint16_t *id)
+{
+    int num = index->url_num;
+    if (num == 0 || step < 0) {
+        return ESP_FAIL;
+    }
+    if (index->repeat == PLAYLIST_REPEAT_ONE) {
+        *id = index->cur_id;
+        return ESP_OK;
+    }
+    int pos = index->shuffle ? index->order_pos[index->cur_id] : index->cur_id;
+    pos = forward ? pos + step : pos - step;
+    if (pos < 0 || pos >= num) {
+        if (index->repeat == PLAYLIST_REPEAT_NONE) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        pos = ((pos % num) + num) % num;
+    }
+    *id = index->shuffle ? index->order[pos] : pos;
+    return ESP_OK;
+}
+
+esp_err_t playlist_index_set_mode(playlist_index_t *index, bool shuffle, playlist_repeat_t repeat)
+{
+    if (repeat < PLAYLIST_REPEAT_ALL || repeat > PLAYLIST_REPEAT_NONE) {
+        return ESP_FAIL;
+    }
+    index->repeat = repeat;
+    if (shuffle == false) {
+        free_order(index);
+        index->shuffle = false;
+        return ESP_OK;
+    }
+    if (reserve_order(index, index->url_num ? index->url_num : 1) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    // Fisher-Yates shuffle, then move current URL to the front
+    for (int i = 0; i < index->url_num; i++) {
+        index->order[i] = i;
+    }
+    for (int i = index->url_num - 1; i > 0; i--) {
+        int j = esp_random() % (i + 1);
+        uint16_t tmp = index->order[i];
+        index->order[i] = index->order[j];
+        index->order[j] = tmp;
+    }
+    for (int i = 0; i < index->url_num; i++) {
+        index->order_pos[index->order[i]] = i;
+    }
+    if (index->url_num) {
+        swap_order(index, 0, index->order_pos[index->cur_id]);
+    }
+    index->shuffle = true;
+    return ESP_OK;
+}
+
+char *playlist_index_cache_find(playlist_index_t *index, uint16_t id)
+{
+    for (int i = 0; i < PLAYLIST_INDEX_CACHE_NUM; i++) {
+        if (index->cache[i].id == id) {
+            return index->arena + index->cache[i].start;
+        }
+    }
+    return NULL;
+}
+
+char *playlist_index_cache_alloc(playlist_index_t *index, uint16_t id, uint16_t len)
+{
+    uint32_t size = len + 1;
+    if (size > PLAYLIST_INDEX_ARENA_SIZE) {
+        ESP_LOGE(TAG, "Url too long for arena, len: %d", len);
+        return NULL;
+    }
+    if (index->arena == NULL) {
+        index->arena = audio_malloc(PLAYLIST_INDEX_ARENA_SIZE);
+        AUDIO_NULL_CHECK(TAG, index->arena, return NULL);
+    }
+    if (index->arena_pos + size > PLAYLIST_INDEX_ARENA_SIZE) {
+        index->arena_pos = 0;
+    }
+    uint32_t start = index->arena_pos;
+    // Drop URLs to be overwritten
+    for (int i = 0; i < PLAYLIST_INDEX_CACHE_NUM; i++) {
+        playlist_index_cache_t *cache = &index->cache[i];
+        if (cache->id >= 0 && cache->start < start + size && start < cache->start + cache->size) {
+            cache->id = -1;
+        }
+    }
+    playlist_index_cache_t *cache = &index->cache[index->cache_next];
+    index->cache_next = (index->cache_next + 1) % PLAYLIST_INDEX_CACHE_NUM;
+    cache->id = id;
+    cache->start = start;
+    cache->size = size;
+    index->arena_pos += size;
+    index->arena[start + len] = '\0';
+    return index->arena + start;
+}
+
+void playlist_index_cache_clear(playlist_index_t *index)
+{
+    for (int i = 0; i < PLAYLIST_INDEX_CACHE_NUM; i++) {
+        index->cache[i].id = -1;
+    }
+    index->arena_pos = 0;
+}
@@ -0,0 +1,248 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _PLAYLIST_INDEX_H_
+#define _PLAYLIST_INDEX_H_
+
+#include "playlist.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PLAYLIST_INDEX_CACHE_NUM    (8)
+#define PLAYLIST_INDEX_ARENA_SIZE   (4096)
+
+/**
+ * @brief Position of URL in storage, same layout as the offset record in storage
+ *
+ * @note  Storage keeps leaf name only, the directory part of URL is kept in directory table
+ */
+typedef struct {
+    uint32_t pos;                   /*!< Position of leaf name */
+    uint16_t len;                   /*!< Length of leaf name without '\0' */
+    uint16_t dir;                   /*!< Index in directory table */
+} playlist_offset_t;
+
+/**
+ * @brief Read leaf name of `len` bytes at `pos` from storage
+ */
+typedef esp_err_t (*playlist_index_read_t)(void *ctx, uint32_t pos, char *buf, uint16_t len);
+
+/**
+ * @brief URL kept in arena
+ */
+typedef struct {
+    int32_t  id;                    /*!< URL id, -1 if unused */
+    uint32_t start;                 /*!< Start of URL in arena */
+    uint16_t size;                  /*!< Size of URL in arena, '\0' included */
+} playlist_index_cache_t;
+
+/**
+ * @brief Index shared by playlist operators, keeps play position, play order and recently used URLs
+ */
+typedef struct {
+    uint16_t                url_num;                            /*!< Number of URLs */
+    uint16_t                cur_id;                             /*!< Current URL id */
+    bool                    keep_offset;                        /*!< Keep position of each URL */
+    playlist_offset_t       *offset;                            /*!< Position of each URL in storage */
+    uint16_t                offset_cap;                         /*!< Capacity of offset array */
+    bool                    shuffle;                            /*!< Play in shuffled order */
+    playlist_repeat_t       repeat;                             /*!< Behavior at both ends of playlist */
+    uint16_t                *order;                             /*!< URL id at each play position when shuffle */
+    uint16_t                *order_pos;                         /*!< Play position of each URL id when shuffle */
+    uint16_t                order_cap;                          /*!< Capacity of order arrays */
+    char                    *arena;                             /*!< Ring buffer of recently used URLs */
+    uint32_t                arena_pos;                          /*!< Write position in arena */
+    playlist_index_cache_t  cache[PLAYLIST_INDEX_CACHE_NUM];    /*!< URLs in arena */
+    uint8_t                 cache_next;                         /*!< Cache entry to be replaced next */
+    char                    *dir_buf;                           /*!< Directories of URLs, '\0' terminated one by one */
+    uint32_t                dir_buf_size;                       /*!< Used size of directory buffer */
+    uint32_t                dir_buf_cap;                        /*!< Capacity of directory buffer */
+    uint32_t                *dir_pos;                           /*!< Start of each directory in buffer */
+    uint16_t                dir_num;                            /*!< Number of directories */
+    uint16_t                dir_cap;                            /*!< Capacity of directory start array */
+    uint16_t                last_dir;                           /*!< Directory of latest split URL */
+    uint32_t                *hash;                              /*!< Hash of each URL */
+    uint16_t                hash_cap;                           /*!< Capacity of hash array */
+    uint16_t                *bucket;                            /*!< Hash set of URL ids, id + 1 in each slot, 0 if empty */
+    uint32_t                bucket_num;                         /*!< Number of slots in hash set, power of 2 */
+} playlist_index_t;
+
+/**
+ * @brief Initialize index
+ *
+ * @param index        Index to be initialized
+ * @param keep_offset  Keep position of each URL so that URL can be read from storage directly
+ */
+void playlist_index_init(playlist_index_t *index, bool keep_offset);
+
+/**
+ * @brief Free memory of index
+ */
+void playlist_index_deinit(playlist_index_t *index);
+
+/**
+ * @brief Remove all URLs from index, play mode is kept
+ */
+void playlist_index_reset(playlist_index_t *index);
+
+/**
+ * @brief Add a URL at the end, a shuffled URL is put at a random position not played yet
+ *
+ * @param index   Index
+ * @param offset  Position of URL in storage
+ * @param hash    Hash of whole URL by `playlist_index_hash`
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL no memory or too many URLs
+ */
+esp_err_t playlist_index_append(playlist_index_t *index, const playlist_offset_t *offset, uint32_t hash);
+
+/**
+ * @brief Remove a URL, ids after it decrease by one
+ */
+esp_err_t playlist_index_remove(playlist_index_t *index, uint16_t id);
+
+/**
+ * @brief Get position of URL in storage
+ */
+esp_err_t playlist_index_get_offset(playlist_index_t *index, uint16_t id, playlist_offset_t *offset);
+
+/**
+ * @brief Split URL into directory (up to and including the last '/') and leaf name
+ *
+ * @param      index  Index
+ * @param      url    URL to be split
+ * @param[out] dir    Index of directory in directory table, directory is added if not exist
+ * @param[out] leaf   Leaf name, point into `url`
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL no memory or too many directories
+ */
+esp_err_t playlist_index_split_url(playlist_index_t *index, const char *url, uint16_t *dir, const char **leaf);
+
+/**
+ * @brief Get URL by id, the URL is kept in arena
+ *
+ * @param index  Index
+ * @param id     URL id
+ * @param read   Function to read leaf name from storage when URL is not in arena
+ * @param ctx    Context of `read`
+ *
+ * @return
+ *     - URL  valid until next call or `playlist_index_cache_clear`
+ *     - NULL fail to read URL
+ */
+char *playlist_index_get_url(playlist_index_t *index, uint16_t id, playlist_index_read_t read, void *ctx);
+
+/**
+ * @brief Read URL into `buf` without touching arena
+ *
+ * @return
+ *     - ESP_OK   success
+ *     - ESP_FAIL fail to read or `buf` too small
+ */
+esp_err_t playlist_index_read_url(playlist_index_t *index, uint16_t id, playlist_index_read_t read, void *ctx, char *buf, int size);
+
+/**
+ * @brief Hash of URL used by membership lookup
+ */
+uint32_t playlist_index_hash(const char *url);
+
+/**
+ * @brief Get next URL id whose hash equals `hash`, the URL still needs to be compared
+ *
+ * @param      index  Index
+ * @param      hash   Hash of URL by `playlist_index_hash`
+ * @param[in,out] probe  Probe count, set to 0 before the first call
+ *
+ * @return
+ *     - URL id
+ *     - -1     no more URL with this hash
+ */
+int playlist_index_find_next(playlist_index_t *index, uint32_t hash, uint32_t *probe);
+
+/**
+ * @brief Check whether URL is in index, only URLs with same hash are read from storage
+ *
+ * @param index  Index
+ * @param url    URL to find
+ * @param read   Function to read leaf name from storage
+ * @param ctx    Context of `read`
+ *
+ * @return
+ *     - true   URL exists
+ *     - false  not found or fail to read
+ */
+bool playlist_index_exist(playlist_index_t *index, const char *url, playlist_index_read_t read, void *ctx);
+
+/**
+ * @brief Get URL id `step` positions after (forward) or before current one in play order
+ *
+ * @return
+ *     - ESP_OK            success
+ *     - ESP_ERR_NOT_FOUND reach end of playlist and repeat mode is PLAYLIST_REPEAT_NONE
+ *     - ESP_FAIL          no URL or invalid step
+ */
+esp_err_t playlist_index_step(playlist_index_t *index, int step, bool forward, uint16_t *id);
+
+/**
+ * @brief Set shuffle and repeat mode, current URL becomes the first one of new shuffled order
+ */
+esp_err_t playlist_index_set_mode(playlist_index_t *index, bool shuffle, playlist_repeat_t repeat);
+
+/**
+ * @brief Find URL in arena
+ *
+ * @return
+ *     - URL  URL is kept in arena
+ *     - NULL not found
+ */
+char *playlist_index_cache_find(playlist_index_t *index, uint16_t id);
+
+/**
+ * @brief Allocate `len + 1` bytes in arena for URL, older URLs are overwritten
+ *
+ * @note  The latest allocated URL is valid until next allocation or `playlist_index_cache_clear`
+ *        Call `playlist_index_cache_clear` if fail to fill it
+ *
+ * @return
+ *     - Buffer to fill URL
+ *     - NULL   no memory or URL too long
+ */
+char *playlist_index_cache_alloc(playlist_index_t *index, uint16_t id, uint16_t len);
+
+/**
+ * @brief Drop all URLs in arena
+ */
+void playlist_index_cache_clear(playlist_index_t *index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
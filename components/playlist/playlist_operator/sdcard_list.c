@@ -23,6 +23,7 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
 #include <sys/types.h>
 #include <dirent.h>
 #include <sys/stat.h>
@@ -31,15 +32,27 @@
 #include "audio_error.h"
 #include "audio_mem.h"
 #include "sdcard_list.h"
+#include "playlist_index.h"
 
 #define SDCARD_DEFAULT_DIR_NAME         "/sdcard/__playlist"
 #define SDCARD_DEFAULT_URL_FILE_NAME    "/sdcard/__playlist/_playlist_url"
 #define SDCARD_DEFAULT_OFFSET_FILE_NAME "/sdcard/__playlist/_offset"
+#define SDCARD_DEFAULT_META_FILE_NAME   "/sdcard/__playlist/_meta"
+#define SDCARD_DEFAULT_SEEK_FILE_NAME   "/sdcard/__playlist/_seek"
+#define SDCARD_META_CACHE_SUFFIX        "_last"
 
 #define SDCARD_URL_FILE_NAME_LENGTH     (strlen(SDCARD_DEFAULT_URL_FILE_NAME) + 10)
 #define SDCARD_OFFSET_FILE_NAME_LENGTH  (strlen(SDCARD_DEFAULT_OFFSET_FILE_NAME) + 10)
+#define SDCARD_META_FILE_NAME_LENGTH    (strlen(SDCARD_DEFAULT_META_FILE_NAME) + 10)
+#define SDCARD_SEEK_FILE_NAME_LENGTH    (strlen(SDCARD_DEFAULT_SEEK_FILE_NAME) + 10)
 
 #define SDCARD_LIST_URL_MAX_LENGTH      (1024 * 2)
+#define SDCARD_LIST_BATCH_URL_SIZE      (SDCARD_LIST_URL_MAX_LENGTH * 2)
+#define SDCARD_LIST_BATCH_OFFSET_NUM    (256)
+#define SDCARD_FILE_PREV_NAME           "file:/"
+
+#define SDCARD_META_MAGIC               (0x4154454D) /* "META" */
+#define SDCARD_META_READ_NUM            (16)
 
 #define CHECK_ERROR(TAG, para, action)  {\
     if ((para) == false) {\
@@ -50,41 +63,262 @@
 
 static const char *TAG = "PLAYLIST_SDCARD";
 
+/**
+ * @brief Metadata record of one url, file is probed again only when url, size or modification time changed
+ */
+typedef struct {
+    uint32_t           magic;            /*!< SDCARD_META_MAGIC, record is invalid otherwise */
+    uint32_t           hash;             /*!< Hash of url */
+    uint32_t           size;             /*!< File size when probed */
+    uint32_t           mtime;            /*!< File modification time when probed */
+    media_probe_info_t info;             /*!< Probed metadata */
+} sdcard_meta_record_t;
+
+/**
+ * @brief Position of cached record, sorted by hash of url
+ */
+typedef struct {
+    uint32_t hash;                       /*!< Hash of url */
+    uint32_t id;                         /*!< Url id when cached */
+} sdcard_meta_key_t;
+
 /**
  * @brief Sdcard list management unit
  */
 typedef struct sdcard_list {
     char *save_file_name;                /*!< Name of file to save URLs */
     char *offset_file_name;              /*!< Name of file to save offset */
+    char *meta_file_name;                /*!< Name of file to save metadata records */
+    char *seek_file_name;                /*!< Name of file to save seek index records */
     FILE *save_file;                     /*!< File to save urls */
     FILE *offset_file;                   /*!< File to save offset of urls */
-    char *cur_url;                       /*!< Point to current URL */
-    uint16_t url_num;                    /*!< Number of URLs */
-    uint16_t cur_url_id;                 /*!< Current url ID */
+    FILE *meta_file;                     /*!< File to save metadata of urls, NULL if disabled */
+    FILE *seek_file;                     /*!< File to save seek index of urls, NULL before the first one saved */
+    char *meta_cache_name;               /*!< Name of metadata file kept from last open */
+    FILE *meta_cache;                    /*!< Records kept from last open, looked up before probe, NULL if none */
+    sdcard_meta_key_t *meta_keys;        /*!< Keys of records kept from last open, built at the first miss by url id */
+    int  meta_key_num;                   /*!< Number of keys, -1 if not built */
+    playlist_index_t index;              /*!< Offsets of URLs, play position and recently read URLs */
     uint32_t total_size_save_file;       /*!< Size of file to save URLs */
     uint32_t total_size_offset_file;     /*!< Size of file to save offset */
+    bool     batch;                      /*!< Saved URLs are buffered until commit */
+    char     *batch_url;                 /*!< Buffered leaf names of URLs */
+    playlist_offset_t *batch_offset;     /*!< Buffered offset records */
+    uint32_t *batch_hash;                /*!< Hash of buffered URLs */
+    uint32_t batch_url_size;             /*!< Size of buffered leaf names */
+    uint16_t batch_url_num;              /*!< Number of buffered URLs */
 } sdcard_list_t;
 
 esp_err_t sdcard_list_get_operation(playlist_operation_t *operation);
 
+static esp_err_t write_url_to_sdcard(sdcard_list_t *playlist, const char *leaf, uint32_t leaf_size, const playlist_offset_t *offset, const uint32_t *hash, uint16_t url_num, bool sync)
+{
+    uint32_t offset_size = url_num * sizeof(playlist_offset_t);
+    CHECK_ERROR(TAG, ((fseek(playlist->offset_file, playlist->total_size_offset_file, SEEK_SET)) == 0), return ESP_FAIL);
+    CHECK_ERROR(TAG, ((fseek(playlist->save_file, playlist->total_size_save_file, SEEK_SET)) == 0), return ESP_FAIL);
+    CHECK_ERROR(TAG, (fwrite(leaf, 1, leaf_size, playlist->save_file) == leaf_size), return ESP_FAIL);
+    CHECK_ERROR(TAG, (fwrite(offset, 1, offset_size, playlist->offset_file) == offset_size), return ESP_FAIL);
+    if (sync) {
+        CHECK_ERROR(TAG, (fsync(fileno(playlist->save_file)) == 0), return ESP_FAIL);
+        CHECK_ERROR(TAG, (fsync(fileno(playlist->offset_file)) == 0), return ESP_FAIL);
+    }
+    playlist->total_size_save_file += leaf_size;
+    playlist->total_size_offset_file += offset_size;
+    for (int i = 0; i < url_num; i++) {
+        CHECK_ERROR(TAG, (playlist_index_append(&playlist->index, &offset[i], hash[i]) == ESP_OK), return ESP_FAIL);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t read_leaf_from_sdcard(void *ctx, uint32_t pos, char *buf, uint16_t len)
+{
+    sdcard_list_t *playlist = (sdcard_list_t *)ctx;
+    CHECK_ERROR(TAG, ((fseek(playlist->save_file, pos, SEEK_SET)) == 0), return ESP_FAIL);
+    CHECK_ERROR(TAG, ((fread(buf, 1, len, playlist->save_file)) == len), return ESP_FAIL);
+    return ESP_OK;
+}
+
+static esp_err_t flush_batch_to_sdcard(sdcard_list_t *playlist, bool sync)
+{
+    if (playlist->batch_url_num == 0) {
+        return ESP_OK;
+    }
+    esp_err_t ret = write_url_to_sdcard(playlist, playlist->batch_url, playlist->batch_url_size,
+                                        playlist->batch_offset, playlist->batch_hash, playlist->batch_url_num, sync);
+    playlist->batch_url_size = 0;
+    playlist->batch_url_num = 0;
+    return ret;
+}
+
+static void free_batch(sdcard_list_t *playlist)
+{
+    audio_free(playlist->batch_url);
+    audio_free(playlist->batch_offset);
+    audio_free(playlist->batch_hash);
+    playlist->batch_url = NULL;
+    playlist->batch_offset = NULL;
+    playlist->batch_hash = NULL;
+    playlist->batch_url_size = 0;
+    playlist->batch_url_num = 0;
+    playlist->batch = false;
+}
+
+static int compare_meta_key(const void *a, const void *b)
+{
+    uint32_t ha = ((const sdcard_meta_key_t *)a)->hash;
+    uint32_t hb = ((const sdcard_meta_key_t *)b)->hash;
+    return ha < hb ? -1 : ha > hb;
+}
+
+static bool read_meta_cache(sdcard_list_t *playlist, uint32_t id, sdcard_meta_record_t *record)
+{
+    sdcard_meta_record_t cached;
+    if (fseek(playlist->meta_cache, id * sizeof(cached), SEEK_SET) != 0
+        || fread(&cached, 1, sizeof(cached), playlist->meta_cache) != sizeof(cached)) {
+        return false;
+    }
+    if (cached.magic != SDCARD_META_MAGIC || cached.hash != record->hash
+        || cached.size != record->size || cached.mtime != record->mtime) {
+        return false;
+    }
+    record->info = cached.info;
+    return true;
+}
+
+static void build_meta_keys(sdcard_list_t *playlist)
+{
+    // Only once, a failure leaves the cache usable by url id
+    playlist->meta_key_num = 0;
+    if (fseek(playlist->meta_cache, 0, SEEK_END) != 0) {
+        return;
+    }
+    long num = ftell(playlist->meta_cache) / sizeof(sdcard_meta_record_t);
+    sdcard_meta_record_t *records = audio_malloc(SDCARD_META_READ_NUM * sizeof(sdcard_meta_record_t));
+    if (num <= 0 || records == NULL || fseek(playlist->meta_cache, 0, SEEK_SET) != 0) {
+        audio_free(records);
+        return;
+    }
+    playlist->meta_keys = audio_malloc(num * sizeof(sdcard_meta_key_t));
+    AUDIO_NULL_CHECK(TAG, playlist->meta_keys, {
+        audio_free(records);
+        return;
+    });
+    int key_num = 0;
+    for (long id = 0; id < num; id += SDCARD_META_READ_NUM) {
+        int n = fread(records, sizeof(sdcard_meta_record_t), SDCARD_META_READ_NUM, playlist->meta_cache);
+        for (int i = 0; i < n; i++) {
+            if (records[i].magic == SDCARD_META_MAGIC) {
+                playlist->meta_keys[key_num].hash = records[i].hash;
+                playlist->meta_keys[key_num].id = id + i;
+                key_num++;
+            }
+        }
+        if (n < SDCARD_META_READ_NUM) {
+            break;
+        }
+    }
+    audio_free(records);
+    qsort(playlist->meta_keys, key_num, sizeof(sdcard_meta_key_t), compare_meta_key);
+    playlist->meta_key_num = key_num;
+}
+
+static bool find_meta_cache(sdcard_list_t *playlist, uint32_t id, sdcard_meta_record_t *record)
+{
+    if (playlist->meta_cache == NULL) {
+        return false;
+    }
+    // Scan order is stable for an unchanged card, so url id of last open hits mostly
+    if (read_meta_cache(playlist, id, record)) {
+        return true;
+    }
+    if (playlist->meta_key_num < 0) {
+        build_meta_keys(playlist);
+    }
+    int low = 0;
+    int high = playlist->meta_key_num;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (playlist->meta_keys[mid].hash < record->hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    for (; low < playlist->meta_key_num && playlist->meta_keys[low].hash == record->hash; low++) {
+        if (playlist->meta_keys[low].id != id && read_meta_cache(playlist, playlist->meta_keys[low].id, record)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void close_meta_cache(sdcard_list_t *playlist)
+{
+    if (playlist->meta_cache) {
+        fclose(playlist->meta_cache);
+        playlist->meta_cache = NULL;
+    }
+    audio_free(playlist->meta_keys);
+    playlist->meta_keys = NULL;
+    playlist->meta_key_num = -1;
+}
+
+static esp_err_t save_meta_to_sdcard(sdcard_list_t *playlist, uint32_t id, const char *path, uint32_t hash)
+{
+    // Record of url id is at fixed position, url without valid record is skipped when read
+    sdcard_meta_record_t record = {
+        .magic = SDCARD_META_MAGIC,
+        .hash = hash,
+    };
+    const char *file = path;
+    if (strncmp(file, SDCARD_FILE_PREV_NAME, strlen(SDCARD_FILE_PREV_NAME)) == 0) {
+        file += strlen(SDCARD_FILE_PREV_NAME);
+    }
+    struct stat st;
+    if (stat(file, &st) == 0) {
+        record.size = st.st_size;
+        record.mtime = st.st_mtime;
+        if (find_meta_cache(playlist, id, &record) == false && media_probe_file(path, &record.info) != ESP_OK) {
+            memset(&record.info, 0, sizeof(record.info));
+        }
+    }
+    CHECK_ERROR(TAG, ((fseek(playlist->meta_file, id * sizeof(record), SEEK_SET)) == 0), return ESP_FAIL);
+    CHECK_ERROR(TAG, (fwrite(&record, 1, sizeof(record), playlist->meta_file) == sizeof(record)), return ESP_FAIL);
+    if (playlist->batch == false) {
+        CHECK_ERROR(TAG, (fsync(fileno(playlist->meta_file)) == 0), return ESP_FAIL);
+    }
+    return ESP_OK;
+}
+
 static esp_err_t save_url_to_sdcard(sdcard_list_t *playlist, const char *path)
 {
     if (playlist->save_file == NULL || playlist->offset_file == NULL) {
         ESP_LOGE(TAG, "The file to save playlist failed to open");
         return ESP_FAIL;
     }
-    uint16_t len = strlen(path);
-    CHECK_ERROR(TAG, ((fseek(playlist->offset_file, playlist->total_size_offset_file, SEEK_SET)) == 0), return ESP_FAIL);
-    CHECK_ERROR(TAG, ((fseek(playlist->save_file, playlist->total_size_save_file, SEEK_SET)) == 0), return ESP_FAIL);
-    CHECK_ERROR(TAG, (fwrite(path, 1, len, playlist->save_file) == len), return ESP_FAIL);
-    CHECK_ERROR(TAG, (fwrite(&playlist->total_size_save_file, 1, sizeof(uint32_t), playlist->offset_file) == sizeof(uint32_t)), return ESP_FAIL);
-    CHECK_ERROR(TAG, (fwrite(&len, 1, sizeof(uint16_t), playlist->offset_file)) == sizeof(uint16_t), return ESP_FAIL);
-    CHECK_ERROR(TAG, (fsync(fileno(playlist->save_file)) == 0), return ESP_FAIL);
-    CHECK_ERROR(TAG, (fsync(fileno(playlist->offset_file)) == 0), return ESP_FAIL);
-    playlist->total_size_save_file += len;
-    playlist->total_size_offset_file += (sizeof(uint16_t) + sizeof(uint32_t));
-    playlist->url_num++;
-
+    // Only leaf name is written, directory part is shared in directory table
+    playlist_offset_t offset;
+    const char *leaf = NULL;
+    CHECK_ERROR(TAG, (playlist_index_split_url(&playlist->index, path, &offset.dir, &leaf) == ESP_OK), return ESP_FAIL);
+    offset.len = strlen(leaf);
+    uint32_t hash = playlist_index_hash(path);
+    if (playlist->meta_file) {
+        CHECK_ERROR(TAG, (save_meta_to_sdcard(playlist, playlist->index.url_num + playlist->batch_url_num, path, hash) == ESP_OK), return ESP_FAIL);
+    }
+    if (playlist->batch == false) {
+        offset.pos = playlist->total_size_save_file;
+        return write_url_to_sdcard(playlist, leaf, offset.len, &offset, &hash, 1, true);
+    }
+    // Write buffered URLs without sync when buffer is full, sync once when commit
+    if (playlist->batch_url_size + offset.len > SDCARD_LIST_BATCH_URL_SIZE || playlist->batch_url_num == SDCARD_LIST_BATCH_OFFSET_NUM) {
+        CHECK_ERROR(TAG, (flush_batch_to_sdcard(playlist, false) == ESP_OK), return ESP_FAIL);
+    }
+    offset.pos = playlist->total_size_save_file + playlist->batch_url_size;
+    playlist->batch_offset[playlist->batch_url_num] = offset;
+    playlist->batch_hash[playlist->batch_url_num] = hash;
+    memcpy(playlist->batch_url + playlist->batch_url_size, leaf, offset.len);
+    playlist->batch_url_size += offset.len;
+    playlist->batch_url_num++;
     return ESP_OK;
 }
 
@@ -100,6 +334,25 @@ static esp_err_t sdcard_list_open(sdcard_list_t *playlist, uint8_t list_id)
 
     sprintf(playlist->save_file_name, "%s%d", SDCARD_DEFAULT_URL_FILE_NAME, list_id);
     sprintf(playlist->offset_file_name, "%s%d", SDCARD_DEFAULT_OFFSET_FILE_NAME, list_id);
+    // Metadata file is created when enabled, the one of last open is kept as probe cache
+    playlist->meta_file_name = audio_calloc(1, SDCARD_META_FILE_NAME_LENGTH);
+    playlist->meta_cache_name = audio_calloc(1, SDCARD_META_FILE_NAME_LENGTH);
+    if (playlist->meta_file_name && playlist->meta_cache_name) {
+        sprintf(playlist->meta_file_name, "%s%d", SDCARD_DEFAULT_META_FILE_NAME, list_id);
+        sprintf(playlist->meta_cache_name, "%s%d%s", SDCARD_DEFAULT_META_FILE_NAME, list_id, SDCARD_META_CACHE_SUFFIX);
+    } else {
+        audio_free(playlist->meta_file_name);
+        audio_free(playlist->meta_cache_name);
+        playlist->meta_file_name = NULL;
+        playlist->meta_cache_name = NULL;
+    }
+    playlist->meta_key_num = -1;
+    // Seek index file is created when the first index saved, records of last boot are dropped with urls
+    playlist->seek_file_name = audio_calloc(1, SDCARD_SEEK_FILE_NAME_LENGTH);
+    if (playlist->seek_file_name) {
+        sprintf(playlist->seek_file_name, "%s%d", SDCARD_DEFAULT_SEEK_FILE_NAME, list_id);
+        remove(playlist->seek_file_name);
+    }
 
     mkdir(SDCARD_DEFAULT_DIR_NAME, 0777);
 
@@ -110,6 +363,9 @@ static esp_err_t sdcard_list_open(sdcard_list_t *playlist, uint8_t list_id)
         ESP_LOGE(TAG, "open file error, line: %d, have you mounted sdcard, set the long file name and UTF-8 encoding configuration ?", __LINE__);
         audio_free(playlist->save_file_name);
         audio_free(playlist->offset_file_name);
+        audio_free(playlist->meta_file_name);
+        audio_free(playlist->meta_cache_name);
+        audio_free(playlist->seek_file_name);
         if (playlist->save_file) {
             fclose(playlist->save_file);
         }
@@ -127,36 +383,24 @@ static esp_err_t sdcard_list_close(sdcard_list_t *playlist)
     fclose(playlist->save_file);
     playlist->offset_file = NULL;
     playlist->save_file = NULL;
+    if (playlist->meta_file) {
+        fclose(playlist->meta_file);
+        playlist->meta_file = NULL;
+    }
+    close_meta_cache(playlist);
+    if (playlist->seek_file) {
+        fclose(playlist->seek_file);
+        playlist->seek_file = NULL;
+    }
     return ESP_OK;
 }
 
 static esp_err_t sdcard_list_choose_id(sdcard_list_t *playlist, int id, char **url_buff)
 {
-    uint32_t pos = 0;
-    uint16_t  size = 0;
-    int offset = id * (sizeof(uint32_t) + sizeof(uint16_t));
-
-    CHECK_ERROR(TAG, ((fseek(playlist->offset_file, offset, SEEK_SET)) == 0), return ESP_FAIL);
-    CHECK_ERROR(TAG, ((fread(&pos, 1, sizeof(uint32_t), playlist->offset_file)) == sizeof(uint32_t)), return ESP_FAIL);
-    CHECK_ERROR(TAG, ((fread(&size, 1, sizeof(uint16_t), playlist->offset_file)) == sizeof(uint16_t)), return ESP_FAIL);
-
-    if (playlist->cur_url) {
-        audio_free(playlist->cur_url);
-    }
-    playlist->cur_url = (char *)audio_calloc(1, size + 1);
-    AUDIO_NULL_CHECK(TAG, playlist->cur_url, {
-        ESP_LOGE(TAG, "Fail to allocate memory for url");
-        fclose(playlist->offset_file);
-        fclose(playlist->save_file);
-        return ESP_FAIL;
-    });
-
-    CHECK_ERROR(TAG, ((fseek(playlist->save_file, pos, SEEK_SET)) == 0), return ESP_FAIL);
-    CHECK_ERROR(TAG, ((fread(playlist->cur_url, 1, size, playlist->save_file)) == size), return ESP_FAIL);
-
-    playlist->cur_url[size] = 0;
-    playlist->cur_url_id = id;
-    *url_buff = playlist->cur_url;
+    char *url = playlist_index_get_url(&playlist->index, id, read_leaf_from_sdcard, playlist);
+    AUDIO_NULL_CHECK(TAG, url, return ESP_FAIL);
+    playlist->index.cur_id = id;
+    *url_buff = url;
 
     return ESP_OK;
 }
@@ -177,6 +421,7 @@ esp_err_t sdcard_list_create(playlist_operator_handle_t *handle)
 
     sdcard_handle->playlist = sdcard_list;
     sdcard_handle->get_operation = sdcard_list_get_operation;
+    playlist_index_init(&sdcard_list->index, true);
 
     static int list_id;
     ret |= sdcard_list_open(sdcard_list, list_id++);
@@ -195,21 +440,17 @@ esp_err_t sdcard_list_show(playlist_operator_handle_t handle)
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
     sdcard_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+    CHECK_ERROR(TAG, (flush_batch_to_sdcard(playlist, false) == ESP_OK), return ESP_FAIL);
 
-    uint32_t pos = 0;
-    uint16_t  size = 0;
     char *url = audio_calloc(1, SDCARD_LIST_URL_MAX_LENGTH);
-
-    CHECK_ERROR(TAG, (fseek(playlist->save_file, 0, SEEK_SET) == 0), return ESP_FAIL);
-    CHECK_ERROR(TAG, (fseek(playlist->offset_file, 0, SEEK_SET) == 0), return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, url, return ESP_FAIL);
 
     ESP_LOGI(TAG, "ID   URL");
-    for (int i = 0; i < playlist->url_num; i++) {
-        memset(url, 0, SDCARD_LIST_URL_MAX_LENGTH);
-        CHECK_ERROR(TAG, (fread(&pos, 1, sizeof(uint32_t), playlist->offset_file) == sizeof(uint32_t)), return ESP_FAIL);
-        CHECK_ERROR(TAG, (fread(&size, 1, sizeof(uint16_t), playlist->offset_file) == sizeof(uint16_t)), return ESP_FAIL);
-        CHECK_ERROR(TAG, (fseek(playlist->save_file, pos, SEEK_SET) == 0), return ESP_FAIL);
-        CHECK_ERROR(TAG, (fread(url, 1, size, playlist->save_file) == size), return ESP_FAIL);
+    for (int i = 0; i < playlist->index.url_num; i++) {
+        CHECK_ERROR(TAG, (playlist_index_read_url(&playlist->index, i, read_leaf_from_sdcard, playlist, url, SDCARD_LIST_URL_MAX_LENGTH) == ESP_OK), {
+            audio_free(url);
+            return ESP_FAIL;
+        });
         ESP_LOGI(TAG, "%d   %s", i, url);
     }
 
@@ -223,8 +464,9 @@ esp_err_t sdcard_list_next(playlist_operator_handle_t handle, int step, char **u
     AUDIO_NULL_CHECK(TAG, url_buff, return ESP_FAIL);
     sdcard_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+    CHECK_ERROR(TAG, (flush_batch_to_sdcard(playlist, false) == ESP_OK), return ESP_FAIL);
 
-    if (playlist->url_num == 0) {
+    if (playlist->index.url_num == 0) {
         ESP_LOGE(TAG, "No url, please save urls to playlist first");
         return ESP_FAIL;
     }
@@ -233,13 +475,12 @@ esp_err_t sdcard_list_next(playlist_operator_handle_t handle, int step, char **u
         return ESP_FAIL;
     }
 
-    int id = 0, total_step = 0;
-    total_step = playlist->cur_url_id + step;
-    id = total_step;
-    if (total_step >= playlist->url_num) {
-        id = total_step % playlist->url_num;
+    uint16_t id = 0;
+    esp_err_t ret = playlist_index_step(&playlist->index, step, true, &id);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Already the last url of the playlist");
+        return ret;
     }
-
     return sdcard_list_choose_id(playlist, id, url_buff);
 }
 
@@ -249,8 +490,9 @@ esp_err_t sdcard_list_prev(playlist_operator_handle_t handle, int step, char **u
     AUDIO_NULL_CHECK(TAG, url_buff, return ESP_FAIL);
     sdcard_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+    CHECK_ERROR(TAG, (flush_batch_to_sdcard(playlist, false) == ESP_OK), return ESP_FAIL);
 
-    if (playlist->url_num == 0) {
+    if (playlist->index.url_num == 0) {
         ESP_LOGE(TAG, "No url, please save urls to playlist first");
         return ESP_FAIL;
     }
@@ -259,18 +501,12 @@ esp_err_t sdcard_list_prev(playlist_operator_handle_t handle, int step, char **u
         return ESP_FAIL;
     }
 
-    int id = 0, total_step = 0;
-    total_step = playlist->cur_url_id - step;
-    id = total_step;
-
-    if (total_step < 0) {
-        if (total_step % playlist->url_num == 0) {
-            id = 0;
-        } else {
-            id = playlist->url_num + total_step % playlist->url_num;
-        }
+    uint16_t id = 0;
+    esp_err_t ret = playlist_index_step(&playlist->index, step, false, &id);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Already the first url of the playlist");
+        return ret;
     }
-
     return sdcard_list_choose_id(playlist, id, url_buff);
 }
 
@@ -280,13 +516,14 @@ esp_err_t sdcard_list_current(playlist_operator_handle_t handle, char **url_buff
     AUDIO_NULL_CHECK(TAG, url_buff, return ESP_FAIL);
     sdcard_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+    CHECK_ERROR(TAG, (flush_batch_to_sdcard(playlist, false) == ESP_OK), return ESP_FAIL);
 
-    if (playlist->url_num == 0) {
+    if (playlist->index.url_num == 0) {
         ESP_LOGE(TAG, "No url, please save urls to playlist first");
         return ESP_FAIL;
     }
 
-    return sdcard_list_choose_id(playlist, playlist->cur_url_id, url_buff);
+    return sdcard_list_choose_id(playlist, playlist->index.cur_id, url_buff);
 }
 
 esp_err_t sdcard_list_choose(playlist_operator_handle_t handle, int url_id, char **url_buff)
@@ -295,12 +532,13 @@ esp_err_t sdcard_list_choose(playlist_operator_handle_t handle, int url_id, char
     AUDIO_NULL_CHECK(TAG, url_buff, return ESP_FAIL);
     sdcard_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+    CHECK_ERROR(TAG, (flush_batch_to_sdcard(playlist, false) == ESP_OK), return ESP_FAIL);
 
-    if (playlist->url_num == 0) {
+    if (playlist->index.url_num == 0) {
         ESP_LOGE(TAG, "No url, please save urls to playlist first");
         return ESP_FAIL;
     }
-    if ((url_id < 0) || (url_id >= playlist->url_num)) {
+    if ((url_id < 0) || (url_id >= playlist->index.url_num)) {
         ESP_LOGE(TAG, "Invalid url id to be choosen");
         return ESP_FAIL;
     }
@@ -325,35 +563,176 @@ esp_err_t sdcard_list_save(playlist_operator_handle_t handle, const char *url)
     return ret;
 }
 
-bool sdcard_list_exist(playlist_operator_handle_t handle, const char *url)
+esp_err_t sdcard_list_save_begin(playlist_operator_handle_t handle)
 {
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
     sdcard_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    uint32_t pos = 0;
-    uint16_t  size = 0;
-    char *url_buff = audio_calloc(1, SDCARD_LIST_URL_MAX_LENGTH);
-
-    CHECK_ERROR(TAG, (fseek(playlist->save_file, 0, SEEK_SET) == 0), return ESP_FAIL);
-    CHECK_ERROR(TAG, (fseek(playlist->offset_file, 0, SEEK_SET) == 0), return ESP_FAIL);
-
-    for (int i = 0; i < playlist->url_num; i++) {
-        memset(url_buff, 0, SDCARD_LIST_URL_MAX_LENGTH);
-        CHECK_ERROR(TAG, (fread(&pos, 1, sizeof(uint32_t), playlist->offset_file) == sizeof(uint32_t)), return ESP_FAIL);
-        CHECK_ERROR(TAG, (fread(&size, 1, sizeof(uint16_t), playlist->offset_file) == sizeof(uint16_t)), return ESP_FAIL);
-        CHECK_ERROR(TAG, (fseek(playlist->save_file, pos, SEEK_SET) == 0), return ESP_FAIL);
-        CHECK_ERROR(TAG, (fread(url_buff, 1, size, playlist->save_file) == size), return ESP_FAIL);
-        if (strlen(url_buff) != strlen(url)) {
-            continue;
+    if (playlist->batch) {
+        return ESP_OK;
+    }
+    playlist->batch_url = audio_malloc(SDCARD_LIST_BATCH_URL_SIZE);
+    playlist->batch_offset = audio_malloc(SDCARD_LIST_BATCH_OFFSET_NUM * sizeof(playlist_offset_t));
+    playlist->batch_hash = audio_malloc(SDCARD_LIST_BATCH_OFFSET_NUM * sizeof(uint32_t));
+    if (playlist->batch_url == NULL || playlist->batch_offset == NULL || playlist->batch_hash == NULL) {
+        ESP_LOGE(TAG, "No memory for batch save");
+        free_batch(playlist);
+        return ESP_FAIL;
+    }
+    playlist->batch = true;
+    return ESP_OK;
+}
+
+esp_err_t sdcard_list_save_commit(playlist_operator_handle_t handle)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    sdcard_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+
+    if (playlist->batch == false) {
+        return ESP_OK;
+    }
+    esp_err_t ret = flush_batch_to_sdcard(playlist, true);
+    if (playlist->meta_file && fsync(fileno(playlist->meta_file)) != 0) {
+        ret = ESP_FAIL;
+    }
+    free_batch(playlist);
+    return ret;
+}
+
+esp_err_t sdcard_list_set_mode(playlist_operator_handle_t handle, bool shuffle, playlist_repeat_t repeat)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    sdcard_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+    CHECK_ERROR(TAG, (flush_batch_to_sdcard(playlist, false) == ESP_OK), return ESP_FAIL);
+
+    return playlist_index_set_mode(&playlist->index, shuffle, repeat);
+}
+
+esp_err_t sdcard_list_enable_meta(playlist_operator_handle_t handle, bool enable)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    sdcard_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, playlist->meta_file_name, return ESP_FAIL);
+
+    if (enable == false) {
+        if (playlist->meta_file) {
+            fclose(playlist->meta_file);
+            playlist->meta_file = NULL;
+            remove(playlist->meta_file_name);
         }
-        if (strcmp(url, url_buff) == 0) {
-            audio_free(url_buff);
-            return true;
+        close_meta_cache(playlist);
+        remove(playlist->meta_cache_name);
+        return ESP_OK;
+    }
+    if (playlist->meta_file == NULL) {
+        // Records of last open become the cache, they are replaced by records of this open
+        remove(playlist->meta_cache_name);
+        if (rename(playlist->meta_file_name, playlist->meta_cache_name) == 0) {
+            playlist->meta_cache = fopen(playlist->meta_cache_name, "rb");
         }
+        playlist->meta_file = fopen(playlist->meta_file_name, "w+");
+        AUDIO_NULL_CHECK(TAG, playlist->meta_file, {
+            close_meta_cache(playlist);
+            return ESP_FAIL;
+        });
+    }
+    return ESP_OK;
+}
+
+esp_err_t sdcard_list_get_meta(playlist_operator_handle_t handle, int url_id, media_probe_info_t *info)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, info, return ESP_FAIL);
+    sdcard_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+    CHECK_ERROR(TAG, (flush_batch_to_sdcard(playlist, false) == ESP_OK), return ESP_FAIL);
+
+    if ((url_id < 0) || (url_id >= playlist->index.url_num)) {
+        ESP_LOGE(TAG, "Invalid url id to get metadata");
+        return ESP_FAIL;
+    }
+    if (playlist->meta_file == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    // Urls saved before metadata enabled have no record
+    sdcard_meta_record_t record;
+    if (fseek(playlist->meta_file, url_id * sizeof(record), SEEK_SET) != 0
+        || fread(&record, 1, sizeof(record), playlist->meta_file) != sizeof(record)
+        || record.magic != SDCARD_META_MAGIC || (record.info.flags & MEDIA_PROBE_FLAG_VALID) == 0) {
+        memset(info, 0, sizeof(media_probe_info_t));
+        return ESP_ERR_NOT_FOUND;
     }
+    *info = record.info;
+    return ESP_OK;
+}
 
-    audio_free(url_buff);
+esp_err_t sdcard_list_save_seek_index(playlist_operator_handle_t handle, int url_id, const seek_index_t *index)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, index, return ESP_FAIL);
+    sdcard_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, playlist->seek_file_name, return ESP_FAIL);
+    CHECK_ERROR(TAG, (flush_batch_to_sdcard(playlist, false) == ESP_OK), return ESP_FAIL);
+
+    if ((url_id < 0) || (url_id >= playlist->index.url_num)) {
+        ESP_LOGE(TAG, "Invalid url id to save seek index");
+        return ESP_FAIL;
+    }
+    if (playlist->seek_file == NULL) {
+        playlist->seek_file = fopen(playlist->seek_file_name, "w+");
+        AUDIO_NULL_CHECK(TAG, playlist->seek_file, return ESP_FAIL);
+    }
+    // Record of url id is at fixed position, gap before it reads as invalid record
+    CHECK_ERROR(TAG, ((fseek(playlist->seek_file, url_id * sizeof(seek_index_t), SEEK_SET)) == 0), return ESP_FAIL);
+    CHECK_ERROR(TAG, (fwrite(index, 1, sizeof(seek_index_t), playlist->seek_file) == sizeof(seek_index_t)), return ESP_FAIL);
+    CHECK_ERROR(TAG, (fsync(fileno(playlist->seek_file)) == 0), return ESP_FAIL);
+    return ESP_OK;
+}
+
+esp_err_t sdcard_list_get_seek_index(playlist_operator_handle_t handle, int url_id, seek_index_t *index)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, index, return ESP_FAIL);
+    sdcard_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+    CHECK_ERROR(TAG, (flush_batch_to_sdcard(playlist, false) == ESP_OK), return ESP_FAIL);
+
+    if ((url_id < 0) || (url_id >= playlist->index.url_num)) {
+        ESP_LOGE(TAG, "Invalid url id to get seek index");
+        return ESP_FAIL;
+    }
+    if (playlist->seek_file == NULL
+        || fseek(playlist->seek_file, url_id * sizeof(seek_index_t), SEEK_SET) != 0
+        || fread(index, 1, sizeof(seek_index_t), playlist->seek_file) != sizeof(seek_index_t)
+        || index->magic != SEEK_INDEX_MAGIC) {
+        memset(index, 0, sizeof(seek_index_t));
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+bool sdcard_list_exist(playlist_operator_handle_t handle, const char *url)
+{
+    AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
+    sdcard_list_t *playlist = handle->playlist;
+    AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+
+    if (playlist_index_exist(&playlist->index, url, read_leaf_from_sdcard, playlist)) {
+        return true;
+    }
+    // Buffered URLs are only flushed when hash of one of them matches
+    uint32_t hash = playlist_index_hash(url);
+    for (int i = 0; i < playlist->batch_url_num; i++) {
+        if (playlist->batch_hash[i] == hash) {
+            CHECK_ERROR(TAG, (flush_batch_to_sdcard(playlist, false) == ESP_OK), return false);
+            return playlist_index_exist(&playlist->index, url, read_leaf_from_sdcard, playlist);
+        }
+    }
     return false;
 }
 
@@ -371,15 +750,22 @@ esp_err_t sdcard_list_reset(playlist_operator_handle_t handle)
        CHECK_ERROR(TAG, (fseek(playlist->save_file, 0, SEEK_SET) == 0), return ESP_FAIL);
        CHECK_ERROR(TAG, (fseek(playlist->offset_file, 0, SEEK_SET) == 0), return ESP_FAIL);
     */
-    if (playlist->cur_url) {
-        audio_free(playlist->cur_url);
-        playlist->cur_url = NULL;
-    }
+    // Buffered URLs are dropped, batch keeps going
+    playlist->batch_url_size = 0;
+    playlist->batch_url_num = 0;
 
-    playlist->url_num = 0;
-    playlist->cur_url_id = 0;
+    playlist_index_reset(&playlist->index);
     playlist->total_size_offset_file = 0;
     playlist->total_size_save_file = 0;
+    // Drop old records so that url saved later not get record of removed url
+    if (playlist->meta_file) {
+        playlist->meta_file = freopen(playlist->meta_file_name, "w+", playlist->meta_file);
+        AUDIO_NULL_CHECK(TAG, playlist->meta_file, return ESP_FAIL);
+    }
+    if (playlist->seek_file) {
+        playlist->seek_file = freopen(playlist->seek_file_name, "w+", playlist->seek_file);
+        AUDIO_NULL_CHECK(TAG, playlist->seek_file, return ESP_FAIL);
+    }
     return ESP_OK;
 }
 
@@ -388,8 +774,9 @@ int sdcard_list_get_url_num(playlist_operator_handle_t handle)
     AUDIO_NULL_CHECK(TAG, handle, return ESP_FAIL);
     sdcard_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
+    CHECK_ERROR(TAG, (flush_batch_to_sdcard(playlist, false) == ESP_OK), return ESP_FAIL);
 
-    return playlist->url_num;
+    return playlist->index.url_num;
 }
 
 int sdcard_list_get_url_id(playlist_operator_handle_t handle)
@@ -398,7 +785,7 @@ int sdcard_list_get_url_id(playlist_operator_handle_t handle)
     sdcard_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
-    return playlist->cur_url_id;
+    return playlist->index.cur_id;
 }
 
 esp_err_t sdcard_list_destroy(playlist_operator_handle_t handle)
@@ -407,15 +794,23 @@ esp_err_t sdcard_list_destroy(playlist_operator_handle_t handle)
     sdcard_list_t *playlist = handle->playlist;
     AUDIO_NULL_CHECK(TAG, playlist, return ESP_FAIL);
 
+    free_batch(playlist);
     sdcard_list_close(playlist);
     remove(playlist->save_file_name);
     remove(playlist->offset_file_name);
+    // Metadata records are kept as probe cache of next open, only the older one is dropped
+    if (playlist->meta_cache_name) {
+        remove(playlist->meta_cache_name);
+    }
+    if (playlist->seek_file_name) {
+        remove(playlist->seek_file_name);
+    }
     audio_free(playlist->save_file_name);
     audio_free(playlist->offset_file_name);
-    if (playlist->cur_url) {
-        audio_free(playlist->cur_url);
-        playlist->cur_url = NULL;
-    }
+    audio_free(playlist->meta_file_name);
+    audio_free(playlist->meta_cache_name);
+    audio_free(playlist->seek_file_name);
+    playlist_index_deinit(&playlist->index);
     audio_free(playlist);
     handle->playlist = NULL;
     audio_free(handle);
@@ -436,6 +831,12 @@ esp_err_t sdcard_list_get_operation(playlist_operation_t *operation)
     operation->destroy = (void *)sdcard_list_destroy;
     operation->get_url_num = (void *)sdcard_list_get_url_num;
     operation->get_url_id  = (void *)sdcard_list_get_url_id;
+    operation->save_begin  = (void *)sdcard_list_save_begin;
+    operation->save_commit = (void *)sdcard_list_save_commit;
+    operation->set_mode    = (void *)sdcard_list_set_mode;
+    operation->get_meta    = (void *)sdcard_list_get_meta;
+    operation->get_seek_index  = (void *)sdcard_list_get_seek_index;
+    operation->save_seek_index = (void *)sdcard_list_save_seek_index;
     operation->type = PLAYLIST_SDCARD;
     return ESP_OK;
 }
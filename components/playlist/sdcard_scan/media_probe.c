@@ -0,0 +1,726 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include "esp_log.h"
+#include "audio_error.h"
+#include "media_probe.h"
+
+#define MEDIA_PROBE_FILE_PREFIX     "file:/"
+#define MEDIA_PROBE_TEXT_MAX        (256)   /* Bytes of one text field read at most */
+#define MEDIA_PROBE_SYNC_SEARCH     (1024)  /* Bytes searched for the first MPEG frame */
+#define MEDIA_PROBE_ADTS_FRAMES     (32)    /* ADTS frames read to estimate average frame size */
+#define MEDIA_PROBE_BOX_DEPTH       (8)
+#define MEDIA_PROBE_COMMENT_MAX     (64)    /* Vorbis comments checked at most */
+
+static const char *TAG = "MEDIA_PROBE";
+
+typedef struct {
+    FILE                *f;
+    uint32_t            size;       /*!< File size */
+    media_probe_info_t  *info;
+} probe_t;
+
+static const uint16_t mp3_bitrate[5][15] = {
+    {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},   /* MPEG1 layer 1 */
+    {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},      /* MPEG1 layer 2 */
+    {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},       /* MPEG1 layer 3 */
+    {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},      /* MPEG2 layer 1 */
+    {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},           /* MPEG2 layer 2 and 3 */
+};
+
+static const uint32_t mp3_sample_rate[3] = {44100, 48000, 32000};
+
+static const uint32_t aac_sample_rate[13] = {
+    96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350
+};
+
+static inline uint32_t be16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static inline uint32_t be24(const uint8_t *p)
+{
+    return (p[0] << 16) | (p[1] << 8) | p[2];
+}
+
+static inline uint32_t be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static inline uint32_t le16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint32_t syncsafe32(const uint8_t *p)
+{
+    return ((p[0] & 0x7F) << 21) | ((p[1] & 0x7F) << 14) | ((p[2] & 0x7F) << 7) | (p[3] & 0x7F);
+}
+
+static bool read_at(probe_t *p, uint32_t pos, void *buf, uint32_t len)
+{
+    if (pos > p->size || len > p->size - pos) {
+        return false;
+    }
+    if (fseek(p->f, pos, SEEK_SET) != 0) {
+        return false;
+    }
+    return fread(buf, 1, len, p->f) == len;
+}
+
+static bool put_utf8(char *dst, int size, int *pos, uint32_t cp)
+{
+    uint8_t tmp[4];
+    int n;
+    if (cp < 0x80) {
+        tmp[0] = cp;
+        n = 1;
+    } else if (cp < 0x800) {
+        tmp[0] = 0xC0 | (cp >> 6);
+        tmp[1] = 0x80 | (cp & 0x3F);
+        n = 2;
+    } else if (cp < 0x10000) {
+        tmp[0] = 0xE0 | (cp >> 12);
+        tmp[1] = 0x80 | ((cp >> 6) & 0x3F);
+        tmp[2] = 0x80 | (cp & 0x3F);
+        n = 3;
+    } else {
+        tmp[0] = 0xF0 | (cp >> 18);
+        tmp[1] = 0x80 | ((cp >> 12) & 0x3F);
+        tmp[2] = 0x80 | ((cp >> 6) & 0x3F);
+        tmp[3] = 0x80 | (cp & 0x3F);
+        n = 4;
+    }
+    // Keep whole characters only, so truncated text is still valid UTF-8
+    if (*pos + n >= size) {
+        return false;
+    }
+    memcpy(dst + *pos, tmp, n);
+    *pos += n;
+    return true;
+}
+
+/**
+ * Encoding: 0 ISO-8859-1, 1 UTF-16 with BOM, 2 UTF-16BE, 3 UTF-8, same as ID3v2
+ */
+static void copy_text(char *dst, int size, const uint8_t *src, int len, int encoding)
+{
+    if (dst[0] != '\0') {
+        return;
+    }
+    int pos = 0;
+    int i = 0;
+    if (encoding == 1 || encoding == 2) {
+        bool le = false;
+        if (encoding == 1 && len >= 2 && src[0] == 0xFF && src[1] == 0xFE) {
+            le = true;
+            i = 2;
+        } else if (encoding == 1 && len >= 2 && src[0] == 0xFE && src[1] == 0xFF) {
+            i = 2;
+        }
+        while (i + 1 < len) {
+            uint32_t cp = le ? le16(src + i) : be16(src + i);
+            i += 2;
+            if (cp == 0) {
+                break;
+            }
+            if (cp >= 0xD800 && cp < 0xDC00 && i + 1 < len) {
+                uint32_t low = le ? le16(src + i) : be16(src + i);
+                if (low >= 0xDC00 && low < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    i += 2;
+                }
+            }
+            if (put_utf8(dst, size, &pos, cp) == false) {
+                break;
+            }
+        }
+    } else if (encoding == 0) {
+        for (; i < len && src[i]; i++) {
+            if (put_utf8(dst, size, &pos, src[i]) == false) {
+                break;
+            }
+        }
+    } else {
+        for (; i < len && src[i] && pos < size - 1; i++) {
+            dst[pos++] = src[i];
+        }
+        // Drop the last character if it is cut
+        int end = pos;
+        while (end > 0 && (dst[end - 1] & 0xC0) == 0x80) {
+            end--;
+        }
+        if (end > 0 && (dst[end - 1] & 0x80)) {
+            uint8_t lead = dst[end - 1];
+            int need = (lead & 0xE0) == 0xC0 ? 2 : (lead & 0xF0) == 0xE0 ? 3 : 4;
+            if (pos - (end - 1) < need) {
+                pos = end - 1;
+            }
+        }
+    }
+    // Trailing spaces come from fixed-size fields of ID3v1
+    while (pos > 0 && dst[pos - 1] == ' ') {
+        pos--;
+    }
+    dst[pos] = '\0';
+}
+
+static void read_text(probe_t *p, uint32_t pos, uint32_t len, int encoding, char *dst, int size)
+{
+    uint8_t buf[MEDIA_PROBE_TEXT_MAX];
+    if (dst[0] != '\0') {
+        return;
+    }
+    if (len > sizeof(buf)) {
+        len = sizeof(buf);
+    }
+    if (read_at(p, pos, buf, len)) {
+        copy_text(dst, size, buf, len, encoding);
+    }
+}
+
+static uint32_t probe_id3v2(probe_t *p)
+{
+    uint8_t hdr[10];
+    if (read_at(p, 0, hdr, 10) == false || memcmp(hdr, "ID3", 3) != 0 || hdr[3] < 2 || hdr[3] > 4) {
+        return 0;
+    }
+    media_probe_info_t *info = p->info;
+    int version = hdr[3];
+    uint32_t tag_size = syncsafe32(hdr + 6);
+    uint32_t end = 10 + tag_size;
+    uint32_t audio_start = end + ((hdr[5] & 0x10) ? 10 : 0);
+    uint32_t pos = 10;
+    if ((hdr[5] & 0x40) && version >= 3) {
+        uint8_t ext[4];
+        if (read_at(p, pos, ext, 4) == false) {
+            return audio_start;
+        }
+        pos += version == 4 ? syncsafe32(ext) : be32(ext) + 4;
+    }
+    int frame_hdr = version == 2 ? 6 : 10;
+    while (pos + frame_hdr <= end && (info->title[0] == '\0' || info->artist[0] == '\0')) {
+        uint8_t fh[10];
+        if (read_at(p, pos, fh, frame_hdr) == false || fh[0] == '\0') {
+            break;
+        }
+        uint32_t size = version == 2 ? be24(fh + 3) : version == 3 ? be32(fh + 4) : syncsafe32(fh + 4);
+        if (size == 0 || size > end - pos - frame_hdr) {
+            break;
+        }
+        uint32_t data = pos + frame_hdr;
+        bool title = version == 2 ? memcmp(fh, "TT2", 3) == 0 : memcmp(fh, "TIT2", 4) == 0;
+        bool artist = version == 2 ? memcmp(fh, "TP1", 3) == 0 : memcmp(fh, "TPE1", 4) == 0;
+        if ((title || artist) && size > 1) {
+            uint8_t encoding;
+            if (read_at(p, data, &encoding, 1)) {
+                if (title) {
+                    read_text(p, data + 1, size - 1, encoding, info->title, sizeof(info->title));
+                } else {
+                    read_text(p, data + 1, size - 1, encoding, info->artist, sizeof(info->artist));
+                }
+            }
+        }
+        pos = data + size;
+    }
+    return audio_start;
+}
+
+static uint32_t probe_id3v1(probe_t *p)
+{
+    uint8_t tag[128];
+    if (p->size < 128 || read_at(p, p->size - 128, tag, 128) == false || memcmp(tag, "TAG", 3) != 0) {
+        return p->size;
+    }
+    copy_text(p->info->title, sizeof(p->info->title), tag + 3, 30, 0);
+    copy_text(p->info->artist, sizeof(p->info->artist), tag + 33, 30, 0);
+    return p->size - 128;
+}
+
+static bool mp3_header(const uint8_t *h, uint32_t *sample_rate, uint32_t *bitrate, int *spf, int *channels, int *side)
+{
+    if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0) {
+        return false;
+    }
+    int version = (h[1] >> 3) & 3;   /* 0: MPEG2.5, 2: MPEG2, 3: MPEG1 */
+    int layer = (h[1] >> 1) & 3;     /* 1: layer 3, 2: layer 2, 3: layer 1 */
+    int br_idx = h[2] >> 4;
+    int sr_idx = (h[2] >> 2) & 3;
+    if (version == 1 || layer == 0 || br_idx == 0 || br_idx == 15 || sr_idx == 3) {
+        return false;
+    }
+    bool v1 = version == 3;
+    int table = v1 ? 3 - layer : (layer == 3 ? 3 : 4);
+    *bitrate = mp3_bitrate[table][br_idx] * 1000;
+    *sample_rate = mp3_sample_rate[sr_idx] >> (v1 ? 0 : (version == 2 ? 1 : 2));
+    *spf = layer == 3 ? 384 : (layer == 1 && !v1) ? 576 : 1152;
+    *channels = (h[3] >> 6) == 3 ? 1 : 2;
+    *side = v1 ? (*channels == 1 ? 17 : 32) : (*channels == 1 ? 9 : 17);
+    return true;
+}
+
+static void probe_mp3(probe_t *p, uint32_t frame, uint32_t audio_end)
+{
+    media_probe_info_t *info = p->info;
+    uint8_t h[64] = { 0 };
+    uint32_t len = audio_end - frame < sizeof(h) ? audio_end - frame : sizeof(h);
+    uint32_t sample_rate, bitrate;
+    int spf, channels, side;
+    if (read_at(p, frame, h, len) == false || mp3_header(h, &sample_rate, &bitrate, &spf, &channels, &side) == false) {
+        return;
+    }
+    info->format = MEDIA_PROBE_FORMAT_MP3;
+    info->sample_rate = sample_rate;
+    info->channels = channels;
+    uint32_t audio_bytes = audio_end - frame;
+    uint32_t frames = 0;
+    uint32_t xing_pos = 4 + side;
+    const uint8_t *xing = h + xing_pos;
+    if (xing_pos + 12 <= len && (memcmp(xing, "Xing", 4) == 0 || memcmp(xing, "Info", 4) == 0)) {
+        uint32_t flags = be32(xing + 4);
+        if (flags & 1) {
+            frames = be32(xing + 8);
+        }
+        if ((flags & 3) == 3 && xing_pos + 16 <= len) {
+            audio_bytes = be32(xing + 12);
+        }
+        // LAME tag follows the optional fields, it keeps encoder delay and padding for gapless playback
+        uint32_t lame_pos = xing_pos + 8 + ((flags & 1) ? 4 : 0) + ((flags & 2) ? 4 : 0) + ((flags & 4) ? 100 : 0) + ((flags & 8) ? 4 : 0);
+        uint8_t lame[24];
+        if (frames && lame_pos + sizeof(lame) <= audio_end - frame && read_at(p, frame + lame_pos, lame, sizeof(lame))
+            && (memcmp(lame, "LAME", 4) == 0 || memcmp(lame, "Lavc", 4) == 0 || memcmp(lame, "Lavf", 4) == 0)) {
+            uint32_t delay = (lame[21] << 4) | (lame[22] >> 4);
+            uint32_t padding = ((lame[22] & 0xF) << 8) | lame[23];
+            if ((uint64_t)frames * spf > delay + padding) {
+                info->enc_delay = delay;
+                info->enc_padding = padding;
+                info->total_samples = (uint64_t)frames * spf - delay - padding;
+                info->flags |= MEDIA_PROBE_FLAG_GAPLESS;
+            }
+        }
+    } else if (4 + 32 + 18 <= len && memcmp(h + 36, "VBRI", 4) == 0) {
+        audio_bytes = be32(h + 36 + 10);
+        frames = be32(h + 36 + 14);
+    }
+    if (frames) {
+        info->duration_ms = (uint64_t)frames * spf * 1000 / sample_rate;
+        info->bitrate = info->duration_ms ? (uint64_t)audio_bytes * 8000 / info->duration_ms : bitrate;
+    } else {
+        info->bitrate = bitrate;
+        info->duration_ms = (uint64_t)audio_bytes * 8000 / bitrate;
+        info->flags |= MEDIA_PROBE_FLAG_ESTIMATED;
+    }
+}
+
+static void probe_adts(probe_t *p, uint32_t start, uint32_t audio_end)
+{
+    media_probe_info_t *info = p->info;
+    uint32_t pos = start;
+    uint32_t frames = 0;
+    uint32_t blocks = 0;
+    uint8_t h[7];
+    while (frames < MEDIA_PROBE_ADTS_FRAMES && pos + 7 <= audio_end && read_at(p, pos, h, 7)) {
+        if (h[0] != 0xFF || (h[1] & 0xF6) != 0xF0) {
+            break;
+        }
+        uint32_t frame_len = ((h[3] & 3) << 11) | (h[4] << 3) | (h[5] >> 5);
+        uint32_t sr_idx = (h[2] >> 2) & 0xF;
+        if (frame_len < 7 || sr_idx >= sizeof(aac_sample_rate) / sizeof(aac_sample_rate[0])) {
+            break;
+        }
+        if (frames == 0) {
+            info->format = MEDIA_PROBE_FORMAT_AAC;
+            info->sample_rate = aac_sample_rate[sr_idx];
+            info->channels = ((h[2] & 1) << 2) | (h[3] >> 6);
+        }
+        blocks += (h[6] & 3) + 1;
+        frames++;
+        pos += frame_len;
+    }
+    if (frames == 0) {
+        return;
+    }
+    // Average size of the first frames is used for the rest of stream
+    uint32_t read_bytes = pos - start;
+    uint64_t samples = (uint64_t)blocks * 1024;
+    if (pos < audio_end) {
+        samples = samples * (audio_end - start) / read_bytes;
+        info->flags |= MEDIA_PROBE_FLAG_ESTIMATED;
+    }
+    info->duration_ms = samples * 1000 / info->sample_rate;
+    info->bitrate = (uint64_t)read_bytes * 8 * info->sample_rate / ((uint64_t)blocks * 1024);
+}
+
+static void probe_wav(probe_t *p)
+{
+    media_probe_info_t *info = p->info;
+    uint32_t pos = 12;
+    uint32_t byte_rate = 0;
+    uint8_t ch[16];
+    while (pos + 8 <= p->size && read_at(p, pos, ch, 8)) {
+        uint32_t size = le32(ch + 4);
+        uint32_t data = pos + 8;
+        if (memcmp(ch, "fmt ", 4) == 0 && size >= 16 && read_at(p, data, ch, 16)) {
+            info->format = MEDIA_PROBE_FORMAT_WAV;
+            info->channels = le16(ch + 2);
+            info->sample_rate = le32(ch + 4);
+            byte_rate = le32(ch + 8);
+            info->bits = le16(ch + 14);
+            info->bitrate = byte_rate * 8;
+        } else if (memcmp(ch, "LIST", 4) == 0 && size >= 4 && read_at(p, data, ch, 4) && memcmp(ch, "INFO", 4) == 0) {
+            uint32_t sub = data + 4;
+            uint32_t list_end = size > p->size - data ? p->size : data + size;
+            while (sub + 8 <= list_end && read_at(p, sub, ch, 8)) {
+                uint32_t sub_size = le32(ch + 4);
+                if (memcmp(ch, "INAM", 4) == 0) {
+                    read_text(p, sub + 8, sub_size, 3, info->title, sizeof(info->title));
+                } else if (memcmp(ch, "IART", 4) == 0) {
+                    read_text(p, sub + 8, sub_size, 3, info->artist, sizeof(info->artist));
+                }
+                sub += 8 + sub_size + (sub_size & 1);
+            }
+        } else if (memcmp(ch, "data", 4) == 0) {
+            // Size of streamed WAV may be unknown, use what is in file
+            if (size > p->size - data) {
+                size = p->size - data;
+            }
+            if (byte_rate) {
+                info->duration_ms = (uint64_t)size * 1000 / byte_rate;
+            }
+            if (info->channels && info->bits) {
+                info->total_samples = size / (info->channels * ((info->bits + 7) / 8));
+            }
+            break;
+        }
+        if (size > p->size - data) {
+            break;
+        }
+        pos = data + size + (size & 1);
+    }
+}
+
+static void probe_vorbis_comment(probe_t *p, uint32_t pos, uint32_t end)
+{
+    media_probe_info_t *info = p->info;
+    uint8_t n[4];
+    if (read_at(p, pos, n, 4) == false) {
+        return;
+    }
+    pos += 4 + le32(n);
+    if (pos + 4 > end || read_at(p, pos, n, 4) == false) {
+        return;
+    }
+    uint32_t count = le32(n);
+    pos += 4;
+    for (uint32_t i = 0; i < count && i < MEDIA_PROBE_COMMENT_MAX && pos + 4 <= end; i++) {
+        uint8_t c[8];
+        if (read_at(p, pos, n, 4) == false) {
+            return;
+        }
+        uint32_t len = le32(n);
+        uint32_t data = pos + 4;
+        if (len > end - data) {
+            return;
+        }
+        if (len > 7 && read_at(p, data, c, 7)) {
+            if (strncasecmp((char *)c, "TITLE=", 6) == 0) {
+                read_text(p, data + 6, len - 6, 3, info->title, sizeof(info->title));
+            } else if (strncasecmp((char *)c, "ARTIST=", 7) == 0) {
+                read_text(p, data + 7, len - 7, 3, info->artist, sizeof(info->artist));
+            }
+        }
+        pos = data + len;
+    }
+}
+
+static void probe_flac(probe_t *p, uint32_t pos)
+{
+    media_probe_info_t *info = p->info;
+    uint8_t b[18];
+    pos += 4;
+    bool last = false;
+    while (last == false && pos + 4 <= p->size && read_at(p, pos, b, 4)) {
+        last = b[0] & 0x80;
+        int type = b[0] & 0x7F;
+        uint32_t len = be24(b + 1);
+        uint32_t data = pos + 4;
+        if (type == 0 && len >= 18 && read_at(p, data, b, 18)) {
+            info->format = MEDIA_PROBE_FORMAT_FLAC;
+            info->sample_rate = (b[10] << 12) | (b[11] << 4) | (b[12] >> 4);
+            info->channels = ((b[12] >> 1) & 7) + 1;
+            info->bits = (((b[12] & 1) << 4) | (b[13] >> 4)) + 1;
+            uint64_t samples = ((uint64_t)(b[13] & 0xF) << 32) | be32(b + 14);
+            info->total_samples = samples > UINT32_MAX ? 0 : samples;
+            if (info->sample_rate) {
+                info->duration_ms = samples * 1000 / info->sample_rate;
+            }
+        } else if (type == 4) {
+            probe_vorbis_comment(p, data, data + len);
+        }
+        pos = data + len;
+    }
+    if (info->duration_ms) {
+        info->bitrate = (uint64_t)(p->size - pos) * 8000 / info->duration_ms;
+    }
+}
+
+static void probe_mp4_boxes(probe_t *p, uint32_t pos, uint32_t end, int depth);
+
+static void probe_itunes_smpb(probe_t *p, uint32_t pos, uint32_t end)
+{
+    // Free form item: "mean" and "name" box, then "data" box with " 00000000 delay padding total_samples ..."
+    media_probe_info_t *info = p->info;
+    uint8_t h[16];
+    bool smpb = false;
+    while (pos + 16 <= end && read_at(p, pos, h, 16)) {
+        uint32_t size = be32(h);
+        if (size < 8 || size > end - pos) {
+            return;
+        }
+        if (memcmp(h + 4, "name", 4) == 0) {
+            smpb = size == 12 + 8 && memcmp(h + 12, "iTun", 4) == 0 && read_at(p, pos + 16, h, 4) && memcmp(h, "SMPB", 4) == 0;
+        } else if (smpb && memcmp(h + 4, "data", 4) == 0 && size > 16) {
+            char text[64] = { 0 };
+            unsigned int delay, padding;
+            unsigned long long total;
+            if (read_at(p, pos + 16, text, size - 16 < sizeof(text) - 1 ? size - 16 : sizeof(text) - 1)
+                && sscanf(text, "%*x %x %x %llx", &delay, &padding, &total) == 3
+                && delay <= UINT16_MAX && padding <= UINT16_MAX && total > 0 && total <= UINT32_MAX) {
+                info->enc_delay = delay;
+                info->enc_padding = padding;
+                info->total_samples = total;
+                info->flags |= MEDIA_PROBE_FLAG_GAPLESS;
+            }
+            return;
+        }
+        pos += size;
+    }
+}
+
+static void probe_mp4_box(probe_t *p, const uint8_t *type, uint32_t data, uint32_t end, int depth)
+{
+    media_probe_info_t *info = p->info;
+    uint8_t b[32];
+    if (memcmp(type, "moov", 4) == 0 || memcmp(type, "trak", 4) == 0 || memcmp(type, "mdia", 4) == 0
+        || memcmp(type, "minf", 4) == 0 || memcmp(type, "stbl", 4) == 0 || memcmp(type, "udta", 4) == 0
+        || memcmp(type, "ilst", 4) == 0) {
+        probe_mp4_boxes(p, data, end, depth + 1);
+    } else if (memcmp(type, "meta", 4) == 0) {
+        // Full box in MP4, plain box in QuickTime
+        if (read_at(p, data, b, 8)) {
+            probe_mp4_boxes(p, memcmp(b + 4, "hdlr", 4) == 0 ? data : data + 4, end, depth + 1);
+        }
+    } else if (memcmp(type, "stsd", 4) == 0) {
+        probe_mp4_boxes(p, data + 8, end, depth + 1);
+    } else if (memcmp(type, "mvhd", 4) == 0 && read_at(p, data, b, 32)) {
+        uint32_t timescale;
+        uint64_t duration;
+        if (b[0] == 1) {
+            timescale = be32(b + 20);
+            duration = ((uint64_t)be32(b + 24) << 32) | be32(b + 28);
+        } else {
+            timescale = be32(b + 12);
+            duration = be32(b + 16);
+        }
+        if (timescale) {
+            info->duration_ms = duration * 1000 / timescale;
+        }
+    } else if (memcmp(type, "mp4a", 4) == 0 && read_at(p, data, b, 28)) {
+        info->channels = be16(b + 16);
+        info->sample_rate = be32(b + 24) >> 16;
+    } else if ((memcmp(type, "\xA9nam", 4) == 0 || memcmp(type, "\xA9" "ART", 4) == 0) && read_at(p, data, b, 16)) {
+        uint32_t size = be32(b);
+        if (memcmp(b + 4, "data", 4) == 0 && size > 16 && size <= end - data) {
+            bool title = type[1] == 'n';
+            read_text(p, data + 16, size - 16, 3, title ? info->title : info->artist,
+                      title ? sizeof(info->title) : sizeof(info->artist));
+        }
+    } else if (memcmp(type, "----", 4) == 0) {
+        probe_itunes_smpb(p, data, end);
+    }
+}
+
+static void probe_mp4_boxes(probe_t *p, uint32_t pos, uint32_t end, int depth)
+{
+    uint8_t h[16];
+    if (depth > MEDIA_PROBE_BOX_DEPTH) {
+        return;
+    }
+    while (pos + 8 <= end && read_at(p, pos, h, 8)) {
+        uint64_t size = be32(h);
+        uint32_t hdr = 8;
+        if (size == 1) {
+            if (read_at(p, pos + 8, h + 8, 8) == false) {
+                return;
+            }
+            size = ((uint64_t)be32(h + 8) << 32) | be32(h + 12);
+            hdr = 16;
+        } else if (size == 0) {
+            size = end - pos;
+        }
+        if (size < hdr || size > end - pos) {
+            return;
+        }
+        probe_mp4_box(p, h + 4, pos + hdr, pos + size, depth);
+        pos += size;
+    }
+}
+
+static void probe_mp4(probe_t *p)
+{
+    media_probe_info_t *info = p->info;
+    info->format = MEDIA_PROBE_FORMAT_M4A;
+    probe_mp4_boxes(p, 0, p->size, 0);
+    if (info->duration_ms) {
+        info->bitrate = (uint64_t)p->size * 8000 / info->duration_ms;
+    }
+}
+
+esp_err_t media_probe_file(const char *path, media_probe_info_t *info)
+{
+    AUDIO_NULL_CHECK(TAG, path, return ESP_ERR_INVALID_ARG);
+    AUDIO_NULL_CHECK(TAG, info, return ESP_ERR_INVALID_ARG);
+    memset(info, 0, sizeof(media_probe_info_t));
+    if (strncmp(path, MEDIA_PROBE_FILE_PREFIX, strlen(MEDIA_PROBE_FILE_PREFIX)) == 0) {
+        path += strlen(MEDIA_PROBE_FILE_PREFIX);
+    } else {
+        // Other schemes such as "http://" are not local files, callers may try any URL so keep quiet
+        const char *sep = strstr(path, "://");
+        if (sep && memchr(path, '/', sep - path) == NULL) {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+    }
+    probe_t p = {
+        .f = fopen(path, "rb"),
+        .info = info,
+    };
+    if (p.f == NULL) {
+        ESP_LOGE(TAG, "Open [%s] failed", path);
+        return ESP_FAIL;
+    }
+    long size = 0;
+    if (fseek(p.f, 0, SEEK_END) == 0) {
+        size = ftell(p.f);
+    }
+    p.size = size > 0 ? size : 0;
+
+    uint8_t h[12] = { 0 };
+    uint32_t start = probe_id3v2(&p);
+    if (start >= p.size || read_at(&p, start, h, p.size - start < sizeof(h) ? p.size - start : sizeof(h)) == false) {
+        goto _exit;
+    }
+    if (start == 0 && memcmp(h, "RIFF", 4) == 0 && memcmp(h + 8, "WAVE", 4) == 0) {
+        probe_wav(&p);
+    } else if (memcmp(h, "fLaC", 4) == 0) {
+        probe_flac(&p, start);
+    } else if (start == 0 && memcmp(h + 4, "ftyp", 4) == 0) {
+        probe_mp4(&p);
+    } else {
+        uint32_t audio_end = probe_id3v1(&p);
+        // Skip padding and junk before the first frame
+        uint8_t buf[64];
+        uint32_t pos = start;
+        while (pos < start + MEDIA_PROBE_SYNC_SEARCH && pos + 4 <= audio_end) {
+            uint32_t len = audio_end - pos < sizeof(buf) ? audio_end - pos : sizeof(buf);
+            if (read_at(&p, pos, buf, len) == false) {
+                break;
+            }
+            uint32_t i = 0;
+            while (i + 1 < len && (buf[i] != 0xFF || (buf[i + 1] & 0xE0) != 0xE0)) {
+                i++;
+            }
+            if (i + 1 >= len) {
+                pos += len - 1;
+                continue;
+            }
+            pos += i;
+            if ((buf[i + 1] & 0xF6) == 0xF0) {
+                probe_adts(&p, pos, audio_end);
+            } else {
+                probe_mp3(&p, pos, audio_end);
+            }
+            if (info->format != MEDIA_PROBE_FORMAT_UNKNOWN) {
+                break;
+            }
+            pos++;
+        }
+    }
+    if (info->format != MEDIA_PROBE_FORMAT_UNKNOWN) {
+        info->flags |= MEDIA_PROBE_FLAG_VALID;
+    }
+
+_exit:
+    fclose(p.f);
+    return ESP_OK;
+}
+
+esp_err_t media_probe_frame(const uint8_t *header, media_probe_frame_t *frame)
+{
+    AUDIO_NULL_CHECK(TAG, header, return ESP_ERR_INVALID_ARG);
+    AUDIO_NULL_CHECK(TAG, frame, return ESP_ERR_INVALID_ARG);
+    const uint8_t *h = header;
+    if (h[0] != 0xFF) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if ((h[1] & 0xF6) == 0xF0) {
+        uint32_t frame_len = ((h[3] & 3) << 11) | (h[4] << 3) | (h[5] >> 5);
+        uint32_t sr_idx = (h[2] >> 2) & 0xF;
+        if (frame_len < 7 || sr_idx >= sizeof(aac_sample_rate) / sizeof(aac_sample_rate[0])) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        frame->format = MEDIA_PROBE_FORMAT_AAC;
+        frame->channels = ((h[2] & 1) << 2) | (h[3] >> 6);
+        frame->samples = ((h[6] & 3) + 1) * 1024;
+        frame->sample_rate = aac_sample_rate[sr_idx];
+        frame->bytes = frame_len;
+        return ESP_OK;
+    }
+    uint32_t sample_rate, bitrate;
+    int spf, channels, side;
+    if (mp3_header(h, &sample_rate, &bitrate, &spf, &channels, &side) == false) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    int padding = (h[2] >> 1) & 1;
+    frame->format = MEDIA_PROBE_FORMAT_MP3;
+    frame->channels = channels;
+    frame->samples = spf;
+    frame->sample_rate = sample_rate;
+    // Layer 1 counts in 4 bytes slots
+    if (spf == 384) {
+        frame->bytes = (12 * bitrate / sample_rate + padding) * 4;
+    } else {
+        frame->bytes = spf / 8 * bitrate / sample_rate + padding;
+    }
+    return ESP_OK;
+}
@@ -27,71 +27,471 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <string.h>
+#include <ctype.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "audio_error.h"
 #include "audio_mem.h"
+#include "audio_mutex.h"
+#include "audio_thread.h"
 #include "sdcard_scan.h"
 
 #define SDCARD_FILE_PREV_NAME           "file:/"
 #define SDCARD_SCAN_URL_MAX_LENGTH      (1024 * 2)
+#define SDCARD_SCAN_BATCH_BUF_SIZE      (SDCARD_SCAN_URL_MAX_LENGTH * 2)
+#define SDCARD_SCAN_EXT_MAX_LENGTH      (31)
+#define SDCARD_SCAN_STACK_ENTRY_TAIL    (4)
+#define SDCARD_SCAN_WORKER_MAX          (8)
+
+/**
+ * Extensions are lowercased once, a file is compared only with extensions of the same length
+ */
+typedef struct {
+    char            *ext;                /*!< Lowercased extensions, '\0' terminated one by one */
+    uint8_t         *len;                /*!< Length of each extension */
+    int             num;                 /*!< Number of extensions */
+    uint32_t        len_mask;            /*!< Bit n is set if there is an extension of length n */
+    bool            all;                 /*!< All files are accepted */
+} scan_filter_t;
+
+/**
+ * Callback and user data of `sdcard_scan`, files are delivered one by one from batch
+ */
+typedef struct {
+    sdcard_scan_cb_t    cb;
+    void                *user_data;
+} scan_single_t;
+
+typedef struct scan_job scan_job_t;
+
+typedef struct {
+    scan_job_t          *job;
+    audio_thread_t      thread;
+    char                *url;            /*!< "file:/" followed by path of current directory, reused for all directories */
+    char                *batch_buf;      /*!< URLs to be delivered */
+    uint32_t            batch_size;
+    char                **batch_url;
+    int                 batch_num;
+    char                *sub_buf;        /*!< Sub directories of current directory */
+    uint32_t            sub_size;
+    uint32_t            sub_cap;
+} scan_worker_t;
+
+struct scan_job {
+    sdcard_scan_batch_cb_t  batch_cb;
+    void                    *user_data;
+    scan_filter_t           filter;
+    int                     depth;
+    int                     batch_max;
+    char                    *stack;      /*!< Directories to scan, entry: path '\0' depth(2) path_len(2) */
+    uint32_t                stack_size;
+    uint32_t                stack_cap;
+    int                     pending;     /*!< Directories in stack or being scanned */
+    int                     worker_num;
+    void                    *lock;       /*!< Protect stack, NULL if scan in caller task only */
+    void                    *cb_lock;    /*!< Callback is never called at the same time */
+    SemaphoreHandle_t       work_sem;    /*!< Given once for each pushed directory, and to stop workers */
+    SemaphoreHandle_t       done_sem;    /*!< Given by each worker task when it exits */
+    esp_err_t               ret;
+};
 
 static const char *TAG = "SDCARD_SCAN";
 
-static void scan_dir(sdcard_scan_cb_t save_url_cb, const char *path, int cur_depth, int depth, const char *file_extension[] , int filter_num, void *user_data)
+static esp_err_t filter_init(scan_filter_t *filter, const char *file_extension[], int filter_num)
+{
+    memset(filter, 0, sizeof(scan_filter_t));
+    if (file_extension == NULL) {
+        filter->all = true;
+        return ESP_OK;
+    }
+    if (filter_num == 0) {
+        return ESP_OK;
+    }
+    int size = 0;
+    for (int i = 0; i < filter_num; i++) {
+        size += strlen(file_extension[i]) + 1;
+    }
+    filter->ext = audio_malloc(size);
+    filter->len = audio_malloc(filter_num);
+    AUDIO_NULL_CHECK(TAG, filter->ext && filter->len, {
+        audio_free(filter->ext);
+        audio_free(filter->len);
+        return ESP_FAIL;
+    });
+    char *p = filter->ext;
+    for (int i = 0; i < filter_num; i++) {
+        int len = strlen(file_extension[i]);
+        for (int k = 0; k <= len; k++) {
+            p[k] = tolower((unsigned char)file_extension[i][k]);
+        }
+        p += len + 1;
+        filter->len[i] = len > SDCARD_SCAN_EXT_MAX_LENGTH ? 0 : len;
+        if (filter->len[i]) {
+            filter->len_mask |= 1UL << len;
+        }
+    }
+    filter->num = filter_num;
+    return ESP_OK;
+}
+
+static void filter_deinit(scan_filter_t *filter)
+{
+    audio_free(filter->ext);
+    audio_free(filter->len);
+    memset(filter, 0, sizeof(scan_filter_t));
+}
+
+static bool filter_match(const scan_filter_t *filter, const char *name, int name_len)
+{
+    if (filter->all) {
+        return true;
+    }
+    const char *detect = strrchr(name, '.');
+    if (NULL == detect) {
+        return false;
+    }
+    detect++;
+    int len = name + name_len - detect;
+    if (len == 0 || len > SDCARD_SCAN_EXT_MAX_LENGTH || (filter->len_mask & (1UL << len)) == 0) {
+        return false;
+    }
+    char lower[SDCARD_SCAN_EXT_MAX_LENGTH + 1];
+    for (int k = 0; k < len; k++) {
+        lower[k] = tolower((unsigned char)detect[k]);
+    }
+    const char *ext = filter->ext;
+    for (int i = 0; i < filter->num; i++) {
+        if (filter->len[i] == len && memcmp(ext, lower, len) == 0) {
+            return true;
+        }
+        ext += strlen(ext) + 1;
+    }
+    return false;
+}
+
+static void job_lock(scan_job_t *job)
+{
+    if (job->lock) {
+        mutex_lock(job->lock);
+    }
+}
+
+static void job_unlock(scan_job_t *job)
+{
+    if (job->lock) {
+        mutex_unlock(job->lock);
+    }
+}
+
+static esp_err_t job_push(scan_job_t *job, const char *path, uint16_t path_len, uint16_t depth)
+{
+    uint32_t size = path_len + 1 + SDCARD_SCAN_STACK_ENTRY_TAIL;
+    if (job->stack_size + size > job->stack_cap) {
+        uint32_t cap = job->stack_cap ? job->stack_cap : SDCARD_SCAN_URL_MAX_LENGTH;
+        while (cap < job->stack_size + size) {
+            cap <<= 1;
+        }
+        char *stack = audio_realloc(job->stack, cap);
+        AUDIO_NULL_CHECK(TAG, stack, return ESP_FAIL);
+        job->stack = stack;
+        job->stack_cap = cap;
+    }
+    char *entry = job->stack + job->stack_size;
+    memcpy(entry, path, path_len);
+    entry[path_len] = '\0';
+    memcpy(entry + path_len + 1, &depth, 2);
+    memcpy(entry + path_len + 3, &path_len, 2);
+    job->stack_size += size;
+    job->pending++;
+    if (job->work_sem) {
+        xSemaphoreGive(job->work_sem);
+    }
+    return ESP_OK;
+}
+
+static bool job_pop(scan_job_t *job, char *path, int *path_len, int *depth)
 {
-    if (cur_depth > depth) {
-        ESP_LOGD(TAG, "scan depth = %d, exit", cur_depth);
+    if (job->stack_size == 0) {
+        return false;
+    }
+    uint16_t len, d;
+    memcpy(&d, job->stack + job->stack_size - 4, 2);
+    memcpy(&len, job->stack + job->stack_size - 2, 2);
+    job->stack_size -= len + 1 + SDCARD_SCAN_STACK_ENTRY_TAIL;
+    memcpy(path, job->stack + job->stack_size, len + 1);
+    *path_len = len;
+    *depth = d;
+    return true;
+}
+
+static void worker_flush(scan_worker_t *worker)
+{
+    scan_job_t *job = worker->job;
+    if (worker->batch_num == 0) {
         return;
     }
-    char *file_url = audio_calloc(1, SDCARD_SCAN_URL_MAX_LENGTH);
-    AUDIO_NULL_CHECK(TAG, file_url, return);
+    if (job->cb_lock) {
+        mutex_lock(job->cb_lock);
+    }
+    job->batch_cb(job->user_data, worker->batch_url, worker->batch_num);
+    if (job->cb_lock) {
+        mutex_unlock(job->cb_lock);
+    }
+    worker->batch_num = 0;
+    worker->batch_size = 0;
+}
+
+static void worker_add_url(scan_worker_t *worker, const char *url, int url_len)
+{
+    if (worker->batch_size + url_len + 1 > SDCARD_SCAN_BATCH_BUF_SIZE || worker->batch_num == worker->job->batch_max) {
+        worker_flush(worker);
+    }
+    char *dst = worker->batch_buf + worker->batch_size;
+    memcpy(dst, url, url_len + 1);
+    worker->batch_url[worker->batch_num++] = dst;
+    worker->batch_size += url_len + 1;
+}
+
+static esp_err_t worker_add_sub(scan_worker_t *worker, const char *name, int name_len)
+{
+    if (worker->sub_size + name_len + 1 > worker->sub_cap) {
+        uint32_t cap = worker->sub_cap ? worker->sub_cap : 256;
+        while (cap < worker->sub_size + name_len + 1) {
+            cap <<= 1;
+        }
+        char *buf = audio_realloc(worker->sub_buf, cap);
+        AUDIO_NULL_CHECK(TAG, buf, return ESP_FAIL);
+        worker->sub_buf = buf;
+        worker->sub_cap = cap;
+    }
+    memcpy(worker->sub_buf + worker->sub_size, name, name_len + 1);
+    worker->sub_size += name_len + 1;
+    return ESP_OK;
+}
 
+static void worker_scan_dir(scan_worker_t *worker, int url_len, int cur_depth)
+{
+    scan_job_t *job = worker->job;
+    const int prefix_len = strlen(SDCARD_FILE_PREV_NAME);
+    const char *path = worker->url + prefix_len;
     DIR *dir = opendir(path);
     if (dir == NULL) {
         ESP_LOGE(TAG, "Open [%s] directory failed", path);
-        audio_free(file_url);
         return;
     }
-
+    worker->sub_size = 0;
     struct dirent *file_info = NULL;
     while (NULL != (file_info = readdir(dir))) {
-        if ((strlen(file_info->d_name) + strlen(path)) > (SDCARD_SCAN_URL_MAX_LENGTH - strlen(SDCARD_FILE_PREV_NAME))) {
+        const char *name = file_info->d_name;
+        int name_len = strlen(name);
+        if (url_len + 1 + name_len >= SDCARD_SCAN_URL_MAX_LENGTH) {
             ESP_LOGE(TAG, "The file name is too long, invalid url");
             continue;
         }
-        if (file_info->d_name[0] == '.') {
+        if (name[0] == '.') {
             continue;
         }
-
         if (file_info->d_type == DT_DIR) {
-            if (file_info->d_name[0] == '_' && file_info->d_name[1] == '_') {
-                continue;
-            }
-            memset(file_url, 0, SDCARD_SCAN_URL_MAX_LENGTH);
-            sprintf(file_url, "%s/%s", path, file_info->d_name);
-            scan_dir(save_url_cb, file_url, cur_depth + 1, depth, file_extension, filter_num, user_data);
-        } else {
-            memset(file_url, 0, SDCARD_SCAN_URL_MAX_LENGTH);
-            sprintf(file_url, "%s%s/%s", SDCARD_FILE_PREV_NAME, path, file_info->d_name);
-            if (NULL == file_extension) {
-                save_url_cb(user_data, file_url);
-                continue;
-            }
-            char *detect = strrchr(file_info->d_name, '.');
-            if (NULL == detect) {
+            if ((name[0] == '_' && name[1] == '_') || cur_depth >= job->depth) {
                 continue;
             }
-            detect ++;
-            for (int i = 0; i < filter_num; i++) {
-                if (strcasecmp(detect, file_extension[i]) == 0) {
-                    save_url_cb(user_data, file_url);
-                    break;
-                }
+            if (worker_add_sub(worker, name, name_len) != ESP_OK) {
+                job->ret = ESP_FAIL;
+                break;
             }
+        } else if (filter_match(&job->filter, name, name_len)) {
+            // Path buffer is shared by all entries, only the name part is rewritten
+            worker->url[url_len] = '/';
+            memcpy(worker->url + url_len + 1, name, name_len + 1);
+            worker_add_url(worker, worker->url, url_len + 1 + name_len);
         }
     }
-    audio_free(file_url);
     closedir(dir);
+    worker->url[url_len] = '\0';
+
+    // Push in reverse order so that sub directories are popped in directory order
+    job_lock(job);
+    uint32_t end = worker->sub_size;
+    while (end > 0) {
+        uint32_t start = end - 1;
+        while (start > 0 && worker->sub_buf[start - 1] != '\0') {
+            start--;
+        }
+        int name_len = end - 1 - start;
+        worker->url[url_len] = '/';
+        memcpy(worker->url + url_len + 1, worker->sub_buf + start, name_len + 1);
+        if (job_push(job, path, url_len - prefix_len + 1 + name_len, cur_depth + 1) != ESP_OK) {
+            job->ret = ESP_FAIL;
+            break;
+        }
+        end = start;
+    }
+    worker->url[url_len] = '\0';
+    job_unlock(job);
+}
+
+static bool worker_next_dir(scan_worker_t *worker, int *url_len, int *depth)
+{
+    scan_job_t *job = worker->job;
+    const int prefix_len = strlen(SDCARD_FILE_PREV_NAME);
+    int path_len = 0;
+    if (job->work_sem) {
+        xSemaphoreTake(job->work_sem, portMAX_DELAY);
+    }
+    job_lock(job);
+    bool ret = job_pop(job, worker->url + prefix_len, &path_len, depth);
+    job_unlock(job);
+    *url_len = prefix_len + path_len;
+    return ret;
+}
+
+static void worker_done_dir(scan_worker_t *worker)
+{
+    scan_job_t *job = worker->job;
+    job_lock(job);
+    // Wake up all workers to exit when no directory is left
+    if (--job->pending == 0 && job->work_sem) {
+        for (int i = 0; i < job->worker_num; i++) {
+            xSemaphoreGive(job->work_sem);
+        }
+    }
+    job_unlock(job);
+}
+
+static void worker_run(scan_worker_t *worker)
+{
+    int url_len = 0;
+    int depth = 0;
+    while (worker_next_dir(worker, &url_len, &depth)) {
+        worker_scan_dir(worker, url_len, depth);
+        worker_done_dir(worker);
+    }
+    worker_flush(worker);
+}
+
+static void worker_task(void *pv)
+{
+    scan_worker_t *worker = (scan_worker_t *)pv;
+    worker_run(worker);
+    xSemaphoreGive(worker->job->done_sem);
+    audio_thread_delete_task(&worker->thread);
+}
+
+static esp_err_t worker_init(scan_worker_t *worker, scan_job_t *job)
+{
+    memset(worker, 0, sizeof(scan_worker_t));
+    worker->job = job;
+    worker->url = audio_calloc(1, SDCARD_SCAN_URL_MAX_LENGTH);
+    worker->batch_buf = audio_malloc(SDCARD_SCAN_BATCH_BUF_SIZE);
+    worker->batch_url = audio_malloc(job->batch_max * sizeof(char *));
+    AUDIO_NULL_CHECK(TAG, worker->url && worker->batch_buf && worker->batch_url, return ESP_FAIL);
+    memcpy(worker->url, SDCARD_FILE_PREV_NAME, strlen(SDCARD_FILE_PREV_NAME));
+    return ESP_OK;
+}
+
+static void worker_deinit(scan_worker_t *worker)
+{
+    audio_free(worker->url);
+    audio_free(worker->batch_buf);
+    audio_free(worker->batch_url);
+    audio_free(worker->sub_buf);
+}
+
+static void scan_single_cb(void *user_data, char *url[], int url_num)
+{
+    scan_single_t *ctx = (scan_single_t *)user_data;
+    for (int i = 0; i < url_num; i++) {
+        ctx->cb(ctx->user_data, url[i]);
+    }
+}
+
+esp_err_t sdcard_scan_with_cfg(const sdcard_scan_cfg_t *cfg)
+{
+    AUDIO_NULL_CHECK(TAG, cfg, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, cfg->batch_cb, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, cfg->path, return ESP_FAIL);
+    int path_len = strlen(cfg->path);
+    if (cfg->depth < 0 || cfg->depth > UINT16_MAX || cfg->filter_num < 0 || (cfg->filter_num && cfg->file_extension == NULL)
+        || path_len + strlen(SDCARD_FILE_PREV_NAME) >= SDCARD_SCAN_URL_MAX_LENGTH) {
+        ESP_LOGE(TAG, "Invalid parameters, please check");
+        return ESP_FAIL;
+    }
+    int worker_num = cfg->worker_num > 1 ? cfg->worker_num : 1;
+    if (worker_num > SDCARD_SCAN_WORKER_MAX) {
+        worker_num = SDCARD_SCAN_WORKER_MAX;
+    }
+    scan_job_t job = {
+        .batch_cb = cfg->batch_cb,
+        .user_data = cfg->user_data,
+        .depth = cfg->depth,
+        .batch_max = cfg->batch_num > 0 ? cfg->batch_num : SDCARD_SCAN_DEFAULT_BATCH_NUM,
+        .worker_num = worker_num,
+        .ret = ESP_OK,
+    };
+    scan_worker_t worker[SDCARD_SCAN_WORKER_MAX];
+    int worker_ready = 0;
+    int task_num = 0;
+    esp_err_t ret = filter_init(&job.filter, cfg->file_extension, cfg->filter_num);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (worker_num > 1) {
+        job.lock = mutex_create();
+        job.cb_lock = mutex_create();
+        job.work_sem = xSemaphoreCreateCounting(UINT16_MAX, 0);
+        job.done_sem = xSemaphoreCreateCounting(worker_num, 0);
+        if (job.lock == NULL || job.cb_lock == NULL || job.work_sem == NULL || job.done_sem == NULL) {
+            ESP_LOGE(TAG, "Create scan workers failed");
+            ret = ESP_FAIL;
+            goto _exit;
+        }
+    }
+    for (; worker_ready < worker_num; worker_ready++) {
+        if (worker_init(&worker[worker_ready], &job) != ESP_OK) {
+            worker_deinit(&worker[worker_ready]);
+            ret = ESP_FAIL;
+            goto _exit;
+        }
+    }
+    if (job_push(&job, cfg->path, path_len, 0) != ESP_OK) {
+        ret = ESP_FAIL;
+        goto _exit;
+    }
+    // Caller task is the first worker, others run in their own tasks
+    for (int i = 1; i < worker_num; i++) {
+        if (audio_thread_create(&worker[i].thread, "sdcard_scan", worker_task, &worker[i], cfg->task_stack,
+                                cfg->task_prio, cfg->stack_in_ext, cfg->task_core) != ESP_OK) {
+            ESP_LOGW(TAG, "Only %d scan workers created", i);
+            break;
+        }
+        task_num++;
+    }
+    worker_run(&worker[0]);
+    for (int i = 0; i < task_num; i++) {
+        xSemaphoreTake(job.done_sem, portMAX_DELAY);
+    }
+    ret = job.ret;
+
+_exit:
+    for (int i = 0; i < worker_ready; i++) {
+        worker_deinit(&worker[i]);
+    }
+    if (job.work_sem) {
+        vSemaphoreDelete(job.work_sem);
+    }
+    if (job.done_sem) {
+        vSemaphoreDelete(job.done_sem);
+    }
+    if (job.lock) {
+        mutex_destroy(job.lock);
+    }
+    if (job.cb_lock) {
+        mutex_destroy(job.cb_lock);
+    }
+    audio_free(job.stack);
+    filter_deinit(&job.filter);
+    return ret;
 }
 
 esp_err_t sdcard_scan(sdcard_scan_cb_t cb, const char *path, int depth, const char *file_extension[], int filter_num, void *user_data)
@@ -104,6 +504,16 @@ esp_err_t sdcard_scan(sdcard_scan_cb_t cb, const char *path, int depth, const ch
         return ESP_FAIL;
     }
 
-    scan_dir(cb, path, 0, depth, file_extension, filter_num, user_data);
-    return ESP_OK;
+    scan_single_t single = {
+        .cb = cb,
+        .user_data = user_data,
+    };
+    sdcard_scan_cfg_t cfg = SDCARD_SCAN_CFG_DEFAULT();
+    cfg.path = path;
+    cfg.depth = depth;
+    cfg.file_extension = file_extension;
+    cfg.filter_num = filter_num;
+    cfg.batch_cb = scan_single_cb;
+    cfg.user_data = &single;
+    return sdcard_scan_with_cfg(&cfg);
 }
@@ -0,0 +1,376 @@
+/*
+ * ESPRESSIF MIT License
+ *
+ * Copyright (c) 2023 <ESPRESSIF SYSTEMS (SHANGHAI) CO., LTD>
+ *
+ * Permission is hereby granted for use on all ESPRESSIF SYSTEMS products, in which case,
+ * it is free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include "esp_log.h"
+#include "audio_error.h"
+#include "audio_mem.h"
+#include "media_probe.h"
+#include "seek_index.h"
+
+#define SEEK_INDEX_FILE_PREFIX      "file:/"
+#define SEEK_INDEX_TAG_SIZE         (10)    /* Size of ID3v2 tag header */
+#define SEEK_INDEX_READ_SIZE        (4096)
+
+static const char *TAG = "SEEK_INDEX";
+
+typedef enum {
+    SEEK_INDEX_STATE_IDLE = 0,              /* Data ignored */
+    SEEK_INDEX_STATE_TAG,                   /* Check ID3v2 tag at start of stream */
+    SEEK_INDEX_STATE_SEARCH,                /* Search the first frame */
+    SEEK_INDEX_STATE_CONFIRM,               /* First frame found, check that the next header follows it */
+    SEEK_INDEX_STATE_SYNCED,                /* Position and time of frames are known */
+    SEEK_INDEX_STATE_DONE,                  /* Data after the last frame, such as ID3v1 tag */
+} seek_index_state_t;
+
+struct seek_index_builder {
+    seek_index_t        *index;
+    seek_index_state_t  state;
+    bool                record;             /*!< Record points of parsed frames */
+    bool                skip;               /*!< Drop frames before `target` */
+    uint32_t            target;             /*!< Sample of seek target */
+    uint32_t            drop_end;           /*!< Stream offset of the first frame at or after target */
+    uint32_t            pos;                /*!< Stream offset of next byte fed */
+    uint32_t            next;               /*!< Stream offset of next frame header, or where search continues */
+    uint32_t            sample;             /*!< Samples before the frame at `next` */
+    media_probe_frame_t ref;                /*!< First frame, later frames must have the same format */
+    uint32_t            ref_pos;            /*!< Stream offset of first frame */
+    uint8_t             hdr[SEEK_INDEX_TAG_SIZE];   /*!< Bytes from `next` */
+    int                 hdr_len;
+};
+
+static void record_point(struct seek_index_builder *b, uint32_t pos)
+{
+    seek_index_t *index = b->index;
+    if (index->num == 0) {
+        index->magic = SEEK_INDEX_MAGIC;
+        index->format = b->ref.format;
+        index->sample_rate = b->ref.sample_rate;
+        index->interval = (uint64_t)b->ref.sample_rate * SEEK_INDEX_INTERVAL_MS / 1000;
+    } else if (pos <= index->point[index->num - 1].pos) {
+        return;
+    }
+    if ((uint64_t)index->num * index->interval > b->sample) {
+        return;
+    }
+    if (index->num == SEEK_INDEX_POINT_NUM) {
+        // Keep every other point, so that index always covers whole stream with fixed size
+        for (int i = 0; i < SEEK_INDEX_POINT_NUM / 2 + 1; i++) {
+            index->point[i] = index->point[i * 2];
+        }
+        index->num = SEEK_INDEX_POINT_NUM / 2 + 1;
+        index->interval *= 2;
+        if ((uint64_t)index->num * index->interval > b->sample) {
+            return;
+        }
+    }
+    index->point[index->num].sample = b->sample;
+    index->point[index->num].pos = pos;
+    index->num++;
+}
+
+static void add_frame(struct seek_index_builder *b, uint32_t pos, const media_probe_frame_t *frame)
+{
+    if (b->record) {
+        record_point(b, pos);
+    }
+    b->sample += frame->samples;
+    // Start of next frame is known before its header arrives, so no byte of it is dropped
+    if (b->skip && b->sample >= b->target) {
+        b->skip = false;
+        b->drop_end = pos + frame->bytes;
+    }
+}
+
+static void consume(struct seek_index_builder *b, uint32_t n)
+{
+    if (n < (uint32_t)b->hdr_len) {
+        memmove(b->hdr, b->hdr + n, b->hdr_len - n);
+        b->hdr_len -= n;
+    } else {
+        b->hdr_len = 0;
+    }
+    b->next += n;
+}
+
+static void resync(struct seek_index_builder *b)
+{
+    int n = 1;
+    while (n < b->hdr_len && b->hdr[n] != 0xFF) {
+        n++;
+    }
+    consume(b, n);
+    b->state = SEEK_INDEX_STATE_SEARCH;
+}
+
+static void parse_header(struct seek_index_builder *b)
+{
+    media_probe_frame_t frame;
+    if (b->state == SEEK_INDEX_STATE_TAG) {
+        b->state = SEEK_INDEX_STATE_SEARCH;
+        if (memcmp(b->hdr, "ID3", 3) == 0) {
+            uint32_t size = ((b->hdr[6] & 0x7F) << 21) | ((b->hdr[7] & 0x7F) << 14) | ((b->hdr[8] & 0x7F) << 7) | (b->hdr[9] & 0x7F);
+            consume(b, SEEK_INDEX_TAG_SIZE + size + ((b->hdr[5] & 0x10) ? SEEK_INDEX_TAG_SIZE : 0));
+            return;
+        }
+    }
+    bool valid = media_probe_frame(b->hdr, &frame) == ESP_OK;
+    if (valid && b->state != SEEK_INDEX_STATE_SEARCH) {
+        valid = frame.format == b->ref.format && frame.sample_rate == b->ref.sample_rate;
+    }
+    switch (b->state) {
+        case SEEK_INDEX_STATE_SEARCH:
+            if (valid) {
+                b->ref = frame;
+                b->ref_pos = b->next;
+                b->state = SEEK_INDEX_STATE_CONFIRM;
+                consume(b, frame.bytes);
+            } else {
+                resync(b);
+            }
+            break;
+        case SEEK_INDEX_STATE_CONFIRM:
+            if (valid) {
+                b->state = SEEK_INDEX_STATE_SYNCED;
+                add_frame(b, b->ref_pos, &b->ref);
+                add_frame(b, b->next, &frame);
+                consume(b, frame.bytes);
+            } else {
+                resync(b);
+            }
+            break;
+        case SEEK_INDEX_STATE_SYNCED:
+            if (valid) {
+                add_frame(b, b->next, &frame);
+                consume(b, frame.bytes);
+            } else {
+                // Trailing tag or broken data, the rest is passed through untouched
+                ESP_LOGD(TAG, "No frame at %u, stop parsing", (unsigned int)b->next);
+                if (b->skip) {
+                    b->skip = false;
+                    b->drop_end = b->next;
+                }
+                b->state = SEEK_INDEX_STATE_DONE;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+seek_index_builder_handle_t seek_index_builder_create(seek_index_t *index)
+{
+    AUDIO_NULL_CHECK(TAG, index, return NULL);
+    struct seek_index_builder *b = audio_calloc(1, sizeof(struct seek_index_builder));
+    AUDIO_MEM_CHECK(TAG, b, return NULL);
+    b->index = index;
+    return b;
+}
+
+esp_err_t seek_index_builder_begin(seek_index_builder_handle_t builder, uint32_t pos)
+{
+    AUDIO_NULL_CHECK(TAG, builder, return ESP_FAIL);
+    struct seek_index_builder *b = builder;
+    if (b->state != SEEK_INDEX_STATE_IDLE && pos == b->pos) {
+        return ESP_OK;
+    }
+    b->skip = false;
+    b->record = false;
+    b->drop_end = 0;
+    b->hdr_len = 0;
+    b->sample = 0;
+    b->pos = pos;
+    b->next = pos;
+    b->state = SEEK_INDEX_STATE_IDLE;
+    if (pos == 0 && (b->index->flags & SEEK_INDEX_FLAG_COMPLETE) == 0) {
+        memset(b->index, 0, sizeof(seek_index_t));
+        b->record = true;
+        b->state = SEEK_INDEX_STATE_TAG;
+    }
+    return ESP_OK;
+}
+
+esp_err_t seek_index_builder_seek(seek_index_builder_handle_t builder, uint32_t time_ms, uint32_t *pos)
+{
+    AUDIO_NULL_CHECK(TAG, builder, return ESP_FAIL);
+    AUDIO_NULL_CHECK(TAG, pos, return ESP_FAIL);
+    struct seek_index_builder *b = builder;
+    seek_index_point_t point;
+    if (seek_index_lookup(b->index, time_ms, &point) != ESP_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    memset(&b->ref, 0, sizeof(b->ref));
+    b->ref.format = b->index->format;
+    b->ref.sample_rate = b->index->sample_rate;
+    b->record = (b->index->flags & SEEK_INDEX_FLAG_COMPLETE) == 0;
+    b->target = (uint64_t)time_ms * b->index->sample_rate / 1000;
+    b->skip = point.sample < b->target;
+    b->drop_end = point.pos;
+    b->hdr_len = 0;
+    b->sample = point.sample;
+    b->pos = point.pos;
+    b->next = point.pos;
+    b->state = SEEK_INDEX_STATE_SYNCED;
+    *pos = point.pos;
+    ESP_LOGD(TAG, "Seek to %u ms from point %u ms at %u", (unsigned int)time_ms,
+             (unsigned int)((uint64_t)point.sample * 1000 / b->index->sample_rate), (unsigned int)point.pos);
+    return ESP_OK;
+}
+
+int seek_index_builder_feed(seek_index_builder_handle_t builder, const void *data, int len)
+{
+    AUDIO_NULL_CHECK(TAG, builder, return 0);
+    AUDIO_NULL_CHECK(TAG, data, return 0);
+    struct seek_index_builder *b = builder;
+    const uint8_t *d = (const uint8_t *)data;
+    uint32_t start = b->pos;
+    int i = 0;
+    while (b->state != SEEK_INDEX_STATE_IDLE && b->state != SEEK_INDEX_STATE_DONE) {
+        if (b->hdr_len == 0) {
+            // Skip frame data, only headers are parsed
+            if (start + len <= b->next) {
+                break;
+            }
+            if (start + i < b->next) {
+                i = b->next - start;
+            }
+            if (b->state == SEEK_INDEX_STATE_SEARCH) {
+                const uint8_t *sync = memchr(d + i, 0xFF, len - i);
+                if (sync == NULL) {
+                    b->next = start + len;
+                    break;
+                }
+                i = sync - d;
+                b->next = start + i;
+            }
+        }
+        int need = b->state == SEEK_INDEX_STATE_TAG ? SEEK_INDEX_TAG_SIZE : MEDIA_PROBE_FRAME_HEADER_SIZE;
+        if (b->hdr_len < need) {
+            int n = need - b->hdr_len < len - i ? need - b->hdr_len : len - i;
+            memcpy(b->hdr + b->hdr_len, d + i, n);
+            b->hdr_len += n;
+            i += n;
+            if (b->hdr_len < need) {
+                break;
+            }
+        }
+        parse_header(b);
+    }
+    b->pos = start + len;
+    if (b->skip) {
+        return len;
+    }
+    if (b->drop_end > start) {
+        return b->drop_end - start < (uint32_t)len ? (int)(b->drop_end - start) : len;
+    }
+    return 0;
+}
+
+esp_err_t seek_index_builder_finish(seek_index_builder_handle_t builder)
+{
+    AUDIO_NULL_CHECK(TAG, builder, return ESP_FAIL);
+    struct seek_index_builder *b = builder;
+    seek_index_t *index = b->index;
+    if (b->record && index->num && (b->state == SEEK_INDEX_STATE_SYNCED || b->state == SEEK_INDEX_STATE_DONE)) {
+        index->total_samples = b->sample;
+        index->end_pos = b->next < b->pos ? b->next : b->pos;
+        index->flags |= SEEK_INDEX_FLAG_COMPLETE;
+        ESP_LOGI(TAG, "Indexed %u ms with %d points", (unsigned int)((uint64_t)b->sample * 1000 / index->sample_rate), index->num);
+    }
+    b->skip = false;
+    b->record = false;
+    b->state = SEEK_INDEX_STATE_IDLE;
+    return ESP_OK;
+}
+
+esp_err_t seek_index_builder_destroy(seek_index_builder_handle_t builder)
+{
+    AUDIO_NULL_CHECK(TAG, builder, return ESP_FAIL);
+    audio_free(builder);
+    return ESP_OK;
+}
+
+esp_err_t seek_index_build_file(const char *path, seek_index_t *index)
+{
+    AUDIO_NULL_CHECK(TAG, path, return ESP_ERR_INVALID_ARG);
+    AUDIO_NULL_CHECK(TAG, index, return ESP_ERR_INVALID_ARG);
+    if (strncmp(path, SEEK_INDEX_FILE_PREFIX, strlen(SEEK_INDEX_FILE_PREFIX)) == 0) {
+        path += strlen(SEEK_INDEX_FILE_PREFIX);
+    }
+    memset(index, 0, sizeof(seek_index_t));
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Open [%s] failed", path);
+        return ESP_FAIL;
+    }
+    esp_err_t ret = ESP_FAIL;
+    uint8_t *buf = audio_malloc(SEEK_INDEX_READ_SIZE);
+    seek_index_builder_handle_t builder = seek_index_builder_create(index);
+    if (buf == NULL || builder == NULL) {
+        goto _exit;
+    }
+    seek_index_builder_begin(builder, 0);
+    size_t len;
+    while ((len = fread(buf, 1, SEEK_INDEX_READ_SIZE, f)) > 0) {
+        seek_index_builder_feed(builder, buf, len);
+    }
+    if (ferror(f)) {
+        ESP_LOGE(TAG, "Read [%s] failed", path);
+        goto _exit;
+    }
+    seek_index_builder_finish(builder);
+    ret = (index->flags & SEEK_INDEX_FLAG_COMPLETE) ? ESP_OK : ESP_ERR_NOT_FOUND;
+
+_exit:
+    if (builder) {
+        seek_index_builder_destroy(builder);
+    }
+    audio_free(buf);
+    fclose(f);
+    return ret;
+}
+
+esp_err_t seek_index_lookup(const seek_index_t *index, uint32_t time_ms, seek_index_point_t *point)
+{
+    AUDIO_NULL_CHECK(TAG, index, return ESP_ERR_INVALID_ARG);
+    AUDIO_NULL_CHECK(TAG, point, return ESP_ERR_INVALID_ARG);
+    if (index->magic != SEEK_INDEX_MAGIC || index->num == 0 || index->num > SEEK_INDEX_POINT_NUM
+        || index->sample_rate == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint64_t target = (uint64_t)time_ms * index->sample_rate / 1000;
+    int low = 0;
+    int high = index->num - 1;
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (index->point[mid].sample <= target) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    *point = index->point[low];
+    return ESP_OK;
+}
@@ -22,7 +22,12 @@
  *
  */
 
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#include "esp_timer.h"
 #include "esp_peripherals.h"
 #include "periph_sdcard.h"
 #include "board.h"
@@ -33,6 +38,8 @@
 #include "partition_list.h"
 #include "unity.h"
 #include "sdcard_scan.h"
+#include "media_probe.h"
+#include "seek_index.h"
 
 static const char *TAG = "TEST_PLAYLIST";
 
@@ -520,6 +527,513 @@ TEST_CASE("Create a sdcard playlist and scan sdcard then save the specified url
     TEST_ASSERT_FALSE(esp_periph_set_destroy(set));
 }
 
+static void scan_count_cb(void *user_data, char *url)
+{
+    (*(int *)user_data)++;
+}
+
+static void scan_batch_count_cb(void *user_data, char *url[], int url_num)
+{
+    *(int *)user_data += url_num;
+}
+
+TEST_CASE("Scan a synthetic directory tree with batched callback and parallel workers", "[playlist]")
+{
+    esp_periph_set_handle_t set;
+    TEST_ASSERT_FALSE(initialize_sdcard(&set));
+
+    const int dir_num = 8;
+    const int file_num = 20;
+    char path[64];
+    mkdir("/sdcard/scan_bench", 0777);
+    for (int d = 0; d < dir_num; d++) {
+        snprintf(path, sizeof(path), "/sdcard/scan_bench/album_%02d", d);
+        mkdir(path, 0777);
+        for (int i = 0; i < file_num; i++) {
+            // One file in four is not music
+            snprintf(path, sizeof(path), "/sdcard/scan_bench/album_%02d/%02d.%s", d, i, (i % 4 == 3) ? "jpg" : "MP3");
+            FILE *f = fopen(path, "w");
+            TEST_ASSERT_NOT_NULL(f);
+            fclose(f);
+        }
+    }
+    const char *ext[] = {"mp3", "flac", "wav"};
+    const int expect = dir_num * file_num * 3 / 4;
+
+    int count = 0;
+    int64_t start = esp_timer_get_time();
+    TEST_ASSERT_FALSE(sdcard_scan(scan_count_cb, "/sdcard/scan_bench", 1, ext, 3, &count));
+    ESP_LOGI(TAG, "Scan one by one: %d files in %d ms", count, (int)((esp_timer_get_time() - start) / 1000));
+    TEST_ASSERT_EQUAL(expect, count);
+
+    for (int worker_num = 1; worker_num <= 2; worker_num++) {
+        sdcard_scan_cfg_t cfg = SDCARD_SCAN_CFG_DEFAULT();
+        cfg.path = "/sdcard/scan_bench";
+        cfg.depth = 1;
+        cfg.file_extension = ext;
+        cfg.filter_num = 3;
+        cfg.batch_cb = scan_batch_count_cb;
+        cfg.worker_num = worker_num;
+        cfg.user_data = &count;
+        count = 0;
+        start = esp_timer_get_time();
+        TEST_ASSERT_FALSE(sdcard_scan_with_cfg(&cfg));
+        ESP_LOGI(TAG, "Scan in batch with %d workers: %d files in %d ms", worker_num, count, (int)((esp_timer_get_time() - start) / 1000));
+        TEST_ASSERT_EQUAL(expect, count);
+    }
+
+    for (int d = 0; d < dir_num; d++) {
+        for (int i = 0; i < file_num; i++) {
+            snprintf(path, sizeof(path), "/sdcard/scan_bench/album_%02d/%02d.%s", d, i, (i % 4 == 3) ? "jpg" : "MP3");
+            remove(path);
+        }
+        snprintf(path, sizeof(path), "/sdcard/scan_bench/album_%02d", d);
+        rmdir(path);
+    }
+    rmdir("/sdcard/scan_bench");
+    TEST_ASSERT_FALSE(esp_periph_set_destroy(set));
+}
+
+static void write_le(uint8_t *p, uint32_t v, int n)
+{
+    for (int i = 0; i < n; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static void write_test_wav(const char *path, int sample_rate, int channels, int ms)
+{
+    uint32_t data_size = sample_rate * channels * 2 * ms / 1000;
+    uint8_t hdr[44] = "RIFF----WAVEfmt ";
+    write_le(hdr + 4, 36 + data_size, 4);
+    write_le(hdr + 16, 16, 4);
+    write_le(hdr + 20, 1, 2);
+    write_le(hdr + 22, channels, 2);
+    write_le(hdr + 24, sample_rate, 4);
+    write_le(hdr + 28, sample_rate * channels * 2, 4);
+    write_le(hdr + 32, channels * 2, 2);
+    write_le(hdr + 34, 16, 2);
+    memcpy(hdr + 36, "data", 4);
+    write_le(hdr + 40, data_size, 4);
+    FILE *f = fopen(path, "w");
+    TEST_ASSERT_NOT_NULL(f);
+    fwrite(hdr, 1, sizeof(hdr), f);
+    fseek(f, data_size - 1, SEEK_CUR);
+    fputc(0, f);
+    fclose(f);
+}
+
+static void write_test_mp3(const char *path, const char *title, const char *artist, int frame_num)
+{
+    // ID3v2.3 with Latin-1 title and artist, then MPEG-1 Layer III 128kbps 44.1kHz frames
+    uint8_t tag[128] = "ID3\x03";
+    int pos = 10;
+    const char *id[] = {"TIT2", "TPE1"};
+    const char *text[] = {title, artist};
+    for (int i = 0; i < 2; i++) {
+        int len = strlen(text[i]);
+        memcpy(tag + pos, id[i], 4);
+        tag[pos + 7] = len + 1;
+        memcpy(tag + pos + 11, text[i], len);
+        pos += 11 + len;
+    }
+    tag[9] = pos - 10;
+    uint8_t frame[417] = {0xff, 0xfb, 0x90, 0x00};
+    FILE *f = fopen(path, "w");
+    TEST_ASSERT_NOT_NULL(f);
+    fwrite(tag, 1, pos, f);
+    for (int i = 0; i < frame_num; i++) {
+        fwrite(frame, 1, sizeof(frame), f);
+    }
+    fclose(f);
+}
+
+TEST_CASE("Probe tags and duration of synthetic files and keep metadata in sdcard playlist", "[playlist]")
+{
+    esp_periph_set_handle_t set;
+    TEST_ASSERT_FALSE(initialize_sdcard(&set));
+
+    write_test_wav("/sdcard/probe.wav", 48000, 2, 1500);
+    write_test_mp3("/sdcard/probe.mp3", "Probe Title", "Probe Artist", 100);
+    FILE *f = fopen("/sdcard/probe.txt", "w");
+    TEST_ASSERT_NOT_NULL(f);
+    fputs("not audio", f);
+    fclose(f);
+
+    media_probe_info_t info;
+    TEST_ASSERT_FALSE(media_probe_file("file://sdcard/probe.wav", &info));
+    TEST_ASSERT_EQUAL(MEDIA_PROBE_FORMAT_WAV, info.format);
+    TEST_ASSERT_EQUAL(48000, info.sample_rate);
+    TEST_ASSERT_EQUAL(2, info.channels);
+    TEST_ASSERT_EQUAL(16, info.bits);
+    TEST_ASSERT_EQUAL(1500, info.duration_ms);
+
+    TEST_ASSERT_FALSE(media_probe_file("/sdcard/probe.mp3", &info));
+    TEST_ASSERT_EQUAL(MEDIA_PROBE_FORMAT_MP3, info.format);
+    TEST_ASSERT_EQUAL(44100, info.sample_rate);
+    TEST_ASSERT_EQUAL(128000, info.bitrate);
+    TEST_ASSERT_EQUAL_STRING("Probe Title", info.title);
+    TEST_ASSERT_EQUAL_STRING("Probe Artist", info.artist);
+    // No Xing header, duration comes from bitrate and size
+    TEST_ASSERT_TRUE(info.flags & MEDIA_PROBE_FLAG_ESTIMATED);
+    TEST_ASSERT_INT_WITHIN(20, 100 * 1152 * 1000 / 44100, info.duration_ms);
+
+    TEST_ASSERT_FALSE(media_probe_file("/sdcard/probe.txt", &info));
+    TEST_ASSERT_EQUAL(MEDIA_PROBE_FORMAT_UNKNOWN, info.format);
+    TEST_ASSERT_EQUAL(ESP_FAIL, media_probe_file("/sdcard/not_exist.mp3", &info));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, media_probe_file("http://example.com/probe.mp3", &info));
+
+    playlist_handle_t handle = playlist_create();
+    TEST_ASSERT_NOT_NULL(handle);
+    playlist_operator_handle_t sdcard_handle = NULL;
+    TEST_ASSERT_FALSE(sdcard_list_create(&sdcard_handle));
+    TEST_ASSERT_FALSE(playlist_add(handle, sdcard_handle, 0));
+    TEST_ASSERT_FALSE(playlist_save(handle, "file://sdcard/probe.txt"));
+    TEST_ASSERT_FALSE(sdcard_list_enable_meta(sdcard_handle, true));
+    TEST_ASSERT_FALSE(playlist_save_begin(handle));
+    TEST_ASSERT_FALSE(playlist_save(handle, "file://sdcard/probe.wav"));
+    TEST_ASSERT_FALSE(playlist_save(handle, "file://sdcard/probe.mp3"));
+    TEST_ASSERT_FALSE(playlist_save(handle, "file://sdcard/probe.txt"));
+    TEST_ASSERT_FALSE(playlist_save_commit(handle));
+
+    // Saved before enabled and not recognized have no metadata
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, playlist_get_meta(handle, 0, &info));
+    TEST_ASSERT_FALSE(playlist_get_meta(handle, 1, &info));
+    TEST_ASSERT_EQUAL(MEDIA_PROBE_FORMAT_WAV, info.format);
+    TEST_ASSERT_EQUAL(1500, info.duration_ms);
+    TEST_ASSERT_FALSE(playlist_get_meta(handle, 2, &info));
+    TEST_ASSERT_EQUAL_STRING("Probe Title", info.title);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, playlist_get_meta(handle, 3, &info));
+    TEST_ASSERT_EQUAL(ESP_FAIL, playlist_get_meta(handle, 4, &info));
+
+    TEST_ASSERT_FALSE(playlist_reset(handle));
+    TEST_ASSERT_FALSE(playlist_save(handle, "file://sdcard/probe.txt"));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, playlist_get_meta(handle, 0, &info));
+
+    playlist_operator_handle_t dram_handle = NULL;
+    TEST_ASSERT_FALSE(dram_list_create(&dram_handle));
+    TEST_ASSERT_FALSE(playlist_add(handle, dram_handle, 1));
+    TEST_ASSERT_FALSE(playlist_checkout_by_id(handle, 1));
+    TEST_ASSERT_FALSE(playlist_save(handle, "file://sdcard/probe.wav"));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, playlist_get_meta(handle, 0, &info));
+
+    TEST_ASSERT_FALSE(playlist_destroy(handle));
+    remove("/sdcard/probe.wav");
+    remove("/sdcard/probe.mp3");
+    remove("/sdcard/probe.txt");
+    TEST_ASSERT_FALSE(esp_periph_set_destroy(set));
+}
+
+static int last_meta_id(char *name, int size)
+{
+    struct stat st;
+    for (int id = 255; id >= 0; id--) {
+        snprintf(name, size, "/sdcard/__playlist/_meta%d", id);
+        if (stat(name, &st) == 0) {
+            return id;
+        }
+    }
+    return -1;
+}
+
+static int meta_duration_after_reopen(const char *url)
+{
+    // Playlist created later gets next list id, move records of the last one to it as after reboot
+    char from[64];
+    char to[64];
+    int id = last_meta_id(from, sizeof(from));
+    TEST_ASSERT_TRUE(id >= 0 && id < 255);
+    snprintf(to, sizeof(to), "/sdcard/__playlist/_meta%d", id + 1);
+    TEST_ASSERT_FALSE(rename(from, to));
+
+    playlist_handle_t handle = playlist_create();
+    TEST_ASSERT_NOT_NULL(handle);
+    playlist_operator_handle_t sdcard_handle = NULL;
+    TEST_ASSERT_FALSE(sdcard_list_create(&sdcard_handle));
+    TEST_ASSERT_FALSE(playlist_add(handle, sdcard_handle, 0));
+    TEST_ASSERT_FALSE(sdcard_list_enable_meta(sdcard_handle, true));
+    TEST_ASSERT_FALSE(playlist_save(handle, url));
+    media_probe_info_t info;
+    TEST_ASSERT_FALSE(playlist_get_meta(handle, 0, &info));
+    TEST_ASSERT_FALSE(playlist_destroy(handle));
+    return info.duration_ms;
+}
+
+TEST_CASE("Keep metadata records as probe cache, probe only new or changed files", "[playlist]")
+{
+    esp_periph_set_handle_t set;
+    TEST_ASSERT_FALSE(initialize_sdcard(&set));
+
+    write_test_wav("/sdcard/cache.wav", 48000, 2, 1500);
+    playlist_handle_t handle = playlist_create();
+    TEST_ASSERT_NOT_NULL(handle);
+    playlist_operator_handle_t sdcard_handle = NULL;
+    TEST_ASSERT_FALSE(sdcard_list_create(&sdcard_handle));
+    TEST_ASSERT_FALSE(playlist_add(handle, sdcard_handle, 0));
+    TEST_ASSERT_FALSE(sdcard_list_enable_meta(sdcard_handle, true));
+    TEST_ASSERT_FALSE(playlist_save(handle, "file://sdcard/cache.wav"));
+    TEST_ASSERT_FALSE(playlist_destroy(handle));
+
+    // Same size and modification time: record is taken from cache though content changed
+    struct stat st;
+    TEST_ASSERT_FALSE(stat("/sdcard/cache.wav", &st));
+    write_test_wav("/sdcard/cache.wav", 24000, 2, 3000);
+    struct utimbuf times = {
+        .actime = st.st_atime,
+        .modtime = st.st_mtime,
+    };
+    TEST_ASSERT_FALSE(utime("/sdcard/cache.wav", &times));
+    TEST_ASSERT_EQUAL(1500, meta_duration_after_reopen("file://sdcard/cache.wav"));
+
+    // Size changed: probed again
+    write_test_wav("/sdcard/cache.wav", 48000, 2, 2000);
+    TEST_ASSERT_EQUAL(2000, meta_duration_after_reopen("file://sdcard/cache.wav"));
+
+    char name[64];
+    TEST_ASSERT_TRUE(last_meta_id(name, sizeof(name)) >= 0);
+    remove(name);
+    remove("/sdcard/cache.wav");
+    TEST_ASSERT_FALSE(esp_periph_set_destroy(set));
+}
+
+static void write_test_vbr_mp3(const char *path, int frame_num)
+{
+    // MPEG-1 Layer III 44.1kHz frames, 128kbps and 320kbps in turn
+    uint8_t frame[1044] = {0xff, 0xfb, 0x90, 0x00};
+    FILE *f = fopen(path, "w");
+    TEST_ASSERT_NOT_NULL(f);
+    for (int i = 0; i < frame_num; i++) {
+        frame[2] = (i % 2) ? 0xe0 : 0x90;
+        fwrite(frame, 1, (i % 2) ? 1044 : 417, f);
+    }
+    fclose(f);
+}
+
+TEST_CASE("Build seek index of VBR MP3 and keep it in sdcard playlist", "[playlist]")
+{
+    esp_periph_set_handle_t set;
+    TEST_ASSERT_FALSE(initialize_sdcard(&set));
+
+    write_test_vbr_mp3("/sdcard/seek.mp3", 1000);
+    FILE *f = fopen("/sdcard/seek.txt", "w");
+    TEST_ASSERT_NOT_NULL(f);
+    fputs("not audio", f);
+    fclose(f);
+
+    seek_index_t *index = calloc(1, sizeof(seek_index_t));
+    seek_index_t *saved = calloc(1, sizeof(seek_index_t));
+    TEST_ASSERT_NOT_NULL(index);
+    TEST_ASSERT_NOT_NULL(saved);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, seek_index_build_file("/sdcard/seek.txt", index));
+    int64_t start = esp_timer_get_time();
+    TEST_ASSERT_FALSE(seek_index_build_file("file://sdcard/seek.mp3", index));
+    ESP_LOGI(TAG, "Index built in %d ms", (int)((esp_timer_get_time() - start) / 1000));
+    TEST_ASSERT_TRUE(index->flags & SEEK_INDEX_FLAG_COMPLETE);
+    TEST_ASSERT_EQUAL(MEDIA_PROBE_FORMAT_MP3, index->format);
+    TEST_ASSERT_EQUAL(44100, index->sample_rate);
+    TEST_ASSERT_EQUAL(1000 * 1152, index->total_samples);
+    TEST_ASSERT_EQUAL(500 * (417 + 1044), index->end_pos);
+    TEST_ASSERT_GREATER_THAN(1, index->num);
+    // Every point is at start of a frame whatever bitrate it has
+    for (int i = 0; i < index->num; i++) {
+        int frame = index->point[i].sample / 1152;
+        TEST_ASSERT_EQUAL(0, index->point[i].sample % 1152);
+        TEST_ASSERT_EQUAL(frame / 2 * (417 + 1044) + (frame % 2) * 417, index->point[i].pos);
+    }
+    seek_index_point_t point;
+    TEST_ASSERT_FALSE(seek_index_lookup(index, 20000, &point));
+    TEST_ASSERT_LESS_OR_EQUAL(20000 * 441 / 10, point.sample);
+    TEST_ASSERT_GREATER_THAN(20000 * 441 / 10 - index->interval - 1152, point.sample);
+
+    playlist_handle_t handle = playlist_create();
+    TEST_ASSERT_NOT_NULL(handle);
+    playlist_operator_handle_t sdcard_handle = NULL;
+    TEST_ASSERT_FALSE(sdcard_list_create(&sdcard_handle));
+    TEST_ASSERT_FALSE(playlist_add(handle, sdcard_handle, 0));
+    TEST_ASSERT_FALSE(playlist_save(handle, "file://sdcard/seek.txt"));
+    TEST_ASSERT_FALSE(playlist_save(handle, "file://sdcard/seek.mp3"));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, playlist_get_seek_index(handle, 1, saved));
+    TEST_ASSERT_FALSE(playlist_save_seek_index(handle, 1, index));
+    TEST_ASSERT_FALSE(playlist_get_seek_index(handle, 1, saved));
+    TEST_ASSERT_EQUAL_MEMORY(index, saved, sizeof(seek_index_t));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, playlist_get_seek_index(handle, 0, saved));
+    TEST_ASSERT_EQUAL(ESP_FAIL, playlist_save_seek_index(handle, 2, index));
+
+    TEST_ASSERT_FALSE(playlist_reset(handle));
+    TEST_ASSERT_FALSE(playlist_save(handle, "file://sdcard/seek.mp3"));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, playlist_get_seek_index(handle, 0, saved));
+
+    playlist_operator_handle_t dram_handle = NULL;
+    TEST_ASSERT_FALSE(dram_list_create(&dram_handle));
+    TEST_ASSERT_FALSE(playlist_add(handle, dram_handle, 1));
+    TEST_ASSERT_FALSE(playlist_checkout_by_id(handle, 1));
+    TEST_ASSERT_FALSE(playlist_save(handle, "file://sdcard/seek.mp3"));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, playlist_save_seek_index(handle, 0, index));
+
+    TEST_ASSERT_FALSE(playlist_destroy(handle));
+    free(index);
+    free(saved);
+    remove("/sdcard/seek.mp3");
+    remove("/sdcard/seek.txt");
+    TEST_ASSERT_FALSE(esp_periph_set_destroy(set));
+}
+
+TEST_CASE("Save urls to sdcard playlist one by one and in batch, compare inserts per second", "[playlist]")
+{
+    esp_periph_set_handle_t set;
+    TEST_ASSERT_FALSE(initialize_sdcard(&set));
+
+    const int url_num = 200;
+    char url[64];
+    for (int batch = 0; batch < 2; batch++) {
+        playlist_handle_t handle = playlist_create();
+        TEST_ASSERT_NOT_NULL(handle);
+        playlist_operator_handle_t sdcard_handle = NULL;
+        TEST_ASSERT_FALSE(sdcard_list_create(&sdcard_handle));
+        TEST_ASSERT_FALSE(playlist_add(handle, sdcard_handle, 0));
+
+        int64_t start = esp_timer_get_time();
+        if (batch) {
+            TEST_ASSERT_FALSE(playlist_save_begin(handle));
+        }
+        for (int i = 0; i < url_num; i++) {
+            snprintf(url, sizeof(url), "file://sdcard/music/track_%04d.mp3", i);
+            TEST_ASSERT_FALSE(playlist_save(handle, url));
+        }
+        if (batch) {
+            TEST_ASSERT_FALSE(playlist_save_commit(handle));
+        }
+        int64_t cost = esp_timer_get_time() - start;
+        ESP_LOGI(TAG, "%s save: %d urls in %d ms, %d inserts/s", batch ? "Batch" : "Single", url_num,
+                 (int)(cost / 1000), (int)(url_num * 1000000LL / (cost ? cost : 1)));
+
+        char *cur = NULL;
+        TEST_ASSERT_EQUAL(url_num, playlist_get_current_list_url_num(handle));
+        TEST_ASSERT_FALSE(playlist_choose(handle, url_num - 1, &cur));
+        TEST_ASSERT_EQUAL_STRING(url, cur);
+        TEST_ASSERT_FALSE(playlist_destroy(handle));
+    }
+
+    TEST_ASSERT_FALSE(esp_periph_set_destroy(set));
+}
+
+TEST_CASE("Import 10k urls to playlists and skip duplicates with playlist_exist", "[playlist]")
+{
+    esp_periph_set_handle_t set;
+    TEST_ASSERT_FALSE(initialize_sdcard(&set));
+
+    // One url in ten is a duplicate, playlist_exist is called for each of them
+    const int url_num = 10000;
+    const int unique_num = 9000;
+    char url[64];
+    for (int type = 0; type < 2; type++) {
+        playlist_handle_t handle = playlist_create();
+        TEST_ASSERT_NOT_NULL(handle);
+        playlist_operator_handle_t list_handle = NULL;
+        if (type == 0) {
+            TEST_ASSERT_FALSE(dram_list_create(&list_handle));
+        } else {
+            TEST_ASSERT_FALSE(sdcard_list_create(&list_handle));
+        }
+        TEST_ASSERT_FALSE(playlist_add(handle, list_handle, 0));
+
+        int added = 0;
+        int64_t start = esp_timer_get_time();
+        TEST_ASSERT_FALSE(playlist_save_begin(handle));
+        for (int i = 0; i < url_num; i++) {
+            snprintf(url, sizeof(url), "file://sdcard/music/album_%02d/track_%04d.mp3", (i % unique_num) % 50, i % unique_num);
+            if (playlist_exist(handle, url) == false) {
+                TEST_ASSERT_FALSE(playlist_save(handle, url));
+                added++;
+            }
+        }
+        // Last unique URL may be still buffered in batch
+        TEST_ASSERT_TRUE(playlist_exist(handle, "file://sdcard/music/album_49/track_8999.mp3"));
+        TEST_ASSERT_FALSE(playlist_save_commit(handle));
+        int64_t cost = esp_timer_get_time() - start;
+        ESP_LOGI(TAG, "%s import: %d urls, %d added in %d ms", type ? "Sdcard" : "Dram", url_num, added, (int)(cost / 1000));
+
+        TEST_ASSERT_EQUAL(unique_num, added);
+        TEST_ASSERT_EQUAL(unique_num, playlist_get_current_list_url_num(handle));
+        TEST_ASSERT_TRUE(playlist_exist(handle, "file://sdcard/music/album_07/track_0107.mp3"));
+        TEST_ASSERT_FALSE(playlist_exist(handle, "file://sdcard/music/album_07/track_0108.mp3"));
+        TEST_ASSERT_FALSE(playlist_destroy(handle));
+    }
+
+    TEST_ASSERT_FALSE(esp_periph_set_destroy(set));
+}
+
+TEST_CASE("Play a playlist in shuffle order and different repeat modes", "[playlist]")
+{
+    playlist_handle_t handle = playlist_create();
+    TEST_ASSERT_NOT_NULL(handle);
+    playlist_operator_handle_t dram_handle = NULL;
+    TEST_ASSERT_FALSE(dram_list_create(&dram_handle));
+    TEST_ASSERT_FALSE(playlist_add(handle, dram_handle, 0));
+
+    const int url_num = 50;
+    char url[32];
+    for (int i = 0; i < url_num; i++) {
+        snprintf(url, sizeof(url), "url %d", i);
+        TEST_ASSERT_FALSE(playlist_save(handle, url));
+    }
+
+    char *cur = NULL;
+    TEST_ASSERT_FALSE(playlist_choose(handle, url_num - 1, &cur));
+    TEST_ASSERT_FALSE(playlist_set_mode(handle, false, PLAYLIST_REPEAT_NONE));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, playlist_next(handle, 1, &cur));
+    TEST_ASSERT_FALSE(playlist_set_mode(handle, false, PLAYLIST_REPEAT_ONE));
+    TEST_ASSERT_FALSE(playlist_next(handle, 1, &cur));
+    TEST_ASSERT_EQUAL(url_num - 1, playlist_get_current_list_url_id(handle));
+
+    // Every url is played once in a round of shuffle
+    bool played[url_num];
+    memset(played, 0, sizeof(played));
+    played[url_num - 1] = true;
+    TEST_ASSERT_FALSE(playlist_set_mode(handle, true, PLAYLIST_REPEAT_ALL));
+    for (int i = 1; i < url_num; i++) {
+        TEST_ASSERT_FALSE(playlist_next(handle, 1, &cur));
+        int id = playlist_get_current_list_url_id(handle);
+        TEST_ASSERT_FALSE(played[id]);
+        played[id] = true;
+    }
+    TEST_ASSERT_FALSE(playlist_next(handle, 1, &cur));
+    TEST_ASSERT_EQUAL(url_num - 1, playlist_get_current_list_url_id(handle));
+
+    TEST_ASSERT_FALSE(playlist_destroy(handle));
+}
+
+TEST_CASE("Save thousands of urls sharing directories to flash playlist", "[playlist]")
+{
+    playlist_handle_t handle = playlist_create();
+    TEST_ASSERT_NOT_NULL(handle);
+    playlist_operator_handle_t flash_handle = NULL;
+    TEST_ASSERT_FALSE(flash_list_create(&flash_handle));
+    TEST_ASSERT_FALSE(playlist_add(handle, flash_handle, 0));
+
+    // Directory is kept once in directory table, only file names are written to nvs
+    const int url_num = 2000;
+    char url[64];
+    char *cur = NULL;
+    TEST_ASSERT_FALSE(playlist_save_begin(handle));
+    for (int i = 0; i < url_num; i++) {
+        snprintf(url, sizeof(url), "file://sdcard/Music/Artist %d/Album/%04d.mp3", i % 10, i);
+        TEST_ASSERT_FALSE(playlist_save(handle, url));
+    }
+    TEST_ASSERT_FALSE(playlist_save_commit(handle));
+    TEST_ASSERT_EQUAL(url_num, playlist_get_current_list_url_num(handle));
+
+    for (int i = 0; i < url_num; i += 97) {
+        snprintf(url, sizeof(url), "file://sdcard/Music/Artist %d/Album/%04d.mp3", i % 10, i);
+        TEST_ASSERT_FALSE(playlist_choose(handle, i, &cur));
+        TEST_ASSERT_EQUAL_STRING(url, cur);
+    }
+    TEST_ASSERT_TRUE(playlist_exist(handle, "file://sdcard/Music/Artist 3/Album/1993.mp3"));
+    TEST_ASSERT_FALSE(playlist_exist(handle, "file://sdcard/Music/Artist 3/Album/1994.mp3"));
+
+    TEST_ASSERT_FALSE(playlist_destroy(handle));
+}
+
 
 /**
  * Abnormal operation and stress test